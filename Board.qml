@@ -5,6 +5,7 @@ import disboard.impl
 Item {
     readonly property alias controller: boardImpl.controller
     readonly property alias pgn: boardImpl.pgn
+    readonly property alias viewStats: boardImpl.viewStats
 
     BoardImpl {
         readonly property int boardSize: pieceSize << 3
@@ -0,0 +1,395 @@
+#include "boardbench.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJSValue>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iterator>
+
+#include "controller.h"
+#include "pgn.h"
+#include "selfplay.h"
+
+namespace {
+    QJsonObject summary(QVector<double> values) {
+        if (values.isEmpty()) return {};
+        std::sort(values.begin(), values.end());
+
+        double total = 0;
+        for (auto value: values) total += value;
+        auto at = [&](double fraction) {
+            auto idx = std::min<qsizetype>(values.size() - 1, static_cast<qsizetype>(fraction * values.size()));
+            return values[idx];
+        };
+        return {
+                {QStringLiteral("mean"), total / values.size()},
+                {QStringLiteral("p50"), at(0.5)},
+                {QStringLiteral("p95"), at(0.95)},
+                {QStringLiteral("p99"), at(0.99)},
+                {QStringLiteral("max"), values.last()},
+                {QStringLiteral("total"), total},
+        };
+    }
+
+    double milliseconds(std::clock_t clocks) {
+        return 1000.0 * static_cast<double>(clocks) / CLOCKS_PER_SEC;
+    }
+}
+
+BoardBench::BoardBench(QQmlEngine &engine, QQuickWindow &window, BenchOptions options)
+        : window(window), options(std::move(options)), component(&engine), rng(this->options.seed) {
+    // Swapped on the render thread with the threaded render loop
+    QObject::connect(&window, &QQuickWindow::frameSwapped, &counter, [this]() {
+        frames.fetch_add(1);
+    }, Qt::DirectConnection);
+}
+
+bool BoardBench::load(QString &error) {
+    if (options.pgn.isEmpty()) {
+        disboard::SelfPlayOptions play;
+        play.games = 1;
+        play.maxPlies = options.plies;
+        play.seed = options.seed;
+        game = disboard::SelfPlay(play).play(0).moves;
+    } else {
+        QFile file(options.pgn);
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = QStringLiteral("cannot open %1").arg(options.pgn);
+            return false;
+        }
+        disboard::PgnSplitter splitter(&file);
+        std::optional<disboard::PgnGame> parsed;
+        if (auto text = splitter.next()) parsed = disboard::PgnGame::parse(*text, &error);
+        if (!parsed.has_value()) {
+            error = error.isEmpty() ? QStringLiteral("no game in %1").arg(options.pgn) :
+                    QStringLiteral("%1: %2").arg(options.pgn, error);
+            return false;
+        }
+        if (parsed->start.hash() != disboard::Position().hash()) {
+            error = QStringLiteral("the game in %1 does not start from the standard position").arg(options.pgn);
+            return false;
+        }
+        game = parsed->mainlineMoves();
+    }
+    if (game.isEmpty()) {
+        error = QStringLiteral("the game has no moves");
+        return false;
+    }
+
+    component.setData("import QtQuick\nimport disboard\nBoard {}\n", QUrl());
+    if (component.isError()) {
+        error = component.errorString();
+        return false;
+    }
+    return true;
+}
+
+QVector<QJsonObject> BoardBench::run() {
+    results.clear();
+    phaseLoad();
+    if (boards.isEmpty()) return results;
+
+    phaseReplay();
+    phaseScrub();
+    phaseSelect();
+    phasePromotion();
+    phaseResize();
+    return results;
+}
+
+BoardBench::ViewStats BoardBench::viewStats() const {
+    ViewStats stats;
+    for (const auto &board: boards) {
+        if (!board.item) continue;
+        // A JS object held by a var property, counted in place by BoardView.mjs
+        auto value = board.item->property("viewStats");
+        auto counts = value.metaType() == QMetaType::fromType<QJSValue>() ?
+                      value.value<QJSValue>().toVariant().toMap() : value.toMap();
+        stats.created += counts.value(QStringLiteral("created")).toLongLong();
+        stats.destroyed += counts.value(QStringLiteral("destroyed")).toLongLong();
+        stats.moved += counts.value(QStringLiteral("moved")).toLongLong();
+        stats.resets += counts.value(QStringLiteral("resets")).toLongLong();
+    }
+    return stats;
+}
+
+void BoardBench::begin(Phase &phase, const QString &name) {
+    phase.name = name;
+    phase.viewBefore = viewStats();
+    phase.signalsBefore = counter.counts();
+}
+
+void BoardBench::end(Phase &phase) {
+    auto view = viewStats();
+    QJsonObject pieces{
+            {QStringLiteral("created"), view.created - phase.viewBefore.created},
+            {QStringLiteral("destroyed"), view.destroyed - phase.viewBefore.destroyed},
+            {QStringLiteral("moved"), view.moved - phase.viewBefore.moved},
+            {QStringLiteral("resets"), view.resets - phase.viewBefore.resets},
+    };
+
+    QJsonObject signalCounts;
+    qint64 notifications = 0;
+    const auto counts = counter.counts();
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        auto emitted = it.value() - phase.signalsBefore.value(it.key());
+        if (emitted == 0) continue;
+        signalCounts.insert(QString::fromLatin1(it.key()), emitted);
+        notifications += emitted;
+    }
+
+    results.push_back({
+            {QStringLiteral("name"), phase.name},
+            {QStringLiteral("steps"), static_cast<int>(phase.cpuMs.size())},
+            {QStringLiteral("missedFrames"), phase.missedFrames},
+            {QStringLiteral("cpuMs"), summary(phase.cpuMs)},
+            {QStringLiteral("wallMs"), summary(phase.wallMs)},
+            {QStringLiteral("guiMs"), summary(phase.guiMs)},
+            {QStringLiteral("pieces"), pieces},
+            {QStringLiteral("notifications"), notifications},
+            {QStringLiteral("signals"), signalCounts},
+    });
+}
+
+void BoardBench::step(Phase &phase, const std::function<void()> &action,
+                      const std::function<bool()> &settled) {
+    auto cpu = std::clock();
+    QElapsedTimer timer;
+    timer.start();
+
+    action();
+    auto guiNs = timer.nsecsElapsed();
+    auto ok = !settled || waitUntil(settled);
+    ok = waitForFrame() && ok;
+
+    phase.cpuMs.push_back(milliseconds(std::clock() - cpu));
+    phase.wallMs.push_back(static_cast<double>(timer.nsecsElapsed()) / 1e6);
+    phase.guiMs.push_back(static_cast<double>(guiNs) / 1e6);
+    if (!ok) phase.missedFrames += 1;
+}
+
+void BoardBench::settle(const std::function<void()> &action, const std::function<bool()> &settled) {
+    action();
+    if (settled) waitUntil(settled);
+    waitForFrame();
+}
+
+bool BoardBench::waitForFrame() {
+    // Anything the step changed is synchronized into the frame after this
+    auto before = frames.load();
+    window.update();
+    return waitUntil([&]() { return frames.load() > before; });
+}
+
+bool BoardBench::waitUntil(const std::function<bool()> &done) {
+    QElapsedTimer timer;
+    timer.start();
+    // Wakes the loop below when nothing else would
+    QTimer wake;
+    wake.start(10);
+
+    while (!done()) {
+        if (timer.elapsed() >= options.frameTimeoutMs) return false;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+void BoardBench::forEach(const std::function<void(Controller &)> &action) {
+    for (const auto &board: boards) {
+        if (board.controller) action(*board.controller);
+    }
+}
+
+bool BoardBench::allAtPly(int ply) const {
+    return std::all_of(boards.begin(), boards.end(), [ply](const Board &board) {
+        return !board.controller || board.controller->ply() == ply;
+    });
+}
+
+void BoardBench::click(Controller &controller, disboard::Square square) {
+    auto size = static_cast<float>(controller.pieceSize());
+    controller.coordClicked((static_cast<float>(square.file()) + 0.5f) * size,
+                            (static_cast<float>(7 - square.rank()) + 0.5f) * size);
+}
+
+void BoardBench::layout(int size) {
+    auto columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(boards.size()))));
+    auto rows = (static_cast<int>(boards.size()) + columns - 1) / columns;
+    for (qsizetype idx = 0; idx < boards.size(); idx += 1) {
+        auto item = boards[idx].item;
+        if (!item) continue;
+        item->setPosition(QPointF(static_cast<qreal>(idx % columns * size), static_cast<qreal>(idx / columns * size)));
+        item->setSize(QSizeF(size, size));
+    }
+    window.resize(columns * size, rows * size);
+}
+
+void BoardBench::resetGame() {
+    auto fen = QString::fromStdString(disboard::Position().fen());
+    forEach([&](Controller &controller) {
+        controller.loadFen(fen);
+        controller.appendMainline(game);
+        gamePlies = static_cast<int>(controller.board().mainlineNodes(controller.root()).size());
+    });
+}
+
+void BoardBench::phaseLoad() {
+    Phase phase;
+    begin(phase, QStringLiteral("load"));
+    step(phase, [this]() {
+        for (int idx = 0; idx < options.boards; idx += 1) {
+            auto item = qobject_cast<QQuickItem *>(component.create());
+            if (!item) {
+                qWarning() << "Cannot create board:" << component.errorString();
+                return;
+            }
+            item->setParent(window.contentItem());
+            item->setParentItem(window.contentItem());
+
+            auto controller = qobject_cast<Controller *>(item->property("controller").value<QObject *>());
+            if (controller) counter.watch(controller);
+            boards.push_back({item, controller});
+        }
+        layout(options.size);
+    });
+    end(phase);
+}
+
+void BoardBench::phaseReplay() {
+    settle([this]() {
+        resetGame();
+        forEach([](Controller &controller) { controller.seekToPly(0); });
+    }, [this]() { return allAtPly(0); });
+
+    Phase phase;
+    begin(phase, QStringLiteral("replay"));
+    for (int ply = 1; ply <= gamePlies; ply += 1) {
+        step(phase, [this]() {
+            forEach([](Controller &controller) { controller.nextMove(); });
+        });
+    }
+    end(phase);
+}
+
+void BoardBench::phaseScrub() {
+    Phase phase;
+    begin(phase, QStringLiteral("scrub"));
+    auto ply = gamePlies;
+    for (int idx = 0; idx < options.scrubs; idx += 1) {
+        auto backwards = (idx / 3) % 2 == 0;
+        switch (idx % 3) {
+            case 0: {
+                // Dragging along the move list
+                auto target = static_cast<int>(rng() % static_cast<uint64_t>(gamePlies + 1));
+                step(phase, [&]() {
+                    forEach([target](Controller &controller) { controller.seekToPly(target); });
+                }, [&]() { return allAtPly(target); });
+                ply = target;
+                break;
+            }
+            case 1: {
+                // A wheel burst, folded into one jump
+                auto delta = backwards ? -1 : 1;
+                auto target = std::clamp(ply + 8 * delta, 0, gamePlies);
+                step(phase, [&]() {
+                    forEach([delta](Controller &controller) {
+                        for (int tick = 0; tick < 8; tick += 1) controller.seek(delta);
+                    });
+                }, [&]() { return allAtPly(target); });
+                ply = target;
+                break;
+            }
+            default:
+                step(phase, [&]() {
+                    forEach([backwards](Controller &controller) {
+                        if (backwards) {
+                            controller.prevMove();
+                        } else {
+                            controller.nextMove();
+                        }
+                    });
+                });
+                ply = std::clamp(ply + (backwards ? -1 : 1), 0, gamePlies);
+                break;
+        }
+    }
+    end(phase);
+}
+
+void BoardBench::phaseSelect() {
+    auto middle = gamePlies / 2;
+    settle([&]() {
+        forEach([middle](Controller &controller) { controller.seekToPly(middle); });
+    }, [&]() { return allAtPly(middle); });
+
+    Phase phase;
+    begin(phase, QStringLiteral("select"));
+    for (int idx = 0; idx < options.selections; idx += 1) {
+        // All boards show the same position
+        const auto &first = *boards.front().controller;
+        auto occupied = first.board().position(first.curNode()).occupied();
+        auto skip = rng() % static_cast<uint64_t>(disboard::bitboard::count(occupied));
+        for (uint64_t n = 0; n < skip; n += 1) disboard::bitboard::popLsb(occupied);
+        auto square = disboard::bitboard::lsb(occupied);
+
+        // Selects, then deselects with a second click on the same square
+        for (int twice = 0; twice < 2; twice += 1) {
+            step(phase, [&]() {
+                forEach([&](Controller &controller) { click(controller, square); });
+            });
+        }
+    }
+    end(phase);
+}
+
+void BoardBench::phasePromotion() {
+    static const auto fen = QStringLiteral("8/P6k/8/8/8/8/8/K7 w - - 0 1");
+    auto from = disboard::Square(0, 6);
+    auto to = disboard::Square(0, 7);
+    auto queen = disboard::Piece(disboard::Color::White, disboard::Role::Queen);
+
+    auto promoting = [this](bool pending) {
+        return std::all_of(boards.begin(), boards.end(), [pending](const Board &board) {
+            return !board.controller || board.controller->promotionSq().isValid() == pending;
+        });
+    };
+
+    Phase phase;
+    begin(phase, QStringLiteral("promotion"));
+    for (int idx = 0; idx < options.promotions; idx += 1) {
+        step(phase, [&]() {
+            forEach([&](Controller &controller) { controller.loadFen(fen); });
+        });
+        step(phase, [&]() {
+            forEach([&](Controller &controller) { click(controller, from); });
+        });
+        // Opens the promotion window
+        step(phase, [&]() {
+            forEach([&](Controller &controller) { click(controller, to); });
+        }, [&]() { return promoting(true); });
+        step(phase, [&]() {
+            forEach([&](Controller &controller) { controller.promote(queen); });
+        }, [&]() { return promoting(false); });
+    }
+    end(phase);
+}
+
+void BoardBench::phaseResize() {
+    static const double factors[] = {0.75, 0.5, 0.75, 1.0, 1.25, 1.0};
+
+    Phase phase;
+    begin(phase, QStringLiteral("resize"));
+    for (int idx = 0; idx < options.resizes; idx += 1) {
+        auto size = static_cast<int>(options.size * factors[idx % std::size(factors)]);
+        step(phase, [&]() { layout(size); });
+    }
+    end(phase);
+    settle([this]() { layout(options.size); });
+}
@@ -0,0 +1,131 @@
+#ifndef DISBOARD_BOARDBENCH_H
+#define DISBOARD_BOARDBENCH_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+#include <random>
+
+#include "move.h"
+#include "signalcounter.h"
+
+class Controller;
+
+struct BenchOptions {
+    // Boards on screen at once, every step acts on all of them
+    int boards = 1;
+    // Edge of one board in pixels
+    int size = 480;
+
+    // Mainline of the replayed game, from the standard position. Empty
+    // plays a random game of `plies` plies from `seed`.
+    QString pgn;
+    int plies = 200;
+    uint64_t seed = 1;
+
+    int scrubs = 100;
+    int selections = 100;
+    int promotions = 20;
+    int resizes = 40;
+
+    // A step whose frame does not come within this counts as missed
+    int frameTimeoutMs = 2000;
+};
+
+// Drives Board.qml through a scripted session and times every step from
+// the first call into the board to the frame that shows it. The window is
+// expected on the offscreen platform, so no vsync paces the frames and
+// the figures are the work done, not the refresh rate.
+class BoardBench {
+public:
+    BoardBench(QQmlEngine &engine, QQuickWindow &window, BenchOptions options);
+
+    // Compiles Board.qml and prepares the game, the boards are created by
+    // the first phase. False with `error` set when either fails.
+    bool load(QString &error);
+
+    // Length of the replayed game
+    [[nodiscard]] int plies() const { return gamePlies; }
+
+    // Runs every phase in order, one JSON object each
+    [[nodiscard]] QVector<QJsonObject> run();
+
+private:
+    struct ViewStats {
+        qint64 created = 0;
+        qint64 destroyed = 0;
+        qint64 moved = 0;
+        qint64 resets = 0;
+    };
+
+    struct Phase {
+        QString name;
+        // Per step, in milliseconds: process CPU time, wall time until the
+        // frame was swapped, and wall time of the calls into the board alone
+        QVector<double> cpuMs;
+        QVector<double> wallMs;
+        QVector<double> guiMs;
+        int missedFrames = 0;
+
+        ViewStats viewBefore;
+        QHash<QByteArray, qint64> signalsBefore;
+    };
+
+    struct Board {
+        QPointer<QQuickItem> item;
+        QPointer<Controller> controller;
+    };
+
+    QQuickWindow &window;
+    BenchOptions options;
+    QQmlComponent component;
+
+    QVector<Board> boards;
+    QVector<disboard::Move> game;
+    int gamePlies = 0;
+    QVector<QJsonObject> results;
+
+    SignalCounter counter;
+    std::atomic<qint64> frames{0};
+    std::mt19937_64 rng;
+
+    [[nodiscard]] ViewStats viewStats() const;
+
+    void begin(Phase &phase, const QString &name);
+    void end(Phase &phase);
+
+    // Runs `action`, waits for `settled` when given, then for the next
+    // frame, and records the step in `phase`
+    void step(Phase &phase, const std::function<void()> &action,
+              const std::function<bool()> &settled = {});
+    // Same without recording, to set up the next steps
+    void settle(const std::function<void()> &action, const std::function<bool()> &settled = {});
+    bool waitForFrame();
+    bool waitUntil(const std::function<bool()> &done);
+
+    void forEach(const std::function<void(Controller &)> &action);
+    [[nodiscard]] bool allAtPly(int ply) const;
+    void click(Controller &controller, disboard::Square square);
+    void layout(int size);
+    void resetGame();
+
+    void phaseLoad();
+    void phaseReplay();
+    void phaseScrub();
+    void phaseSelect();
+    void phasePromotion();
+    void phaseResize();
+};
+
+
+#endif //DISBOARD_BOARDBENCH_H
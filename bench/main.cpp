@@ -0,0 +1,193 @@
+#include <QCommandLineParser>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QQmlEngine>
+#include <QQuickWindow>
+#include <QSGRendererInterface>
+#include <QTextStream>
+#include <QtQml/qqmlextensionplugin.h>
+
+#include "boardbench.h"
+
+Q_IMPORT_QML_PLUGIN(disboardPlugin)
+
+namespace {
+    double figure(const QJsonObject &phase, const QString &group, const QString &key) {
+        return phase.value(group).toObject().value(key).toDouble();
+    }
+
+    // Figures worse than in the baseline run, per phase
+    QStringList regressions(const QJsonObject &current, const QJsonObject &baseline, double tolerance) {
+        QHash<QString, QJsonObject> before;
+        for (const auto &value: baseline.value(QStringLiteral("phases")).toArray()) {
+            auto phase = value.toObject();
+            before.insert(phase.value(QStringLiteral("name")).toString(), phase);
+        }
+
+        QStringList found;
+        for (const auto &key: {QStringLiteral("graphics"), QStringLiteral("boards"),
+                               QStringLiteral("size"), QStringLiteral("plies")}) {
+            if (current.value(key) != baseline.value(key)) {
+                found.push_back(QStringLiteral("the baseline ran another workload, %1 differs").arg(key));
+            }
+        }
+        if (!found.isEmpty()) return found;
+
+        for (const auto &value: current.value(QStringLiteral("phases")).toArray()) {
+            auto phase = value.toObject();
+            auto name = phase.value(QStringLiteral("name")).toString();
+            if (!before.contains(name)) continue;
+            const auto &old = before[name];
+
+            auto cpu = figure(phase, QStringLiteral("cpuMs"), QStringLiteral("p95"));
+            auto oldCpu = figure(old, QStringLiteral("cpuMs"), QStringLiteral("p95"));
+            if (cpu > oldCpu * (1 + tolerance)) {
+                found.push_back(QStringLiteral("%1: p95 CPU %2 ms, was %3 ms")
+                                        .arg(name).arg(cpu, 0, 'f', 3).arg(oldCpu, 0, 'f', 3));
+            }
+
+            // The workload is deterministic, so counts only change with the code
+            for (const auto &key: {QStringLiteral("created"), QStringLiteral("destroyed")}) {
+                auto count = figure(phase, QStringLiteral("pieces"), key);
+                auto oldCount = figure(old, QStringLiteral("pieces"), key);
+                if (count > oldCount) {
+                    found.push_back(QStringLiteral("%1: %2 %3 pieces, was %4").arg(name).arg(count).arg(key).arg(oldCount));
+                }
+            }
+            auto notifications = phase.value(QStringLiteral("notifications")).toDouble();
+            auto oldNotifications = old.value(QStringLiteral("notifications")).toDouble();
+            if (notifications > oldNotifications) {
+                found.push_back(QStringLiteral("%1: %2 notifications, was %3")
+                                        .arg(name).arg(notifications).arg(oldNotifications));
+            }
+        }
+        return found;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // No display needed, and no vsync to pace the frames
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("disboard-bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Frame times of the board view under a scripted session"));
+    parser.addHelpOption();
+
+    QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output")},
+                                    QStringLiteral("Write the JSON report to <file> instead of standard output."),
+                                    QStringLiteral("file"));
+    QCommandLineOption graphicsOption(QStringLiteral("graphics"),
+                                      QStringLiteral("Scene graph backend: software or opengl."),
+                                      QStringLiteral("api"), QStringLiteral("software"));
+    QCommandLineOption boardsOption(QStringLiteral("boards"),
+                                    QStringLiteral("Boards on screen at once."),
+                                    QStringLiteral("n"), QStringLiteral("1"));
+    QCommandLineOption sizeOption(QStringLiteral("size"),
+                                  QStringLiteral("Edge of one board in pixels."),
+                                  QStringLiteral("px"), QStringLiteral("480"));
+    QCommandLineOption pgnOption(QStringLiteral("pgn"),
+                                 QStringLiteral("Replay the first game of <file> instead of a random one."),
+                                 QStringLiteral("file"));
+    QCommandLineOption pliesOption(QStringLiteral("plies"),
+                                   QStringLiteral("Length of the random game."),
+                                   QStringLiteral("n"), QStringLiteral("200"));
+    QCommandLineOption seedOption(QStringLiteral("seed"),
+                                  QStringLiteral("Seed of the random game and of the workload."),
+                                  QStringLiteral("n"), QStringLiteral("1"));
+    QCommandLineOption baselineOption(QStringLiteral("baseline"),
+                                      QStringLiteral("Compare with the report in <file>, exit 1 on regressions."),
+                                      QStringLiteral("file"));
+    QCommandLineOption toleranceOption(QStringLiteral("tolerance"),
+                                       QStringLiteral("Allowed p95 CPU time increase over the baseline, in percent."),
+                                       QStringLiteral("percent"), QStringLiteral("10"));
+
+    parser.addOptions({outputOption, graphicsOption, boardsOption, sizeOption, pgnOption,
+                       pliesOption, seedOption, baselineOption, toleranceOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&](const QString &message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    bool ok = true;
+    BenchOptions options;
+    options.boards = parser.value(boardsOption).toInt(&ok);
+    if (!ok || options.boards <= 0) return fail(QStringLiteral("--boards needs a positive count"));
+    options.size = parser.value(sizeOption).toInt(&ok);
+    if (!ok || options.size < 64) return fail(QStringLiteral("--size needs at least 64 pixels"));
+    options.plies = parser.value(pliesOption).toInt(&ok);
+    if (!ok || options.plies <= 0) return fail(QStringLiteral("--plies needs a positive count"));
+    options.seed = parser.value(seedOption).toULongLong(&ok);
+    if (!ok) return fail(QStringLiteral("--seed needs a number"));
+    options.pgn = parser.value(pgnOption);
+    auto tolerance = parser.value(toleranceOption).toDouble(&ok);
+    if (!ok || tolerance < 0) return fail(QStringLiteral("--tolerance needs a percentage"));
+
+    auto graphics = parser.value(graphicsOption);
+    if (graphics == QStringLiteral("software")) {
+        QQuickWindow::setGraphicsApi(QSGRendererInterface::Software);
+    } else if (graphics == QStringLiteral("opengl")) {
+        QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGL);
+    } else {
+        return fail(QStringLiteral("unknown graphics api %1").arg(graphics));
+    }
+
+    QJsonObject baseline;
+    if (parser.isSet(baselineOption)) {
+        QFile file(parser.value(baselineOption));
+        if (!file.open(QIODevice::ReadOnly)) return fail(QStringLiteral("cannot open %1").arg(file.fileName()));
+        QJsonParseError error{};
+        baseline = QJsonDocument::fromJson(file.readAll(), &error).object();
+        if (error.error != QJsonParseError::NoError) {
+            return fail(QStringLiteral("%1: %2").arg(file.fileName(), error.errorString()));
+        }
+    }
+
+    QQmlEngine engine;
+    engine.addImportPath(QStringLiteral("qrc:/imports"));
+    QQuickWindow window;
+    window.resize(options.size, options.size);
+    window.show();
+
+    BoardBench bench(engine, window, options);
+    QString error;
+    if (!bench.load(error)) return fail(error);
+    auto phases = bench.run();
+    if (phases.isEmpty()) return fail(QStringLiteral("no board was created"));
+
+    QJsonArray phaseArray;
+    for (const auto &phase: phases) phaseArray.push_back(phase);
+    QJsonObject report{
+            {QStringLiteral("version"), 1},
+            {QStringLiteral("qt"), QString::fromLatin1(qVersion())},
+            {QStringLiteral("platform"), QGuiApplication::platformName()},
+            {QStringLiteral("graphics"), graphics},
+            {QStringLiteral("boards"), options.boards},
+            {QStringLiteral("size"), options.size},
+            {QStringLiteral("plies"), bench.plies()},
+            {QStringLiteral("seed"), QString::number(options.seed)},
+            {QStringLiteral("phases"), phaseArray},
+    };
+
+    auto output = parser.value(outputOption);
+    QFile file(output);
+    bool opened = output.isEmpty() ? file.open(stdout, QIODevice::WriteOnly) :
+                  file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!opened || file.write(QJsonDocument(report).toJson()) < 0 || !file.flush()) {
+        return fail(QStringLiteral("cannot write %1").arg(output.isEmpty() ? QStringLiteral("the report") : output));
+    }
+
+    if (!baseline.isEmpty()) {
+        auto found = regressions(report, baseline, tolerance / 100);
+        for (const auto &line: found) err << line << Qt::endl;
+        if (!found.isEmpty()) return 1;
+    }
+    return 0;
+}
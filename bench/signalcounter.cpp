@@ -0,0 +1,27 @@
+#include "signalcounter.h"
+
+#include <QMetaMethod>
+
+SignalCounter::SignalCounter(QObject *parent)
+        : QObject(parent) {}
+
+void SignalCounter::watch(QObject *object) {
+    auto slot = metaObject()->method(metaObject()->indexOfSlot("signalled()"));
+    auto meta = object->metaObject();
+    for (int idx = QObject::staticMetaObject.methodCount(); idx < meta->methodCount(); idx += 1) {
+        auto method = meta->method(idx);
+        if (method.methodType() != QMetaMethod::Signal) continue;
+        // A slot without arguments accepts any signal
+        connect(object, method, this, slot);
+    }
+}
+
+QHash<QByteArray, qint64> SignalCounter::counts() const {
+    return mCounts;
+}
+
+void SignalCounter::signalled() {
+    auto index = senderSignalIndex();
+    if (index < 0) return;
+    mCounts[sender()->metaObject()->method(index).name()] += 1;
+}
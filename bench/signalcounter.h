@@ -0,0 +1,31 @@
+#ifndef DISBOARD_SIGNALCOUNTER_H
+#define DISBOARD_SIGNALCOUNTER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+
+// Counts the emissions of every signal declared by the watched objects,
+// QObject's own excepted. Each notify signal is a round of binding
+// re-evaluations in QML, so the counts stand in for binding statistics,
+// which the engine does not expose.
+class SignalCounter : public QObject {
+Q_OBJECT
+
+public:
+    explicit SignalCounter(QObject *parent = nullptr);
+
+    void watch(QObject *object);
+
+    // Signal name to emissions, summed over the watched objects
+    [[nodiscard]] QHash<QByteArray, qint64> counts() const;
+
+private slots:
+    void signalled();
+
+private:
+    QHash<QByteArray, qint64> mCounts;
+};
+
+
+#endif //DISBOARD_SIGNALCOUNTER_H
@@ -0,0 +1,264 @@
+#include "batch.h"
+
+#include "boundedqueue.h"
+#include "pgn.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Games per hand-off, large enough to keep queue traffic negligible
+    constexpr int batchSize = 256;
+
+    struct RawGame {
+        int input;
+        int line;
+        std::string text;
+        bool unreadable = false;
+    };
+
+    struct Batch {
+        qint64 seq;
+        QVector<RawGame> games;
+    };
+
+    struct ProcessedGame {
+        int input;
+        int line;
+        bool ok;
+        QString error;
+        uint64_t key = 0;
+        std::string text;
+    };
+
+    struct ProcessedBatch {
+        qint64 seq;
+        QVector<ProcessedGame> games;
+    };
+
+    ProcessedGame process(const RawGame &raw, const BatchOptions &options) {
+        ProcessedGame result{raw.input, raw.line, false};
+        if (raw.unreadable) {
+            result.error = QStringLiteral("cannot open file");
+            return result;
+        }
+
+        auto game = disboard::PgnGame::parse(raw.text, &result.error);
+        if (!game.has_value()) return result;
+        result.ok = true;
+
+        if (options.stripVariations) game->stripVariations();
+
+        switch (options.dedupe) {
+            case BatchOptions::Dedupe::None:
+                break;
+            case BatchOptions::Dedupe::Moves:
+                result.key = game->moveKey();
+                break;
+            case BatchOptions::Dedupe::Position:
+                result.key = game->finalPosition().hash();
+                break;
+        }
+
+        if (options.validateOnly) return result;
+        switch (options.format) {
+            case BatchOptions::Format::Pgn:
+                result.text = game->toPgn();
+                break;
+            case BatchOptions::Format::Uci: {
+                QStringList moves;
+                for (auto m: game->mainlineMoves()) moves.push_back(m.toString());
+                result.text = moves.join(QLatin1Char(' ')).toStdString() + '\n';
+                break;
+            }
+            case BatchOptions::Format::Fen:
+                result.text = game->finalPosition().fen() + '\n';
+                break;
+            case BatchOptions::Format::Draws: {
+                auto states = game->states();
+                auto line = game->mainline();
+                line.prepend(0);
+                result.text = std::to_string(line.count() - 1);
+                auto found = std::find_if(line.cbegin(), line.cend(), [&](int idx) {
+                    auto status = states.status(idx);
+                    return status.claimable() || status.drawn();
+                });
+                if (found == line.cend()) {
+                    result.text += " -";
+                } else {
+                    result.text += ' ' + std::to_string(found - line.cbegin()) + ' ' +
+                                   states.status(*found).reason().toStdString();
+                }
+                result.text += '\n';
+                break;
+            }
+        }
+        return result;
+    }
+
+    // The output file, or the current part of a split output
+    class Output {
+    public:
+        explicit Output(const BatchOptions &options) : path(options.output), split(options.split) {}
+
+        bool write(const std::string &text) {
+            if (!file.isOpen() || (split > 0 && written == split)) {
+                if (!openNext()) return false;
+            }
+            written += 1;
+            auto size = static_cast<qint64>(text.size());
+            return file.write(text.data(), size) == size;
+        }
+
+        bool close() {
+            if (!file.isOpen()) return true;
+            bool ok = file.flush();
+            file.close();
+            return ok;
+        }
+
+    private:
+        QString path;
+        int split;
+        QFile file;
+        int part = 0;
+        int written = 0;
+
+        bool openNext() {
+            if (!close()) return false;
+            written = 0;
+            part += 1;
+
+            if (path.isEmpty()) return file.open(stdout, QIODevice::WriteOnly);
+            if (split <= 0) {
+                file.setFileName(path);
+            } else {
+                QFileInfo info(path);
+                auto name = info.completeBaseName() + QStringLiteral("-%1").arg(part, 4, 10, QLatin1Char('0'));
+                if (!info.suffix().isEmpty()) name += QLatin1Char('.') + info.suffix();
+                file.setFileName(info.dir().filePath(name));
+            }
+            return file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        }
+    };
+}
+
+double BatchReport::gamesPerSecond() const {
+    return elapsedNs > 0 ? static_cast<double>(games) * 1e9 / static_cast<double>(elapsedNs) : 0;
+}
+
+BatchRunner::BatchRunner(BatchOptions options) : options(std::move(options)) {}
+
+bool BatchRunner::run(BatchReport &report) const {
+    QElapsedTimer timer;
+    timer.start();
+
+    auto workers = options.threads > 0 ? options.threads : std::max(1, QThread::idealThreadCount());
+    report = {};
+    report.threads = workers;
+
+    auto capacity = static_cast<size_t>(workers) * 4;
+    BoundedQueue<Batch> toParse(capacity);
+    BoundedQueue<ProcessedBatch> toWrite(capacity);
+    // One slot per batch read but not yet written. A batch that stalls in a
+    // parser holds back the reader, not just the writer, so the batches
+    // waiting behind it for their turn never exceed the capacity either.
+    BoundedQueue<qint64> inFlight(capacity);
+
+    std::thread reader([this, &toParse, &inFlight]() {
+        qint64 seq = 0;
+        Batch batch{seq, {}};
+        auto flush = [&]() {
+            inFlight.push(seq);
+            toParse.push(std::move(batch));
+            batch = {++seq, {}};
+        };
+
+        for (int input = 0; input < options.inputs.count(); input += 1) {
+            QFile file(options.inputs[input]);
+            if (!file.open(QIODevice::ReadOnly)) {
+                batch.games.push_back({input, 0, {}, true});
+                continue;
+            }
+
+            disboard::PgnSplitter splitter(&file);
+            while (auto text = splitter.next()) {
+                batch.games.push_back({input, splitter.line(), std::move(*text)});
+                if (batch.games.count() == batchSize) flush();
+            }
+        }
+        if (!batch.games.empty()) flush();
+        toParse.close();
+    });
+
+    std::atomic<int> running = workers;
+    std::vector<std::thread> parsers;
+    parsers.reserve(static_cast<size_t>(workers));
+    for (int idx = 0; idx < workers; idx += 1) {
+        parsers.emplace_back([this, &toParse, &toWrite, &running]() {
+            while (auto batch = toParse.pop()) {
+                ProcessedBatch processed{batch->seq, {}};
+                processed.games.reserve(batch->games.count());
+                for (const auto &raw: batch->games) {
+                    processed.games.push_back(process(raw, options));
+                }
+                toWrite.push(std::move(processed));
+            }
+            // The last parser out tells the writer
+            if (running.fetch_sub(1) == 1) toWrite.close();
+        });
+    }
+
+    // Batches come back in any order and are written in input order, which
+    // also makes "first occurrence wins" deterministic for dedupe.
+    Output output(options);
+    bool ok = true;
+    QSet<quint64> seen;
+    std::map<qint64, ProcessedBatch> early;
+    qint64 next = 0;
+
+    while (auto batch = toWrite.pop()) {
+        early.emplace(batch->seq, std::move(*batch));
+        for (auto it = early.begin(); it != early.end() && it->first == next; it = early.erase(it), next += 1) {
+            for (auto &game: it->second.games) {
+                report.games += 1;
+                if (!game.ok) {
+                    report.invalid += 1;
+                    if (onError) onError(options.inputs.value(game.input), game.line, game.error);
+                    continue;
+                }
+
+                if (options.dedupe != BatchOptions::Dedupe::None) {
+                    if (seen.contains(game.key)) {
+                        report.duplicates += 1;
+                        continue;
+                    }
+                    seen.insert(game.key);
+                }
+
+                // After a failed write the queues are still drained, so the
+                // other stages can finish
+                if (!options.validateOnly && ok) ok = output.write(game.text);
+                report.written += 1;
+            }
+            inFlight.pop();
+        }
+    }
+
+    reader.join();
+    for (auto &parser: parsers) parser.join();
+    ok = output.close() && ok;
+
+    report.elapsedNs = timer.nsecsElapsed();
+    return ok;
+}
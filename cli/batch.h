@@ -0,0 +1,79 @@
+#ifndef DISBOARD_CLI_BATCH_H
+#define DISBOARD_CLI_BATCH_H
+
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+struct BatchOptions {
+    enum class Dedupe {
+        None,
+        // Same start position and mainline moves
+        Moves,
+        // Same final position of the mainline
+        Position,
+    };
+
+    enum class Format {
+        Pgn,
+        // Mainline moves in UCI notation, one game per line
+        Uci,
+        // Final position of the mainline, one game per line
+        Fen,
+        // Mainline plies, then the first ply where a draw could be claimed
+        // or is automatic and the rule, or -, one game per line
+        Draws,
+    };
+
+    // Read in order, as if they were one file
+    QStringList inputs;
+    // Standard output when empty
+    QString output;
+    // Games per output file, 0 writes a single file. Files are numbered
+    // after the output name, e.g. games-0001.pgn.
+    int split = 0;
+
+    Dedupe dedupe = Dedupe::None;
+    bool stripVariations = false;
+    // Parse and report errors without writing anything
+    bool validateOnly = false;
+    Format format = Format::Pgn;
+    // 0 uses one parser per core
+    int threads = 0;
+};
+
+struct BatchReport {
+    // Every game read, valid or not
+    qint64 games = 0;
+    qint64 written = 0;
+    qint64 invalid = 0;
+    qint64 duplicates = 0;
+    int threads = 0;
+    qint64 elapsedNs = 0;
+
+    [[nodiscard]] double gamesPerSecond() const;
+};
+
+// Streams games through read -> parse and transform -> write. One thread
+// splits the inputs into games, the parsers work on batches of them, and
+// the calling thread writes the results back in input order. Every stage
+// is connected by a bounded queue and the batches between reading and
+// writing are capped as well, so memory stays flat for any input size even
+// when one batch is slow to parse.
+class BatchRunner {
+public:
+    explicit BatchRunner(BatchOptions options);
+
+    // Called on the writing thread, with file, line and message
+    std::function<void(const QString &, int, const QString &)> onError;
+
+    // False when an output could not be written
+    bool run(BatchReport &report) const;
+
+private:
+    BatchOptions options;
+};
+
+
+#endif //DISBOARD_CLI_BATCH_H
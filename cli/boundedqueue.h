@@ -0,0 +1,53 @@
+#ifndef DISBOARD_CLI_BOUNDEDQUEUE_H
+#define DISBOARD_CLI_BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// Hands items between pipeline stages. Producers block while the queue is
+// full, so a fast reader cannot run ahead of the parsers by more than the
+// capacity.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T item) {
+        std::unique_lock lock(mutex);
+        notFull.wait(lock, [this]() { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    // Nullopt once the queue is closed and drained
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) return {};
+
+        auto item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return item;
+    }
+
+    // No more pushes will come, consumers finish what is queued
+    void close() {
+        std::lock_guard lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    bool closed = false;
+};
+
+
+#endif //DISBOARD_CLI_BOUNDEDQUEUE_H
@@ -0,0 +1,362 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <atomic>
+#include <optional>
+
+#include "batch.h"
+#include "boardrenderer.h"
+#include "gifwriter.h"
+#include "selfplay.h"
+
+namespace {
+    // Mainlines of the games in `path` that start from the standard position
+    std::optional<QVector<QVector<disboard::Move>>> loadOpenings(const QString &path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return {};
+
+        QVector<QVector<disboard::Move>> openings;
+        disboard::PgnSplitter splitter(&file);
+        while (auto text = splitter.next()) {
+            auto game = disboard::PgnGame::parse(*text);
+            if (!game.has_value() || game->start.hash() != disboard::Position().hash()) continue;
+            openings.push_back(game->mainlineMoves());
+        }
+        return openings;
+    }
+
+    bool selfPlay(const disboard::SelfPlayOptions &options, const QString &path, bool binary,
+                  disboard::SelfPlayReport &report) {
+        QFile file(path);
+        bool opened = path.isEmpty() ? file.open(stdout, QIODevice::WriteOnly) :
+                      file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+        if (!opened) return false;
+
+        bool ok = !binary || file.write(disboard::SelfPlay::binaryHeader()) >= 0;
+        disboard::SelfPlay selfPlay(options);
+        // Calls never overlap, the runner serializes them
+        report = selfPlay.run([&](disboard::SelfPlayGame &&game) {
+            if (!ok) return;
+            if (binary) {
+                auto bytes = game.toBinary();
+                ok = file.write(bytes) == bytes.size();
+            } else {
+                auto text = game.toPgnGame(options).toPgn();
+                auto size = static_cast<qint64>(text.size());
+                ok = file.write(text.data(), size) == size;
+            }
+        });
+        return file.flush() && ok;
+    }
+
+    struct RenderReport {
+        int games = 0;
+        qint64 images = 0;
+        qint64 elapsedNs = 0;
+    };
+
+    // A PNG of every mainline position and/or a GIF of every game of the
+    // inputs, named after the game's number across all inputs
+    bool renderGames(const QStringList &inputs, const disboard::RenderOptions &options,
+                     const QString &thumbnails, const QString &gifs, int delay, RenderReport &report) {
+        disboard::BoardRenderer renderer(options);
+        if (!renderer.valid()) return false;
+
+        std::optional<disboard::GifPalette> palette;
+        if (!gifs.isEmpty()) palette.emplace(renderer.keyColors());
+
+        QElapsedTimer timer;
+        timer.start();
+        std::atomic<bool> ok = true;
+        std::atomic<qint64> images = 0;
+        auto write = [&](const QString &path, const QByteArray &bytes) {
+            QFile file(path);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(bytes) != bytes.size()) {
+                ok = false;
+            }
+        };
+
+        // Thumbnails of many games go out as one batch, a pool per game
+        // would cost more than short games take to draw
+        QVector<disboard::RenderJob> batch;
+        QStringList paths;
+        auto flush = [&]() {
+            renderer.renderAll(batch, [&](int idx, QImage &&image) {
+                write(paths[idx], disboard::BoardRenderer::encodePng(image));
+                images += 1;
+            });
+            batch.clear();
+            paths.clear();
+        };
+
+        for (const auto &input: inputs) {
+            QFile file(input);
+            if (!file.open(QIODevice::ReadOnly)) return false;
+
+            disboard::PgnSplitter splitter(&file);
+            while (auto text = splitter.next()) {
+                auto game = disboard::PgnGame::parse(*text);
+                if (!game.has_value()) continue;
+                report.games += 1;
+                auto name = QStringLiteral("%1").arg(report.games, 6, 10, QLatin1Char('0'));
+                auto jobs = disboard::BoardRenderer::mainline(*game);
+
+                if (!thumbnails.isEmpty()) {
+                    for (int ply = 0; ply < jobs.count(); ply += 1) {
+                        batch.push_back(jobs[ply]);
+                        paths.push_back(QDir(thumbnails).filePath(
+                                QStringLiteral("%1-%2.png").arg(name).arg(ply, 3, 10, QLatin1Char('0'))));
+                    }
+                    if (batch.count() >= 4096) flush();
+                }
+                if (!gifs.isEmpty()) {
+                    disboard::GifWriter gif(renderer.size(), renderer.size(), *palette);
+                    renderer.renderInOrder(jobs, [&](int ply, QImage &&image) {
+                        // Linger on the final position
+                        gif.addFrame(image, ply + 1 == jobs.count() ? delay * 4 : delay);
+                        images += 1;
+                    });
+                    write(QDir(gifs).filePath(QStringLiteral("%1.gif").arg(name)), gif.finish());
+                }
+            }
+        }
+        flush();
+
+        report.images = images;
+        report.elapsedNs = timer.nsecsElapsed();
+        return ok;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("disboard-cli"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Batch processing of PGN collections and self-play"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("inputs"), QStringLiteral("PGN files, merged in order"),
+                                 QStringLiteral("<input.pgn>..."));
+
+    QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output")},
+                                    QStringLiteral("Write to <file> instead of standard output."),
+                                    QStringLiteral("file"));
+    QCommandLineOption validateOption(QStringLiteral("validate"),
+                                      QStringLiteral("Only check the games and report errors."));
+    QCommandLineOption dedupeOption(QStringLiteral("dedupe"),
+                                    QStringLiteral("Drop games repeating an earlier one: moves or position."),
+                                    QStringLiteral("key"));
+    QCommandLineOption stripOption(QStringLiteral("strip-variations"),
+                                   QStringLiteral("Keep the mainline only."));
+    QCommandLineOption splitOption(QStringLiteral("split"),
+                                   QStringLiteral("Write <n> games per file, numbered after the output."),
+                                   QStringLiteral("n"));
+    QCommandLineOption formatOption(QStringLiteral("format"),
+                                    QStringLiteral("Output format: pgn, uci, fen or draws, self-play writes pgn or bin."),
+                                    QStringLiteral("format"), QStringLiteral("pgn"));
+    QCommandLineOption threadsOption({QStringLiteral("j"), QStringLiteral("threads")},
+                                     QStringLiteral("Parser threads, one per core by default."),
+                                     QStringLiteral("n"));
+
+    QCommandLineOption selfPlayOption(QStringLiteral("selfplay"),
+                                      QStringLiteral("Play <n> games instead of reading inputs."),
+                                      QStringLiteral("n"));
+    QCommandLineOption policyOption(QStringLiteral("policy"),
+                                    QStringLiteral("Self-play move policy: random, greedy or search."),
+                                    QStringLiteral("policy"), QStringLiteral("random"));
+    QCommandLineOption depthOption(QStringLiteral("depth"),
+                                   QStringLiteral("Plies searched by the search policy."),
+                                   QStringLiteral("n"), QStringLiteral("2"));
+    QCommandLineOption openingsOption(QStringLiteral("openings"),
+                                      QStringLiteral("Start self-play games from random games in <file>."),
+                                      QStringLiteral("file"));
+    QCommandLineOption openingPliesOption(QStringLiteral("opening-plies"),
+                                          QStringLiteral("Plies taken from the opening games."),
+                                          QStringLiteral("n"), QStringLiteral("8"));
+    QCommandLineOption maxPliesOption(QStringLiteral("max-plies"),
+                                      QStringLiteral("Self-play games end unfinished after <n> plies."),
+                                      QStringLiteral("n"), QStringLiteral("400"));
+    QCommandLineOption seedOption(QStringLiteral("seed"),
+                                  QStringLiteral("Random seed of the self-play run."),
+                                  QStringLiteral("n"), QStringLiteral("0"));
+
+    QCommandLineOption thumbnailsOption(QStringLiteral("thumbnails"),
+                                        QStringLiteral("Write a PNG of every mainline position to <dir>."),
+                                        QStringLiteral("dir"));
+    QCommandLineOption gifOption(QStringLiteral("gif"),
+                                 QStringLiteral("Write an animated GIF of every game to <dir>."),
+                                 QStringLiteral("dir"));
+    QCommandLineOption sizeOption(QStringLiteral("size"),
+                                  QStringLiteral("Edge of rendered boards in pixels."),
+                                  QStringLiteral("px"), QStringLiteral("256"));
+    QCommandLineOption flipOption(QStringLiteral("flip"),
+                                  QStringLiteral("Render boards from black's side."));
+    QCommandLineOption delayOption(QStringLiteral("delay"),
+                                   QStringLiteral("GIF frame delay in milliseconds."),
+                                   QStringLiteral("ms"), QStringLiteral("800"));
+
+    parser.addOptions({outputOption, validateOption, dedupeOption, stripOption,
+                       splitOption, formatOption, threadsOption,
+                       selfPlayOption, policyOption, depthOption, openingsOption,
+                       openingPliesOption, maxPliesOption, seedOption,
+                       thumbnailsOption, gifOption, sizeOption, flipOption, delayOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    auto fail = [&](const QString &message) {
+        err << message << Qt::endl;
+        return 2;
+    };
+
+    bool ok = true;
+    auto threads = 0;
+    if (parser.isSet(threadsOption)) {
+        threads = parser.value(threadsOption).toInt(&ok);
+        if (!ok || threads <= 0) return fail(QStringLiteral("--threads needs a positive count"));
+    }
+
+    if (parser.isSet(selfPlayOption)) {
+        disboard::SelfPlayOptions options;
+        options.threads = threads;
+        options.games = parser.value(selfPlayOption).toInt(&ok);
+        if (!ok || options.games <= 0) return fail(QStringLiteral("--selfplay needs a positive count"));
+
+        auto policy = parser.value(policyOption);
+        if (policy == QStringLiteral("random")) {
+            options.policy = disboard::SelfPlayOptions::Policy::Random;
+        } else if (policy == QStringLiteral("greedy")) {
+            options.policy = disboard::SelfPlayOptions::Policy::Greedy;
+        } else if (policy == QStringLiteral("search")) {
+            options.policy = disboard::SelfPlayOptions::Policy::Search;
+        } else {
+            return fail(QStringLiteral("unknown policy: %1").arg(policy));
+        }
+
+        options.searchDepth = parser.value(depthOption).toInt(&ok);
+        if (!ok || options.searchDepth <= 0) return fail(QStringLiteral("--depth needs a positive count"));
+        options.openingPlies = parser.value(openingPliesOption).toInt(&ok);
+        if (!ok || options.openingPlies < 0) return fail(QStringLiteral("--opening-plies needs a count"));
+        options.maxPlies = parser.value(maxPliesOption).toInt(&ok);
+        if (!ok || options.maxPlies <= 0) return fail(QStringLiteral("--max-plies needs a positive count"));
+        options.seed = parser.value(seedOption).toULongLong(&ok);
+        if (!ok) return fail(QStringLiteral("--seed needs a number"));
+
+        if (parser.isSet(openingsOption)) {
+            auto openings = loadOpenings(parser.value(openingsOption));
+            if (!openings.has_value()) return fail(QStringLiteral("cannot open %1").arg(parser.value(openingsOption)));
+            options.openings = *openings;
+        }
+
+        auto format = parser.value(formatOption);
+        if (format != QStringLiteral("pgn") && format != QStringLiteral("bin")) {
+            return fail(QStringLiteral("self-play writes pgn or bin, not %1").arg(format));
+        }
+
+        disboard::SelfPlayReport report;
+        bool written = selfPlay(options, parser.value(outputOption), format == QStringLiteral("bin"), report);
+
+        err << QStringLiteral("%1 games, %2 moves in %3 s on %4 threads: %5 games/s, %6 moves/s")
+                .arg(report.games)
+                .arg(report.moves)
+                .arg(static_cast<double>(report.elapsedNs) / 1e9, 0, 'f', 2)
+                .arg(report.threads)
+                .arg(report.gamesPerSecond(), 0, 'f', 0)
+                .arg(report.movesPerSecond(), 0, 'f', 0)
+            << Qt::endl;
+        if (!written) return fail(QStringLiteral("could not write the output"));
+        return 0;
+    }
+
+    if (parser.isSet(thumbnailsOption) || parser.isSet(gifOption)) {
+        disboard::RenderOptions options;
+        options.threads = threads;
+        options.flipped = parser.isSet(flipOption);
+        options.size = parser.value(sizeOption).toInt(&ok);
+        if (!ok || options.size < 8) return fail(QStringLiteral("--size needs at least 8 pixels"));
+        auto delay = parser.value(delayOption).toInt(&ok);
+        if (!ok || delay < 0) return fail(QStringLiteral("--delay needs a duration"));
+
+        QString dirs[] = {parser.value(thumbnailsOption), parser.value(gifOption)};
+        for (const auto &dir: dirs) {
+            if (!dir.isEmpty() && !QDir().mkpath(dir)) return fail(QStringLiteral("cannot create %1").arg(dir));
+        }
+        auto inputs = parser.positionalArguments();
+        if (inputs.empty()) return fail(QStringLiteral("no input files"));
+
+        RenderReport report;
+        bool written = renderGames(inputs, options, dirs[0], dirs[1], delay / 10, report);
+
+        auto seconds = static_cast<double>(report.elapsedNs) / 1e9;
+        err << QStringLiteral("%1 games, %2 images in %3 s: %4 images/s")
+                .arg(report.games)
+                .arg(report.images)
+                .arg(seconds, 0, 'f', 2)
+                .arg(seconds > 0 ? static_cast<double>(report.images) / seconds : 0, 0, 'f', 0)
+            << Qt::endl;
+        if (!written) return fail(QStringLiteral("could not render or write the images"));
+        return 0;
+    }
+
+    BatchOptions options;
+    options.threads = threads;
+    options.inputs = parser.positionalArguments();
+    if (options.inputs.empty()) return fail(QStringLiteral("no input files"));
+
+    options.output = parser.value(outputOption);
+    options.validateOnly = parser.isSet(validateOption);
+    options.stripVariations = parser.isSet(stripOption);
+
+    if (parser.isSet(dedupeOption)) {
+        auto key = parser.value(dedupeOption);
+        if (key == QStringLiteral("moves")) {
+            options.dedupe = BatchOptions::Dedupe::Moves;
+        } else if (key == QStringLiteral("position")) {
+            options.dedupe = BatchOptions::Dedupe::Position;
+        } else {
+            return fail(QStringLiteral("unknown dedupe key: %1").arg(key));
+        }
+    }
+
+    auto format = parser.value(formatOption);
+    if (format == QStringLiteral("pgn")) {
+        options.format = BatchOptions::Format::Pgn;
+    } else if (format == QStringLiteral("uci")) {
+        options.format = BatchOptions::Format::Uci;
+    } else if (format == QStringLiteral("fen")) {
+        options.format = BatchOptions::Format::Fen;
+    } else if (format == QStringLiteral("draws")) {
+        options.format = BatchOptions::Format::Draws;
+    } else {
+        return fail(QStringLiteral("unknown format: %1").arg(format));
+    }
+
+    if (parser.isSet(splitOption)) {
+        options.split = parser.value(splitOption).toInt(&ok);
+        if (!ok || options.split <= 0) return fail(QStringLiteral("--split needs a positive count"));
+        if (options.output.isEmpty()) return fail(QStringLiteral("--split needs an output file"));
+    }
+    BatchRunner runner(options);
+    runner.onError = [&err](const QString &file, int line, const QString &message) {
+        err << file << QLatin1Char(':') << line << QStringLiteral(": ") << message << Qt::endl;
+    };
+
+    BatchReport report;
+    bool written = runner.run(report);
+
+    err << QStringLiteral("%1 games in %2 s, %3 games/s on %4 threads: %5 written, %6 invalid, %7 duplicates")
+            .arg(report.games)
+            .arg(static_cast<double>(report.elapsedNs) / 1e9, 0, 'f', 2)
+            .arg(report.gamesPerSecond(), 0, 'f', 0)
+            .arg(report.threads)
+            .arg(report.written)
+            .arg(report.invalid)
+            .arg(report.duplicates)
+        << Qt::endl;
+
+    if (!written) return fail(QStringLiteral("could not write the output"));
+    return report.invalid > 0 ? 1 : 0;
+}
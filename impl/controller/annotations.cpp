@@ -0,0 +1,417 @@
+#include "annotations.h"
+
+#include <QHashFunctions>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+
+using namespace disboard;
+
+namespace {
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    std::string_view trimmed(std::string_view text) {
+        while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+        while (!text.empty() && isSpace(text.back())) text.remove_suffix(1);
+        return text;
+    }
+
+    void appendWords(std::string &out, std::string_view text) {
+        text = trimmed(text);
+        if (text.empty()) return;
+        if (!out.empty()) out += ' ';
+        out += text;
+    }
+
+    std::optional<Square> parseSquare(std::string_view text) {
+        if (text.size() != 2) return {};
+        if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8') return {};
+        return Square(static_cast<uint8_t>(text[0] - 'a'), static_cast<uint8_t>(text[1] - '1'));
+    }
+
+    std::string squareName(Square sq) {
+        return {static_cast<char>('a' + sq.file()), static_cast<char>('1' + sq.rank())};
+    }
+
+    // h:mm:ss with optional fractions of a second
+    std::optional<int32_t> parseClock(std::string_view text) {
+        int64_t ms = 0;
+        int64_t part = 0;
+        int fields = 0;
+        bool digits = false;
+        for (size_t idx = 0; idx < text.size(); idx += 1) {
+            auto c = text[idx];
+            if (c >= '0' && c <= '9') {
+                part = std::min<int64_t>(part * 10 + (c - '0'), 1000000);
+                digits = true;
+            } else if (c == ':' && digits) {
+                ms = (ms + part) * 60;
+                part = 0;
+                fields += 1;
+                digits = false;
+            } else if (c == '.' && digits) {
+                int64_t fraction = 0;
+                int scale = 1000;
+                for (idx += 1; idx < text.size() && text[idx] >= '0' && text[idx] <= '9'; idx += 1) {
+                    scale /= 10;
+                    fraction += (text[idx] - '0') * scale;
+                }
+                if (idx != text.size()) return {};
+                return static_cast<int32_t>(std::min<int64_t>((ms + part) * 1000 + fraction, INT32_MAX));
+            } else {
+                return {};
+            }
+        }
+        if (!digits || fields > 2) return {};
+        return static_cast<int32_t>(std::min<int64_t>((ms + part) * 1000, INT32_MAX));
+    }
+
+    // Tenths as most clocks give them, milliseconds when there are any, so
+    // a clock reads back as it was parsed
+    std::string formatClock(int32_t ms) {
+        auto seconds = ms / 1000;
+        char buf[32];
+        if (ms % 100 != 0) {
+            std::snprintf(buf, sizeof buf, "%d:%02d:%02d.%03d",
+                          seconds / 3600, seconds / 60 % 60, seconds % 60, ms % 1000);
+        } else if (ms % 1000 != 0) {
+            std::snprintf(buf, sizeof buf, "%d:%02d:%02d.%d",
+                          seconds / 3600, seconds / 60 % 60, seconds % 60, ms % 1000 / 100);
+        } else {
+            std::snprintf(buf, sizeof buf, "%d:%02d:%02d", seconds / 3600, seconds / 60 % 60, seconds % 60);
+        }
+        return buf;
+    }
+
+    // Pawns with an optional ",depth", or #moves for mates
+    std::optional<int32_t> parseEval(std::string_view text) {
+        text = text.substr(0, text.find(','));
+        if (text.empty()) return {};
+
+        std::string value(text);
+        char *end = nullptr;
+        if (value.front() == '#') {
+            auto moves = std::strtol(value.c_str() + 1, &end, 10);
+            if (end == value.c_str() + 1 || *end != '\0' || std::abs(moves) >= Annotations::mateScore) return {};
+            return Annotations::fromMate(static_cast<int>(moves));
+        }
+        auto pawns = std::strtod(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0' || !std::isfinite(pawns)) return {};
+        auto cp = std::clamp(std::lround(pawns * 100), -(Annotations::mateScore / 2L), Annotations::mateScore / 2L);
+        return static_cast<int32_t>(cp);
+    }
+
+    std::string formatEval(int32_t eval) {
+        char buf[32];
+        if (Annotations::isMate(eval)) {
+            std::snprintf(buf, sizeof buf, "#%d", Annotations::mateIn(eval));
+        } else {
+            std::snprintf(buf, sizeof buf, "%.2f", eval / 100.0);
+        }
+        return buf;
+    }
+
+    std::optional<QVector<Arrow>> parseArrows(std::string_view text) {
+        QVector<Arrow> arrows;
+        while (!text.empty()) {
+            auto comma = text.find(',');
+            auto item = text.substr(0, comma);
+            text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+
+            if (item.size() != 5) return {};
+            auto from = parseSquare(item.substr(1, 2));
+            auto to = parseSquare(item.substr(3, 2));
+            if (!from.has_value() || !to.has_value()) return {};
+            arrows.push_back({*from, *to, item[0]});
+        }
+        return arrows;
+    }
+}
+
+int StringArena::intern(std::string_view text) {
+    auto hash = qHash(QByteArrayView(text.data(), static_cast<qsizetype>(text.size())));
+    for (auto it = index.constFind(hash); it != index.constEnd() && it.key() == hash; ++it) {
+        if (view(*it) == text) return *it;
+    }
+
+    auto id = count();
+    data.append(text);
+    offsets.push_back(static_cast<qsizetype>(data.size()));
+    index.insert(hash, id);
+    return id;
+}
+
+std::string_view StringArena::view(int id) const {
+    if (id < 0 || id >= count()) return {};
+    return std::string_view(data).substr(offsets[id], offsets[id + 1] - offsets[id]);
+}
+
+QString StringArena::at(int id) const {
+    auto text = view(id);
+    return QString::fromUtf8(text.data(), static_cast<qsizetype>(text.size()));
+}
+
+qint64 StringArena::memoryBytes() const {
+    return static_cast<qint64>(data.capacity()) + heapBytes(offsets)
+           + static_cast<qint64>(index.capacity()) * static_cast<qint64>(sizeof(size_t) + sizeof(int) + 1);
+}
+
+void StringArena::clear() {
+    data.clear();
+    offsets = {0};
+    index.clear();
+}
+
+bool Annotations::isMate(int32_t eval) {
+    return eval != noEval && std::abs(eval) > mateScore / 2;
+}
+
+int Annotations::mateIn(int32_t eval) {
+    if (!isMate(eval)) return 0;
+    return eval > 0 ? mateScore - eval : -(mateScore + eval);
+}
+
+int32_t Annotations::fromMate(int moves) {
+    return moves >= 0 ? mateScore - moves : -mateScore - moves;
+}
+
+qint64 Annotations::memoryBytes() const {
+    return heapBytes(slots) + heapBytes(commentIds) + heapBytes(packedNags) + heapBytes(evalColumn)
+           + heapBytes(clockColumn) + heapBytes(arrowBegin) + heapBytes(arrowCount) + heapBytes(arrowPool)
+           + strings.memoryBytes();
+}
+
+void Annotations::clear() {
+    slots.clear();
+    commentIds.clear();
+    packedNags.clear();
+    evalColumn.clear();
+    clockColumn.clear();
+    arrowBegin.clear();
+    arrowCount.clear();
+    arrowPool.clear();
+    strings.clear();
+    deadSlots = 0;
+}
+
+void Annotations::remove(const QVector<QUuid> &nodes) {
+    if (slots.empty()) return;
+    for (auto node: nodes) {
+        if (slots.remove(node)) deadSlots += 1;
+    }
+    if (slots.empty()) {
+        clear();
+    } else if (deadSlots * 2 >= commentIds.count()) {
+        compactSlots();
+    }
+}
+
+int Annotations::ensureSlot(QUuid node) {
+    auto it = slots.constFind(node);
+    if (it != slots.constEnd()) return *it;
+
+    auto idx = static_cast<int>(commentIds.count());
+    slots.insert(node, idx);
+    commentIds.push_back(-1);
+    packedNags.push_back(0);
+    evalColumn.push_back(noEval);
+    clockColumn.push_back(noClock);
+    arrowBegin.push_back(0);
+    arrowCount.push_back(0);
+    return idx;
+}
+
+QString Annotations::comment(QUuid node) const {
+    auto idx = slot(node);
+    return idx < 0 ? QString() : strings.at(commentIds[idx]);
+}
+
+void Annotations::setComment(QUuid node, std::string_view text) {
+    text = trimmed(text);
+    if (text.empty() && !contains(node)) return;
+    auto idx = ensureSlot(node);
+    commentIds[idx] = text.empty() ? -1 : strings.intern(text);
+}
+
+QVector<uint8_t> Annotations::nags(QUuid node) const {
+    QVector<uint8_t> list;
+    auto idx = slot(node);
+    if (idx < 0) return list;
+    for (auto packed = packedNags[idx]; packed != 0; packed >>= 8) {
+        list.push_back(static_cast<uint8_t>(packed & 0xff));
+    }
+    return list;
+}
+
+void Annotations::setNags(QUuid node, const QVector<uint8_t> &nags) {
+    uint32_t packed = 0;
+    int shift = 0;
+    // NAG 0 is the null annotation, it would end the list early
+    for (auto nag: nags) {
+        if (nag == 0 || shift == 32) continue;
+        packed |= static_cast<uint32_t>(nag) << shift;
+        shift += 8;
+    }
+    if (packed == 0 && !contains(node)) return;
+    packedNags[ensureSlot(node)] = packed;
+}
+
+int32_t Annotations::eval(QUuid node) const {
+    auto idx = slot(node);
+    return idx < 0 ? noEval : evalColumn[idx];
+}
+
+void Annotations::setEval(QUuid node, int32_t eval) {
+    if (eval == noEval && !contains(node)) return;
+    evalColumn[ensureSlot(node)] = eval;
+}
+
+int32_t Annotations::clock(QUuid node) const {
+    auto idx = slot(node);
+    return idx < 0 ? noClock : clockColumn[idx];
+}
+
+void Annotations::setClock(QUuid node, int32_t ms) {
+    if (ms < 0) ms = noClock;
+    if (ms == noClock && !contains(node)) return;
+    clockColumn[ensureSlot(node)] = ms;
+}
+
+QVector<Arrow> Annotations::arrows(QUuid node) const {
+    auto idx = slot(node);
+    if (idx < 0) return {};
+    return arrowPool.mid(arrowBegin[idx], arrowCount[idx]);
+}
+
+void Annotations::setArrows(QUuid node, const QVector<Arrow> &arrows) {
+    if (arrows.empty() && !contains(node)) return;
+    auto idx = ensureSlot(node);
+    auto count = std::min<qsizetype>(arrows.count(), std::numeric_limits<uint8_t>::max());
+
+    if (count > arrowCount[idx]) {
+        // Ranges that were outgrown are garbage until the next compaction
+        if (arrowPool.count() + count > std::numeric_limits<uint32_t>::max()) compactArrows();
+        arrowBegin[idx] = static_cast<uint32_t>(arrowPool.count());
+        arrowPool.resize(arrowPool.count() + count);
+    }
+    std::copy_n(arrows.cbegin(), count, arrowPool.begin() + arrowBegin[idx]);
+    arrowCount[idx] = static_cast<uint8_t>(count);
+}
+
+void Annotations::compactArrows() {
+    QVector<Arrow> pool;
+    for (qsizetype idx = 0; idx < arrowBegin.count(); idx += 1) {
+        auto begin = static_cast<uint32_t>(pool.count());
+        pool.append(arrowPool.mid(arrowBegin[idx], arrowCount[idx]));
+        arrowBegin[idx] = begin;
+    }
+    arrowPool = std::move(pool);
+}
+
+void Annotations::compactSlots() {
+    // Live slots keep their relative order, so a line gathered after the
+    // compaction reads the columns in the same order as before
+    QVector<std::pair<int, QUuid>> live;
+    live.reserve(slots.count());
+    for (auto it = slots.cbegin(); it != slots.cend(); ++it) live.push_back({*it, it.key()});
+    std::sort(live.begin(), live.end(), [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+    Annotations packed;
+    packed.slots.reserve(live.count());
+    for (const auto &[old, node]: live) {
+        auto idx = packed.ensureSlot(node);
+        if (commentIds[old] >= 0) packed.commentIds[idx] = packed.strings.intern(strings.view(commentIds[old]));
+        packed.packedNags[idx] = packedNags[old];
+        packed.evalColumn[idx] = evalColumn[old];
+        packed.clockColumn[idx] = clockColumn[old];
+        packed.arrowBegin[idx] = static_cast<uint32_t>(packed.arrowPool.count());
+        packed.arrowCount[idx] = arrowCount[old];
+        packed.arrowPool.append(arrowPool.mid(arrowBegin[old], arrowCount[old]));
+    }
+    *this = std::move(packed);
+}
+
+QVector<int32_t> Annotations::evals(const QVector<QUuid> &nodes) const {
+    QVector<int32_t> list(nodes.count(), noEval);
+    if (slots.empty()) return list;
+    for (qsizetype idx = 0; idx < nodes.count(); idx += 1) {
+        auto s = slot(nodes[idx]);
+        if (s >= 0) list[idx] = evalColumn[s];
+    }
+    return list;
+}
+
+QVector<int32_t> Annotations::clocks(const QVector<QUuid> &nodes) const {
+    QVector<int32_t> list(nodes.count(), noClock);
+    if (slots.empty()) return list;
+    for (qsizetype idx = 0; idx < nodes.count(); idx += 1) {
+        auto s = slot(nodes[idx]);
+        if (s >= 0) list[idx] = clockColumn[s];
+    }
+    return list;
+}
+
+std::string Annotations::pgnComment(QUuid node) const {
+    auto idx = slot(node);
+    if (idx < 0) return {};
+
+    std::string out(strings.view(commentIds[idx]));
+    if (clockColumn[idx] != noClock) appendWords(out, "[%clk " + formatClock(clockColumn[idx]) + "]");
+    if (evalColumn[idx] != noEval) appendWords(out, "[%eval " + formatEval(evalColumn[idx]) + "]");
+    if (arrowCount[idx] > 0) {
+        std::string cal = "[%cal ";
+        for (uint32_t a = arrowBegin[idx]; a < arrowBegin[idx] + arrowCount[idx]; a += 1) {
+            if (a != arrowBegin[idx]) cal += ',';
+            cal += arrowPool[a].color;
+            cal += squareName(arrowPool[a].from);
+            cal += squareName(arrowPool[a].to);
+        }
+        appendWords(out, cal + "]");
+    }
+    return out;
+}
+
+void Annotations::setPgnComment(QUuid node, std::string_view text) {
+    std::string comment;
+    std::optional<int32_t> clock, eval;
+    std::optional<QVector<Arrow>> arrows;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        auto open = text.find("[%", pos);
+        auto close = open == std::string_view::npos ? open : text.find(']', open);
+        if (close == std::string_view::npos) {
+            appendWords(comment, text.substr(pos));
+            break;
+        }
+        appendWords(comment, text.substr(pos, open - pos));
+        pos = close + 1;
+
+        auto command = trimmed(text.substr(open + 2, close - open - 2));
+        auto space = command.find(' ');
+        auto name = command.substr(0, space);
+        auto value = space == std::string_view::npos ? std::string_view() : trimmed(command.substr(space));
+
+        // Commands this store has no column for stay in the text
+        std::optional<int32_t> parsed;
+        if (name == "clk" && (parsed = parseClock(value))) {
+            clock = parsed;
+        } else if (name == "eval" && (parsed = parseEval(value))) {
+            eval = parsed;
+        } else if (auto list = name == "cal" ? parseArrows(value) : std::nullopt) {
+            arrows = std::move(list);
+        } else {
+            appendWords(comment, text.substr(open, close - open + 1));
+        }
+    }
+
+    setComment(node, comment);
+    setClock(node, clock.value_or(noClock));
+    setEval(node, eval.value_or(noEval));
+    setArrows(node, arrows.value_or(QVector<Arrow>()));
+}
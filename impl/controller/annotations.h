@@ -0,0 +1,131 @@
+#ifndef DISBOARD_ANNOTATIONS_H
+#define DISBOARD_ANNOTATIONS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "memorystats.h"
+#include "square.h"
+
+namespace disboard {
+    // Deduplicated strings packed back to back in one buffer. Ids stay valid
+    // until clear(), strings are never removed one by one.
+    class StringArena {
+    public:
+        int intern(std::string_view text);
+        [[nodiscard]] std::string_view view(int id) const;
+        [[nodiscard]] QString at(int id) const;
+
+        [[nodiscard]] int count() const { return static_cast<int>(offsets.count()) - 1; }
+        [[nodiscard]] qsizetype bytes() const { return data.size(); }
+        [[nodiscard]] qint64 memoryBytes() const;
+        void clear();
+
+    private:
+        std::string data;
+        QVector<qsizetype> offsets{0};
+        QMultiHash<size_t, int> index;
+    };
+
+    struct Arrow {
+        Square from;
+        Square to;
+        // As in [%cal]: 'G', 'R', 'Y' or 'B'
+        char color = 'G';
+
+        bool operator==(const Arrow &rhs) const {
+            return from == rhs.from && to == rhs.to && color == rhs.color;
+        }
+    };
+
+    // Comments, NAGs, clocks, evals and arrows of the nodes of one tree.
+    // Every kind of annotation is a column indexed by a dense slot per
+    // annotated node, so a whole line of evals or clocks is gathered in one
+    // pass without touching the others.
+    class Annotations {
+    public:
+        // Evals are centipawns from white's point of view. Mates are folded
+        // into the same column as mateScore minus the moves to mate, negated
+        // when black mates.
+        static constexpr int32_t noEval = std::numeric_limits<int32_t>::min();
+        static constexpr int32_t mateScore = 1000000;
+        static constexpr int32_t noClock = -1;
+
+        [[nodiscard]] static bool isMate(int32_t eval);
+        // Moves to mate, negative when black mates, 0 when not a mate
+        [[nodiscard]] static int mateIn(int32_t eval);
+        [[nodiscard]] static int32_t fromMate(int moves);
+
+        [[nodiscard]] bool contains(QUuid node) const { return slots.contains(node); }
+        [[nodiscard]] bool empty() const { return slots.empty(); }
+        [[nodiscard]] qint64 memoryBytes() const;
+        void clear();
+        // Forgets everything about `nodes`, e.g. after they were cut from
+        // the tree
+        void remove(const QVector<QUuid> &nodes);
+
+        [[nodiscard]] QString comment(QUuid node) const;
+        void setComment(QUuid node, std::string_view text);
+
+        [[nodiscard]] QVector<uint8_t> nags(QUuid node) const;
+        // Up to four per node, the rest are dropped
+        void setNags(QUuid node, const QVector<uint8_t> &nags);
+
+        [[nodiscard]] int32_t eval(QUuid node) const;
+        void setEval(QUuid node, int32_t eval);
+
+        // Remaining time in milliseconds after the move, noClock if unknown
+        [[nodiscard]] int32_t clock(QUuid node) const;
+        void setClock(QUuid node, int32_t ms);
+
+        [[nodiscard]] QVector<Arrow> arrows(QUuid node) const;
+        void setArrows(QUuid node, const QVector<Arrow> &arrows);
+
+        // Bulk gathers, parallel to `nodes` with the empty value for nodes
+        // without the annotation
+        [[nodiscard]] QVector<int32_t> evals(const QVector<QUuid> &nodes) const;
+        [[nodiscard]] QVector<int32_t> clocks(const QVector<QUuid> &nodes) const;
+
+        // Everything of a node as the text of a PGN comment: the comment
+        // followed by [%clk], [%eval] and [%cal] commands
+        [[nodiscard]] std::string pgnComment(QUuid node) const;
+        // The reverse, commands are taken out of the text and stored in
+        // their own columns
+        void setPgnComment(QUuid node, std::string_view text);
+
+    private:
+        // Slots are handed out on the first write. Those of removed nodes
+        // are left in the columns until they make up half of them, then
+        // the columns and strings are packed again.
+        QHash<QUuid, int> slots;
+        int deadSlots = 0;
+
+        QVector<int32_t> commentIds;
+        QVector<uint32_t> packedNags;
+        QVector<int32_t> evalColumn;
+        QVector<int32_t> clockColumn;
+        // Arrows of a slot are a range of arrowPool, rewritten in place when
+        // they fit and appended otherwise
+        QVector<uint32_t> arrowBegin;
+        QVector<uint8_t> arrowCount;
+        QVector<Arrow> arrowPool;
+
+        StringArena strings;
+
+        [[nodiscard]] int slot(QUuid node) const { return slots.value(node, -1); }
+        int ensureSlot(QUuid node);
+        void compactArrows();
+        void compactSlots();
+    };
+}
+
+
+#endif //DISBOARD_ANNOTATIONS_H
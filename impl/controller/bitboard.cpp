@@ -0,0 +1,308 @@
+#include "bitboard.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DISBOARD_HAS_PEXT 1
+#include <immintrin.h>
+#if !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace disboard;
+using namespace disboard::bitboard;
+
+namespace {
+    struct Delta {
+        int file;
+        int rank;
+    };
+
+    constexpr Delta bishopDeltas[4] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    constexpr Delta rookDeltas[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+    Bitboard slidingAttacks(const Delta *deltas, Square square, Bitboard occupied) {
+        Bitboard result = 0;
+        for (int dir = 0; dir < 4; dir += 1) {
+            auto delta = deltas[dir];
+            int file = square.file() + delta.file;
+            int rank = square.rank() + delta.rank;
+            while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                auto bb = fromSquare(Square(file, rank));
+                result |= bb;
+                if (occupied & bb) break;
+                file += delta.file;
+                rank += delta.rank;
+            }
+        }
+        return result;
+    }
+
+    Bitboard stepAttacks(std::initializer_list<Delta> deltas, Square square) {
+        Bitboard result = 0;
+        for (auto delta: deltas) {
+            int file = square.file() + delta.file;
+            int rank = square.rank() + delta.rank;
+            if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+                result |= fromSquare(Square(file, rank));
+            }
+        }
+        return result;
+    }
+
+    bool cpuHasFastPext() {
+#if defined(DISBOARD_HAS_PEXT)
+        unsigned regs[4] = {};
+        auto cpuid = [&regs](unsigned leaf, unsigned subleaf) {
+#if defined(_MSC_VER)
+            int out[4];
+            __cpuidex(out, static_cast<int>(leaf), static_cast<int>(subleaf));
+            std::memcpy(regs, out, sizeof(regs));
+#else
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        };
+
+        cpuid(0, 0);
+        auto maxLeaf = regs[0];
+        char vendor[13] = {};
+        std::memcpy(vendor, &regs[1], 4);
+        std::memcpy(vendor + 4, &regs[3], 4);
+        std::memcpy(vendor + 8, &regs[2], 4);
+        if (maxLeaf < 7) return false;
+
+        cpuid(7, 0);
+        bool bmi2 = regs[1] & (1u << 8);
+        if (!bmi2) return false;
+
+        // Zen and Zen 2 implement PEXT in microcode, magics are faster there
+        cpuid(1, 0);
+        auto family = ((regs[0] >> 8) & 0xf) + ((regs[0] >> 20) & 0xff);
+        if (std::strcmp(vendor, "AuthenticAMD") == 0 && family < 0x19) return false;
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+#if defined(DISBOARD_HAS_PEXT)
+#if !defined(_MSC_VER)
+    __attribute__((target("bmi2")))
+#endif
+    unsigned pextIndex(Bitboard occupied, Bitboard mask) {
+        return static_cast<unsigned>(_pext_u64(occupied, mask));
+    }
+#endif
+
+    // xorshift64star, seeded per rank so magic search is deterministic
+    class Prng {
+    public:
+        explicit Prng(uint64_t seed) : s(seed) {}
+
+        uint64_t next() {
+            s ^= s >> 12;
+            s ^= s << 25;
+            s ^= s >> 27;
+            return s * 2685821657736338717ULL;
+        }
+
+        uint64_t sparse() { return next() & next() & next(); }
+
+    private:
+        uint64_t s;
+    };
+
+    struct Magic {
+        Bitboard mask;
+        Bitboard magic;
+        Bitboard *attacks;
+        unsigned shift;
+    };
+
+    struct Tables {
+        bool pext;
+
+        Bitboard pawn[2][64];
+        Bitboard knight[64];
+        Bitboard king[64];
+        Bitboard between[64][64];
+        Bitboard line[64][64];
+
+        Magic bishop[64];
+        Magic rook[64];
+        std::vector<Bitboard> bishopTable;
+        std::vector<Bitboard> rookTable;
+
+        Tables();
+
+        [[nodiscard]] unsigned index(const Magic &m, Bitboard occupied) const {
+#if defined(DISBOARD_HAS_PEXT)
+            if (pext) return pextIndex(occupied, m.mask);
+#endif
+            return static_cast<unsigned>(((occupied & m.mask) * m.magic) >> m.shift);
+        }
+
+    private:
+        void initSliders(Magic (&magics)[64], std::vector<Bitboard> &table, const Delta *deltas);
+    };
+
+    Tables::Tables()
+            : pext(false), bishopTable(0x1480), rookTable(0x19000) {
+        const char *forced = std::getenv("DISBOARD_SLIDERS");
+        pext = cpuHasFastPext() && !(forced && std::strcmp(forced, "magic") == 0);
+
+        for (uint8_t idx = 0; idx < 64; idx += 1) {
+            auto square = Square::fromIndex(idx);
+            pawn[static_cast<uint8_t>(Color::White)][idx] = stepAttacks({{-1, 1}, {1, 1}}, square);
+            pawn[static_cast<uint8_t>(Color::Black)][idx] = stepAttacks({{-1, -1}, {1, -1}}, square);
+            knight[idx] = stepAttacks(
+                    {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}},
+                    square
+            );
+            king[idx] = stepAttacks(
+                    {{1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}},
+                    square
+            );
+        }
+
+        initSliders(bishop, bishopTable, bishopDeltas);
+        initSliders(rook, rookTable, rookDeltas);
+
+        for (uint8_t a = 0; a < 64; a += 1) {
+            auto sqA = Square::fromIndex(a);
+            for (uint8_t b = 0; b < 64; b += 1) {
+                auto sqB = Square::fromIndex(b);
+                between[a][b] = 0;
+                line[a][b] = 0;
+                if (a == b) continue;
+
+                for (const Delta *deltas: {bishopDeltas, rookDeltas}) {
+                    if (!(slidingAttacks(deltas, sqA, 0) & fromSquare(sqB))) continue;
+
+                    line[a][b] = (slidingAttacks(deltas, sqA, 0) & slidingAttacks(deltas, sqB, 0))
+                                 | fromSquare(sqA) | fromSquare(sqB);
+                    between[a][b] = slidingAttacks(deltas, sqA, fromSquare(sqB))
+                                    & slidingAttacks(deltas, sqB, fromSquare(sqA));
+                }
+            }
+        }
+    }
+
+    void Tables::initSliders(Magic (&magics)[64], std::vector<Bitboard> &table, const Delta *deltas) {
+        constexpr uint64_t seeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+
+        std::vector<Bitboard> occupancy(4096), reference(4096);
+        std::vector<int> epoch(4096, 0);
+        int attempt = 0;
+        size_t offset = 0;
+
+        for (uint8_t idx = 0; idx < 64; idx += 1) {
+            auto square = Square::fromIndex(idx);
+            auto &m = magics[idx];
+
+            Bitboard edges = ((Rank1 | Rank8) & ~rank(square.rank()))
+                             | ((FileA | FileH) & ~file(square.file()));
+            m.mask = slidingAttacks(deltas, square, 0) & ~edges;
+            m.shift = 64 - count(m.mask);
+            m.magic = 0;
+            m.attacks = table.data() + offset;
+
+            // Carry-Rippler enumeration of every subset of the mask
+            int size = 0;
+            Bitboard b = 0;
+            do {
+                occupancy[size] = b;
+                reference[size] = slidingAttacks(deltas, square, b);
+#if defined(DISBOARD_HAS_PEXT)
+                if (pext) m.attacks[pextIndex(b, m.mask)] = reference[size];
+#endif
+                size += 1;
+                b = (b - m.mask) & m.mask;
+            } while (b);
+            offset += size;
+
+            if (pext) continue;
+
+            Prng rng(seeds[square.rank()]);
+            for (int i = 0; i < size;) {
+                do {
+                    m.magic = rng.sparse();
+                } while (count((m.magic * m.mask) >> 56) < 6);
+
+                attempt += 1;
+                for (i = 0; i < size; i += 1) {
+                    auto entry = index(m, occupancy[i]);
+                    if (epoch[entry] < attempt) {
+                        epoch[entry] = attempt;
+                        m.attacks[entry] = reference[i];
+                    } else if (m.attacks[entry] != reference[i]) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    const Tables &tables() {
+        static const Tables instance;
+        return instance;
+    }
+}
+
+Bitboard bitboard::pawnAttacks(Color color, Square square) {
+    return tables().pawn[static_cast<uint8_t>(color)][square.index()];
+}
+
+Bitboard bitboard::knightAttacks(Square square) {
+    return tables().knight[square.index()];
+}
+
+Bitboard bitboard::kingAttacks(Square square) {
+    return tables().king[square.index()];
+}
+
+Bitboard bitboard::bishopAttacks(Square square, Bitboard occupied) {
+    const auto &t = tables();
+    const auto &m = t.bishop[square.index()];
+    return m.attacks[t.index(m, occupied)];
+}
+
+Bitboard bitboard::rookAttacks(Square square, Bitboard occupied) {
+    const auto &t = tables();
+    const auto &m = t.rook[square.index()];
+    return m.attacks[t.index(m, occupied)];
+}
+
+Bitboard bitboard::attacks(Role role, Color color, Square square, Bitboard occupied) {
+    switch (role) {
+        case Role::Pawn:
+            return pawnAttacks(color, square);
+        case Role::Knight:
+            return knightAttacks(square);
+        case Role::Bishop:
+            return bishopAttacks(square, occupied);
+        case Role::Rook:
+            return rookAttacks(square, occupied);
+        case Role::Queen:
+            return queenAttacks(square, occupied);
+        case Role::King:
+            return kingAttacks(square);
+    }
+    return 0;
+}
+
+Bitboard bitboard::between(Square a, Square b) {
+    return tables().between[a.index()][b.index()];
+}
+
+Bitboard bitboard::line(Square a, Square b) {
+    return tables().line[a.index()][b.index()];
+}
+
+const char *bitboard::slidingBackend() {
+    return tables().pext ? "pext" : "magic";
+}
@@ -0,0 +1,89 @@
+#ifndef DISBOARD_BITBOARD_H
+#define DISBOARD_BITBOARD_H
+
+#include "square.h"
+#include "piece.h"
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace disboard {
+    using Bitboard = uint64_t;
+
+    namespace bitboard {
+        constexpr Bitboard Empty = 0;
+        constexpr Bitboard All = ~Bitboard(0);
+
+        constexpr Bitboard FileA = 0x0101010101010101ULL;
+        constexpr Bitboard FileH = FileA << 7;
+        constexpr Bitboard Rank1 = 0xffULL;
+        constexpr Bitboard Rank8 = Rank1 << 56;
+        // a1 and every square of its color
+        constexpr Bitboard DarkSquares = 0xaa55aa55aa55aa55ULL;
+
+        [[nodiscard]] constexpr Bitboard fromSquare(Square square) {
+            return Bitboard(1) << square.index();
+        }
+        [[nodiscard]] constexpr bool contains(Bitboard bb, Square square) {
+            return (bb >> square.index()) & 1;
+        }
+        [[nodiscard]] constexpr Bitboard file(uint8_t file) { return FileA << file; }
+        [[nodiscard]] constexpr Bitboard rank(uint8_t rank) { return Rank1 << (8 * rank); }
+
+        [[nodiscard]] inline int count(Bitboard bb) {
+#if defined(_MSC_VER)
+            return static_cast<int>(__popcnt64(bb));
+#else
+            return __builtin_popcountll(bb);
+#endif
+        }
+
+        [[nodiscard]] constexpr bool moreThanOne(Bitboard bb) {
+            return bb & (bb - 1);
+        }
+
+        // Undefined for an empty bitboard
+        [[nodiscard]] inline Square lsb(Bitboard bb) {
+#if defined(_MSC_VER)
+            unsigned long idx;
+            _BitScanForward64(&idx, bb);
+            return Square::fromIndex(static_cast<uint8_t>(idx));
+#else
+            return Square::fromIndex(static_cast<uint8_t>(__builtin_ctzll(bb)));
+#endif
+        }
+
+        inline Square popLsb(Bitboard &bb) {
+            auto square = lsb(bb);
+            bb &= bb - 1;
+            return square;
+        }
+
+        [[nodiscard]] Bitboard pawnAttacks(Color color, Square square);
+        [[nodiscard]] Bitboard knightAttacks(Square square);
+        [[nodiscard]] Bitboard kingAttacks(Square square);
+        [[nodiscard]] Bitboard bishopAttacks(Square square, Bitboard occupied);
+        [[nodiscard]] Bitboard rookAttacks(Square square, Bitboard occupied);
+        [[nodiscard]] inline Bitboard queenAttacks(Square square, Bitboard occupied) {
+            return bishopAttacks(square, occupied) | rookAttacks(square, occupied);
+        }
+        [[nodiscard]] Bitboard attacks(Role role, Color color, Square square, Bitboard occupied);
+
+        // Squares strictly between two aligned squares, empty otherwise
+        [[nodiscard]] Bitboard between(Square a, Square b);
+        // The full rank, file or diagonal through two aligned squares, empty otherwise
+        [[nodiscard]] Bitboard line(Square a, Square b);
+
+        // Sliding attacks are looked up with BMI2 PEXT when the CPU has a
+        // fast implementation of it, and with magic multiplication otherwise.
+        // The choice is made once at startup; setting DISBOARD_SLIDERS=magic
+        // forces the portable path.
+        [[nodiscard]] const char *slidingBackend();
+    }
+}
+
+
+#endif //DISBOARD_BITBOARD_H
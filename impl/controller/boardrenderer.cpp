@@ -0,0 +1,214 @@
+#include "boardrenderer.h"
+
+#include <QBuffer>
+#include <QPainter>
+#include <QSvgRenderer>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+using namespace disboard;
+
+namespace {
+    constexpr Role roles[] = {Role::Pawn, Role::Knight, Role::Bishop, Role::Rook, Role::Queen, Role::King};
+
+    int pieceIndex(Piece piece) {
+        return static_cast<int>(piece.color()) * 6 + static_cast<int>(piece.role()) - 1;
+    }
+
+    QRgb blend(const QColor &base, const QColor &overlay) {
+        auto alpha = overlay.alphaF();
+        return qRgb(
+                qRound(base.red() * (1 - alpha) + overlay.red() * alpha),
+                qRound(base.green() * (1 - alpha) + overlay.green() * alpha),
+                qRound(base.blue() * (1 - alpha) + overlay.blue() * alpha)
+        );
+    }
+}
+
+BoardRenderer::BoardRenderer(RenderOptions options)
+        : options(std::move(options)), squareSize(std::max(this->options.size / 8, 1)) {
+    emptyBoard = QImage(squareSize * 8, squareSize * 8, QImage::Format_ARGB32_Premultiplied);
+    {
+        QPainter painter(&emptyBoard);
+        for (uint8_t idx = 0; idx < 64; idx += 1) {
+            auto square = Square::fromIndex(idx);
+            bool light = (square.file() + square.rank()) % 2 == 1;
+            painter.fillRect(squareRect(square), light ? this->options.light : this->options.dark);
+        }
+    }
+
+    // QSvgRenderer is not meant for concurrent use, so every piece is
+    // rasterized here once and only the bitmaps are shared
+    for (auto color: {Color::Black, Color::White}) {
+        for (auto role: roles) {
+            Piece piece(color, role);
+            QSvgRenderer svg(QStringLiteral("%1/%2.svg").arg(this->options.pieceDir, piece.pieceStr()));
+            if (!svg.isValid()) {
+                loaded = false;
+                continue;
+            }
+
+            QImage image(squareSize, squareSize, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            painter.setRenderHint(QPainter::Antialiasing);
+            svg.render(&painter);
+            painter.end();
+            pieces[pieceIndex(piece)] = std::move(image);
+        }
+    }
+}
+
+QImage BoardRenderer::render(const RenderJob &job) const {
+    auto image = emptyBoard.copy();
+    QPainter painter(&image);
+
+    if (job.lastMove.has_value()) {
+        painter.fillRect(squareRect(job.lastMove->from()), options.lastMove);
+        painter.fillRect(squareRect(job.lastMove->to()), options.lastMove);
+    }
+    for (auto square: job.highlights) {
+        painter.fillRect(squareRect(square), options.highlight);
+    }
+
+    auto occupied = job.position.occupied();
+    while (occupied) {
+        auto square = bitboard::popLsb(occupied);
+        const auto &piece = pieces[pieceIndex(*job.position.pieceAt(square))];
+        if (!piece.isNull()) painter.drawImage(squareRect(square).topLeft(), piece);
+    }
+
+    painter.end();
+    return image;
+}
+
+void BoardRenderer::renderAll(const QVector<RenderJob> &jobs,
+                              const std::function<void(int, QImage &&)> &onImage) const {
+    std::atomic<int> next{0};
+    auto count = static_cast<int>(jobs.count());
+    auto work = [&]() {
+        for (auto idx = next.fetch_add(1); idx < count; idx = next.fetch_add(1)) {
+            onImage(idx, render(jobs[idx]));
+        }
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount());
+    for (int idx = 0; idx < pool.maxThreadCount(); idx += 1) {
+        pool.start(work);
+    }
+    pool.waitForDone();
+}
+
+void BoardRenderer::renderInOrder(const QVector<RenderJob> &jobs,
+                                  const std::function<void(int, QImage &&)> &onImage) const {
+    auto count = static_cast<int>(jobs.count());
+    auto threads = threadCount();
+    // How far rendering may run ahead of the consumer
+    auto window = threads * 4;
+
+    std::mutex mutex;
+    std::condition_variable advanced;
+    QVector<std::optional<QImage>> ready(count);
+    int claimed = 0;
+    int delivered = 0;
+    bool delivering = false;
+
+    auto work = [&]() {
+        std::unique_lock lock(mutex);
+        for (;;) {
+            advanced.wait(lock, [&]() { return claimed >= count || claimed < delivered + window; });
+            if (claimed >= count) return;
+            auto idx = claimed++;
+
+            lock.unlock();
+            auto image = render(jobs[idx]);
+            lock.lock();
+            ready[idx] = std::move(image);
+
+            // Whichever worker finds the next image ready hands it and the
+            // ones after it over, the others keep rendering
+            if (delivering) continue;
+            delivering = true;
+            while (delivered < count && ready[delivered].has_value()) {
+                auto out = std::move(*ready[delivered]);
+                ready[delivered].reset();
+                auto outIdx = delivered;
+
+                lock.unlock();
+                onImage(outIdx, std::move(out));
+                lock.lock();
+                delivered += 1;
+                advanced.notify_all();
+            }
+            delivering = false;
+        }
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int idx = 0; idx < threads; idx += 1) {
+        pool.start(work);
+    }
+    pool.waitForDone();
+}
+
+QVector<QRgb> BoardRenderer::keyColors() const {
+    return {
+            options.light.rgb(),
+            options.dark.rgb(),
+            blend(options.light, options.lastMove),
+            blend(options.dark, options.lastMove),
+            blend(options.light, options.highlight),
+            blend(options.dark, options.highlight),
+    };
+}
+
+QVector<RenderJob> BoardRenderer::mainline(const Disboard &board) {
+    // Entries come mainline first, so the mainline is the leading run of
+    // nodes each parented by the one before
+    auto entries = board.nodes();
+    QVector<RenderJob> jobs;
+    auto position = board.initialPosition();
+    jobs.push_back({position, {}, {}});
+    for (qsizetype idx = 1; idx < entries.count() && entries[idx].parent == idx - 1; idx += 1) {
+        position.play(entries[idx].move);
+        jobs.push_back({position, entries[idx].move, {}});
+    }
+    return jobs;
+}
+
+QVector<RenderJob> BoardRenderer::mainline(const PgnGame &game) {
+    QVector<RenderJob> jobs;
+    auto position = game.start;
+    jobs.push_back({position, {}, {}});
+    for (auto m: game.mainlineMoves()) {
+        position.play(m);
+        jobs.push_back({position, m, {}});
+    }
+    return jobs;
+}
+
+QByteArray BoardRenderer::encodePng(const QImage &image) {
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    // Boards compress well at any level, the fast one keeps up with rendering
+    image.save(&buffer, "PNG", 80);
+    return bytes;
+}
+
+int BoardRenderer::threadCount() const {
+    return options.threads > 0 ? options.threads : std::max(1, QThread::idealThreadCount());
+}
+
+QRect BoardRenderer::squareRect(Square square) const {
+    auto file = options.flipped ? 7 - square.file() : square.file();
+    auto rank = options.flipped ? square.rank() : 7 - square.rank();
+    return {file * squareSize, rank * squareSize, squareSize, squareSize};
+}
@@ -0,0 +1,86 @@
+#ifndef DISBOARD_BOARDRENDERER_H
+#define DISBOARD_BOARDRENDERER_H
+
+#include <QByteArray>
+#include <QColor>
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+#include <array>
+#include <functional>
+#include <optional>
+
+#include "disboard.h"
+#include "pgn.h"
+
+namespace disboard {
+    struct RenderOptions {
+        // Board edge in pixels, rounded down to a multiple of 8
+        int size = 256;
+        // Black at the bottom
+        bool flipped = false;
+
+        // Same as the QML board: blue.svg and its highlight overlay
+        QColor light{0xea, 0xe9, 0xd2};
+        QColor dark{0x4b, 0x73, 0x99};
+        QColor lastMove{0x00, 0xa5, 0xff, 0x80};
+        QColor highlight{0xff, 0xd7, 0x00, 0x80};
+
+        // Folder of the wK.svg ... bP.svg pieces, the bundled ones by default
+        QString pieceDir = QStringLiteral(":/chess/pieces");
+        // 0 uses one thread per core
+        int threads = 0;
+    };
+
+    struct RenderJob {
+        Position position;
+        std::optional<Move> lastMove;
+        QVector<Square> highlights;
+    };
+
+    // Draws boards straight into QImage with QPainter, without a scene or a
+    // window. Pieces are rasterized once at construction, every render is
+    // then a copy of the empty board plus a blit per piece, and render()
+    // may be called from any number of threads at once.
+    class BoardRenderer {
+    public:
+        explicit BoardRenderer(RenderOptions options);
+
+        // False when a piece image could not be loaded
+        [[nodiscard]] bool valid() const { return loaded; }
+        [[nodiscard]] int size() const { return squareSize * 8; }
+
+        [[nodiscard]] QImage render(const RenderJob &job) const;
+
+        // Renders on a private pool. `onImage` is called from the workers as
+        // soon as each image is ready, concurrently and in any order.
+        void renderAll(const QVector<RenderJob> &jobs, const std::function<void(int, QImage &&)> &onImage) const;
+        // Same, but `onImage` is called in job order and never concurrently.
+        // Workers stay at most a few images ahead of it.
+        void renderInOrder(const QVector<RenderJob> &jobs, const std::function<void(int, QImage &&)> &onImage) const;
+
+        // Colors worth an exact palette entry when quantizing, e.g. for GIF
+        [[nodiscard]] QVector<QRgb> keyColors() const;
+
+        // Root and every mainline position after it, last move marked
+        [[nodiscard]] static QVector<RenderJob> mainline(const Disboard &board);
+        [[nodiscard]] static QVector<RenderJob> mainline(const PgnGame &game);
+
+        [[nodiscard]] static QByteArray encodePng(const QImage &image);
+
+    private:
+        RenderOptions options;
+        int squareSize;
+        bool loaded = true;
+        QImage emptyBoard;
+        // Indexed by color * 6 + role - 1
+        std::array<QImage, 12> pieces;
+
+        [[nodiscard]] int threadCount() const;
+        [[nodiscard]] QRect squareRect(Square square) const;
+    };
+}
+
+
+#endif //DISBOARD_BOARDRENDERER_H
@@ -1,7 +1,25 @@
 #include "controller.h"
 
+#include "frameprobe.h"
+#include "journal.h"
+#include "repertoire.h"
+#include "scheduler.h"
+#include "tablebase.h"
+#include "treesession.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QPointer>
+#include <QTimer>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <tuple>
+#include <utility>
 
 disboard::Square coord_to_square(float x, float y, int piece_size) {
     uint8_t file = ((int) x) / piece_size;
@@ -14,7 +32,34 @@ class Controller::p {
     friend Controller;
 public:
     explicit p(Controller *q)
-        : q(q), board({}), curNode(board.root()), pieceSize(0) {}
+        : q(q), board({}), curNode(board.root()), pieceSize(0),
+          probe(q, [this](qint64 startNs, qint64 presentedNs) {
+              inputLatency.add(static_cast<qreal>(presentedNs - startNs) / 1e6);
+              emit this->q->inputLatencyChanged();
+          }) {
+        seekTimer.setSingleShot(true);
+        seekTimer.setTimerType(Qt::PreciseTimer);
+        seekTimer.setInterval(seekIntervalMs);
+        QObject::connect(&seekTimer, &QTimer::timeout, q, [this]() {
+            flushSeek();
+        });
+        QObject::connect(q, &Controller::curNodeChanged, q, [this]() {
+            // Work queued for the node we left is dropped unstarted
+            nodeToken.cancel();
+            nodeToken = disboard::CancelToken::make();
+            probeTablebase();
+            updateMasks();
+        });
+        // Connected before anything outside, so the masks are current for
+        // every other receiver
+        QObject::connect(q, &Controller::highlightedSqChanged, q, [this]() { updateMasks(); });
+        QObject::connect(q, &Controller::premovesChanged, q, [this]() { updateMasks(); });
+        QObject::connect(&memoryTimer, &QTimer::timeout, q, [this]() {
+            sampleMemory();
+            qInfo().noquote() << "memory:" << memoryStats.toString();
+            qInfo().noquote() << "scheduler:" << disboard::Scheduler::instance().stats().toString();
+        });
+    }
 
     void resync() {
         const auto [squares, pieces] = board.pieces(curNode);
@@ -27,6 +72,11 @@ public:
 
         if (cancelPromotion()) return;
 
+        if (premoveMode()) {
+            premoveClicked(_highlightedSq, sq);
+            return;
+        }
+
         if (_highlightedSq.has_value()) {
             auto srcSq = *_highlightedSq;
             if (srcSq == sq) {
@@ -56,7 +106,8 @@ public:
 
         if (cancelPromotion()) return;
 
-        auto piece = board.pieceAt(curNode, sq);
+        auto piece = premoveMode() ? premovePieceAt(sq) : board.pieceAt(curNode, sq);
+        if (premoveMode() && piece.has_value() && piece->color() != *playerColor) piece.reset();
         if (!piece.has_value()) {
             // No new piece selected
             return;
@@ -70,7 +121,9 @@ public:
         );
         emit q->dragChanged();
 
-        emit q->removePiece(sq);
+        // A premove may pick up a piece that only gets to `sq` through an
+        // earlier premove, whatever really stands there stays on the board
+        if (!premoveMode() || board.pieceAt(curNode, sq) == piece) emit q->removePiece(sq);
     }
 
     void dragEnded(disboard::Square destSq) {
@@ -81,6 +134,18 @@ public:
         auto srcSq = _dragged->square;
         auto piece = _dragged->piece;
 
+        if (premoveMode()) {
+            // The pieces stay put until the premove is actually played. The
+            // view is put back from the real board, as the piece picked up
+            // may not be the one standing on `srcSq` there.
+            resync();
+            if (queuePremove(srcSq, destSq)) {
+                highlightedSq = {};
+                emit q->highlightedSqChanged();
+            }
+            return;
+        }
+
         auto m = board.legalMove(curNode, srcSq, destSq);
         if (!m.has_value()) {
             emit q->placePiece(piece, srcSq);
@@ -97,8 +162,7 @@ public:
     }
 
     void promote(disboard::Piece piece) {
-        auto _promotion = std::move(promotion);
-        promotion = std::nullopt;
+        auto _promotion = std::exchange(promotion, std::nullopt);
         if (!_promotion.has_value()) {
             qDebug() << "Nothing to promote...";
             return;
@@ -125,6 +189,23 @@ public:
         applyMove(*_promotion);
     }
 
+    void queueSeek(std::optional<int> ply, int plies) {
+        if (ply.has_value()) {
+            pendingPly = ply;
+            pendingSeek = 0;
+        }
+        pendingSeek = std::clamp<qint64>(
+                pendingSeek + plies,
+                std::numeric_limits<int>::min(), std::numeric_limits<int>::max()
+        );
+
+        // The first request of a burst is applied right away, the rest are
+        // accumulated until the frame interval elapses.
+        if (seekTimer.isActive()) return;
+        flushSeek();
+        seekTimer.start();
+    }
+
 private:
     Controller *q;
     disboard::Disboard board;
@@ -132,6 +213,11 @@ private:
     int pieceSize;
     QUuid curNode;
     std::optional<disboard::Square> highlightedSq;
+    disboard::Bitboard hintBits = disboard::bitboard::Empty;
+    disboard::Bitboard captureBits = disboard::bitboard::Empty;
+    std::array<disboard::Bitboard, 3> wdlBits{};
+    // Cancelled whenever curNode changes
+    disboard::CancelToken nodeToken = disboard::CancelToken::make();
 
     struct DraggedPiece {
         disboard::Square square;
@@ -144,7 +230,209 @@ private:
     std::optional<DraggedPiece> dragged;
     std::optional<disboard::Move> promotion;
 
-    void tryApplyMove(const disboard::Move& m) {
+    // Drag positions are applied once per frame, right before the scene is
+    // polished, and timed from the first input of the frame to its swap.
+    disboard::FrameProbe probe;
+    disboard::LatencyStats inputLatency;
+    QMetaObject::Connection animatingConnection;
+    std::optional<QPointF> pendingDragPos;
+    qint64 pendingDragStart = 0;
+    disboard::Square dragSq;
+
+    void setWindow(QQuickWindow *window) {
+        QObject::disconnect(animatingConnection);
+        flushDragPos();
+        probe.setWindow(window);
+        if (!window) return;
+
+        animatingConnection = QObject::connect(window, &QQuickWindow::afterAnimating, q, [this]() {
+            flushDragPos();
+        });
+    }
+
+    void queueDragPos(QPointF pos) {
+        if (!probe.window()) {
+            applyDragPos(pos, disboard::FrameProbe::now());
+            return;
+        }
+
+        if (!pendingDragPos.has_value()) pendingDragStart = disboard::FrameProbe::now();
+        pendingDragPos = pos;
+        probe.window()->update();
+    }
+
+    void flushDragPos() {
+        auto pos = std::exchange(pendingDragPos, std::nullopt);
+        if (!pos.has_value()) return;
+        applyDragPos(*pos, pendingDragStart);
+    }
+
+    void applyDragPos(QPointF pos, qint64 startNs) {
+        if (q->mDragPos == pos) return;
+        q->mDragPos = pos;
+        emit q->dragPosChanged();
+        updateDragSq();
+
+        probe.mark(startNs);
+    }
+
+    void updateDragSq() {
+        auto sq = coord_to_square(
+                q->mDragPos.x(), q->mDragPos.y(),
+                std::max(pieceSize, 1)
+        );
+        if (sq == dragSq) return;
+        dragSq = sq;
+        emit q->dragSqChanged();
+    }
+
+    // Side the user plays, premoves are accepted while it is not to move
+    std::optional<disboard::Color> playerColor;
+    QVector<disboard::Move> premoves;
+
+    // Autosave, every tree edit is appended as it happens
+    std::unique_ptr<disboard::Journal> journal;
+
+    void journalAdded(QUuid parent, const QVector<QUuid> &nodes, const QVector<disboard::Move> &moves) {
+        if (journal) journal->added(board, parent, nodes, moves);
+    }
+
+    void openJournal(const QString &path) {
+        journal.reset();
+        if (path.isEmpty()) return;
+
+        // Whatever the last session left behind comes back first, then the
+        // journal starts over from a snapshot of it
+        if (auto replay = disboard::Journal::replay(path)) {
+            load(std::move(replay->board));
+            q->setCurNode(replay->curNode);
+        }
+        journal = std::make_unique<disboard::Journal>(path, board, curNode);
+    }
+
+    disboard::MemoryStats memoryStats;
+    QTimer memoryTimer;
+    QPointer<TreeSession> session;
+
+    void sampleMemory() {
+        memoryStats = board.memoryStats();
+        emit q->memoryStatsChanged();
+    }
+
+    // Game counts of the loaded repertoire, empty for any other tree
+    QHash<QUuid, disboard::NodeStats> stats;
+
+    void loadRepertoire(const QString &path) {
+        // Built off the GUI thread, only the swap happens here
+        disboard::Scheduler::instance().run(disboard::Priority::Background, q, [path]() {
+            return disboard::RepertoireBuilder({}).load(path);
+        }, [q = q](std::optional<disboard::Repertoire> repertoire) {
+            if (repertoire.has_value()) q->setRepertoire(std::move(*repertoire));
+            emit q->repertoireLoaded(repertoire.has_value());
+        });
+    }
+
+    QString tablebasePath;
+    std::unique_ptr<disboard::Tablebase> tablebase;
+    // Probe of the current node's position
+    std::optional<disboard::TablebaseProbe> tablebaseProbe;
+    std::optional<uint64_t> tablebaseHash;
+    int tablebaseGeneration = 0;
+
+    void loadTablebases() {
+        // Tables cannot be removed, so a new path means new tables and
+        // probes of the old ones landing late are ignored.
+        tablebase.reset();
+        tablebaseGeneration += 1;
+        tablebaseHash.reset();
+        auto dirs = tablebasePath.split(QDir::listSeparator(), Qt::SkipEmptyParts);
+        if (!dirs.empty()) {
+            tablebase = std::make_unique<disboard::Tablebase>(q);
+            for (const auto &dir: dirs) tablebase->addDirectory(dir);
+        }
+        probeTablebase();
+    }
+
+    // Quiet and capture targets of the highlighted piece, then the targets
+    // with a known tablebase result split by win, draw and loss. Worked out
+    // once per change of the highlight or the premoves and read by every
+    // mask property in between.
+    void updateMasks() {
+        hintBits = captureBits = disboard::bitboard::Empty;
+        wdlBits = {};
+        if (!highlightedSq.has_value()) return;
+
+        if (premoveMode()) {
+            // Every pseudo target counts as quiet
+            if (auto piece = premovePieceAt(*highlightedSq)) {
+                hintBits = disboard::Position::premoveTargets(*piece, *highlightedSq);
+            }
+            return;
+        }
+        std::tie(hintBits, captureBits) = board.hints(curNode, *highlightedSq);
+
+        if (!tablebaseProbe.has_value()) return;
+        auto targets = hintBits | captureBits;
+        while (targets) {
+            auto sq = disboard::bitboard::popLsb(targets);
+            auto value = tablebaseProbe->wdlAfter(*highlightedSq, sq);
+            if (!value.has_value()) continue;
+            wdlBits[*value > 0 ? 0 : *value == 0 ? 1 : 2] |= disboard::bitboard::fromSquare(sq);
+        }
+    }
+
+    void probeTablebase() {
+        auto position = board.position(curNode);
+        if (tablebaseHash == position.hash()) {
+            // A transposition keeps its probe, but one still pending was
+            // cancelled with the old node and has to be asked for again
+            if (!tablebaseProbe.has_value()) requestProbe(position);
+            return;
+        }
+        tablebaseHash = position.hash();
+
+        bool hadProbe = tablebaseProbe.has_value();
+        tablebaseProbe.reset();
+        if (hadProbe) {
+            emit q->tablebaseChanged();
+            emit q->highlightedSqChanged();
+        }
+
+        requestProbe(position);
+    }
+
+    void requestProbe(const disboard::Position &position) {
+        if (!tablebase) return;
+        auto generation = tablebaseGeneration;
+        tablebase->probeAsync(position, [this, generation](uint64_t hash, std::optional<disboard::TablebaseProbe> probe) {
+            // The board may have moved on while the files were read
+            if (generation != tablebaseGeneration || tablebaseHash != hash || !probe.has_value()) return;
+            tablebaseProbe = std::move(probe);
+            emit q->tablebaseChanged();
+            emit q->highlightedSqChanged();
+        }, nodeToken);
+    }
+
+    static constexpr int seekIntervalMs = 16;
+    QTimer seekTimer;
+    qint64 pendingSeek = 0;
+    std::optional<int> pendingPly;
+
+    void flushSeek() {
+        auto ply = std::exchange(pendingPly, std::nullopt);
+        auto plies = static_cast<int>(std::exchange(pendingSeek, 0));
+        if (!ply.has_value() && plies == 0) return;
+
+        auto target = curNode;
+        if (ply.has_value()) {
+            target = board.seekToPly(target, *ply);
+        }
+        target = board.seek(target, plies);
+
+        q->setCurNode(target);
+    }
+
+    void tryApplyMove(disboard::Move m) {
         if (m.isPromotion()) {
             promotion.emplace(m);
             emit q->promotionChanged();
@@ -168,16 +456,17 @@ private:
         applyMove(m);
     }
 
-    void applyMove(const disboard::Move& m) {
-        auto newNode = board.addNode(curNode, m);
+    void applyMove(disboard::Move m) {
+        auto parent = curNode;
+        auto newNode = board.addNode(parent, m);
+        journalAdded(parent, {newNode}, {m});
         setCurNode(newNode);
         emit q->nodePushed(newNode);
         emit q->treeChanged();
     }
 
     bool cancelPromotion() {
-        auto _promotion = std::move(promotion);
-        promotion = std::nullopt;
+        auto _promotion = std::exchange(promotion, std::nullopt);
         if (!_promotion.has_value()) return false;
 
         emit q->promotionChanged();
@@ -193,11 +482,204 @@ private:
         return true;
     }
 
+    int appendMainline(const QVector<disboard::Move> &moves) {
+        auto end = board.seek(board.root(), std::numeric_limits<int>::max());
+        bool follow = curNode == end;
+
+        auto newNodes = board.addNodes(end, moves);
+        if (newNodes.empty()) return 0;
+        auto added = static_cast<int>(newNodes.count());
+
+        // The reply goes into the same tree update and the same resync as
+        // the move it answers, without a round trip through the event loop.
+        std::optional<QUuid> premoveNode;
+        auto newMoves = moves.mid(0, added);
+        if (follow && !premoves.empty()) {
+            premoveNode = playPremove(newNodes.back());
+            if (premoveNode.has_value()) {
+                newNodes.push_back(*premoveNode);
+                newMoves.push_back(*board.lastMove(*premoveNode));
+            }
+        }
+        journalAdded(end, newNodes, newMoves);
+
+        emit q->nodesPushed(newNodes);
+        emit q->treeChanged();
+
+        if (follow) q->setCurNode(newNodes.back());
+        if (premoveNode.has_value()) emit q->premoveApplied(*premoveNode);
+        return added;
+    }
+
+    QVector<QUuid> addMoves(QUuid node, const QStringList &moves) {
+        auto parsed = board.parseMoves(node, moves);
+        auto newNodes = board.addNodes(node, parsed);
+        if (newNodes.empty()) return {};
+        journalAdded(node, newNodes, parsed);
+
+        emit q->nodesPushed(newNodes);
+        emit q->treeChanged();
+        return newNodes;
+    }
+
+    bool removeNodes(QUuid parent, const QVector<QUuid> &removed) {
+        if (removed.empty()) return false;
+
+        if (removed.contains(curNode)) {
+            // The resync puts back whatever was picked up or promoting
+            promotion.reset();
+            dragged.reset();
+            highlightedSq.reset();
+            emit q->promotionChanged();
+            emit q->dragChanged();
+            emit q->highlightedSqChanged();
+            q->setCurNode(parent);
+        }
+
+        emit q->nodesRemoved(parent, removed);
+        emit q->treeChanged();
+        return true;
+    }
+
+    void reordered(const QVector<QUuid> &parents) {
+        for (auto parent: parents) emit q->variationsReordered(parent);
+        emit q->treeChanged();
+    }
+
+    void annotated(QUuid node) {
+        emit q->annotationsChanged(node);
+        emit q->treeChanged();
+    }
+
+    [[nodiscard]] bool premoveMode() const {
+        return playerColor.has_value() && board.turn(curNode) != *playerColor;
+    }
+
+    // The board as it will look once the queued premoves are played,
+    // regardless of what the opponent does in between
+    [[nodiscard]] std::array<std::optional<disboard::Piece>, 64> premoveBoard() const {
+        std::array<std::optional<disboard::Piece>, 64> squares;
+        auto position = board.position(curNode);
+        auto occupied = position.occupied();
+        while (occupied) {
+            auto sq = disboard::bitboard::popLsb(occupied);
+            squares[sq.index()] = position.pieceAt(sq);
+        }
+        for (const auto &premove: premoves) {
+            auto from = premove.from(), to = premove.to();
+            auto piece = std::exchange(squares[from.index()], std::nullopt);
+            if (piece.has_value() && piece->role() == disboard::Role::King
+                && std::abs(to.file() - from.file()) >= 2) {
+                // Castling, queued onto the king's target or the rook itself
+                bool kingside = to.file() > from.file();
+                auto rank = from.rank();
+                auto rook = std::exchange(squares[disboard::Square(kingside ? 7 : 0, rank).index()], std::nullopt);
+                squares[disboard::Square(kingside ? 5 : 3, rank).index()] = rook;
+                to = disboard::Square(kingside ? 6 : 2, rank);
+            }
+            squares[to.index()] = piece;
+        }
+        return squares;
+    }
+
+    [[nodiscard]] std::optional<disboard::Piece> premovePieceAt(disboard::Square sq) const {
+        return premoveBoard()[sq.index()];
+    }
+
+    void premoveClicked(std::optional<disboard::Square> srcSq, disboard::Square sq) {
+        if (srcSq.has_value()) {
+            if (*srcSq == sq) return;
+            if (queuePremove(*srcSq, sq)) return;
+        }
+
+        auto piece = premovePieceAt(sq);
+        if (!piece.has_value() || piece->color() != *playerColor) {
+            // Clicking anywhere else drops the queue, as on most servers
+            if (!srcSq.has_value()) clearPremoves();
+            return;
+        }
+
+        highlightedSq = sq;
+    }
+
+    bool queuePremove(disboard::Square from, disboard::Square to) {
+        if (from == to) return false;
+
+        auto piece = premovePieceAt(from);
+        if (!piece.has_value() || piece->color() != *playerColor) return false;
+        if (!disboard::bitboard::contains(disboard::Position::premoveTargets(*piece, from), to)) return false;
+
+        // Promotions are queued as queens, there is no time to ask
+        auto kind = disboard::Move::Kind::Normal;
+        if (piece->role() == disboard::Role::Pawn && (to.rank() == 0 || to.rank() == 7)) {
+            kind = disboard::Move::Kind::Promotion;
+        }
+        premoves.push_back(disboard::Move(from, to, kind, disboard::Role::Queen));
+        emit q->premovesChanged();
+        return true;
+    }
+
+    void clearPremoves() {
+        if (premoves.empty()) return;
+        premoves.clear();
+        emit q->premovesChanged();
+    }
+
+    // Plays the first premove after `node` if it is legal there. An illegal
+    // premove cancels the whole queue, the rest was planned around it.
+    std::optional<QUuid> playPremove(QUuid node) {
+        if (!playerColor.has_value() || board.turn(node) != *playerColor) return {};
+
+        auto premove = premoves.takeFirst();
+        auto m = board.legalMove(node, premove.from(), premove.to());
+        if (m.has_value() && m->isPromotion()) m->setPromotion(premove.promotion());
+        if (!m.has_value()) {
+            premoves.clear();
+            emit q->premovesChanged();
+            return {};
+        }
+
+        emit q->premovesChanged();
+        return board.addNode(node, *m);
+    }
+
+    bool load(std::optional<disboard::Disboard> newBoard, QHash<QUuid, disboard::NodeStats> newStats = {}) {
+        if (!newBoard.has_value()) return false;
+
+        board = std::move(*newBoard);
+        stats = std::move(newStats);
+        curNode = board.root();
+        pendingSeek = 0;
+        pendingPly.reset();
+        seekTimer.stop();
+
+        highlightedSq.reset();
+        dragged.reset();
+        promotion.reset();
+        premoves.clear();
+        if (journal) journal->reset(board, curNode);
+
+        emit q->rootChanged();
+        emit q->curNodeChanged();
+        emit q->treeChanged();
+        emit q->highlightedSqChanged();
+        emit q->dragChanged();
+        emit q->promotionChanged();
+        emit q->premovesChanged();
+        resync();
+        return true;
+    }
+
     void setCurNode(QUuid newValue) {
         if (curNode == newValue) {
             return;
         }
+        // Any explicit navigation supersedes queued seeks
+        pendingSeek = 0;
+        pendingPly.reset();
+
         curNode = newValue;
+        if (journal) journal->selected(curNode);
         emit q->curNodeChanged();
     }
 };
@@ -236,18 +718,25 @@ void Controller::promote(disboard::Piece piece) {
     emit promotionChanged();
 }
 
-void Controller::prevMove() {
-    auto prevNode = p->board.prevNode(curNode());
-    if (!prevNode.has_value()) return;
+bool Controller::loadFen(const QString &fen) {
+    auto fenStr = fen.toStdString();
+    return p->load(disboard::Disboard::fromFen(fenStr));
+}
 
-    setCurNode(*prevNode);
+void Controller::prevMove() {
+    setCurNode(p->board.seek(curNode(), -1));
 }
 
 void Controller::nextMove() {
-    auto nextNode = p->board.nextMainlineNode(curNode());
-    if (!nextNode.has_value()) return;
+    setCurNode(p->board.seek(curNode(), 1));
+}
 
-    setCurNode(*nextNode);
+void Controller::seek(int plies) {
+    p->queueSeek(std::nullopt, plies);
+}
+
+void Controller::seekToPly(int ply) {
+    p->queueSeek(ply, 0);
 }
 
 int Controller::pieceSize() const {
@@ -260,6 +749,7 @@ void Controller::setPieceSize(int newValue) {
     }
     p->pieceSize = newValue;
     emit curNodeChanged();
+    p->updateDragSq();
 }
 
 QUuid Controller::root() const {
@@ -278,6 +768,10 @@ void Controller::setCurNode(QUuid newValue) {
     resyncBoard();
 }
 
+int Controller::ply() const {
+    return p->board.ply(curNode());
+}
+
 QVariant Controller::promotionSq() const {
     if (!p->promotion.has_value()) return {};
 
@@ -325,18 +819,38 @@ QPointF Controller::dragPos() const {
 }
 
 void Controller::setDragPos(QPointF newValue) {
-    if (mDragPos == newValue) return;
-    mDragPos = newValue;
-    emit dragPosChanged();
+    p->queueDragPos(newValue);
 }
 
 disboard::Square Controller::dragSq() const {
-    return {
-            coord_to_square(
-                    mDragPos.x(), mDragPos.y(),
-                    std::max(pieceSize(), 1)
-            )
-    };
+    return p->dragSq;
+}
+
+QQuickWindow *Controller::window() const {
+    return p->probe.window();
+}
+
+void Controller::setWindow(QQuickWindow *newValue) {
+    if (p->probe.window() == newValue) return;
+    p->setWindow(newValue);
+    emit windowChanged();
+}
+
+qreal Controller::inputLatency() const {
+    return p->inputLatency.last;
+}
+
+qreal Controller::meanInputLatency() const {
+    return p->inputLatency.mean();
+}
+
+qreal Controller::maxInputLatency() const {
+    return p->inputLatency.max;
+}
+
+void Controller::resetInputLatency() {
+    p->inputLatency = {};
+    emit inputLatencyChanged();
 }
 
 QVariant Controller::highlightedSq() const {
@@ -365,25 +879,294 @@ QVariant Controller::lastDestSq() const {
 }
 
 QVector<disboard::Square> Controller::hintSq() const {
-    if (auto _highlightSq = p->highlightedSq) {
-        const auto [hints, _] = p->board.hints(curNode(), *_highlightSq);
-        return hints;
-    }
-    return {};
+    return hintMask().squares();
 }
 
 QVector<disboard::Square> Controller::captureSq() const {
-    if (auto _highlightSq = p->highlightedSq) {
-        const auto [_, captures] = p->board.hints(curNode(), *_highlightSq);
-        return captures;
+    return captureMask().squares();
+}
+
+disboard::SquareSet Controller::highlightMask() const {
+    if (!p->highlightedSq.has_value()) return {};
+    return disboard::SquareSet(disboard::bitboard::fromSquare(*p->highlightedSq));
+}
+
+disboard::SquareSet Controller::lastMoveMask() const {
+    auto move = p->board.lastMove(curNode());
+    if (!move.has_value()) return {};
+    return disboard::SquareSet(disboard::bitboard::fromSquare(move->from()) |
+                               disboard::bitboard::fromSquare(move->to()));
+}
+
+disboard::SquareSet Controller::hintMask() const {
+    return disboard::SquareSet(p->hintBits);
+}
+
+disboard::SquareSet Controller::captureMask() const {
+    return disboard::SquareSet(p->captureBits);
+}
+
+disboard::SquareSet Controller::winMask() const {
+    return disboard::SquareSet(p->wdlBits[0]);
+}
+
+disboard::SquareSet Controller::drawMask() const {
+    return disboard::SquareSet(p->wdlBits[1]);
+}
+
+disboard::SquareSet Controller::lossMask() const {
+    return disboard::SquareSet(p->wdlBits[2]);
+}
+
+QVariant Controller::playerColor() const {
+    if (!p->playerColor.has_value()) return {};
+    return QVariant::fromValue(*p->playerColor);
+}
+
+void Controller::setPlayerColor(const QVariant &newValue) {
+    std::optional<disboard::Color> color;
+    if (newValue.metaType() == QMetaType::fromType<disboard::Color>()) {
+        color = newValue.value<disboard::Color>();
+    } else if (bool ok = false; !newValue.isNull()) {
+        // Plain numbers from QML, 0 for black and 1 for white
+        auto value = newValue.toInt(&ok);
+        if (ok && (value == 0 || value == 1)) color = static_cast<disboard::Color>(value);
     }
-    return {};
+    if (p->playerColor == color) return;
+
+    p->playerColor = color;
+    p->clearPremoves();
+    emit playerColorChanged();
+    emit highlightedSqChanged();
+}
+
+QVector<disboard::Square> Controller::premoveSq() const {
+    QVector<disboard::Square> squares;
+    squares.reserve(p->premoves.count() * 2);
+    for (const auto &premove: p->premoves) {
+        squares.push_back(premove.from());
+        squares.push_back(premove.to());
+    }
+    return squares;
+}
+
+disboard::SquareSet Controller::premoveMask() const {
+    disboard::Bitboard mask = disboard::bitboard::Empty;
+    for (const auto &premove: p->premoves) {
+        mask |= disboard::bitboard::fromSquare(premove.from()) | disboard::bitboard::fromSquare(premove.to());
+    }
+    return disboard::SquareSet(mask);
+}
+
+void Controller::clearPremoves() {
+    p->clearPremoves();
 }
 
 QString Controller::pgn() const {
     return p->board.pgn();
 }
 
+QString Controller::fen() const {
+    return QString::fromStdString(p->board.position(curNode()).fen());
+}
+
+QString Controller::autosavePath() const {
+    return p->journal ? p->journal->path() : QString();
+}
+
+void Controller::setAutosavePath(const QString &newValue) {
+    if (autosavePath() == newValue) return;
+    p->openJournal(newValue);
+    emit autosavePathChanged();
+}
+
+QString Controller::tablebasePath() const {
+    return p->tablebasePath;
+}
+
+void Controller::setTablebasePath(const QString &newValue) {
+    if (p->tablebasePath == newValue) return;
+    p->tablebasePath = newValue;
+    p->loadTablebases();
+    emit tablebasePathChanged();
+}
+
+QVariant Controller::tablebase() const {
+    const auto &probe = p->tablebaseProbe;
+    if (!probe.has_value()) return {};
+
+    auto position = p->board.position(curNode());
+    QStringList bestMoves;
+    for (auto m: probe->bestMoves()) bestMoves.push_back(QString::fromStdString(position.san(m)));
+
+    return QVariantMap{
+            {QStringLiteral("wdl"), probe->wdl},
+            {QStringLiteral("dtz"), probe->dtz.has_value() ? QVariant(*probe->dtz) : QVariant()},
+            {QStringLiteral("bestMoves"), bestMoves},
+    };
+}
+
+bool Controller::loadPgn(const QString &pgn) {
+    auto game = disboard::PgnGame::parse(pgn.toStdString());
+    if (!game.has_value()) return false;
+    return p->load(disboard::Disboard::fromPgn(*game));
+}
+
+QVariantMap Controller::annotations(QUuid node) const {
+    const auto &notes = p->board.annotations();
+    if (!notes.contains(node)) return {};
+
+    QVariantList nags;
+    for (auto nag: notes.nags(node)) nags.push_back(nag);
+
+    QVariantList arrows;
+    for (const auto &arrow: notes.arrows(node)) {
+        arrows.push_back(QVariantMap{
+                {QStringLiteral("from"), QVariant::fromValue(arrow.from)},
+                {QStringLiteral("to"), QVariant::fromValue(arrow.to)},
+                {QStringLiteral("color"), QString(QChar(arrow.color))},
+        });
+    }
+
+    auto eval = notes.eval(node);
+    auto clock = notes.clock(node);
+    QVariant evalValue, mateValue;
+    if (disboard::Annotations::isMate(eval)) mateValue = disboard::Annotations::mateIn(eval);
+    else if (eval != disboard::Annotations::noEval) evalValue = eval / 100.0;
+
+    return {
+            {QStringLiteral("comment"), notes.comment(node)},
+            {QStringLiteral("nags"), nags},
+            {QStringLiteral("eval"), evalValue},
+            {QStringLiteral("mate"), mateValue},
+            {QStringLiteral("clock"), clock == disboard::Annotations::noClock ? QVariant() : QVariant(clock)},
+            {QStringLiteral("arrows"), arrows},
+    };
+}
+
+void Controller::setComment(QUuid node, const QString &comment) {
+    p->board.annotations().setComment(node, comment.toStdString());
+    p->annotated(node);
+}
+
+void Controller::setEval(QUuid node, const QVariant &pawns) {
+    auto eval = disboard::Annotations::noEval;
+    if (pawns.isValid()) eval = static_cast<int32_t>(std::lround(pawns.toDouble() * 100));
+    p->board.annotations().setEval(node, eval);
+    p->annotated(node);
+}
+
+void Controller::setClock(QUuid node, const QVariant &ms) {
+    p->board.annotations().setClock(node, ms.isValid() ? ms.toInt() : disboard::Annotations::noClock);
+    p->annotated(node);
+}
+
+QVector<QUuid> Controller::addMoves(QUuid node, const QStringList &moves) {
+    return p->addMoves(node, moves);
+}
+
+bool Controller::removeNode(QUuid node) {
+    auto parent = p->board.prevNode(node);
+    if (!parent.has_value()) return false;
+    auto removed = p->board.removeNode(node);
+    if (p->journal && !removed.empty()) p->journal->removed(p->board, node, removed);
+    return p->removeNodes(*parent, removed);
+}
+
+bool Controller::truncate(QUuid node) {
+    auto removed = p->board.truncate(node);
+    if (p->journal && !removed.empty()) p->journal->truncated(p->board, node, removed);
+    return p->removeNodes(node, removed);
+}
+
+bool Controller::moveVariation(QUuid node, int index) {
+    auto parent = p->board.prevNode(node);
+    if (!parent.has_value() || !p->board.moveVariation(node, index)) return false;
+    if (p->journal) p->journal->movedVariation(p->board, node, index);
+    p->reordered({*parent});
+    return true;
+}
+
+bool Controller::promoteVariation(QUuid node) {
+    auto parents = p->board.promoteVariation(node);
+    if (parents.empty()) return false;
+    if (p->journal) p->journal->promotedVariation(p->board, node);
+    p->reordered(parents);
+    return true;
+}
+
+int Controller::appendMainline(const QVector<disboard::Move> &moves) {
+    return p->appendMainline(moves);
+}
+
+void Controller::setBoard(disboard::Disboard &&board) {
+    p->load(std::move(board));
+}
+
+void Controller::setRepertoire(disboard::Repertoire &&repertoire) {
+    p->load(std::move(repertoire.tree), std::move(repertoire.stats));
+}
+
+void Controller::loadRepertoire(const QString &path) {
+    p->loadRepertoire(path);
+}
+
+QVariant Controller::nodeStats(QUuid node) const {
+    auto it = p->stats.constFind(node);
+    if (it == p->stats.constEnd()) return {};
+    return QVariant::fromValue(*it);
+}
+
+QVariant Controller::curNodeStats() const {
+    return nodeStats(curNode());
+}
+
+disboard::GameStatus Controller::gameStatus() const {
+    return p->board.status(p->curNode);
+}
+
+TreeSession *Controller::session() const {
+    return p->session;
+}
+
+void Controller::setSession(TreeSession *newValue) {
+    if (p->session == newValue) return;
+    if (p->session) p->session->remove(this);
+    p->session = newValue;
+    if (p->session) p->session->add(this);
+    emit sessionChanged();
+}
+
+bool Controller::spillTree(const QString &path) {
+    // A piece in hand would read the tree straight back in
+    if (p->dragged.has_value() || p->promotion.has_value()) return false;
+    return p->board.spill(path);
+}
+
+void Controller::refreshMemoryStats() {
+    p->sampleMemory();
+}
+
+disboard::CancelToken Controller::nodeToken() const {
+    return p->nodeToken;
+}
+
+disboard::MemoryStats Controller::memoryStats() const {
+    return p->memoryStats;
+}
+
+int Controller::memoryLogInterval() const {
+    return p->memoryTimer.isActive() ? p->memoryTimer.interval() : 0;
+}
+
+void Controller::setMemoryLogInterval(int newValue) {
+    newValue = std::max(newValue, 0);
+    if (memoryLogInterval() == newValue) return;
+    if (newValue > 0) p->memoryTimer.start(newValue);
+    else p->memoryTimer.stop();
+    emit memoryLogIntervalChanged();
+}
+
 const disboard::Disboard& Controller::board() const {
     return p->board;
 }
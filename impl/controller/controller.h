@@ -5,24 +5,39 @@
 #include <QUuid>
 #include <QVariant>
 #include <QPointF>
+#include <QQuickWindow>
 #include <QtQml/qqmlregistration.h>
 
 #include "disboard.h"
+#include "repertoire.h"
+#include "scheduler.h"
+#include "squareset.h"
+
+class TreeSession;
 
 class Controller : public QObject {
 Q_OBJECT
 
     QML_ELEMENT
     Q_DISABLE_COPY(Controller)
+    Q_MOC_INCLUDE("treesession.h")
 
     Q_PROPERTY(int pieceSize READ pieceSize WRITE setPieceSize NOTIFY pieceSizeChanged)
 
     Q_PROPERTY(QUuid root READ root NOTIFY rootChanged)
     Q_PROPERTY(QUuid curNode READ curNode WRITE setCurNode NOTIFY curNodeChanged)
+    Q_PROPERTY(int ply READ ply NOTIFY curNodeChanged)
 
     Q_PROPERTY(QVariant phantom READ phantom NOTIFY dragChanged)
+    // Writes are applied once per frame when a window is set
     Q_PROPERTY(QPointF dragPos READ dragPos WRITE setDragPos NOTIFY dragPosChanged)
-    Q_PROPERTY(disboard::Square dragSq READ dragSq NOTIFY dragPosChanged)
+    Q_PROPERTY(disboard::Square dragSq READ dragSq NOTIFY dragSqChanged)
+
+    Q_PROPERTY(QQuickWindow *window READ window WRITE setWindow NOTIFY windowChanged)
+    // Milliseconds from a drag input to the swap of the frame showing it
+    Q_PROPERTY(qreal inputLatency READ inputLatency NOTIFY inputLatencyChanged)
+    Q_PROPERTY(qreal meanInputLatency READ meanInputLatency NOTIFY inputLatencyChanged)
+    Q_PROPERTY(qreal maxInputLatency READ maxInputLatency NOTIFY inputLatencyChanged)
 
     Q_PROPERTY(QVariant highlightedSq READ highlightedSq NOTIFY highlightedSqChanged)
     Q_PROPERTY(QVariant lastSrcSq READ lastSrcSq NOTIFY curNodeChanged)
@@ -31,10 +46,53 @@ Q_OBJECT
     Q_PROPERTY(QVector<disboard::Square> hintSq READ hintSq NOTIFY highlightedSqChanged)
     Q_PROPERTY(QVector<disboard::Square> captureSq READ captureSq NOTIFY highlightedSqChanged)
 
+    // The same squares as masks, for SquareOverlay. Reading these never
+    // allocates.
+    Q_PROPERTY(disboard::SquareSet highlightMask READ highlightMask NOTIFY highlightedSqChanged)
+    Q_PROPERTY(disboard::SquareSet lastMoveMask READ lastMoveMask NOTIFY curNodeChanged)
+    Q_PROPERTY(disboard::SquareSet hintMask READ hintMask NOTIFY highlightedSqChanged)
+    Q_PROPERTY(disboard::SquareSet captureMask READ captureMask NOTIFY highlightedSqChanged)
+    // Hint and capture targets by tablebase result for the mover
+    Q_PROPERTY(disboard::SquareSet winMask READ winMask NOTIFY highlightedSqChanged)
+    Q_PROPERTY(disboard::SquareSet drawMask READ drawMask NOTIFY highlightedSqChanged)
+    Q_PROPERTY(disboard::SquareSet lossMask READ lossMask NOTIFY highlightedSqChanged)
+
     Q_PROPERTY(QVariant promotionSq READ promotionSq NOTIFY promotionChanged)
     Q_PROPERTY(QVariant promotionPieces READ promotionPieces NOTIFY promotionChanged)
 
+    // Color the user plays, null when moving both sides (analysis)
+    Q_PROPERTY(QVariant playerColor READ playerColor WRITE setPlayerColor NOTIFY playerColorChanged)
+    // Source and destination square of every queued premove, in order
+    Q_PROPERTY(QVector<disboard::Square> premoveSq READ premoveSq NOTIFY premovesChanged)
+    Q_PROPERTY(disboard::SquareSet premoveMask READ premoveMask NOTIFY premovesChanged)
+
     Q_PROPERTY(QString pgn READ pgn NOTIFY treeChanged)
+    Q_PROPERTY(QString fen READ fen NOTIFY curNodeChanged)
+
+    // Journal file the tree is saved to as it is edited. Setting it restores
+    // the tree saved there, if any, before saving the current one.
+    Q_PROPERTY(QString autosavePath READ autosavePath WRITE setAutosavePath NOTIFY autosavePathChanged)
+
+    // Directories of Syzygy tables, separated like PATH
+    Q_PROPERTY(QString tablebasePath READ tablebasePath WRITE setTablebasePath NOTIFY tablebasePathChanged)
+    // { wdl, dtz, bestMoves } of the current node, null until the probe lands
+    // or when the position is not covered
+    Q_PROPERTY(QVariant tablebase READ tablebase NOTIFY tablebaseChanged)
+
+    // Session that may spill this controller's tree to disk while it is idle
+    Q_PROPERTY(TreeSession *session READ session WRITE setSession NOTIFY sessionChanged)
+
+    // Refreshed on every memoryLogInterval tick, or by refreshMemoryStats()
+    Q_PROPERTY(disboard::MemoryStats memoryStats READ memoryStats NOTIFY memoryStatsChanged)
+    // Milliseconds between memory and scheduler samples written to the log,
+    // 0 disables
+    Q_PROPERTY(int memoryLogInterval READ memoryLogInterval WRITE setMemoryLogInterval NOTIFY memoryLogIntervalChanged)
+
+    // Game counts of the current node when a repertoire is loaded, else null
+    Q_PROPERTY(QVariant curNodeStats READ curNodeStats NOTIFY curNodeChanged)
+
+    // Repetitions, fifty-move count and material of the current node
+    Q_PROPERTY(disboard::GameStatus gameStatus READ gameStatus NOTIFY curNodeChanged)
 
 public:
     explicit Controller(QObject *parent = nullptr);
@@ -60,21 +118,73 @@ public:
     Q_INVOKABLE
     void promote(disboard::Piece piece);
 
+    // Replaces the tree with a new one starting from `fen`. Returns false
+    // and keeps the current tree when the FEN is not a legal position.
+    Q_INVOKABLE bool loadFen(const QString &fen);
+
+    Q_INVOKABLE void clearPremoves();
+
+    // Replaces the tree with the first game of `pgn`, variations, comments,
+    // NAGs, clocks, evals and arrows included
+    Q_INVOKABLE bool loadPgn(const QString &pgn);
+
+    // { comment, nags, eval, mate, clock, arrows } of `node`, empty when it
+    // has no annotations. Evals are in pawns from white's point of view.
+    Q_INVOKABLE QVariantMap annotations(QUuid node) const;
+    Q_INVOKABLE void setComment(QUuid node, const QString &comment);
+    // Null clears
+    Q_INVOKABLE void setEval(QUuid node, const QVariant &pawns);
+    Q_INVOKABLE void setClock(QUuid node, const QVariant &ms);
+
+    // Validates and appends a line of SAN or UCI moves after `node` as one
+    // tree update, without moving the board. Stops at the first move that
+    // is not legal and returns the new nodes.
+    Q_INVOKABLE QVector<QUuid> addMoves(QUuid node, const QStringList &moves);
+    Q_INVOKABLE void resetInputLatency();
+
+    // Tree edits, announced with nodesRemoved or variationsReordered and
+    // treeChanged. A board showing a removed node moves to the nearest
+    // node left above it.
+    Q_INVOKABLE bool removeNode(QUuid node);
+    Q_INVOKABLE bool truncate(QUuid node);
+    Q_INVOKABLE bool moveVariation(QUuid node, int index);
+    Q_INVOKABLE bool promoteVariation(QUuid node);
+
+    // Folds the games of a PGN file into one tree off the GUI thread and
+    // swaps it in, see repertoireLoaded
+    Q_INVOKABLE void loadRepertoire(const QString &path);
+    Q_INVOKABLE QVariant nodeStats(QUuid node) const;
+
+    Q_INVOKABLE void refreshMemoryStats();
+
     Q_INVOKABLE void prevMove();
     Q_INVOKABLE void nextMove();
 
+    // Coalesced navigation: requests arriving within one frame are folded
+    // into a single jump and a single board resync.
+    Q_INVOKABLE void seek(int plies);
+    Q_INVOKABLE void seekToPly(int ply);
+
     [[nodiscard]] int pieceSize() const;
     void setPieceSize(int newValue);
 
     [[nodiscard]] QUuid root() const;
     [[nodiscard]] QUuid curNode() const;
     void setCurNode(QUuid newValue);
+    [[nodiscard]] int ply() const;
 
     [[nodiscard]] QVariant phantom() const;
     [[nodiscard]] QPointF dragPos() const;
     void setDragPos(QPointF newValue);
     [[nodiscard]] disboard::Square dragSq() const;
 
+    [[nodiscard]] QQuickWindow *window() const;
+    void setWindow(QQuickWindow *newValue);
+
+    [[nodiscard]] qreal inputLatency() const;
+    [[nodiscard]] qreal meanInputLatency() const;
+    [[nodiscard]] qreal maxInputLatency() const;
+
     [[nodiscard]] QVariant highlightedSq() const;
     [[nodiscard]] QVariant lastSrcSq() const;
     [[nodiscard]] QVariant lastDestSq() const;
@@ -82,13 +192,60 @@ public:
     [[nodiscard]] QVector<disboard::Square> hintSq() const;
     [[nodiscard]] QVector<disboard::Square> captureSq() const;
 
+    [[nodiscard]] disboard::SquareSet highlightMask() const;
+    [[nodiscard]] disboard::SquareSet lastMoveMask() const;
+    [[nodiscard]] disboard::SquareSet hintMask() const;
+    [[nodiscard]] disboard::SquareSet captureMask() const;
+    [[nodiscard]] disboard::SquareSet winMask() const;
+    [[nodiscard]] disboard::SquareSet drawMask() const;
+    [[nodiscard]] disboard::SquareSet lossMask() const;
+
     [[nodiscard]] QVariant promotionSq() const;
     [[nodiscard]] QVariant promotionPieces() const;
 
+    [[nodiscard]] QVariant playerColor() const;
+    void setPlayerColor(const QVariant &newValue);
+    [[nodiscard]] QVector<disboard::Square> premoveSq() const;
+    [[nodiscard]] disboard::SquareSet premoveMask() const;
+
     [[nodiscard]] QString pgn() const;
+    [[nodiscard]] QString fen() const;
+
+    [[nodiscard]] QString autosavePath() const;
+    void setAutosavePath(const QString &newValue);
+
+    [[nodiscard]] QString tablebasePath() const;
+    void setTablebasePath(const QString &newValue);
+    [[nodiscard]] QVariant tablebase() const;
+
+    [[nodiscard]] QVariant curNodeStats() const;
+    [[nodiscard]] disboard::GameStatus gameStatus() const;
+
+    [[nodiscard]] TreeSession *session() const;
+    void setSession(TreeSession *newValue);
+    // Writes the tree to `path` and frees it until it is next needed
+    bool spillTree(const QString &path);
+
+    // Cancelled when curNode changes, for background work about the
+    // current node whose result is useless once the user moves on
+    [[nodiscard]] disboard::CancelToken nodeToken() const;
+
+    [[nodiscard]] disboard::MemoryStats memoryStats() const;
+    [[nodiscard]] int memoryLogInterval() const;
+    void setMemoryLogInterval(int newValue);
 
     [[nodiscard]] const disboard::Disboard& board() const;
 
+    // Appends moves after the last mainline node as one tree update. The
+    // board follows if it was showing the end of the mainline, with a single
+    // resync, and a queued premove is played on top when it is legal.
+    // Stops at the first illegal move and returns the count of `moves` added.
+    int appendMainline(const QVector<disboard::Move> &moves);
+    // Swaps in a whole new tree, e.g. one rebuilt from a move list
+    void setBoard(disboard::Disboard &&board);
+    // Swaps in a repertoire tree along with its game counts
+    void setRepertoire(disboard::Repertoire &&repertoire);
+
 private:
     class p;
     std::shared_ptr<p> p;
@@ -109,14 +266,39 @@ signals:
     void rootChanged();
     void curNodeChanged();
     void nodePushed(QUuid node);
+    // Several nodes added at once, each one the child of the one before
+    void nodesPushed(const QVector<QUuid> &nodes);
+    // `nodes` below `parent` are gone, in preorder
+    void nodesRemoved(QUuid parent, const QVector<QUuid> &nodes);
+    // The children of `parent` changed order, its mainline may have too
+    void variationsReordered(QUuid parent);
     void treeChanged();
 
     void dragChanged();
     void dragPosChanged();
+    void dragSqChanged();
+
+    void windowChanged();
+    void inputLatencyChanged();
 
     void highlightedSqChanged();
 
     void promotionChanged();
+
+    void playerColorChanged();
+    void premovesChanged();
+    // A premove was played in reply to an incoming move
+    void premoveApplied(QUuid node);
+
+    void autosavePathChanged();
+    void tablebasePathChanged();
+    void tablebaseChanged();
+    void repertoireLoaded(bool ok);
+    void sessionChanged();
+    void memoryStatsChanged();
+    void memoryLogIntervalChanged();
+    // Also followed by treeChanged, since the PGN carries annotations
+    void annotationsChanged(QUuid node);
 };
 
 #endif //DISBOARD_CONTROLLER_H
@@ -1,6 +1,12 @@
 #include "disboard.h"
 
 #include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 using namespace disboard;
 
@@ -22,124 +28,742 @@ librustdisboard::Uuid from_quuid(QUuid uuid) {
     };
 }
 
+namespace {
+    // Spill files: magic and version, the root FEN (empty for the standard
+    // position), the node count, then per node in preorder its parent
+    // ordinal plus one (0 for the root), its move and its public id
+    constexpr char spillMagic[] = "DSBT\x01";
+
+    void putVarint(QByteArray &out, uint32_t value) {
+        while (value >= 0x80) {
+            out.append(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.append(static_cast<char>(value));
+    }
+
+    bool getVarint(const QByteArray &in, qsizetype &pos, uint32_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (pos >= in.size()) return false;
+            auto byte = static_cast<uint8_t>(in[pos++]);
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+}
+
 Disboard::Disboard()
-    : tree(librustdisboard::game_default()) {
-    qDebug() << "initializing disboard ffi";
+    : tree(librustdisboard::game_default()) {}
+
+Disboard::Disboard(rust::Box<librustdisboard::GameTree> tree, const Position &rootPosition)
+    : tree(std::move(tree)), rootPosition(rootPosition) {}
+
+std::optional<Disboard> Disboard::fromFen(std::string_view fen) {
+    auto position = Position::fromFen(fen);
+    if (!position.has_value()) return {};
+
+    // Hand the normalized FEN over, so both sides agree on the position
+    auto normalized = position->fen();
+    try {
+        return Disboard{
+                librustdisboard::game_from_fen(rust::Str(normalized.data(), normalized.size())),
+                *position
+        };
+    } catch (const rust::Error &e) {
+        qWarning() << "rejected fen:" << e.what();
+        return {};
+    }
+}
+
+std::optional<Disboard> Disboard::fromPgn(const PgnGame &game) {
+    auto board = game.start.hash() == Position().hash() ?
+                 std::optional<Disboard>(Disboard()) :
+                 fromFen(game.start.fen());
+    if (!board.has_value() || game.nodes.empty()) return board;
+
+    // PgnGame indices count the root, addTree ones do not
+    QVector<int> parents;
+    QVector<Move> moves;
+    parents.reserve(game.nodes.count() - 1);
+    moves.reserve(game.nodes.count() - 1);
+    for (qsizetype idx = 1; idx < game.nodes.count(); idx += 1) {
+        parents.push_back(game.nodes[idx].parent - 1);
+        moves.push_back(game.nodes[idx].move);
+    }
+
+    auto root = board->root();
+    auto newNodes = board->addTree(root, parents, moves);
+
+    auto annotate = [&](QUuid node, const PgnNode &entry) {
+        if (!entry.comment.empty()) board->notes.setPgnComment(node, entry.comment);
+        if (!entry.nags.empty()) board->notes.setNags(node, entry.nags);
+    };
+    annotate(root, game.nodes.front());
+    for (qsizetype idx = 0; idx < newNodes.count(); idx += 1) {
+        annotate(newNodes[idx], game.nodes[idx + 1]);
+    }
+    return board;
+}
+
+bool Disboard::spill(const QString &path) {
+    if (!resident()) return true;
+
+    auto entries = nodes();
+    QByteArray bytes(spillMagic, sizeof spillMagic - 1);
+    auto fen = rootPosition.hash() == Position().hash() ? std::string() : rootPosition.fen();
+    putVarint(bytes, static_cast<uint32_t>(fen.size()));
+    bytes.append(fen.data(), static_cast<qsizetype>(fen.size()));
+    putVarint(bytes, static_cast<uint32_t>(entries.count()));
+    bytes.reserve(bytes.size() + entries.count() * 20);
+    for (const auto &entry: entries) {
+        putVarint(bytes, static_cast<uint32_t>(entry.parent + 1));
+        auto bits = entry.move.toBits();
+        bytes.append(static_cast<char>(bits & 0xff));
+        bytes.append(static_cast<char>(bits >> 8));
+        bytes.append(entry.node.toRfc4122());
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit()) {
+        qWarning() << "could not spill tree to" << path << file.errorString();
+        return false;
+    }
+
+    tree.reset();
+    spillPath = path;
+    spillSize = bytes.size();
+    spilledNodes = static_cast<int>(entries.count());
+    toInternal = {};
+    toExternal = {};
+    mainline = {};
+    mainlinePly = {};
+    positions = {};
+    states.clear();
+    stateIndex = {};
+    return true;
+}
+
+bool Disboard::faultIn() const {
+    QFile file(spillPath);
+    QByteArray bytes;
+    if (file.open(QIODevice::ReadOnly)) bytes = file.readAll();
+
+    qsizetype pos = sizeof spillMagic - 1;
+    uint32_t fenSize = 0, count = 0;
+    bool ok = bytes.startsWith(QByteArray(spillMagic, sizeof spillMagic - 1))
+              && getVarint(bytes, pos, fenSize) && pos + fenSize <= bytes.size();
+    std::string fen;
+    if (ok) {
+        fen.assign(bytes.constData() + pos, fenSize);
+        pos += fenSize;
+        ok = getVarint(bytes, pos, count) && count > 0;
+    }
+
+    std::vector<int32_t> parents;
+    std::vector<uint16_t> bits;
+    QVector<QUuid> ids;
+    parents.reserve(count);
+    bits.reserve(count);
+    ids.reserve(count);
+    for (uint32_t idx = 0; ok && idx < count; idx += 1) {
+        uint32_t parent = 0;
+        ok = getVarint(bytes, pos, parent) && parent <= idx && pos + 18 <= bytes.size();
+        if (!ok) break;
+        auto low = static_cast<uint8_t>(bytes[pos]), high = static_cast<uint8_t>(bytes[pos + 1]);
+        ids.push_back(QUuid::fromRfc4122(QByteArrayView(bytes.constData() + pos + 2, 16)));
+        pos += 18;
+        // The root is not part of the grafted list, so ordinals shift by one
+        if (idx == 0) continue;
+        parents.push_back(parent <= 1 ? -1 : static_cast<int32_t>(parent) - 2);
+        bits.push_back(static_cast<uint16_t>(low | (high << 8)));
+    }
+    // The root position never left memory, so it tells a file that is
+    // damaged or someone else's
+    ok = ok && pos == bytes.size()
+         && fen == (rootPosition.hash() == Position().hash() ? std::string() : rootPosition.fen());
+    if (!ok) {
+        // The file is all there is of the tree, keep it for a later try
+        qCritical() << "could not read spilled tree back from" << spillPath;
+        return false;
+    }
+
+    // The moves were legal when they were written, no need to replay them
+    replant(fen, parents, bits, ids);
+
+    file.remove();
+    spillPath.clear();
+    spillSize = 0;
+    spilledNodes = 0;
+    return true;
+}
+
+void Disboard::replant(const std::string &fen, const std::vector<int32_t> &parents,
+                       const std::vector<uint16_t> &bits, const QVector<QUuid> &ids) const {
+    tree = fen.empty() ?
+           librustdisboard::game_default() :
+           librustdisboard::game_from_fen(rust::Str(fen.data(), fen.size()));
+
+    auto root = (*tree)->root();
+    rust::Vec<librustdisboard::Uuid> node_vec;
+    if (!bits.empty()) {
+        node_vec = (*tree)->add_tree(
+                root,
+                rust::Slice<const int32_t>(parents.data(), parents.size()),
+                rust::Slice<const uint16_t>(bits.data(), bits.size())
+        );
+    }
+
+    toInternal.clear();
+    toExternal.clear();
+    toInternal.reserve(static_cast<qsizetype>(node_vec.size()) + 1);
+    toExternal.reserve(static_cast<qsizetype>(node_vec.size()) + 1);
+    auto alias = [&](QUuid external, QUuid internal) {
+        if (external.isNull() || external == internal) return;
+        toInternal.insert(external, internal);
+        toExternal.insert(internal, external);
+    };
+    alias(ids.front(), from_uuid(root));
+    for (size_t idx = 0; idx < node_vec.size() && idx + 1 < static_cast<size_t>(ids.count()); idx += 1) {
+        alias(ids[static_cast<qsizetype>(idx) + 1], from_uuid(node_vec[idx]));
+    }
+}
+
+bool Disboard::restore() const {
+    return resident() || faultIn();
+}
+
+librustdisboard::GameTree &Disboard::rust() const {
+    if (!tree.has_value() && !faultIn()) {
+        qFatal("spilled tree lost, kept at %s", qPrintable(spillPath));
+    }
+    return **tree;
+}
+
+librustdisboard::Uuid Disboard::toRust(QUuid node) const {
+    if (!toInternal.empty()) node = toInternal.value(node, node);
+    return from_quuid(node);
+}
+
+QUuid Disboard::fromRust(librustdisboard::Uuid uuid) const {
+    auto node = from_uuid(uuid);
+    if (!toExternal.empty()) return toExternal.value(node, node);
+    return node;
 }
 
 QUuid Disboard::root() const {
-    return from_uuid(tree->root());
+    return fromRust(rust().root());
 }
 
 Color Disboard::turn(QUuid node) const {
-    return tree->position(from_quuid(node))->turn();
+    return positionAt(node).turn();
 }
 
 std::tuple<QVector<Square>, QVector<Piece>>
 Disboard::pieces(QUuid node) const {
-    auto position = tree->position(from_quuid(node));
-    auto _squares = position->squares();
-    auto _pieces = position->pieces();
+    const auto &position = positionAt(node);
 
     QVector<Square> squares;
     QVector<Piece> pieces;
-    for (auto square: _squares) {
-        squares.push_back(Square{square});
-    }
-    for (auto piece: _pieces) {
-        pieces.push_back(Piece{piece});
+    auto occupied = position.occupied();
+    squares.reserve(bitboard::count(occupied));
+    pieces.reserve(bitboard::count(occupied));
+    while (occupied) {
+        auto square = bitboard::popLsb(occupied);
+        squares.push_back(square);
+        pieces.push_back(*position.pieceAt(square));
     }
 
     return std::make_tuple(squares, pieces);
 }
 
 std::optional<Piece> Disboard::pieceAt(QUuid node, Square square) const {
-    auto position = tree->position(from_quuid(node));
-    if (position->has_piece_at(square.impl)) {
-        auto piece = position->piece_at(square.impl);
-        return Piece(piece);
-    }
-    return {};
+    return positionAt(node).pieceAt(square);
 }
 
 std::optional<Move>
 Disboard::legalMove(QUuid node, Square from, Square to) const {
-    auto position = tree->position(from_quuid(node));
-    if (position->has_legal_move(from.impl, to.impl)) {
-        return Move{
-            position->legal_move(from.impl, to.impl)
-        };
-    }
-    return {};
+    return positionAt(node).legalMove(from, to);
 }
 
 std::optional<Move>
 Disboard::lastMove(QUuid node) const {
-    auto _node = from_quuid(node);
-    if (tree->has_prev_move(_node)) {
-        return Move{
-            tree->prev_move(_node)
-        };
+    auto move = Move::fromBits(rust().prev_move(toRust(node)));
+    if (move.isNull()) return {};
+    return move;
 }
-    return {};
+
+QString Disboard::san(QUuid node) const {
+    auto san = rust().san(toRust(node));
+    AllocationCounters::count(AllocationCounters::ffiStrings);
+    return QString::fromUtf8(san.data(), static_cast<qsizetype>(san.size()));
 }
 
-std::tuple<QVector<Square>, QVector<Square>>
-Disboard::hints(QUuid node, Square from) const {
-    auto position = tree->position(from_quuid(node));
+std::pair<Bitboard, Bitboard> Disboard::hints(QUuid node, Square from) const {
+    return positionAt(node).hints(from);
+}
 
-    auto hint_vec = position->hints(from.impl);
-    auto capture_vec = position->captures(from.impl);
+std::optional<QUuid> Disboard::prevNode(QUuid node) const {
+    if (!rust().has_prev_node(toRust(node))) return {};
+    return fromRust(rust().prev_node(toRust(node)));
+}
 
-    QVector<Square> hints, captures;
-    for (auto square: hint_vec) {
-        hints.emplace_back(Square{square});
+std::optional<QUuid> Disboard::nextMainlineNode(QUuid node) const {
+    if (!rust().has_next_mainline_node(toRust(node))) return {};
+    return fromRust(rust().next_mainline_node(toRust(node)));
+}
+
+int Disboard::ply(QUuid node) const {
+    ensureMainline();
+    if (auto it = mainlinePly.constFind(node); it != mainlinePly.cend()) {
+        return *it;
     }
-    for (auto square: capture_vec) {
-        captures.emplace_back(Square{square});
+    return static_cast<int>(rust().ply(toRust(node)));
+}
+
+QUuid Disboard::seek(QUuid node, int plies) const {
+    if (plies == 0) return node;
+
+    ensureMainline();
+    if (auto it = mainlinePly.constFind(node); it != mainlinePly.cend()) {
+        auto target = std::clamp<qint64>(
+                qint64(*it) + plies, 0, mainline.count() - 1
+        );
+        return mainline[target];
     }
 
-    return std::make_tuple(hints, captures);
+    auto _node = toRust(node);
+    if (plies < 0) {
+        return fromRust(rust().ancestor(_node, static_cast<uint32_t>(-qint64(plies))));
+    }
+    return fromRust(rust().mainline_descendant(_node, static_cast<uint32_t>(plies)));
 }
 
-std::optional<QUuid> Disboard::prevNode(QUuid node) const {
-    if (!tree->has_prev_node(from_quuid(node))) return {};
-    return from_uuid(tree->prev_node(from_quuid(node)));
+QUuid Disboard::seekToPly(QUuid node, int ply) const {
+    auto plies = std::clamp<qint64>(
+            qint64(ply) - this->ply(node),
+            std::numeric_limits<int>::min(), std::numeric_limits<int>::max()
+    );
+    return seek(node, static_cast<int>(plies));
 }
 
-std::optional<QUuid> Disboard::nextMainlineNode(QUuid node) const {
-    if (!tree->has_next_mainline_node(from_quuid(node))) return {};
-    return from_uuid(tree->next_mainline_node(from_quuid(node)));
+void Disboard::ensureMainline() const {
+    if (!mainline.empty()) return;
+
+    mainline.push_back(root());
+    mainline.append(mainlineNodes(root()));
+    mainlinePly.reserve(mainline.count());
+    for (int idx = 0; idx < mainline.count(); idx += 1) {
+        mainlinePly.insert(mainline[idx], idx);
+    }
 }
 
 QVector<QUuid> Disboard::siblings(QUuid node) const {
-    auto node_vec = tree->siblings(from_quuid(node));
+    auto node_vec = rust().siblings(toRust(node));
+    AllocationCounters::count(AllocationCounters::ffiVectors);
     QVector<QUuid> nodes;
     for (auto _node : node_vec) {
-        nodes.push_back(from_uuid(_node));
+        nodes.push_back(fromRust(_node));
     }
     return nodes;
 }
 
 QVector<QUuid> Disboard::mainlineNodes(QUuid node) const {
-    auto node_vec = tree->mainline_nodes(from_quuid(node));
+    auto node_vec = rust().mainline_nodes(toRust(node));
+    AllocationCounters::count(AllocationCounters::ffiVectors);
     QVector<QUuid> nodes;
     for (auto _node : node_vec) {
-        nodes.push_back(from_uuid(_node));
+        nodes.push_back(fromRust(_node));
     }
     return nodes;
 }
 
+QVector<NodeEntry> Disboard::nodes() const {
+    auto entry_vec = rust().entries();
+    AllocationCounters::count(AllocationCounters::ffiVectors);
+
+    QVector<NodeEntry> entries;
+    entries.reserve(static_cast<qsizetype>(entry_vec.size()));
+    for (const auto &entry: entry_vec) {
+        entries.push_back({
+                fromRust(entry.node),
+                entry.parent == std::numeric_limits<uint32_t>::max() ? -1 : static_cast<int>(entry.parent),
+                Move::fromBits(entry.m)
+        });
+    }
+    return entries;
+}
+
 QUuid Disboard::addNode(QUuid node, Move move) {
-    auto new_node = tree->add_node(
-            from_quuid(node),
-            std::move(move.impl)
+    auto position = positionAt(node);
+
+    auto new_node = rust().add_node(
+            toRust(node),
+            move.toBits()
             );
-    return from_uuid(new_node);
+    auto newNode = fromRust(new_node);
+
+    // A move appended to the last mainline node extends the mainline,
+    // anything else is a variation and leaves it untouched.
+    if (!mainline.empty() && mainline.back() == node) {
+        mainlinePly.insert(newNode, mainline.count());
+        mainline.push_back(newNode);
+    }
+
+    position.play(move);
+    trackState(node, newNode, position);
+    if (positions.count() >= positionCacheLimit) positions.clear();
+    positions.insert(newNode, position);
+
+    return newNode;
+}
+
+QVector<QUuid> Disboard::addNodes(QUuid node, const QVector<Move> &moves) {
+    // Validate natively first, so the Rust side never sees an illegal move
+    // and every new node gets its position cached on the way.
+    auto position = positionAt(node);
+    QVector<Position> linePositions;
+    std::vector<uint16_t> bits;
+    linePositions.reserve(moves.count());
+    bits.reserve(moves.count());
+    for (auto move: moves) {
+        if (!position.isLegal(move)) break;
+        position.play(move);
+        linePositions.push_back(position);
+        bits.push_back(move.toBits());
+    }
+    if (bits.empty()) return {};
+
+    auto node_vec = rust().add_moves(
+            toRust(node),
+            rust::Slice<const uint16_t>(bits.data(), bits.size())
+    );
+    AllocationCounters::count(AllocationCounters::ffiVectors);
+
+    QVector<QUuid> newNodes;
+    newNodes.reserve(static_cast<qsizetype>(node_vec.size()));
+    for (auto _node: node_vec) {
+        newNodes.push_back(fromRust(_node));
+    }
+
+    if (!mainline.empty() && mainline.back() == node) {
+        for (auto newNode: newNodes) {
+            mainlinePly.insert(newNode, mainline.count());
+            mainline.push_back(newNode);
+        }
+    }
+
+    if (positions.count() + newNodes.count() >= positionCacheLimit) positions.clear();
+    for (qsizetype idx = 0; idx < std::min(newNodes.count(), linePositions.count()); idx += 1) {
+        trackState(idx == 0 ? node : newNodes[idx - 1], newNodes[idx], linePositions[idx]);
+        positions.insert(newNodes[idx], linePositions[idx]);
+    }
+
+    return newNodes;
+}
+
+QVector<QUuid> Disboard::addTree(QUuid node, const QVector<int> &parents, const QVector<Move> &moves) {
+    // Same native validation as addNodes, with a position per new node
+    auto rootPosition = positionAt(node);
+    QVector<Position> treePositions;
+    std::vector<int32_t> parentIdx;
+    std::vector<uint16_t> bits;
+    treePositions.reserve(moves.count());
+    parentIdx.reserve(moves.count());
+    bits.reserve(moves.count());
+    for (qsizetype idx = 0; idx < std::min(parents.count(), moves.count()); idx += 1) {
+        auto parent = parents[idx];
+        if (parent >= treePositions.count()) break;
+        auto position = parent < 0 ? rootPosition : treePositions[parent];
+        if (!position.isLegal(moves[idx])) break;
+        position.play(moves[idx]);
+        treePositions.push_back(position);
+        parentIdx.push_back(parent < 0 ? -1 : parent);
+        bits.push_back(moves[idx].toBits());
+    }
+    if (bits.empty()) return {};
+
+    auto node_vec = rust().add_tree(
+            toRust(node),
+            rust::Slice<const int32_t>(parentIdx.data(), parentIdx.size()),
+            rust::Slice<const uint16_t>(bits.data(), bits.size())
+    );
+    AllocationCounters::count(AllocationCounters::ffiVectors);
+
+    QVector<QUuid> newNodes;
+    newNodes.reserve(static_cast<qsizetype>(node_vec.size()));
+    for (auto _node: node_vec) {
+        newNodes.push_back(fromRust(_node));
+    }
+
+    for (qsizetype idx = 0; idx < std::min(newNodes.count(), treePositions.count()); idx += 1) {
+        auto parent = parentIdx[static_cast<size_t>(idx)];
+        trackState(parent < 0 ? node : newNodes[parent], newNodes[idx], treePositions[idx]);
+    }
+
+    // A whole tree may extend the mainline by any number of plies, it is
+    // cheaper to rebuild the index on the next seek than to work it out.
+    // Positions are left to be replayed on demand for the same reason.
+    if (!mainline.empty() && mainline.back() == node) {
+        mainline.clear();
+        mainlinePly.clear();
+    }
+
+    return newNodes;
+}
+
+QVector<QUuid> Disboard::removeNode(QUuid node) {
+    auto entries = nodes();
+    auto idx = indexOf(entries, node);
+    if (idx <= 0) return {};
+
+    auto children = childLists(entries);
+    children[entries[idx].parent].removeOne(idx);
+    return rebuild(entries, children);
+}
+
+QVector<QUuid> Disboard::truncate(QUuid node) {
+    auto entries = nodes();
+    auto idx = indexOf(entries, node);
+    if (idx < 0) return {};
+
+    auto children = childLists(entries);
+    if (children[idx].empty()) return {};
+    children[idx].clear();
+    return rebuild(entries, children);
+}
+
+bool Disboard::moveVariation(QUuid node, int index) {
+    auto entries = nodes();
+    auto idx = indexOf(entries, node);
+    if (idx <= 0) return false;
+
+    auto children = childLists(entries);
+    auto &siblings = children[entries[idx].parent];
+    auto from = siblings.indexOf(idx);
+    auto to = std::clamp<qsizetype>(index, 0, siblings.count() - 1);
+    if (from == to) return false;
+
+    siblings.move(from, to);
+    rebuild(entries, children);
+    return true;
+}
+
+QVector<QUuid> Disboard::promoteVariation(QUuid node) {
+    auto entries = nodes();
+    auto idx = indexOf(entries, node);
+    if (idx < 0) return {};
+
+    auto children = childLists(entries);
+    QVector<QUuid> parents;
+    for (; entries[idx].parent >= 0; idx = entries[idx].parent) {
+        auto &siblings = children[entries[idx].parent];
+        if (siblings.front() == idx) continue;
+        siblings.move(siblings.indexOf(idx), 0);
+        parents.push_front(entries[entries[idx].parent].node);
+    }
+    if (parents.empty()) return {};
+
+    rebuild(entries, children);
+    return parents;
+}
+
+int Disboard::indexOf(const QVector<NodeEntry> &entries, QUuid node) {
+    auto it = std::find_if(entries.cbegin(), entries.cend(), [&](const NodeEntry &entry) {
+        return entry.node == node;
+    });
+    return it == entries.cend() ? -1 : static_cast<int>(it - entries.cbegin());
+}
+
+QVector<QVector<int>> Disboard::childLists(const QVector<NodeEntry> &entries) {
+    QVector<QVector<int>> children(entries.count());
+    for (int idx = 1; idx < entries.count(); idx += 1) {
+        children[entries[idx].parent].push_back(idx);
+    }
+    return children;
+}
+
+QVector<QUuid> Disboard::rebuild(const QVector<NodeEntry> &entries, const QVector<QVector<int>> &children) {
+    // Walk the edited child lists in preorder, mainline first, which is
+    // the order add_tree wants and the one nodes() gives back
+    std::vector<int32_t> parents;
+    std::vector<uint16_t> bits;
+    QVector<QUuid> ids;
+    QVector<int> ordinal(entries.count(), -1);
+    QVector<int> stack{0};
+    while (!stack.empty()) {
+        auto idx = stack.takeLast();
+        ordinal[idx] = static_cast<int>(ids.count());
+        ids.push_back(entries[idx].node);
+        if (idx > 0) {
+            // The root is not part of the grafted list, so ordinals shift by one
+            auto parent = ordinal[entries[idx].parent];
+            parents.push_back(parent == 0 ? -1 : parent - 1);
+            bits.push_back(entries[idx].move.toBits());
+        }
+        for (auto it = children[idx].crbegin(); it != children[idx].crend(); ++it) stack.push_back(*it);
+    }
+
+    QVector<QUuid> removed;
+    for (int idx = 0; idx < entries.count(); idx += 1) {
+        if (ordinal[idx] < 0) removed.push_back(entries[idx].node);
+    }
+
+    // The moves are the same, so is the path to every node left, along with
+    // its position and draw state. Only what belongs to the removed ones is
+    // dropped. Draw states are packed by parent, so after a removal they are
+    // replayed on the next query rather than patched.
+    auto fen = rootPosition.hash() == Position().hash() ? std::string() : rootPosition.fen();
+    replant(fen, parents, bits, ids);
+    for (auto node: removed) positions.remove(node);
+    notes.remove(removed);
+    if (!removed.empty()) {
+        states.clear();
+        stateIndex = {};
+    }
+    mainline.clear();
+    mainlinePly.clear();
+    return removed;
+}
+
+QVector<Move> Disboard::parseMoves(QUuid node, const QStringList &moves) const {
+    auto position = positionAt(node);
+
+    QVector<Move> parsed;
+    parsed.reserve(moves.count());
+    for (const auto &move: moves) {
+        auto m = position.parseSan(move.toStdString());
+        if (!m.has_value()) break;
+        position.play(*m);
+        parsed.push_back(*m);
+    }
+    return parsed;
 }
 
 QString Disboard::pgn() const {
-    auto pgn = tree->pgn();
-    std::string pgnStr{pgn};
-    return QString::fromStdString(pgnStr);
+    return QString::fromStdString(toPgnGame().toPgn());
+}
+
+PgnGame Disboard::toPgnGame() const {
+    PgnGame game;
+    game.start = rootPosition;
+    if (rootPosition.hash() != Position().hash()) {
+        game.tags = {{"SetUp", "1"}, {"FEN", rootPosition.fen()}};
+    }
+
+    auto entries = nodes();
+    game.nodes.reserve(entries.count());
+    for (const auto &entry: entries) {
+        game.nodes.push_back({entry.parent, entry.move, notes.pgnComment(entry.node), notes.nags(entry.node)});
+    }
+    return game;
+}
+
+QVector<QUuid> Disboard::mainlineFrom(QUuid node) const {
+    ensureMainline();
+    auto it = mainlinePly.constFind(node);
+    if (it != mainlinePly.constEnd()) return mainline.mid(*it);
+
+    QVector<QUuid> line{node};
+    line.append(mainlineNodes(node));
+    return line;
+}
+
+QVector<int32_t> Disboard::mainlineEvals(QUuid node) const {
+    return notes.evals(mainlineFrom(node));
+}
+
+QVector<int32_t> Disboard::mainlineClocks(QUuid node) const {
+    return notes.clocks(mainlineFrom(node));
+}
+
+Position Disboard::position(QUuid node) const {
+    return positionAt(node);
+}
+
+uint64_t Disboard::perft(QUuid node, int depth) const {
+    return positionAt(node).perft(depth);
+}
+
+uint64_t Disboard::referencePerft(QUuid node, int depth) const {
+    AllocationCounters::count(AllocationCounters::ffiBoxes);
+    return rust().position(toRust(node))->perft(static_cast<uint32_t>(std::max(depth, 0)));
+}
+
+const Position &Disboard::positionAt(QUuid node) const {
+    if (auto it = positions.constFind(node); it != positions.cend()) {
+        AllocationCounters::count(AllocationCounters::positionHits);
+        return *it;
+    }
+
+    AllocationCounters::count(AllocationCounters::positionReplays);
+    AllocationCounters::count(AllocationCounters::ffiVectors);
+    auto position = rootPosition;
+    for (auto bits: rust().line_moves(toRust(node))) {
+        position.play(Move::fromBits(bits));
+    }
+
+    if (positions.count() >= positionCacheLimit) positions.clear();
+    return *positions.insert(node, position);
+}
+
+GameStatus Disboard::status(QUuid node) const {
+    ensureStates();
+    return states.status(stateIndex.value(node, -1));
+}
+
+QVector<GameStatus> Disboard::mainlineStatus(QUuid node) const {
+    ensureStates();
+    auto line = mainlineFrom(node);
+    QVector<GameStatus> statuses;
+    statuses.reserve(line.count());
+    for (auto lineNode: line) statuses.push_back(states.status(stateIndex.value(lineNode, -1)));
+    return statuses;
+}
+
+void Disboard::ensureStates() const {
+    if (!states.empty()) return;
+
+    auto entries = nodes();
+    states.assign(rootPosition, entries);
+    stateIndex.reserve(entries.count());
+    for (int idx = 0; idx < entries.count(); idx += 1) {
+        stateIndex.insert(entries[idx].node, idx);
+    }
+}
+
+void Disboard::trackState(QUuid parent, QUuid node, const Position &position) {
+    // Nothing to extend before the first query, and a move that was there
+    // already comes back as the node tracked before
+    if (states.empty() || stateIndex.contains(node)) return;
+
+    auto it = stateIndex.constFind(parent);
+    if (it == stateIndex.constEnd()) {
+        // Lost track somehow, start over on the next query
+        states.clear();
+        stateIndex.clear();
+        return;
+    }
+    stateIndex.insert(node, states.add(*it, position));
+}
+
+MemoryStats Disboard::memoryStats() const {
+    MemoryStats stats;
+    if (resident()) {
+        auto memory = rust().memory();
+        stats.nodes = static_cast<int>(memory.nodes);
+        stats.treeBytes = static_cast<qint64>(memory.bytes);
+    } else {
+        stats.nodes = spilledNodes;
+        stats.spilledBytes = spillSize;
+    }
+    stats.aliasBytes = heapBytes(toInternal) + heapBytes(toExternal);
+    stats.positionCacheEntries = static_cast<int>(positions.count());
+    stats.positionCacheBytes = heapBytes(positions);
+    stats.mainlineIndexBytes = heapBytes(mainline) + heapBytes(mainlinePly);
+    stats.annotationBytes = notes.memoryBytes();
+    stats.gameStateBytes = states.memoryBytes() + heapBytes(stateIndex);
+    stats.sampleCounters();
+    return stats;
 }
@@ -6,14 +6,41 @@
 #include "square.h"
 #include "piece.h"
 #include "move.h"
+#include "position.h"
+#include "annotations.h"
+#include "gamestate.h"
+#include "memorystats.h"
+#include "pgn.h"
 
 #include <QUuid>
+#include <QHash>
+#include <QStringList>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace disboard {
+    // A node of a flattened tree: parents always precede their children and
+    // the root comes first with a parent index of -1.
+    struct NodeEntry {
+        QUuid node;
+        int parent;
+        Move move;
+    };
+
     class Disboard {
     public:
         Disboard();
 
+        // A tree starting from any legal position. The move counters are
+        // optional, so the first four fields of an EPD record are enough.
+        [[nodiscard]] static std::optional<Disboard> fromFen(std::string_view fen);
+        // The whole game tree in one FFI call, comments going through
+        // Annotations::setPgnComment. Moves past an illegal one are dropped.
+        [[nodiscard]] static std::optional<Disboard> fromPgn(const PgnGame &game);
+
         [[nodiscard]] QUuid root() const;
 
         [[nodiscard]] Color turn(QUuid node) const;
@@ -23,22 +50,154 @@ namespace disboard {
         [[nodiscard]] std::optional<Move> legalMove(QUuid node, Square from, Square to) const;
 
         [[nodiscard]] std::optional<Move> lastMove(QUuid node) const;
+        // SAN of the move leading to `node`, empty for the root
+        [[nodiscard]] QString san(QUuid node) const;
 
-        [[nodiscard]] std::tuple<QVector<Square>, QVector<Square>>
-            hints(QUuid node, Square from) const;
+        // Quiet targets and capture targets of the piece on `from`
+        [[nodiscard]] std::pair<Bitboard, Bitboard> hints(QUuid node, Square from) const;
 
         [[nodiscard]] std::optional<QUuid> prevNode(QUuid node) const;
         [[nodiscard]] std::optional<QUuid> nextMainlineNode(QUuid node) const;
 
+        [[nodiscard]] int ply(QUuid node) const;
+        // Walks `plies` moves back (negative) or forward along the mainline
+        // (positive) from `node`, stopping at the root or the end of the line.
+        [[nodiscard]] QUuid seek(QUuid node, int plies) const;
+        [[nodiscard]] QUuid seekToPly(QUuid node, int ply) const;
+
         [[nodiscard]] QVector<QUuid> siblings(QUuid node) const;
         [[nodiscard]] QVector<QUuid> mainlineNodes(QUuid node) const;
+        // `node` followed by mainlineNodes(node), served from the mainline
+        // index when `node` is on the root's mainline
+        [[nodiscard]] QVector<QUuid> mainlineFrom(QUuid node) const;
+        // The whole tree in one FFI call. Does not touch the node caches, so
+        // it may run on a worker thread while the tree is not being edited.
+        [[nodiscard]] QVector<NodeEntry> nodes() const;
+        [[nodiscard]] const Position &initialPosition() const { return rootPosition; }
 
         QUuid addNode(QUuid node, Move move);
-
+        // Appends a line of moves after `node` in one FFI call, each move
+        // following the one before. Stops at the first illegal move and
+        // returns the new nodes in order.
+        QVector<QUuid> addNodes(QUuid node, const QVector<Move> &moves);
+        // Grafts a whole subtree below `node` in one FFI call. `parents`
+        // index into the same list, -1 standing for `node`, and come before
+        // their children. Stops at the first illegal move and returns the
+        // new nodes, parallel to `moves`.
+        QVector<QUuid> addTree(QUuid node, const QVector<int> &parents, const QVector<Move> &moves);
+        // Tree edits. The Rust tree has no way to unlink or reorder nodes,
+        // so each edit rebuilds it from the flattened tree in one FFI call,
+        // the nodes left keeping their handles as after a spill. Annotations
+        // and cached state of removed nodes go with them.
+
+        // Removes `node` and everything below it and returns them in
+        // preorder. The root cannot be removed.
+        QVector<QUuid> removeNode(QUuid node);
+        // Removes everything below `node`
+        QVector<QUuid> truncate(QUuid node);
+        // Moves `node` to `index` among its siblings, 0 being the mainline.
+        // False when it is already there.
+        bool moveVariation(QUuid node, int index);
+        // Makes the line to `node` the mainline from the root on. Returns the
+        // nodes whose children were reordered, root side first.
+        QVector<QUuid> promoteVariation(QUuid node);
+
+        // Resolves SAN or UCI moves played in sequence from `node`, up to the
+        // first one that does not parse
+        [[nodiscard]] QVector<Move> parseMoves(QUuid node, const QStringList &moves) const;
+
+        // Exported natively, so annotations are written back as comments
         [[nodiscard]] QString pgn() const;
+        [[nodiscard]] PgnGame toPgnGame() const;
+
+        [[nodiscard]] const Annotations &annotations() const { return notes; }
+        [[nodiscard]] Annotations &annotations() { return notes; }
+        // Evals and clocks of `node` and the mainline after it, one entry
+        // per node and gathered in one pass
+        [[nodiscard]] QVector<int32_t> mainlineEvals(QUuid node) const;
+        [[nodiscard]] QVector<int32_t> mainlineClocks(QUuid node) const;
+
+        [[nodiscard]] Position position(QUuid node) const;
+
+        // Repetitions, halfmove clock and material at `node`. The first query
+        // replays the whole tree once, nodes added after that are tracked as
+        // they are added, so every query is a lookup.
+        [[nodiscard]] GameStatus status(QUuid node) const;
+        // status() of `node` and the mainline after it
+        [[nodiscard]] QVector<GameStatus> mainlineStatus(QUuid node) const;
+
+        // Node counts of the native move generator and of the Rust engine,
+        // the two must agree for every position.
+        [[nodiscard]] uint64_t perft(QUuid node, int depth) const;
+        [[nodiscard]] uint64_t referencePerft(QUuid node, int depth) const;
+
+        // Walks the whole tree on the Rust side, not meant for every frame
+        [[nodiscard]] MemoryStats memoryStats() const;
+
+        // Cold storage: writes the tree to `path` in a compact form and frees
+        // the Rust tree and the caches. The next query that needs the tree
+        // reads it back in, node handles stay valid across the round trip.
+        // Not for trees shared with worker threads, faulting in writes.
+        bool spill(const QString &path);
+        // Reads a spilled tree back in now rather than on the next query.
+        // False if the file is missing or damaged: the tree then stays
+        // spilled and the file is kept, and a query that needs the tree
+        // aborts instead of answering from a tree that is not there.
+        bool restore() const;
+        [[nodiscard]] bool resident() const { return tree.has_value(); }
+        [[nodiscard]] qint64 spilledBytes() const { return spillSize; }
 
     private:
-        rust::Box<librustdisboard::GameTree> tree;
+        Disboard(rust::Box<librustdisboard::GameTree> tree, const Position &rootPosition);
+
+        // Empty while spilled, see rust()
+        mutable std::optional<rust::Box<librustdisboard::GameTree>> tree;
+        mutable QString spillPath;
+        mutable qint64 spillSize = 0;
+        mutable int spilledNodes = 0;
+        // A tree read back in gets new ids on the Rust side. Handles given
+        // out before stay the public ones and are translated at the FFI.
+        mutable QHash<QUuid, QUuid> toInternal;
+        mutable QHash<QUuid, QUuid> toExternal;
+
+        [[nodiscard]] librustdisboard::GameTree &rust() const;
+        bool faultIn() const;
+        // A fresh Rust tree from `fen` with the nodes in add_tree form,
+        // `ids` being the public handles of the root and then of each node
+        void replant(const std::string &fen, const std::vector<int32_t> &parents,
+                     const std::vector<uint16_t> &bits, const QVector<QUuid> &ids) const;
+
+        [[nodiscard]] static int indexOf(const QVector<NodeEntry> &entries, QUuid node);
+        [[nodiscard]] static QVector<QVector<int>> childLists(const QVector<NodeEntry> &entries);
+        // Replants the nodes reachable through `children` and returns the
+        // others, in preorder
+        QVector<QUuid> rebuild(const QVector<NodeEntry> &entries, const QVector<QVector<int>> &children);
+        [[nodiscard]] librustdisboard::Uuid toRust(QUuid node) const;
+        [[nodiscard]] QUuid fromRust(librustdisboard::Uuid uuid) const;
+
+        // Ply-indexed mainline of the root, built lazily on the first seek
+        // and extended in place when a move is appended to its last node.
+        mutable QVector<QUuid> mainline;
+        mutable QHash<QUuid, int> mainlinePly;
+
+        void ensureMainline() const;
+
+        Annotations notes;
+
+        // Positions are replayed natively from the root and cached per node,
+        // so the interactive queries below never cross the FFI on a hit.
+        static constexpr int positionCacheLimit = 4096;
+        Position rootPosition;
+        mutable QHash<QUuid, Position> positions;
+
+        [[nodiscard]] const Position &positionAt(QUuid node) const;
+
+        // Draw state per node, empty until the first status query
+        mutable GameStates states;
+        mutable QHash<QUuid, int> stateIndex;
+
+        void ensureStates() const;
+        void trackState(QUuid parent, QUuid node, const Position &position);
     };
 }
 
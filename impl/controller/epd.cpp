@@ -0,0 +1,159 @@
+#include "epd.h"
+
+#include <QFile>
+
+#include <string>
+
+using namespace disboard;
+
+namespace {
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    std::string_view nextToken(std::string_view &str) {
+        while (!str.empty() && isSpace(str.front())) str.remove_prefix(1);
+        size_t end = 0;
+        while (end < str.size() && !isSpace(str[end])) end += 1;
+        auto token = str.substr(0, end);
+        str.remove_prefix(end);
+        return token;
+    }
+
+    // Splits one `opcode operand...` operation, honoring quoted operands
+    QStringList operands(std::string_view operation) {
+        QStringList list;
+        std::string current;
+        bool quoted = false, pending = false;
+        for (auto c: operation) {
+            if (c == '"') {
+                quoted = !quoted;
+                pending = true;
+            } else if (isSpace(c) && !quoted) {
+                if (pending) list.push_back(QString::fromStdString(current));
+                current.clear();
+                pending = false;
+            } else {
+                current += c;
+                pending = true;
+            }
+        }
+        if (pending) list.push_back(QString::fromStdString(current));
+        return list;
+    }
+
+    std::optional<uint64_t> parseCount(const QString &str) {
+        bool ok = false;
+        auto value = str.toULongLong(&ok);
+        if (!ok) return {};
+        return value;
+    }
+}
+
+std::optional<EpdRecord> EpdRecord::parse(std::string_view line, QString *error) {
+    auto fail = [error](const QString &message) -> std::optional<EpdRecord> {
+        if (error) *error = message;
+        return {};
+    };
+
+    std::string fen;
+    for (int field = 0; field < 4; field += 1) {
+        auto token = nextToken(line);
+        if (token.empty()) return fail(QStringLiteral("expected four position fields"));
+        if (field) fen += ' ';
+        fen += token;
+    }
+
+    EpdRecord record;
+    QString halfmoves = QStringLiteral("0"), fullmoves = QStringLiteral("1");
+
+    // Perft suites often carry a full six-field FEN instead of hmvc/fmvn
+    {
+        auto rest = line;
+        auto first = nextToken(rest), second = nextToken(rest);
+        auto numeric = [](std::string_view str) {
+            return !str.empty() && str.find_first_not_of("0123456789") == std::string_view::npos;
+        };
+        if (numeric(first) && numeric(second)) {
+            halfmoves = QString::fromLatin1(first.data(), static_cast<qsizetype>(first.size()));
+            fullmoves = QString::fromLatin1(second.data(), static_cast<qsizetype>(second.size()));
+            line = rest;
+        }
+    }
+
+    // Operations are separated by semicolons, which may not appear quoted
+    // in the opcodes this reader understands.
+    QVector<QStringList> operations;
+    while (!line.empty()) {
+        auto end = std::min(line.find(';'), line.size());
+        auto list = operands(line.substr(0, end));
+        line.remove_prefix(std::min(end + 1, line.size()));
+        if (!list.empty()) operations.push_back(list);
+    }
+
+    for (const auto &operation: operations) {
+        const auto &opcode = operation.front();
+        auto args = operation.mid(1);
+
+        if (opcode == QStringLiteral("bm")) {
+            record.bestMoves.append(args);
+        } else if (opcode == QStringLiteral("am")) {
+            record.avoidMoves.append(args);
+        } else if (opcode == QStringLiteral("id")) {
+            record.id = args.join(QLatin1Char(' '));
+        } else if (opcode == QStringLiteral("hmvc") && !args.empty()) {
+            halfmoves = args.front();
+        } else if (opcode == QStringLiteral("fmvn") && !args.empty()) {
+            fullmoves = args.front();
+        } else if (opcode.size() >= 2 && opcode.front() == QLatin1Char('D')) {
+            bool ok = false;
+            auto depth = opcode.mid(1).toInt(&ok);
+            auto nodes = args.empty() ? std::nullopt : parseCount(args.front());
+            if (!ok || depth <= 0 || !nodes.has_value()) {
+                return fail(QStringLiteral("malformed perft operation %1").arg(operation.join(QLatin1Char(' '))));
+            }
+            record.perft.push_back({depth, *nodes});
+        }
+        // Other opcodes (c0, acd, ce, ...) carry nothing we check
+    }
+
+    fen += ' ' + halfmoves.toStdString() + ' ' + fullmoves.toStdString();
+    auto position = Position::fromFen(fen);
+    if (!position.has_value()) return fail(QStringLiteral("illegal position %1").arg(QString::fromStdString(fen)));
+    record.position = *position;
+
+    return record;
+}
+
+EpdSuite EpdSuite::parse(const QByteArray &data) {
+    EpdSuite suite;
+
+    int lineNumber = 0;
+    qsizetype start = 0;
+    while (start < data.size()) {
+        auto end = data.indexOf('\n', start);
+        if (end < 0) end = data.size();
+        std::string_view line(data.constData() + start, static_cast<size_t>(end - start));
+        start = end + 1;
+        lineNumber += 1;
+
+        while (!line.empty() && isSpace(line.front())) line.remove_prefix(1);
+        if (line.empty() || line.front() == '#') continue;
+
+        QString error;
+        if (auto record = EpdRecord::parse(line, &error)) {
+            record->line = lineNumber;
+            suite.records.push_back(std::move(*record));
+        } else {
+            suite.errors.push_back({lineNumber, error});
+        }
+    }
+
+    return suite;
+}
+
+std::optional<EpdSuite> EpdSuite::load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+    return parse(file.readAll());
+}
@@ -0,0 +1,51 @@
+#ifndef DISBOARD_EPD_H
+#define DISBOARD_EPD_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <optional>
+#include <string_view>
+
+#include "position.h"
+
+namespace disboard {
+    // Expected node count of a `D<depth>` opcode, as used by perft suites
+    struct PerftExpectation {
+        int depth;
+        uint64_t nodes;
+    };
+
+    // One line of an EPD file. `bm` and `am` operands are kept as written
+    // and only resolved against the position when a job runs, so a broken
+    // suite shows up in the report instead of failing to load.
+    struct EpdRecord {
+        int line = 0;
+        Position position;
+        QString id;
+        QStringList bestMoves;
+        QStringList avoidMoves;
+        QVector<PerftExpectation> perft;
+
+        [[nodiscard]] static std::optional<EpdRecord> parse(std::string_view line, QString *error = nullptr);
+    };
+
+    struct EpdError {
+        int line;
+        QString message;
+    };
+
+    struct EpdSuite {
+        QVector<EpdRecord> records;
+        QVector<EpdError> errors;
+
+        // Blank lines and lines starting with '#' are skipped
+        [[nodiscard]] static EpdSuite parse(const QByteArray &data);
+        [[nodiscard]] static std::optional<EpdSuite> load(const QString &path);
+    };
+}
+
+
+#endif //DISBOARD_EPD_H
@@ -0,0 +1,177 @@
+#include "epdrunner.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+
+using namespace disboard;
+
+bool EpdResult::passed() const {
+    if (!unresolved.empty()) return false;
+    if (solved.has_value() && !*solved) return false;
+    return std::all_of(perft.cbegin(), perft.cend(), [](const PerftResult &result) {
+        return result.nodes == result.expected;
+    });
+}
+
+QJsonObject EpdResult::toJson() const {
+    QJsonObject obj;
+    obj[QStringLiteral("line")] = line;
+    if (!id.isEmpty()) obj[QStringLiteral("id")] = id;
+    obj[QStringLiteral("fen")] = fen;
+    obj[QStringLiteral("passed")] = passed();
+    obj[QStringLiteral("legalMoves")] = legalMoves;
+    obj[QStringLiteral("elapsedNs")] = elapsedNs;
+
+    if (!unresolved.empty()) obj[QStringLiteral("unresolved")] = QJsonArray::fromStringList(unresolved);
+    if (solved.has_value()) {
+        obj[QStringLiteral("solverMove")] = solverMove;
+        obj[QStringLiteral("solved")] = *solved;
+    }
+
+    if (!perft.empty()) {
+        QJsonArray perftArr;
+        for (const auto &result: perft) {
+            perftArr.append(QJsonObject{
+                    {QStringLiteral("depth"), result.depth},
+                    // Node counts exceed the 53 bits a JSON number holds exactly
+                    {QStringLiteral("expected"), QString::number(result.expected)},
+                    {QStringLiteral("nodes"), QString::number(result.nodes)},
+                    {QStringLiteral("elapsedNs"), result.elapsedNs},
+            });
+        }
+        obj[QStringLiteral("perft")] = perftArr;
+    }
+
+    return obj;
+}
+
+int EpdReport::failures() const {
+    return static_cast<int>(std::count_if(results.cbegin(), results.cend(), [](const EpdResult &result) {
+        return !result.passed();
+    }));
+}
+
+QJsonObject EpdReport::toJson() const {
+    QJsonArray resultArr;
+    qint64 jobNs = 0;
+    uint64_t perftNodes = 0;
+    qint64 perftNs = 0;
+    for (const auto &result: results) {
+        resultArr.append(result.toJson());
+        jobNs += result.elapsedNs;
+        for (const auto &perft: result.perft) {
+            perftNodes += perft.nodes;
+            perftNs += perft.elapsedNs;
+        }
+    }
+
+    auto perSecond = [](double count, qint64 ns) {
+        return ns > 0 ? count * 1e9 / static_cast<double>(ns) : 0.0;
+    };
+
+    QJsonObject summary{
+            {QStringLiteral("positions"), static_cast<int>(results.count())},
+            {QStringLiteral("failures"), failures()},
+            {QStringLiteral("threads"), threads},
+            {QStringLiteral("elapsedNs"), elapsedNs},
+            {QStringLiteral("jobNs"), jobNs},
+            {QStringLiteral("positionsPerSecond"), perSecond(static_cast<double>(results.count()), elapsedNs)},
+            {QStringLiteral("perftNodes"), QString::number(perftNodes)},
+            // Per thread, the wall clock rate is this times the parallelism
+            {QStringLiteral("perftNodesPerSecond"), perSecond(static_cast<double>(perftNodes), perftNs)},
+    };
+
+    return QJsonObject{
+            {QStringLiteral("summary"), summary},
+            {QStringLiteral("results"), resultArr},
+    };
+}
+
+EpdRunner::EpdRunner(EpdOptions options)
+        : options(std::move(options)) {}
+
+EpdResult EpdRunner::runOne(const EpdRecord &record) const {
+    QElapsedTimer timer;
+    timer.start();
+
+    const auto &position = record.position;
+
+    EpdResult result;
+    result.line = record.line;
+    result.id = record.id;
+    result.fen = QString::fromStdString(position.fen());
+    result.legalMoves = position.legalMoves().size();
+
+    QVector<Move> bestMoves, avoidMoves;
+    auto resolve = [&](const QStringList &sans, QVector<Move> &moves) {
+        for (const auto &san: sans) {
+            if (auto move = position.parseSan(san.toStdString())) {
+                moves.push_back(*move);
+            } else {
+                result.unresolved.push_back(san);
+            }
+        }
+    };
+    resolve(record.bestMoves, bestMoves);
+    resolve(record.avoidMoves, avoidMoves);
+
+    if (options.solver && (!bestMoves.empty() || !avoidMoves.empty())) {
+        auto move = options.solver(position);
+        bool solved = false;
+        if (move.has_value() && position.isLegal(*move)) {
+            result.solverMove = QString::fromStdString(position.san(*move));
+            solved = (bestMoves.empty() || bestMoves.contains(*move)) && !avoidMoves.contains(*move);
+        }
+        result.solved = solved;
+    }
+
+    for (const auto &expectation: record.perft) {
+        if (expectation.depth > options.maxPerftDepth) continue;
+
+        QElapsedTimer perftTimer;
+        perftTimer.start();
+        auto nodes = position.perft(expectation.depth);
+        result.perft.push_back({expectation.depth, expectation.nodes, nodes, perftTimer.nsecsElapsed()});
+    }
+
+    result.elapsedNs = timer.nsecsElapsed();
+    return result;
+}
+
+EpdReport EpdRunner::run(const QVector<EpdRecord> &records) const {
+    QElapsedTimer timer;
+    timer.start();
+
+    EpdReport report;
+    report.results.resize(records.count());
+
+    auto total = static_cast<int>(records.count());
+    auto threads = options.threads > 0 ? options.threads : QThread::idealThreadCount();
+    threads = std::max(1, std::min(threads, total));
+    report.threads = threads;
+
+    // Jobs vary wildly in cost (a deep perft against a bare legal move
+    // count), so workers claim one record at a time.
+    std::atomic<int> next{0};
+    auto results = report.results.data();
+    auto work = [&]() {
+        for (auto idx = next.fetch_add(1); idx < total; idx = next.fetch_add(1)) {
+            results[idx] = runOne(records[idx]);
+        }
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int idx = 0; idx < threads; idx += 1) {
+        pool.start(work);
+    }
+    pool.waitForDone();
+
+    report.elapsedNs = timer.nsecsElapsed();
+    return report;
+}
@@ -0,0 +1,77 @@
+#ifndef DISBOARD_EPDRUNNER_H
+#define DISBOARD_EPDRUNNER_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <optional>
+
+#include "epd.h"
+
+namespace disboard {
+    struct EpdOptions {
+        // D<n> operations deeper than this are skipped, 0 disables perft
+        int maxPerftDepth = 0;
+        // 0 uses one thread per core
+        int threads = 0;
+        // Picks a move for the bm/am check. Without a solver the check only
+        // verifies that every bm/am move is legal and unambiguous. Called
+        // from several worker threads at once.
+        std::function<std::optional<Move>(const Position &)> solver;
+    };
+
+    struct PerftResult {
+        int depth;
+        uint64_t expected;
+        uint64_t nodes;
+        qint64 elapsedNs;
+    };
+
+    struct EpdResult {
+        int line = 0;
+        QString id;
+        QString fen;
+
+        int legalMoves = 0;
+
+        // bm/am operands that are not a legal move in the position
+        QStringList unresolved;
+        // SAN of the solver's move, empty without a solver
+        QString solverMove;
+        std::optional<bool> solved;
+
+        QVector<PerftResult> perft;
+        qint64 elapsedNs = 0;
+
+        [[nodiscard]] bool passed() const;
+        [[nodiscard]] QJsonObject toJson() const;
+    };
+
+    struct EpdReport {
+        QVector<EpdResult> results;
+        int threads = 0;
+        qint64 elapsedNs = 0;
+
+        [[nodiscard]] int failures() const;
+        // Per-job results plus a summary with throughput figures
+        [[nodiscard]] QJsonObject toJson() const;
+    };
+
+    // Runs one job per record on a private thread pool and blocks until all
+    // of them are done. Results keep the order of the records.
+    class EpdRunner {
+    public:
+        explicit EpdRunner(EpdOptions options);
+
+        [[nodiscard]] EpdReport run(const QVector<EpdRecord> &records) const;
+        [[nodiscard]] EpdResult runOne(const EpdRecord &record) const;
+
+    private:
+        EpdOptions options;
+    };
+}
+
+
+#endif //DISBOARD_EPDRUNNER_H
@@ -0,0 +1,119 @@
+#include "evalgraphmodel.h"
+
+#include <algorithm>
+
+using disboard::Annotations;
+
+EvalGraphModel::EvalGraphModel(QObject *parent)
+        : QAbstractListModel(parent) {}
+
+int EvalGraphModel::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid()) return 0;
+    return static_cast<int>(nodes.count());
+}
+
+QVariant EvalGraphModel::data(const QModelIndex &idx, int role) const {
+    if (!idx.isValid()) return {};
+    if (idx.row() < 0 || idx.row() >= nodes.count()) return {};
+
+    auto eval = evals[idx.row()];
+    if (role == NodeRole) return nodes[idx.row()];
+    if (role == PlyRole) return idx.row();
+    if (role == EvalRole) {
+        if (eval == Annotations::noEval || Annotations::isMate(eval)) return {};
+        return eval / 100.0;
+    }
+    if (role == MateRole) {
+        if (!Annotations::isMate(eval)) return {};
+        return Annotations::mateIn(eval);
+    }
+    if (role == ScoreRole) {
+        if (eval == Annotations::noEval) return {};
+        return score(eval);
+    }
+    if (role == ClockRole) {
+        if (clocks[idx.row()] == Annotations::noClock) return {};
+        return clocks[idx.row()];
+    }
+
+    return {};
+}
+
+QHash<int, QByteArray> EvalGraphModel::roleNames() const {
+    QHash<int, QByteArray> roles = QAbstractItemModel::roleNames();
+
+    roles[NodeRole] = "node";
+    roles[PlyRole] = "ply";
+    roles[EvalRole] = "eval";
+    roles[MateRole] = "mate";
+    roles[ScoreRole] = "score";
+    roles[ClockRole] = "clock";
+
+    return roles;
+}
+
+Controller *EvalGraphModel::controller() const {
+    return c;
+}
+
+void EvalGraphModel::setController(Controller *newValue) {
+    if (c == newValue) return;
+    if (c) disconnect(c, nullptr, this, nullptr);
+
+    c = newValue;
+    if (c) {
+        // Every tree edit and annotation change is followed by treeChanged
+        connect(c, &Controller::treeChanged, this, &EvalGraphModel::refill);
+        connect(c, &Controller::rootChanged, this, &EvalGraphModel::refill);
+    }
+    refill();
+    emit controllerChanged();
+}
+
+qreal EvalGraphModel::cap() const {
+    return mCap;
+}
+
+void EvalGraphModel::setCap(qreal newValue) {
+    if (qFuzzyCompare(mCap, newValue)) return;
+    mCap = newValue;
+    if (!nodes.empty()) emit dataChanged(index(0), index(static_cast<int>(nodes.count()) - 1), {ScoreRole});
+    emit capChanged();
+}
+
+int EvalGraphModel::count() const {
+    return static_cast<int>(nodes.count());
+}
+
+QVector<qreal> EvalGraphModel::scores() const {
+    QVector<qreal> list;
+    list.reserve(evals.count());
+    for (auto eval: evals) {
+        list.push_back(eval == Annotations::noEval ? qQNaN() : score(eval));
+    }
+    return list;
+}
+
+void EvalGraphModel::refill() {
+    auto oldCount = nodes.count();
+
+    beginResetModel();
+    if (c) {
+        const auto &board = c->board();
+        nodes = board.mainlineFrom(board.root());
+        evals = board.annotations().evals(nodes);
+        clocks = board.annotations().clocks(nodes);
+    } else {
+        nodes.clear();
+        evals.clear();
+        clocks.clear();
+    }
+    endResetModel();
+
+    if (oldCount != nodes.count()) emit countChanged();
+}
+
+qreal EvalGraphModel::score(int32_t eval) const {
+    if (Annotations::isMate(eval)) return eval > 0 ? mCap : -mCap;
+    return std::clamp(eval / 100.0, -mCap, mCap);
+}
@@ -0,0 +1,72 @@
+#ifndef DISBOARD_EVALGRAPHMODEL_H
+#define DISBOARD_EVALGRAPHMODEL_H
+
+#include <QAbstractListModel>
+#include <QObject>
+#include <QPointer>
+#include <QtQml/qqmlregistration.h>
+
+#include "controller.h"
+
+// One row per node of the controller's mainline, root included, for eval
+// and clock charts. Rows are refilled from two bulk column gathers
+// whenever the tree or its annotations change.
+class EvalGraphModel : public QAbstractListModel {
+Q_OBJECT
+
+    QML_ELEMENT
+    Q_DISABLE_COPY(EvalGraphModel)
+
+    Q_PROPERTY(Controller *controller READ controller WRITE setController NOTIFY controllerChanged REQUIRED)
+    // Evals are clamped to +-cap pawns in the score role, mates land on it
+    Q_PROPERTY(qreal cap READ cap WRITE setCap NOTIFY capChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+public:
+    enum ItemRoles {
+        NodeRole = Qt::UserRole + 1,
+        PlyRole,
+        // Pawns from white's point of view, null without an eval
+        EvalRole,
+        // Moves to mate, negative when black mates, null when not a mate
+        MateRole,
+        ScoreRole,
+        // Milliseconds left after the move, null when unknown
+        ClockRole,
+    };
+
+    explicit EvalGraphModel(QObject *parent = nullptr);
+
+    [[nodiscard]] int rowCount(const QModelIndex &parent) const override;
+    [[nodiscard]] QVariant data(const QModelIndex &index, int role) const override;
+    [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
+
+    [[nodiscard]] Controller *controller() const;
+    void setController(Controller *newValue);
+
+    [[nodiscard]] qreal cap() const;
+    void setCap(qreal newValue);
+
+    [[nodiscard]] int count() const;
+
+    // Whole score column at once, for series that take a plain list
+    Q_INVOKABLE QVector<qreal> scores() const;
+
+private:
+    QPointer<Controller> c;
+    qreal mCap = 10;
+
+    QVector<QUuid> nodes;
+    QVector<int32_t> evals;
+    QVector<int32_t> clocks;
+
+    void refill();
+    [[nodiscard]] qreal score(int32_t eval) const;
+
+signals:
+    void controllerChanged();
+    void capChanged();
+    void countChanged();
+};
+
+
+#endif //DISBOARD_EVALGRAPHMODEL_H
@@ -0,0 +1,100 @@
+#include "frameprobe.h"
+
+#include <QVector>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+using namespace disboard;
+
+struct FrameProbe::State {
+    struct Sample {
+        qint64 startNs;
+        bool synced;
+    };
+
+    Presented onPresented;
+
+    // Shared with the render thread
+    std::mutex mutex;
+    QVector<Sample> samples;
+};
+
+FrameProbe::FrameProbe(QObject *context, Presented onPresented)
+        : state(std::make_shared<State>()), context(context) {
+    state->onPresented = std::move(onPresented);
+}
+
+FrameProbe::~FrameProbe() {
+    disconnect();
+}
+
+QQuickWindow *FrameProbe::window() const {
+    return mWindow;
+}
+
+void FrameProbe::setWindow(QQuickWindow *window) {
+    disconnect();
+    {
+        std::lock_guard lock(state->mutex);
+        state->samples.clear();
+    }
+    mWindow = window;
+    if (!window) return;
+
+    // Both run on the render thread, the lambdas only hold the state so a
+    // frame in flight cannot outlive what it touches.
+    syncConnection = QObject::connect(window, &QQuickWindow::afterSynchronizing, context, [state = state]() {
+        std::lock_guard lock(state->mutex);
+        for (auto &sample: state->samples) sample.synced = true;
+    }, Qt::DirectConnection);
+
+    auto context = this->context;
+    swapConnection = QObject::connect(window, &QQuickWindow::frameSwapped, context, [state = state, context]() {
+        auto presented = now();
+
+        QVector<qint64> shown;
+        {
+            std::lock_guard lock(state->mutex);
+            auto it = std::stable_partition(state->samples.begin(), state->samples.end(), [](const State::Sample &sample) {
+                return !sample.synced;
+            });
+            for (auto shownIt = it; shownIt != state->samples.end(); ++shownIt) {
+                shown.push_back(shownIt->startNs);
+            }
+            state->samples.erase(it, state->samples.end());
+        }
+        if (shown.empty()) return;
+
+        QMetaObject::invokeMethod(context, [state, shown, presented]() {
+            for (auto start: shown) {
+                state->onPresented(start, presented);
+            }
+        }, Qt::QueuedConnection);
+    }, Qt::DirectConnection);
+}
+
+void FrameProbe::mark(qint64 startNs) {
+    if (!mWindow) {
+        state->onPresented(startNs, now());
+        return;
+    }
+
+    {
+        std::lock_guard lock(state->mutex);
+        state->samples.push_back({startNs, false});
+    }
+    mWindow->update();
+}
+
+qint64 FrameProbe::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+void FrameProbe::disconnect() {
+    QObject::disconnect(syncConnection);
+    QObject::disconnect(swapConnection);
+}
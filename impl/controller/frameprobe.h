@@ -0,0 +1,67 @@
+#ifndef DISBOARD_FRAMEPROBE_H
+#define DISBOARD_FRAMEPROBE_H
+
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <QQuickWindow>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+namespace disboard {
+    // Follows updates made on the GUI thread to the frame that shows them.
+    // The GUI thread is blocked while the scene graph synchronizes, so all
+    // updates marked before that are part of the frame swapped next.
+    class FrameProbe {
+    public:
+        // Called on the GUI thread with steady clock nanoseconds
+        using Presented = std::function<void(qint64 startNs, qint64 presentedNs)>;
+
+        FrameProbe(QObject *context, Presented onPresented);
+        ~FrameProbe();
+
+        FrameProbe(const FrameProbe &) = delete;
+        FrameProbe &operator=(const FrameProbe &) = delete;
+
+        [[nodiscard]] QQuickWindow *window() const;
+        void setWindow(QQuickWindow *window);
+
+        // Records an update that began at `startNs` and asks for a frame.
+        // Without a window the update counts as presented right away.
+        void mark(qint64 startNs);
+
+        [[nodiscard]] static qint64 now();
+
+    private:
+        struct State;
+        std::shared_ptr<State> state;
+
+        QObject *context;
+        QPointer<QQuickWindow> mWindow;
+        QMetaObject::Connection syncConnection;
+        QMetaObject::Connection swapConnection;
+
+        void disconnect();
+    };
+
+    // Running figures of a latency probe, in milliseconds
+    struct LatencyStats {
+        qreal last = 0;
+        qreal max = 0;
+        qreal sum = 0;
+        int count = 0;
+
+        void add(qreal latency) {
+            last = latency;
+            max = std::max(max, latency);
+            sum += latency;
+            count += 1;
+        }
+        [[nodiscard]] qreal mean() const { return count ? sum / count : 0; }
+    };
+}
+
+
+#endif //DISBOARD_FRAMEPROBE_H
@@ -0,0 +1,68 @@
+#include "gamecollection.h"
+
+#include <vector>
+
+using namespace disboard;
+
+IndexedGame::IndexedGame(std::shared_ptr<const Disboard> game)
+        : mGame(std::move(game)) {}
+
+const GameIndex &IndexedGame::index() const {
+    std::call_once(indexed, [this]() {
+        mIndex.nodes = mGame->nodes();
+
+        auto count = mIndex.nodes.count();
+        mIndex.plies.resize(count);
+        mIndex.hashes.resize(count);
+        mIndex.materials.resize(count);
+
+        // Parents precede children, so one position per node is enough to
+        // replay the whole tree in a single pass.
+        std::vector<Position> positions;
+        positions.reserve(count);
+        for (qsizetype idx = 0; idx < count; idx += 1) {
+            const auto &entry = mIndex.nodes[idx];
+            if (entry.parent < 0) {
+                positions.push_back(mGame->initialPosition());
+                mIndex.plies[idx] = 0;
+            } else {
+                auto position = positions[entry.parent];
+                position.play(entry.move);
+                positions.push_back(position);
+                mIndex.plies[idx] = mIndex.plies[entry.parent] + 1;
+            }
+            mIndex.hashes[idx] = positions.back().hash();
+            mIndex.materials[idx] = positions.back().materialKey();
+        }
+    });
+    return mIndex;
+}
+
+class GameCollection::p {
+    friend GameCollection;
+
+private:
+    QVector<std::shared_ptr<const IndexedGame>> games;
+};
+
+GameCollection::GameCollection(QObject *parent)
+        : QObject(parent),
+          p(new class GameCollection::p) {}
+
+int GameCollection::count() const {
+    return static_cast<int>(p->games.count());
+}
+
+void GameCollection::add(std::shared_ptr<const Disboard> game) {
+    p->games.push_back(std::make_shared<IndexedGame>(std::move(game)));
+    emit countChanged();
+}
+
+std::shared_ptr<const Disboard> GameCollection::game(int idx) const {
+    if (idx < 0 || idx >= p->games.count()) return {};
+    return p->games[idx]->game();
+}
+
+QVector<std::shared_ptr<const IndexedGame>> GameCollection::snapshot() const {
+    return p->games;
+}
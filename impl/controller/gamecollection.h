@@ -0,0 +1,69 @@
+#ifndef DISBOARD_GAMECOLLECTION_H
+#define DISBOARD_GAMECOLLECTION_H
+
+#include <QObject>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+#include <memory>
+#include <mutex>
+
+#include "disboard.h"
+
+namespace disboard {
+    // Per-node search keys of one game, parallel to `nodes`
+    struct GameIndex {
+        QVector<NodeEntry> nodes;
+        QVector<int> plies;
+        QVector<uint64_t> hashes;
+        QVector<uint64_t> materials;
+    };
+
+    // A game of a collection. Collection games are read-only, which is what
+    // makes it safe to scan them from several threads at once.
+    class IndexedGame {
+    public:
+        explicit IndexedGame(std::shared_ptr<const Disboard> game);
+
+        [[nodiscard]] const std::shared_ptr<const Disboard> &game() const { return mGame; }
+
+        // Built on first use, safe to call from any thread
+        [[nodiscard]] const GameIndex &index() const;
+
+    private:
+        std::shared_ptr<const Disboard> mGame;
+
+        mutable std::once_flag indexed;
+        mutable GameIndex mIndex;
+    };
+}
+
+class GameCollection : public QObject {
+Q_OBJECT
+
+    QML_ELEMENT
+    Q_DISABLE_COPY(GameCollection)
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    explicit GameCollection(QObject *parent = nullptr);
+
+    [[nodiscard]] int count() const;
+
+    void add(std::shared_ptr<const disboard::Disboard> game);
+    [[nodiscard]] std::shared_ptr<const disboard::Disboard> game(int idx) const;
+
+    // The games at this point in time, unaffected by later additions
+    [[nodiscard]] QVector<std::shared_ptr<const disboard::IndexedGame>> snapshot() const;
+
+private:
+    class p;
+    std::shared_ptr<p> p;
+
+signals:
+    void countChanged();
+};
+
+
+#endif //DISBOARD_GAMECOLLECTION_H
@@ -0,0 +1,58 @@
+#include "gamestate.h"
+
+#include <algorithm>
+
+using namespace disboard;
+
+QString GameStatus::reason() const {
+    if (insufficientMaterial) return QStringLiteral("insufficient material");
+    if (repetitions >= 5) return QStringLiteral("fivefold repetition");
+    if (halfmoves >= 150) return QStringLiteral("seventy-five-move rule");
+    if (threefold()) return QStringLiteral("threefold repetition");
+    if (fiftyMoves()) return QStringLiteral("fifty-move rule");
+    return {};
+}
+
+int GameStates::add(int parent, const Position &position) {
+    Entry entry{
+            position.hash(),
+            parent,
+            static_cast<uint16_t>(std::min(position.halfmoves(), 0xffff)),
+            1,
+            position.isInsufficientMaterial()
+    };
+
+    // A capture or pawn move can never be undone, so only the plies since
+    // the last one can repeat this position, and only those with the same
+    // side to move. The nearest repetition already counts the ones before.
+    auto ancestor = parent < 0 ? -1 : entries[static_cast<size_t>(parent)].parent;
+    for (int back = 2; ancestor >= 0 && back <= entry.halfmoves; back += 2) {
+        const auto &candidate = entries[static_cast<size_t>(ancestor)];
+        if (candidate.hash == entry.hash) {
+            entry.repetitions = static_cast<uint8_t>(std::min(candidate.repetitions + 1, 0xff));
+            break;
+        }
+        ancestor = candidate.parent < 0 ? -1 : entries[static_cast<size_t>(candidate.parent)].parent;
+    }
+
+    entries.push_back(entry);
+    return static_cast<int>(entries.size()) - 1;
+}
+
+GameStatus GameStates::status(int index) const {
+    if (index < 0 || index >= count()) return {};
+    const auto &entry = entries[static_cast<size_t>(index)];
+    GameStatus status;
+    status.halfmoves = entry.halfmoves;
+    status.repetitions = entry.repetitions;
+    status.insufficientMaterial = entry.insufficientMaterial;
+    return status;
+}
+
+void GameStates::clear() {
+    entries = {};
+}
+
+qint64 GameStates::memoryBytes() const {
+    return static_cast<qint64>(entries.capacity() * sizeof(Entry));
+}
@@ -0,0 +1,116 @@
+#ifndef DISBOARD_GAMESTATE_H
+#define DISBOARD_GAMESTATE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+#include <vector>
+
+#include "position.h"
+
+namespace disboard {
+    // Draw rules as they stand at one node, given the path leading to it
+    class GameStatus {
+        Q_GADGET
+        QML_VALUE_TYPE(gameStatus)
+        Q_PROPERTY(int halfmoves MEMBER halfmoves CONSTANT)
+        Q_PROPERTY(int repetitions MEMBER repetitions CONSTANT)
+        Q_PROPERTY(bool insufficientMaterial MEMBER insufficientMaterial CONSTANT)
+        Q_PROPERTY(bool threefold READ threefold CONSTANT)
+        Q_PROPERTY(bool fiftyMoves READ fiftyMoves CONSTANT)
+        Q_PROPERTY(bool claimable READ claimable CONSTANT)
+        Q_PROPERTY(bool drawn READ drawn CONSTANT)
+        Q_PROPERTY(QString reason READ reason CONSTANT)
+
+    public:
+        int halfmoves = 0;
+        // Occurrences of the position on the path, this one included
+        int repetitions = 1;
+        bool insufficientMaterial = false;
+
+        [[nodiscard]] bool threefold() const { return repetitions >= 3; }
+        [[nodiscard]] bool fiftyMoves() const { return halfmoves >= 100; }
+        // A player may claim the draw
+        [[nodiscard]] bool claimable() const { return threefold() || fiftyMoves(); }
+        // Drawn without a claim: fivefold repetition, seventy-five moves or
+        // no mating material left
+        [[nodiscard]] bool drawn() const {
+            return repetitions >= 5 || halfmoves >= 150 || insufficientMaterial;
+        }
+        // The rule that draws or may draw the game, empty when none does
+        [[nodiscard]] QString reason() const;
+    };
+
+    // Draw state of every node of a flattened tree, appended as the tree
+    // grows. A node only needs its own position and its parent's entry, so
+    // adding one costs a walk back over the reversible plies at most, and
+    // every query after is a lookup.
+    class GameStates {
+    public:
+        // Appends the node reached in `position` below `parent`, -1 for
+        // the root, and returns its index
+        int add(int parent, const Position &position);
+
+        // Replays nodes flattened like NodeEntry or PgnNode, root first,
+        // keeping only the positions of the current path when they come in
+        // preorder. Entry indices follow `nodes`.
+        template<typename Node>
+        void assign(const Position &root, const QVector<Node> &nodes);
+
+        [[nodiscard]] GameStatus status(int index) const;
+        [[nodiscard]] int count() const { return static_cast<int>(entries.size()); }
+        [[nodiscard]] bool empty() const { return entries.empty(); }
+        void clear();
+
+        [[nodiscard]] qint64 memoryBytes() const;
+
+    private:
+        struct Entry {
+            uint64_t hash;
+            int32_t parent;
+            uint16_t halfmoves;
+            uint8_t repetitions;
+            bool insufficientMaterial;
+        };
+
+        std::vector<Entry> entries;
+    };
+
+    template<typename Node>
+    void GameStates::assign(const Position &root, const QVector<Node> &nodes) {
+        clear();
+        entries.reserve(static_cast<size_t>(nodes.count()));
+
+        std::vector<std::pair<int, Position>> path;
+        for (int idx = 0; idx < nodes.count(); idx += 1) {
+            auto parent = nodes[idx].parent;
+            if (parent < 0) {
+                path.assign(1, {idx, root});
+                add(-1, root);
+                continue;
+            }
+
+            while (!path.empty() && path.back().first != parent) path.pop_back();
+            if (path.empty()) {
+                // Not in preorder after all, replay the whole line
+                std::vector<Move> line;
+                for (auto node = parent; nodes[node].parent >= 0; node = nodes[node].parent) {
+                    line.push_back(nodes[node].move);
+                }
+                auto position = root;
+                for (auto it = line.rbegin(); it != line.rend(); ++it) position.play(*it);
+                path.emplace_back(parent, position);
+            }
+
+            auto position = path.back().second;
+            position.play(nodes[idx].move);
+            add(parent, position);
+            path.emplace_back(idx, position);
+        }
+    }
+}
+
+
+#endif //DISBOARD_GAMESTATE_H
@@ -0,0 +1,221 @@
+#include "gifwriter.h"
+
+#include <algorithm>
+#include <climits>
+
+using namespace disboard;
+
+namespace {
+    constexpr int maxKeyColors = 40;
+    constexpr int clearCode = 256;
+    constexpr int endCode = 257;
+    constexpr int maxCode = 4095;
+    constexpr int hashSize = 8192;
+
+    int bucket(QRgb rgb) {
+        return (qRed(rgb) >> 3) << 10 | (qGreen(rgb) >> 3) << 5 | qBlue(rgb) >> 3;
+    }
+
+    void putShort(QByteArray &out, int value) {
+        out.append(static_cast<char>(value & 0xff));
+        out.append(static_cast<char>(value >> 8 & 0xff));
+    }
+
+    // Packs variable width codes LSB first into 255 byte sub-blocks
+    class CodeWriter {
+    public:
+        explicit CodeWriter(QByteArray &out) : out(out) {}
+
+        void write(int code, int size) {
+            bits |= static_cast<uint32_t>(code) << count;
+            count += size;
+            while (count >= 8) {
+                push(static_cast<char>(bits & 0xff));
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+
+        void finish() {
+            if (count > 0) push(static_cast<char>(bits & 0xff));
+            flush();
+            out.append('\0');
+        }
+
+    private:
+        QByteArray &out;
+        uint32_t bits = 0;
+        int count = 0;
+        char block[255]{};
+        int blockSize = 0;
+
+        void push(char byte) {
+            block[blockSize++] = byte;
+            if (blockSize == 255) flush();
+        }
+
+        void flush() {
+            if (blockSize == 0) return;
+            out.append(static_cast<char>(blockSize));
+            out.append(block, blockSize);
+            blockSize = 0;
+        }
+    };
+}
+
+GifPalette::GifPalette(const QVector<QRgb> &keyColors)
+        : lookup(1 << 15) {
+    auto keys = std::min(static_cast<int>(keyColors.count()), maxKeyColors);
+    for (int idx = 0; idx < keys; idx += 1) colors[idx] = keyColors[idx] | 0xff000000;
+    // The cube fills the last 216 entries whatever the number of keys
+    for (int idx = 0; idx < 216; idx += 1) {
+        colors[maxKeyColors + idx] = qRgb(idx / 36 * 51, idx / 6 % 6 * 51, idx % 6 * 51);
+    }
+    for (int idx = keys; idx < maxKeyColors; idx += 1) colors[idx] = colors[maxKeyColors];
+
+    for (int rgb = 0; rgb < (1 << 15); rgb += 1) {
+        int r = (rgb >> 10) << 3 | 4, g = (rgb >> 5 & 31) << 3 | 4, b = (rgb & 31) << 3 | 4;
+        int best = 0, bestDistance = INT_MAX;
+        for (int idx = 0; idx < 256; idx += 1) {
+            int dr = qRed(colors[idx]) - r, dg = qGreen(colors[idx]) - g, db = qBlue(colors[idx]) - b;
+            int distance = dr * dr + dg * dg + db * db;
+            if (distance < bestDistance) {
+                best = idx;
+                bestDistance = distance;
+            }
+        }
+        lookup[rgb] = static_cast<uint8_t>(best);
+    }
+    // Flat board colors must come out exact, not just close
+    for (int idx = 0; idx < keys; idx += 1) lookup[bucket(colors[idx])] = static_cast<uint8_t>(idx);
+}
+
+uint8_t GifPalette::index(QRgb rgb) const {
+    return lookup[bucket(rgb)];
+}
+
+GifWriter::GifWriter(int width, int height, const GifPalette &palette)
+        : width(width), height(height), palette(palette) {
+    writeHeader();
+}
+
+void GifWriter::writeHeader() {
+    out.append("GIF89a", 6);
+    putShort(out, width);
+    putShort(out, height);
+    // Global table of 256 entries, 8 bits per channel
+    out.append(static_cast<char>(0xf7));
+    out.append('\0'); // background
+    out.append('\0'); // aspect
+    for (int idx = 0; idx < 256; idx += 1) {
+        auto rgb = palette.color(idx);
+        out.append(static_cast<char>(qRed(rgb)));
+        out.append(static_cast<char>(qGreen(rgb)));
+        out.append(static_cast<char>(qBlue(rgb)));
+    }
+
+    // Loop forever
+    out.append("\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 19);
+}
+
+QVector<uint8_t> GifWriter::indexed(const QImage &image) const {
+    auto rgb = image.convertToFormat(QImage::Format_RGB32);
+    QVector<uint8_t> pixels(width * height);
+    for (int y = 0; y < height; y += 1) {
+        auto line = reinterpret_cast<const QRgb *>(rgb.constScanLine(y));
+        for (int x = 0; x < width; x += 1) {
+            pixels[y * width + x] = palette.index(line[x]);
+        }
+    }
+    return pixels;
+}
+
+void GifWriter::addFrame(const QImage &image, int delay) {
+    Q_ASSERT(image.width() == width && image.height() == height);
+    auto pixels = indexed(image);
+
+    int left = 0, top = 0, right = width - 1, bottom = height - 1;
+    if (!previous.empty()) {
+        // Bounding box of the pixels that differ from the last frame
+        left = width, top = height, right = -1, bottom = -1;
+        for (int y = 0; y < height; y += 1) {
+            for (int x = 0; x < width; x += 1) {
+                if (pixels[y * width + x] == previous[y * width + x]) continue;
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+            }
+        }
+        // Nothing changed, still a frame to carry the delay
+        if (right < 0) left = top = right = bottom = 0;
+    }
+
+    // Graphic control: keep the previous frame underneath, no transparency
+    out.append("\x21\xf9\x04\x04", 4);
+    putShort(out, std::clamp(delay, 0, 0xffff));
+    out.append("\x00\x00", 2);
+
+    auto w = right - left + 1, h = bottom - top + 1;
+    out.append('\x2c');
+    putShort(out, left);
+    putShort(out, top);
+    putShort(out, w);
+    putShort(out, h);
+    out.append('\0'); // no local table, not interlaced
+
+    QVector<uint8_t> rect(w * h);
+    for (int y = 0; y < h; y += 1) {
+        std::copy_n(pixels.constData() + (top + y) * width + left, w, rect.data() + y * w);
+    }
+    writeLzw(rect);
+
+    previous = std::move(pixels);
+    frames += 1;
+}
+
+void GifWriter::writeLzw(const QVector<uint8_t> &pixels) {
+    out.append('\x08'); // minimum code size
+
+    // Open addressing from (prefix << 8 | byte) to the code extending prefix
+    QVector<int32_t> keys(hashSize, -1);
+    QVector<int16_t> codes(hashSize);
+
+    CodeWriter writer(out);
+    int codeSize = 9;
+    int next = endCode;
+    writer.write(clearCode, codeSize);
+
+    int prefix = pixels[0];
+    for (qsizetype idx = 1; idx < pixels.count(); idx += 1) {
+        auto byte = pixels[idx];
+        auto key = prefix << 8 | byte;
+        auto slot = static_cast<int>((static_cast<uint32_t>(key) * 2654435761u) >> 19);
+        while (keys[slot] != -1 && keys[slot] != key) slot = (slot + 1) & (hashSize - 1);
+        if (keys[slot] == key) {
+            prefix = codes[slot];
+            continue;
+        }
+
+        writer.write(prefix, codeSize);
+        next += 1;
+        keys[slot] = key;
+        codes[slot] = static_cast<int16_t>(next);
+        if (next >= (1 << codeSize)) codeSize += 1;
+        if (next == maxCode) {
+            writer.write(clearCode, codeSize);
+            keys.fill(-1);
+            codeSize = 9;
+            next = endCode;
+        }
+        prefix = byte;
+    }
+    writer.write(prefix, codeSize);
+    writer.write(endCode, codeSize);
+    writer.finish();
+}
+
+QByteArray GifWriter::finish() {
+    out.append('\x3b');
+    return std::move(out);
+}
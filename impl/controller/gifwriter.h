@@ -0,0 +1,59 @@
+#ifndef DISBOARD_GIFWRITER_H
+#define DISBOARD_GIFWRITER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QVector>
+
+#include <array>
+#include <cstdint>
+
+namespace disboard {
+    // Fixed 256 color table: the given key colors exactly, then a 6x6x6
+    // cube for piece shading. Building the lookup takes a while, so one
+    // palette is meant to be shared by all writers.
+    class GifPalette {
+    public:
+        // Up to 40 key colors are kept
+        explicit GifPalette(const QVector<QRgb> &keyColors);
+
+        [[nodiscard]] QRgb color(int idx) const { return colors[idx]; }
+        [[nodiscard]] uint8_t index(QRgb rgb) const;
+
+    private:
+        std::array<QRgb, 256> colors{};
+        // Nearest entry for every 5-bit-per-channel color
+        QVector<uint8_t> lookup;
+    };
+
+    // Animated GIF89a encoder for board images, which Qt cannot write.
+    // Frames after the first only encode the rectangle that changed.
+    class GifWriter {
+    public:
+        // All frames must be width x height, `palette` must outlive the writer
+        GifWriter(int width, int height, const GifPalette &palette);
+
+        // `delay` in hundredths of a second
+        void addFrame(const QImage &image, int delay);
+
+        [[nodiscard]] int frameCount() const { return frames; }
+        // Appends the trailer, the writer must not be used afterwards
+        [[nodiscard]] QByteArray finish();
+
+    private:
+        int width;
+        int height;
+        int frames = 0;
+        QByteArray out;
+
+        const GifPalette &palette;
+        QVector<uint8_t> previous;
+
+        void writeHeader();
+        [[nodiscard]] QVector<uint8_t> indexed(const QImage &image) const;
+        void writeLzw(const QVector<uint8_t> &pixels);
+    };
+}
+
+
+#endif //DISBOARD_GIFWRITER_H
@@ -0,0 +1,669 @@
+#include "journal.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace disboard;
+
+namespace {
+    const QByteArray magic = QByteArrayLiteral("DSBJ\x02");
+
+    // Group commit: edits arriving this soon after the first one of a batch
+    // share its write and its sync
+    constexpr auto groupCommitWindow = std::chrono::milliseconds(5);
+
+    // Nodes are referred to by ids, the root being 0. An id is given out
+    // once and never reused, so records stay valid across snapshots.
+    enum class Record : uint8_t {
+        // FEN of the root, empty for the standard position. Always first.
+        Start = 1,
+        // Parent id, move count, then per node its move as a packed 16-bit
+        // value and its id
+        Line = 2,
+        // Id of the node shown on the board
+        Select = 3,
+        // The whole tree after Start: node count, then per node in preorder
+        // the position of its parent in the record (0 for the root), its
+        // move and its id
+        Tree = 4,
+        // Id of the node, as in the Disboard edit of the same name
+        Remove = 5,
+        Truncate = 6,
+        // Id of the node, then its new index among its siblings
+        MoveVariation = 7,
+        PromoteVariation = 8,
+    };
+
+    uint32_t crc32(const char *data, qsizetype size) {
+        static const auto table = []() {
+            std::array<uint32_t, 256> table{};
+            for (uint32_t idx = 0; idx < 256; idx += 1) {
+                auto crc = idx;
+                for (int bit = 0; bit < 8; bit += 1) crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320u : 0);
+                table[idx] = crc;
+            }
+            return table;
+        }();
+
+        uint32_t crc = 0xffffffffu;
+        for (qsizetype idx = 0; idx < size; idx += 1) {
+            crc = table[(crc ^ static_cast<uint8_t>(data[idx])) & 0xff] ^ (crc >> 8);
+        }
+        return crc ^ 0xffffffffu;
+    }
+
+    void putVarint(QByteArray &out, uint32_t value) {
+        while (value >= 0x80) {
+            out.append(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.append(static_cast<char>(value));
+    }
+
+    void putU16(QByteArray &out, uint16_t value) {
+        out.append(static_cast<char>(value & 0xff));
+        out.append(static_cast<char>(value >> 8));
+    }
+
+    void putU32(QByteArray &out, uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) out.append(static_cast<char>((value >> shift) & 0xff));
+    }
+
+    // Frames a record as its length, the record and a CRC-32 of it
+    void putRecord(QByteArray &out, const QByteArray &record) {
+        putVarint(out, static_cast<uint32_t>(record.size()));
+        out.append(record);
+        putU32(out, crc32(record.constData(), record.size()));
+    }
+
+    // One edit on its way to the writer, in terms of ids
+    struct Op {
+        Record type;
+        // The parent for Line, the node edited or selected otherwise
+        int node = 0;
+        // MoveVariation
+        int index = 0;
+        // Line: per node its move and its id. Tree: per node after the root
+        // its move and its parent id, ids being the order of the list.
+        QVector<uint16_t> moves;
+        QVector<int> ids;
+        QVector<int> parents;
+        // Tree
+        std::string fen;
+    };
+
+    QByteArray selectRecord(int node) {
+        QByteArray record;
+        record.append(static_cast<char>(Record::Select));
+        putVarint(record, static_cast<uint32_t>(node));
+        return record;
+    }
+
+    // The record of any op but Tree
+    QByteArray opRecord(const Op &op) {
+        QByteArray record;
+        record.append(static_cast<char>(op.type));
+        putVarint(record, static_cast<uint32_t>(op.node));
+        if (op.type == Record::Line) {
+            record.reserve(4 + op.moves.count() * 5);
+            putVarint(record, static_cast<uint32_t>(op.moves.count()));
+            for (qsizetype idx = 0; idx < op.moves.count(); idx += 1) {
+                putU16(record, op.moves[idx]);
+                putVarint(record, static_cast<uint32_t>(op.ids[idx]));
+            }
+        } else if (op.type == Record::MoveVariation) {
+            putVarint(record, static_cast<uint32_t>(op.index));
+        }
+        return record;
+    }
+
+    class Reader {
+    public:
+        Reader(const char *data, qsizetype size) : data(data), end(data + size) {}
+
+        std::optional<uint32_t> varint() {
+            uint32_t value = 0;
+            for (int shift = 0; shift < 35 && data != end; shift += 7) {
+                auto byte = static_cast<uint8_t>(*data++);
+                value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) return value;
+            }
+            return {};
+        }
+
+        std::optional<uint16_t> u16() {
+            if (end - data < 2) return {};
+            auto value = static_cast<uint16_t>(static_cast<uint8_t>(data[0]) | (static_cast<uint8_t>(data[1]) << 8));
+            data += 2;
+            return value;
+        }
+
+        std::optional<uint32_t> u32() {
+            if (end - data < 4) return {};
+            uint32_t value = 0;
+            for (int idx = 0; idx < 4; idx += 1) value |= static_cast<uint32_t>(static_cast<uint8_t>(data[idx])) << (idx * 8);
+            data += 4;
+            return value;
+        }
+
+        std::optional<QByteArray> bytes(qsizetype size) {
+            if (end - data < size) return {};
+            QByteArray value(data, size);
+            data += size;
+            return value;
+        }
+
+        // The next record, or nullopt at the end or at a torn record
+        std::optional<QByteArray> record() {
+            auto size = varint();
+            if (!size.has_value()) return {};
+            auto record = bytes(*size);
+            auto crc = u32();
+            if (!record.has_value() || !crc.has_value() || record->isEmpty()) return {};
+            if (crc32(record->constData(), record->size()) != *crc) return {};
+            return record;
+        }
+
+    private:
+        const char *data;
+        const char *end;
+    };
+
+    bool syncToDisk(QFile &file) {
+        if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return ::fsync(file.handle()) == 0;
+#endif
+    }
+
+    // The shape of the tree as the journal has it, kept by the writer so it
+    // can compact the journal on its own
+    class Mirror {
+    public:
+        void reset(const Op &tree) {
+            fen = tree.fen;
+            nodes.clear();
+            nodes.resize(tree.moves.count() + 1);
+            nodes[0] = {-1, 0, true, {}};
+            for (qsizetype idx = 0; idx < tree.moves.count(); idx += 1) {
+                auto id = static_cast<int>(idx) + 1;
+                nodes[id] = {tree.parents[idx], tree.moves[idx], true, {}};
+                nodes[tree.parents[idx]].children.push_back(id);
+            }
+            select = tree.node;
+        }
+
+        void apply(const Op &op) {
+            if (!alive(op.node)) return;
+            switch (op.type) {
+                case Record::Line: {
+                    auto parent = op.node;
+                    for (qsizetype idx = 0; idx < op.moves.count(); idx += 1) {
+                        auto id = op.ids[idx];
+                        if (!alive(id)) {
+                            if (id >= nodes.count()) nodes.resize(id + 1);
+                            nodes[id] = {parent, op.moves[idx], true, {}};
+                            nodes[parent].children.push_back(id);
+                        }
+                        parent = id;
+                    }
+                    break;
+                }
+                case Record::Select:
+                    select = op.node;
+                    break;
+                case Record::Remove: {
+                    if (op.node == 0) break;
+                    nodes[nodes[op.node].parent].children.removeOne(op.node);
+                    drop(op.node);
+                    break;
+                }
+                case Record::Truncate: {
+                    for (auto child: std::exchange(nodes[op.node].children, {})) drop(child);
+                    break;
+                }
+                case Record::MoveVariation: {
+                    if (op.node == 0) break;
+                    auto &siblings = nodes[nodes[op.node].parent].children;
+                    siblings.move(siblings.indexOf(op.node), std::clamp<qsizetype>(op.index, 0, siblings.count() - 1));
+                    break;
+                }
+                case Record::PromoteVariation: {
+                    for (auto id = op.node; id != 0; id = nodes[id].parent) {
+                        auto &siblings = nodes[nodes[id].parent].children;
+                        siblings.move(siblings.indexOf(id), 0);
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        // Magic, Start, Tree and Select, everything a replay needs
+        [[nodiscard]] QByteArray snapshot() const {
+            QByteArray bytes = magic;
+
+            QByteArray start;
+            start.append(static_cast<char>(Record::Start));
+            start.append(fen.data(), static_cast<qsizetype>(fen.size()));
+            putRecord(bytes, start);
+
+            QVector<int> order;
+            QVector<int> stack(nodes[0].children.crbegin(), nodes[0].children.crend());
+            while (!stack.empty()) {
+                auto id = stack.takeLast();
+                order.push_back(id);
+                const auto &children = nodes[id].children;
+                for (auto it = children.crbegin(); it != children.crend(); ++it) stack.push_back(*it);
+            }
+
+            QByteArray tree;
+            tree.reserve(8 + order.count() * 8);
+            tree.append(static_cast<char>(Record::Tree));
+            putVarint(tree, static_cast<uint32_t>(order.count()));
+            QHash<int, int> positions;
+            positions.reserve(order.count());
+            for (qsizetype idx = 0; idx < order.count(); idx += 1) {
+                const auto &node = nodes[order[idx]];
+                putVarint(tree, static_cast<uint32_t>(node.parent == 0 ? 0 : positions.value(node.parent)));
+                putU16(tree, node.move);
+                putVarint(tree, static_cast<uint32_t>(order[idx]));
+                positions.insert(order[idx], static_cast<int>(idx) + 1);
+            }
+            putRecord(bytes, tree);
+
+            if (alive(select)) putRecord(bytes, selectRecord(select));
+            return bytes;
+        }
+
+    private:
+        struct Node {
+            int parent;
+            uint16_t move;
+            bool alive;
+            QVector<int> children;
+        };
+
+        std::string fen;
+        // By id, removed nodes stay behind as dead entries
+        QVector<Node> nodes;
+        int select = 0;
+
+        [[nodiscard]] bool alive(int id) const {
+            return id >= 0 && id < nodes.count() && nodes[id].alive;
+        }
+
+        void drop(int id) {
+            QVector<int> stack{id};
+            while (!stack.empty()) {
+                auto &node = nodes[stack.takeLast()];
+                node.alive = false;
+                stack.append(std::exchange(node.children, {}));
+            }
+        }
+    };
+}
+
+struct Journal::State {
+    QString path;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable written;
+    QVector<Op> ops;
+    std::optional<int> pendingSelect;
+    bool stop = false;
+
+    uint64_t queuedSeq = 0;
+    uint64_t writtenSeq = 0;
+    std::atomic<bool> failed = false;
+
+    // Writer thread only
+    Mirror mirror;
+    int records = 0;
+
+    void enqueue(Op op) {
+        {
+            std::lock_guard lock(mutex);
+            // Selections made before a snapshot are part of it
+            if (op.type == Record::Tree) pendingSelect.reset();
+            ops.push_back(std::move(op));
+            queuedSeq += 1;
+        }
+        wake.notify_one();
+    }
+
+    void run() {
+        QFile file;
+
+        for (;;) {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this]() { return stop || !ops.empty() || pendingSelect.has_value(); });
+            // A selection alone waits for company, or for selectDelay
+            if (!stop && ops.empty()) {
+                wake.wait_for(lock, std::chrono::milliseconds(selectDelayMs), [this]() {
+                    return stop || !ops.empty();
+                });
+            }
+            if (!stop) wake.wait_for(lock, groupCommitWindow, [this]() { return stop; });
+
+            auto batch = std::exchange(ops, {});
+            auto select = std::exchange(pendingSelect, std::nullopt);
+            auto batchSeq = queuedSeq;
+            bool done = stop;
+            lock.unlock();
+
+            if (select.has_value()) batch.push_back({Record::Select, *select});
+            if (!failed && !write(file, batch)) failed = true;
+
+            lock.lock();
+            writtenSeq = batchSeq;
+            written.notify_all();
+            if (done && ops.empty()) return;
+        }
+    }
+
+    bool write(QFile &file, const QVector<Op> &batch) {
+        // A snapshot makes whatever came before it in the batch moot
+        QByteArray bytes;
+        bool replace = false;
+        for (const auto &op: batch) {
+            if (op.type == Record::Tree) {
+                mirror.reset(op);
+                bytes = mirror.snapshot();
+                replace = true;
+                records = 0;
+                continue;
+            }
+            mirror.apply(op);
+            putRecord(bytes, opRecord(op));
+            records += 1;
+        }
+        if (records >= compactAfter) {
+            bytes = mirror.snapshot();
+            replace = true;
+            records = 0;
+        }
+
+        if (replace) {
+            if (!replaceWith(file, bytes)) return false;
+        } else if (!file.isOpen() || file.write(bytes) != bytes.size()) {
+            return false;
+        }
+        return syncToDisk(file);
+    }
+
+    bool replaceWith(QFile &file, const QByteArray &bytes) {
+        file.close();
+
+        // Written aside and renamed over the journal once it is on disk
+        QSaveFile save(path);
+        if (!save.open(QIODevice::WriteOnly)) return false;
+        if (save.write(bytes) != bytes.size()) return false;
+        if (!save.commit()) return false;
+
+        file.setFileName(path);
+        return file.open(QIODevice::WriteOnly | QIODevice::Append);
+    }
+};
+
+std::optional<Journal::Replay> Journal::replay(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+    auto data = file.readAll();
+    if (!data.startsWith(magic)) return {};
+
+    Reader reader(data.constData() + magic.size(), data.size() - magic.size());
+
+    std::optional<Disboard> board;
+    QHash<int, QUuid> nodes;
+    QUuid curNode;
+
+    auto node = [&](std::optional<uint32_t> id) -> std::optional<QUuid> {
+        if (!id.has_value()) return {};
+        auto it = nodes.constFind(static_cast<int>(*id));
+        if (it == nodes.cend()) return {};
+        return *it;
+    };
+    // Edits that remove the node shown leave the board on the one above
+    auto removed = [&](QUuid parent, const QVector<QUuid> &gone) {
+        if (gone.contains(curNode)) curNode = parent;
+    };
+
+    while (auto record = reader.record()) {
+        Reader fields(record->constData() + 1, record->size() - 1);
+        auto type = static_cast<Record>(record->front());
+
+        if (type == Record::Start) {
+            if (board.has_value()) break;
+            auto fen = record->mid(1).toStdString();
+            board = fen.empty() ? std::optional<Disboard>(Disboard()) : Disboard::fromFen(fen);
+            if (!board.has_value()) return {};
+            nodes.insert(0, board->root());
+            curNode = board->root();
+            continue;
+        }
+        if (!board.has_value()) return {};
+
+        if (type == Record::Tree) {
+            auto count = fields.varint();
+            if (!count.has_value() || nodes.count() != 1) break;
+
+            QVector<int> parents;
+            QVector<Move> moves;
+            QVector<int> ids;
+            for (uint32_t idx = 0; idx < *count; idx += 1) {
+                auto parent = fields.varint();
+                auto bits = fields.u16();
+                auto id = fields.varint();
+                if (!parent.has_value() || !bits.has_value() || !id.has_value() || *parent > idx) break;
+                parents.push_back(static_cast<int>(*parent) - 1);
+                moves.push_back(Move::fromBits(*bits));
+                ids.push_back(static_cast<int>(*id));
+            }
+            if (ids.count() != static_cast<qsizetype>(*count)) break;
+
+            auto added = board->addTree(board->root(), parents, moves);
+            // Moves that do not replay are corruption the CRC missed
+            if (added.count() != ids.count()) break;
+            for (qsizetype idx = 0; idx < ids.count(); idx += 1) nodes.insert(ids[idx], added[idx]);
+        } else if (type == Record::Line) {
+            auto parent = node(fields.varint());
+            auto count = fields.varint();
+            if (!parent.has_value() || !count.has_value()) break;
+
+            QVector<Move> moves;
+            QVector<int> ids;
+            moves.reserve(static_cast<qsizetype>(*count));
+            for (uint32_t idx = 0; idx < *count; idx += 1) {
+                auto bits = fields.u16();
+                auto id = fields.varint();
+                if (!bits.has_value() || !id.has_value()) break;
+                moves.push_back(Move::fromBits(*bits));
+                ids.push_back(static_cast<int>(*id));
+            }
+            if (moves.count() != static_cast<qsizetype>(*count)) break;
+
+            // Adding an existing move returns its node, as it did live
+            auto added = board->addNodes(*parent, moves);
+            if (added.count() != moves.count()) break;
+            for (qsizetype idx = 0; idx < ids.count(); idx += 1) nodes.insert(ids[idx], added[idx]);
+        } else if (type == Record::Select) {
+            auto selected = node(fields.varint());
+            if (!selected.has_value()) break;
+            curNode = *selected;
+        } else if (type == Record::Remove) {
+            auto edited = node(fields.varint());
+            if (!edited.has_value()) break;
+            auto parent = board->prevNode(*edited);
+            if (!parent.has_value()) break;
+            removed(*parent, board->removeNode(*edited));
+        } else if (type == Record::Truncate) {
+            auto edited = node(fields.varint());
+            if (!edited.has_value()) break;
+            removed(*edited, board->truncate(*edited));
+        } else if (type == Record::MoveVariation) {
+            auto edited = node(fields.varint());
+            auto index = fields.varint();
+            if (!edited.has_value() || !index.has_value()) break;
+            board->moveVariation(*edited, static_cast<int>(*index));
+        } else if (type == Record::PromoteVariation) {
+            auto edited = node(fields.varint());
+            if (!edited.has_value()) break;
+            board->promoteVariation(*edited);
+        } else {
+            break;
+        }
+    }
+
+    if (!board.has_value()) return {};
+    return Replay{std::move(*board), curNode};
+}
+
+Journal::Journal(const QString &path, const Disboard &board, QUuid curNode)
+        : state(std::make_shared<State>()) {
+    state->path = path;
+    reset(board, curNode);
+    writer = std::thread([state = state]() {
+        state->run();
+    });
+}
+
+Journal::~Journal() {
+    {
+        std::lock_guard lock(state->mutex);
+        state->stop = true;
+    }
+    state->wake.notify_one();
+    writer.join();
+}
+
+void Journal::added(const Disboard &board, QUuid parent, const QVector<QUuid> &nodes, const QVector<Move> &moves) {
+    if (nodes.empty() || state->failed) return;
+
+    auto parentIt = ids.constFind(parent);
+    if (parentIt == ids.cend()) {
+        // Not a node this journal knows, start over from the tree itself
+        reset(board, curNode);
+        return;
+    }
+
+    Op op{Record::Line, *parentIt};
+    op.ids = idsOf(nodes);
+    op.moves.reserve(nodes.count());
+    for (auto m: moves.mid(0, nodes.count())) op.moves.push_back(m.toBits());
+    state->enqueue(std::move(op));
+}
+
+void Journal::removed(const Disboard &board, QUuid node, const QVector<QUuid> &gone) {
+    if (auto id = editedId(board, node)) state->enqueue({Record::Remove, *id});
+    forget(gone);
+}
+
+void Journal::truncated(const Disboard &board, QUuid node, const QVector<QUuid> &gone) {
+    if (auto id = editedId(board, node)) state->enqueue({Record::Truncate, *id});
+    forget(gone);
+}
+
+void Journal::movedVariation(const Disboard &board, QUuid node, int index) {
+    if (auto id = editedId(board, node)) state->enqueue({Record::MoveVariation, *id, index});
+}
+
+void Journal::promotedVariation(const Disboard &board, QUuid node) {
+    if (auto id = editedId(board, node)) state->enqueue({Record::PromoteVariation, *id});
+}
+
+void Journal::selected(QUuid node) {
+    curNode = node;
+    auto it = ids.constFind(node);
+    if (it == ids.cend()) return;
+    {
+        std::lock_guard lock(state->mutex);
+        state->pendingSelect = *it;
+    }
+    state->wake.notify_one();
+}
+
+void Journal::reset(const Disboard &board, QUuid curNode) {
+    this->curNode = curNode;
+
+    // The walk has to happen here, it is what hands out the ids. Encoding
+    // and writing the snapshot are left to the writer.
+    Op op{Record::Tree};
+    auto fen = board.initialPosition().fen();
+    if (fen != Position().fen()) op.fen = fen;
+
+    auto entries = board.nodes();
+    ids.clear();
+    ids.reserve(entries.count());
+    op.moves.reserve(entries.count());
+    op.parents.reserve(entries.count());
+    for (qsizetype idx = 0; idx < entries.count(); idx += 1) {
+        const auto &entry = entries[idx];
+        ids.insert(entry.node, static_cast<int>(idx));
+        if (entry.parent < 0) continue;
+        op.moves.push_back(entry.move.toBits());
+        op.parents.push_back(entry.parent);
+    }
+    nextId = static_cast<int>(entries.count());
+    op.node = ids.value(curNode, 0);
+    state->enqueue(std::move(op));
+}
+
+void Journal::sync() {
+    std::unique_lock lock(state->mutex);
+    auto target = state->queuedSeq;
+    state->written.wait(lock, [&]() { return state->writtenSeq >= target; });
+}
+
+bool Journal::failed() const {
+    return state->failed;
+}
+
+QString Journal::path() const {
+    return state->path;
+}
+
+QVector<int> Journal::idsOf(const QVector<QUuid> &nodes) {
+    QVector<int> result;
+    result.reserve(nodes.count());
+    for (const auto &node: nodes) {
+        auto it = ids.constFind(node);
+        if (it == ids.cend()) it = ids.insert(node, nextId++);
+        result.push_back(*it);
+    }
+    return result;
+}
+
+void Journal::forget(const QVector<QUuid> &nodes) {
+    for (const auto &node: nodes) ids.remove(node);
+}
+
+std::optional<int> Journal::editedId(const Disboard &board, QUuid node) {
+    if (state->failed) return {};
+
+    auto it = ids.constFind(node);
+    if (it == ids.cend()) {
+        // As in added(), the tree itself is the way back in step
+        reset(board, curNode);
+        return {};
+    }
+    return *it;
+}
@@ -0,0 +1,87 @@
+#ifndef DISBOARD_JOURNAL_H
+#define DISBOARD_JOURNAL_H
+
+#include <QHash>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include "disboard.h"
+
+namespace disboard {
+    // Crash-safe autosave of one tree. Every edit is appended to a binary
+    // journal as a few bytes, nodes being referred to by ids the journal
+    // hands out as they are added. A background thread writes batches and
+    // syncs them to disk once per batch. It keeps its own copy of the tree
+    // shape, so after enough records it replaces the journal with a
+    // snapshot without a round trip through the GUI thread.
+    //
+    // Records are framed with their length and a CRC-32, so replaying stops
+    // cleanly at a record torn by a crash.
+    class Journal {
+    public:
+        struct Replay {
+            Disboard board;
+            QUuid curNode;
+        };
+
+        // Rebuilds the tree up to the last complete record. Nullopt when
+        // the file is missing or does not start like a journal.
+        [[nodiscard]] static std::optional<Replay> replay(const QString &path);
+
+        // Starts over at `path` with a snapshot of `board`
+        Journal(const QString &path, const Disboard &board, QUuid curNode);
+        // Flushes what is queued and waits for it to be written
+        ~Journal();
+
+        Journal(const Journal &) = delete;
+        Journal &operator=(const Journal &) = delete;
+
+        // Nodes added after `parent`, each the child of the one before
+        void added(const Disboard &board, QUuid parent, const QVector<QUuid> &nodes, const QVector<Move> &moves);
+        // The Disboard edit of the same name went through, `removed` being
+        // what it returned
+        void removed(const Disboard &board, QUuid node, const QVector<QUuid> &removed);
+        void truncated(const Disboard &board, QUuid node, const QVector<QUuid> &removed);
+        void movedVariation(const Disboard &board, QUuid node, int index);
+        void promotedVariation(const Disboard &board, QUuid node);
+        // Not worth a sync of its own, written with the next batch or after
+        // selectDelayMs at the latest
+        void selected(QUuid node);
+        // The tree was replaced
+        void reset(const Disboard &board, QUuid curNode);
+
+        // Blocks until everything appended so far is on disk
+        void sync();
+        // Set once writing failed, nothing is written after that
+        [[nodiscard]] bool failed() const;
+
+        [[nodiscard]] QString path() const;
+
+        // Records after which the journal is compacted into a snapshot
+        static constexpr int compactAfter = 8192;
+        static constexpr int selectDelayMs = 1000;
+
+    private:
+        struct State;
+        std::shared_ptr<State> state;
+        std::thread writer;
+
+        QHash<QUuid, int> ids;
+        int nextId = 0;
+        QUuid curNode;
+
+        // Ids of `nodes`, handing out new ones to those seen the first time
+        [[nodiscard]] QVector<int> idsOf(const QVector<QUuid> &nodes);
+        void forget(const QVector<QUuid> &nodes);
+        // Id of an edited node, nullopt after starting over when unknown
+        [[nodiscard]] std::optional<int> editedId(const Disboard &board, QUuid node);
+    };
+}
+
+
+#endif //DISBOARD_JOURNAL_H
@@ -0,0 +1,319 @@
+#include "livefeed.h"
+
+#include "frameprobe.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QQueue>
+#include <QTimer>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+namespace {
+    qint64 now() {
+        return QDateTime::currentMSecsSinceEpoch();
+    }
+
+    // Commands for one game collected from a single read. A full move list
+    // or a new start supersedes everything collected before it.
+    struct PendingGame {
+        bool reset = false;
+        std::optional<QString> fen;
+        QStringList moves;
+    };
+
+    struct FeedGame {
+        QPointer<Controller> controller;
+        // Starting position of the relay's game, empty for the standard one
+        QString fen;
+    };
+
+    std::optional<QVector<disboard::Move>>
+    parseMoves(disboard::Position position, const QStringList &sans) {
+        QVector<disboard::Move> moves;
+        moves.reserve(sans.count());
+        for (const auto &san: sans) {
+            auto m = position.parseSan(san.toStdString());
+            if (!m.has_value()) return {};
+            position.play(*m);
+            moves.push_back(*m);
+        }
+        return moves;
+    }
+}
+
+class LiveFeed::p {
+    friend LiveFeed;
+public:
+    explicit p(LiveFeed *q)
+            : q(q),
+              probe(q, [this](qint64 startNs, qint64 presentedNs) {
+                  presented(startNs, presentedNs);
+              }) {
+        reconnectTimer.setSingleShot(true);
+        QObject::connect(&reconnectTimer, &QTimer::timeout, q, [this]() {
+            connectToServer();
+        });
+
+        QObject::connect(&socket, &QLocalSocket::stateChanged, q, [this](QLocalSocket::LocalSocketState state) {
+            if (state == QLocalSocket::ConnectedState) {
+                reconnectDelayMs = minReconnectDelayMs;
+                resync();
+            } else if (state == QLocalSocket::UnconnectedState) {
+                // Failed attempts and dropped connections alike
+                scheduleReconnect();
+            }
+            emit this->q->connectedChanged();
+        });
+        QObject::connect(&socket, &QLocalSocket::readyRead, q, [this]() {
+            read();
+        });
+    }
+
+    ~p() {
+        // Aborting the socket below would call back into a half destroyed p
+        QObject::disconnect(&socket, nullptr, nullptr, nullptr);
+    }
+
+private:
+    LiveFeed *q;
+
+    QString server;
+    QLocalSocket socket;
+
+    static constexpr int minReconnectDelayMs = 250;
+    static constexpr int maxReconnectDelayMs = 5000;
+    QTimer reconnectTimer;
+    int reconnectDelayMs = minReconnectDelayMs;
+
+    QHash<QString, FeedGame> games;
+
+    // Batches are timed from the relay timestamp to the frame showing them.
+    // The relay stamps wall clock time, the probe runs on the steady clock.
+    disboard::FrameProbe probe;
+    disboard::LatencyStats latency;
+    // Arrival times of the batches in flight, presented in marking order
+    QQueue<qint64> arrivals;
+
+    void connectToServer() {
+        socket.abort();
+        reconnectTimer.stop();
+        if (server.isEmpty()) return;
+        socket.connectToServer(server);
+    }
+
+    void scheduleReconnect() {
+        if (server.isEmpty() || reconnectTimer.isActive()) return;
+        if (socket.state() != QLocalSocket::UnconnectedState) return;
+
+        reconnectTimer.start(reconnectDelayMs);
+        reconnectDelayMs = std::min(reconnectDelayMs * 2, maxReconnectDelayMs);
+    }
+
+    void send(const QString &line) {
+        if (socket.state() != QLocalSocket::ConnectedState) return;
+        socket.write((line + QLatin1Char('\n')).toUtf8());
+    }
+
+    void resync() {
+        for (auto it = games.cbegin(); it != games.cend(); ++it) {
+            send(QStringLiteral("sync ") + it.key());
+        }
+    }
+
+    void read() {
+        auto received = now();
+        auto relayed = std::numeric_limits<qint64>::max();
+
+        // Everything that has arrived is folded into one update per game
+        QHash<QString, PendingGame> pending;
+        QStringList order;
+
+        while (socket.canReadLine()) {
+            auto line = QString::fromUtf8(socket.readLine()).trimmed();
+            if (line.isEmpty()) continue;
+
+            auto tokens = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+            if (tokens.front().startsWith(QLatin1Char('@'))) {
+                bool ok = false;
+                auto timestamp = tokens.takeFirst().mid(1).toLongLong(&ok);
+                if (ok) relayed = std::min(relayed, timestamp);
+            }
+            if (tokens.count() < 2) {
+                emit q->protocolError(line);
+                continue;
+            }
+
+            auto id = tokens.takeFirst();
+            auto command = tokens.takeFirst();
+            if (!games.contains(id)) continue;
+
+            if (!pending.contains(id)) order.push_back(id);
+            auto &game = pending[id];
+            if (command == QStringLiteral("move")) {
+                game.moves.append(tokens);
+            } else if (command == QStringLiteral("moves")) {
+                game.reset = true;
+                game.moves = tokens;
+            } else if (command == QStringLiteral("start")) {
+                game.reset = true;
+                game.fen = tokens.join(QLatin1Char(' '));
+                game.moves.clear();
+            } else {
+                emit q->protocolError(line);
+            }
+        }
+
+        bool changed = false;
+        for (const auto &id: order) {
+            auto it = games.find(id);
+            if (it == games.end()) continue;
+            if (!apply(*it, pending[id])) {
+                // Lost track of the game, start over from the full list
+                emit q->protocolError(id);
+                send(QStringLiteral("sync ") + id);
+                continue;
+            }
+            changed = true;
+        }
+        if (!changed) return;
+
+        if (relayed == std::numeric_limits<qint64>::max()) relayed = received;
+
+        auto steadyNow = disboard::FrameProbe::now();
+        auto start = steadyNow - (now() - relayed) * 1000000;
+        arrivals.enqueue(steadyNow - (now() - received) * 1000000);
+        probe.mark(start);
+    }
+
+    bool apply(FeedGame &game, const PendingGame &pending) {
+        auto c = game.controller.data();
+        if (!c) return true;
+
+        if (pending.fen.has_value()) game.fen = *pending.fen;
+        if (pending.reset) return applyMoveList(game, pending.moves);
+
+        const auto &board = c->board();
+        auto end = board.seek(board.root(), std::numeric_limits<int>::max());
+        auto moves = parseMoves(board.position(end), pending.moves);
+        if (!moves.has_value()) return false;
+
+        c->appendMainline(*moves);
+        return true;
+    }
+
+    bool applyMoveList(FeedGame &game, const QStringList &sans) {
+        auto c = game.controller.data();
+
+        auto start = game.fen.isEmpty() ?
+                     std::optional<disboard::Position>(disboard::Position()) :
+                     disboard::Position::fromFen(game.fen.toStdString());
+        if (!start.has_value()) return false;
+        auto moves = parseMoves(*start, sans);
+        if (!moves.has_value()) return false;
+
+        // Usually the list only extends what is shown already, which keeps
+        // the tree (and any variations the viewer added) intact.
+        const auto &board = c->board();
+        if (board.initialPosition().hash() == start->hash()) {
+            auto mainline = board.mainlineNodes(board.root());
+            bool prefix = mainline.count() <= moves->count();
+            for (qsizetype idx = 0; prefix && idx < mainline.count(); idx += 1) {
+                prefix = board.lastMove(mainline[idx]) == (*moves)[idx];
+            }
+            if (prefix) {
+                c->appendMainline(moves->mid(mainline.count()));
+                return true;
+            }
+        }
+
+        auto newBoard = game.fen.isEmpty() ?
+                        std::optional<disboard::Disboard>(disboard::Disboard()) :
+                        disboard::Disboard::fromFen(game.fen.toStdString());
+        if (!newBoard.has_value()) return false;
+
+        auto nodes = newBoard->addNodes(newBoard->root(), *moves);
+        auto last = nodes.empty() ? newBoard->root() : nodes.back();
+        c->setBoard(std::move(*newBoard));
+        c->setCurNode(last);
+        return true;
+    }
+
+    void presented(qint64 startNs, qint64 presentedNs) {
+        auto received = arrivals.isEmpty() ? startNs : arrivals.dequeue();
+        auto feedToScreen = static_cast<qreal>(presentedNs - startNs) / 1e6;
+        auto receiveToScreen = static_cast<qreal>(presentedNs - received) / 1e6;
+
+        latency.add(feedToScreen);
+
+        emit q->latencyMeasured(feedToScreen, receiveToScreen);
+        emit q->latencyChanged();
+    }
+};
+
+LiveFeed::LiveFeed(QObject *parent)
+        : QObject(parent),
+          p(new class LiveFeed::p(this)) {}
+
+void LiveFeed::attach(const QString &game, Controller *controller) {
+    if (!controller) return;
+    p->games.insert(game, {controller, {}});
+    p->send(QStringLiteral("sync ") + game);
+}
+
+void LiveFeed::detach(const QString &game) {
+    p->games.remove(game);
+}
+
+void LiveFeed::resync() {
+    p->resync();
+}
+
+void LiveFeed::resetLatency() {
+    p->latency = {};
+    emit latencyChanged();
+}
+
+QString LiveFeed::server() const {
+    return p->server;
+}
+
+void LiveFeed::setServer(const QString &newValue) {
+    if (p->server == newValue) return;
+    p->server = newValue;
+    p->reconnectTimer.stop();
+    p->reconnectDelayMs = p->minReconnectDelayMs;
+    p->connectToServer();
+    emit serverChanged();
+}
+
+bool LiveFeed::connected() const {
+    return p->socket.state() == QLocalSocket::ConnectedState;
+}
+
+QQuickWindow *LiveFeed::window() const {
+    return p->probe.window();
+}
+
+void LiveFeed::setWindow(QQuickWindow *newValue) {
+    if (p->probe.window() == newValue) return;
+    p->probe.setWindow(newValue);
+    p->arrivals.clear();
+    emit windowChanged();
+}
+
+qreal LiveFeed::lastLatency() const {
+    return p->latency.last;
+}
+
+qreal LiveFeed::meanLatency() const {
+    return p->latency.mean();
+}
+
+qreal LiveFeed::maxLatency() const {
+    return p->latency.max;
+}
@@ -0,0 +1,76 @@
+#ifndef DISBOARD_LIVEFEED_H
+#define DISBOARD_LIVEFEED_H
+
+#include <QObject>
+#include <QQuickWindow>
+#include <QtQml/qqmlregistration.h>
+
+#include "controller.h"
+
+// Client of a broadcast relay on a local socket (a named pipe on Windows).
+// The relay sends one command per line:
+//
+//     [@<epoch ms>] <game> move <move>...     moves after the current last one
+//     [@<epoch ms>] <game> moves <move>...    the full move list of the game
+//     [@<epoch ms>] <game> start [<fen>]      a new game, standard start if no FEN
+//
+// Moves may be SAN or UCI. The client asks for full lists with
+// `sync <game>` whenever it (re)connects or loses track of a game.
+class LiveFeed : public QObject {
+Q_OBJECT
+
+    QML_ELEMENT
+    Q_DISABLE_COPY(LiveFeed)
+
+    Q_PROPERTY(QString server READ server WRITE setServer NOTIFY serverChanged)
+    Q_PROPERTY(bool connected READ connected NOTIFY connectedChanged)
+    // Window the attached boards are shown in. With it, latency is measured
+    // up to the frame that shows the moves, otherwise up to the tree update.
+    Q_PROPERTY(QQuickWindow *window READ window WRITE setWindow NOTIFY windowChanged)
+
+    // Feed to screen latency in milliseconds, from the relay timestamp if
+    // the line carries one and from its arrival otherwise
+    Q_PROPERTY(qreal lastLatency READ lastLatency NOTIFY latencyChanged)
+    Q_PROPERTY(qreal meanLatency READ meanLatency NOTIFY latencyChanged)
+    Q_PROPERTY(qreal maxLatency READ maxLatency NOTIFY latencyChanged)
+
+public:
+    explicit LiveFeed(QObject *parent = nullptr);
+
+    // Routes the moves of `game` to `controller`, replacing its tree with
+    // the game as soon as the relay has sent the full move list.
+    Q_INVOKABLE void attach(const QString &game, Controller *controller);
+    Q_INVOKABLE void detach(const QString &game);
+    // Asks the relay for the full move list of every attached game
+    Q_INVOKABLE void resync();
+    Q_INVOKABLE void resetLatency();
+
+    [[nodiscard]] QString server() const;
+    void setServer(const QString &newValue);
+
+    [[nodiscard]] bool connected() const;
+
+    [[nodiscard]] QQuickWindow *window() const;
+    void setWindow(QQuickWindow *newValue);
+
+    [[nodiscard]] qreal lastLatency() const;
+    [[nodiscard]] qreal meanLatency() const;
+    [[nodiscard]] qreal maxLatency() const;
+
+private:
+    class p;
+    std::shared_ptr<p> p;
+
+signals:
+    void serverChanged();
+    void connectedChanged();
+    void windowChanged();
+    void latencyChanged();
+
+    // Relay time to screen time and arrival time to screen time of one batch
+    void latencyMeasured(qreal feedToScreenMs, qreal receiveToScreenMs);
+    void protocolError(const QString &line);
+};
+
+
+#endif //DISBOARD_LIVEFEED_H
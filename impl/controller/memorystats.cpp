@@ -0,0 +1,44 @@
+#include "memorystats.h"
+
+using namespace disboard;
+
+qreal MemoryStats::bytesPerNode() const {
+    return nodes > 0 ? static_cast<qreal>(totalBytes() - modelBytes) / nodes : 0;
+}
+
+qint64 MemoryStats::totalBytes() const {
+    return treeBytes + positionCacheBytes + mainlineIndexBytes + annotationBytes + gameStateBytes + aliasBytes +
+           modelBytes;
+}
+
+void MemoryStats::sampleCounters() {
+    ffiVectors = AllocationCounters::ffiVectors.load(std::memory_order_relaxed);
+    ffiStrings = AllocationCounters::ffiStrings.load(std::memory_order_relaxed);
+    ffiBoxes = AllocationCounters::ffiBoxes.load(std::memory_order_relaxed);
+    positionReplays = AllocationCounters::positionReplays.load(std::memory_order_relaxed);
+    positionHits = AllocationCounters::positionHits.load(std::memory_order_relaxed);
+    modelBytes = AllocationCounters::modelBytes.load(std::memory_order_relaxed);
+}
+
+QString MemoryStats::toString() const {
+    return QStringLiteral("%1 nodes, %2 B total (%3 B/node): tree %4 B, positions %5 B (%6), "
+                          "mainline %7 B, annotations %8 B, game states %9 B, aliases %10 B, models %11 B, "
+                          "spilled %12 B; ffi vectors %13, strings %14, boxes %15; position replays %16, hits %17")
+            .arg(nodes)
+            .arg(totalBytes())
+            .arg(bytesPerNode(), 0, 'f', 1)
+            .arg(treeBytes)
+            .arg(positionCacheBytes)
+            .arg(positionCacheEntries)
+            .arg(mainlineIndexBytes)
+            .arg(annotationBytes)
+            .arg(gameStateBytes)
+            .arg(aliasBytes)
+            .arg(modelBytes)
+            .arg(spilledBytes)
+            .arg(ffiVectors)
+            .arg(ffiStrings)
+            .arg(ffiBoxes)
+            .arg(positionReplays)
+            .arg(positionHits);
+}
@@ -0,0 +1,102 @@
+#ifndef DISBOARD_MEMORYSTATS_H
+#define DISBOARD_MEMORYSTATS_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+#include <atomic>
+
+namespace disboard {
+    // Process-wide counters of allocations on the hot paths: every vector,
+    // string or box handed over the FFI, and every position the cache had
+    // to replay from the root
+    class AllocationCounters {
+    public:
+        static inline std::atomic<qint64> ffiVectors{0};
+        static inline std::atomic<qint64> ffiStrings{0};
+        static inline std::atomic<qint64> ffiBoxes{0};
+        static inline std::atomic<qint64> positionReplays{0};
+        static inline std::atomic<qint64> positionHits{0};
+        // Node lists copied into models, see MoveListModel
+        static inline std::atomic<qint64> modelBytes{0};
+
+        static void count(std::atomic<qint64> &counter, qint64 n = 1) {
+            counter.fetch_add(n, std::memory_order_relaxed);
+        }
+    };
+
+    // Heap held by container storage, capacity rather than size
+    template<typename T>
+    [[nodiscard]] qint64 heapBytes(const QVector<T> &vec) {
+        return static_cast<qint64>(vec.capacity()) * static_cast<qint64>(sizeof(T));
+    }
+
+    // Qt 6 hashes keep an offset byte per bucket and the nodes in spans
+    template<typename K, typename V>
+    [[nodiscard]] qint64 heapBytes(const QHash<K, V> &hash) {
+        return static_cast<qint64>(hash.capacity()) * static_cast<qint64>(sizeof(K) + sizeof(V) + 1);
+    }
+
+    // What one tree costs, and the allocation counters at the time it was
+    // taken. Tree bytes are estimated on the Rust side, the rest is the
+    // capacity of the native caches and indexes.
+    class MemoryStats {
+        Q_GADGET
+        QML_VALUE_TYPE(memoryStats)
+        Q_PROPERTY(int nodes MEMBER nodes CONSTANT)
+        Q_PROPERTY(qint64 treeBytes MEMBER treeBytes CONSTANT)
+        Q_PROPERTY(qreal bytesPerNode READ bytesPerNode CONSTANT)
+        Q_PROPERTY(int positionCacheEntries MEMBER positionCacheEntries CONSTANT)
+        Q_PROPERTY(qint64 positionCacheBytes MEMBER positionCacheBytes CONSTANT)
+        Q_PROPERTY(qint64 mainlineIndexBytes MEMBER mainlineIndexBytes CONSTANT)
+        Q_PROPERTY(qint64 annotationBytes MEMBER annotationBytes CONSTANT)
+        Q_PROPERTY(qint64 gameStateBytes MEMBER gameStateBytes CONSTANT)
+        Q_PROPERTY(qint64 modelBytes MEMBER modelBytes CONSTANT)
+        Q_PROPERTY(qint64 aliasBytes MEMBER aliasBytes CONSTANT)
+        // On disk while the tree is spilled, not part of totalBytes
+        Q_PROPERTY(qint64 spilledBytes MEMBER spilledBytes CONSTANT)
+        Q_PROPERTY(qint64 totalBytes READ totalBytes CONSTANT)
+        Q_PROPERTY(qint64 ffiVectors MEMBER ffiVectors CONSTANT)
+        Q_PROPERTY(qint64 ffiStrings MEMBER ffiStrings CONSTANT)
+        Q_PROPERTY(qint64 ffiBoxes MEMBER ffiBoxes CONSTANT)
+        Q_PROPERTY(qint64 positionReplays MEMBER positionReplays CONSTANT)
+        Q_PROPERTY(qint64 positionHits MEMBER positionHits CONSTANT)
+        QML_UNCREATABLE("MemoryStats can only be created on C++ side")
+
+    public:
+        int nodes = 0;
+        qint64 treeBytes = 0;
+        int positionCacheEntries = 0;
+        qint64 positionCacheBytes = 0;
+        qint64 mainlineIndexBytes = 0;
+        qint64 annotationBytes = 0;
+        // Draw state per node, see Disboard::status
+        qint64 gameStateBytes = 0;
+        // Process-wide, models are not tied to a single tree
+        qint64 modelBytes = 0;
+        // Node id maps of a tree that was spilled and faulted back in
+        qint64 aliasBytes = 0;
+        qint64 spilledBytes = 0;
+
+        qint64 ffiVectors = 0;
+        qint64 ffiStrings = 0;
+        qint64 ffiBoxes = 0;
+        qint64 positionReplays = 0;
+        qint64 positionHits = 0;
+
+        [[nodiscard]] qreal bytesPerNode() const;
+        [[nodiscard]] qint64 totalBytes() const;
+
+        // Fills in the allocation counters and model bytes
+        void sampleCounters();
+
+        // One line for logs
+        [[nodiscard]] Q_INVOKABLE QString toString() const;
+    };
+}
+
+
+#endif //DISBOARD_MEMORYSTATS_H
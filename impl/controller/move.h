@@ -4,43 +4,100 @@
 #include <QObject>
 #include <QtQml/qqmlregistration.h>
 
-#include "librustdisboard/lib.h"
-
 #include "square.h"
 #include "piece.h"
 
+#include <cstdint>
+#include <type_traits>
+
 namespace disboard {
+    // A move packed into 16 bits:
+    //   bits  0-5   source square
+    //   bits  6-11  destination square (the king's destination for castling)
+    //   bits 12-13  promotion role, counted from the knight
+    //   bits 14-15  move kind
+    // The zero value (a1a1) is never a legal move and doubles as "no move".
     class Move {
         Q_GADGET
         QML_VALUE_TYPE(move)
-        QML_UNCREATABLE("Move can only be created on Rust side")
+        QML_UNCREATABLE("Move can only be created on C++ side")
 
     public:
-        Move(const Move& rhs);
-        Move& operator=(const Move& rhs);
+        enum class Kind : uint8_t {
+            Normal = 0,
+            Promotion = 1,
+            EnPassant = 2,
+            Castle = 3,
+        };
 
-        [[nodiscard]] Square from() const;
-        [[nodiscard]] Square to() const;
+        constexpr Move() : bits(0) {}
+        constexpr Move(Square from, Square to, Kind kind = Kind::Normal,
+                       Role promotion = Role::Knight)
+                : bits(static_cast<uint16_t>(
+                               from.index()
+                               | (to.index() << 6)
+                               | (promotionBits(promotion) << 12)
+                               | (static_cast<uint8_t>(kind) << 14))) {}
 
-        [[nodiscard]] bool isPromotion() const;
-        void setPromotion(Role role);
+        [[nodiscard]] static constexpr Move fromBits(uint16_t bits) {
+            Move move;
+            move.bits = bits;
+            return move;
+        }
+        [[nodiscard]] constexpr uint16_t toBits() const { return bits; }
+        [[nodiscard]] constexpr bool isNull() const { return bits == 0; }
 
-        [[nodiscard]] bool isEnPassant() const;
+        [[nodiscard]] constexpr Square from() const {
+            return Square::fromIndex(bits & 0x3f);
+        }
+        [[nodiscard]] constexpr Square to() const {
+            return Square::fromIndex((bits >> 6) & 0x3f);
+        }
+        [[nodiscard]] constexpr Kind kind() const {
+            return static_cast<Kind>(bits >> 14);
+        }
 
-        [[nodiscard]] bool isCastle() const;
-        [[nodiscard]] Square castleRookFrom() const;
-        [[nodiscard]] Square castleRookTo() const;
+        [[nodiscard]] constexpr bool isPromotion() const {
+            return kind() == Kind::Promotion;
+        }
+        [[nodiscard]] constexpr Role promotion() const {
+            return static_cast<Role>(((bits >> 12) & 3) + static_cast<uint8_t>(Role::Knight));
+        }
+        constexpr void setPromotion(Role role) {
+            bits = static_cast<uint16_t>((bits & ~0x3000) | (promotionBits(role) << 12));
+        }
 
-        [[nodiscard]] QString toString() const;
+        [[nodiscard]] constexpr bool isEnPassant() const {
+            return kind() == Kind::EnPassant;
+        }
+
+        [[nodiscard]] constexpr bool isCastle() const {
+            return kind() == Kind::Castle;
+        }
+        [[nodiscard]] constexpr Square castleRookFrom() const {
+            return {to().file() > from().file() ? uint8_t(7) : uint8_t(0), from().rank()};
+        }
+        [[nodiscard]] constexpr Square castleRookTo() const {
+            return {to().file() > from().file() ? uint8_t(5) : uint8_t(3), from().rank()};
+        }
 
-    friend class Disboard;
+        constexpr bool operator==(Move rhs) const { return bits == rhs.bits; }
+        constexpr bool operator!=(Move rhs) const { return bits != rhs.bits; }
+
+        // UCI notation, SAN depends on the position and lives in Disboard
+        [[nodiscard]] QString toString() const;
 
     private:
-        explicit Move(rust::Box<librustdisboard::Move> move)
-                : impl(std::move(move)) {}
+        [[nodiscard]] static constexpr uint8_t promotionBits(Role role) {
+            auto idx = static_cast<unsigned>(role) - static_cast<unsigned>(Role::Knight);
+            return idx <= 3 ? static_cast<uint8_t>(idx) : uint8_t(3);
+        }
 
-        rust::Box<librustdisboard::Move> impl;
+        uint16_t bits;
     };
+
+    static_assert(std::is_trivially_copyable_v<Move>);
+    static_assert(sizeof(Move) == sizeof(uint16_t));
 }
 
 
@@ -7,7 +7,13 @@ class MoveListModel::p {
 public:
     p(Controller *c, QUuid root, MoveListModel *q)
             : c(c), root(root), q(q),
-              mainlineNodes(c->board().mainlineNodes(root)) {}
+              mainlineNodes(c->board().mainlineNodes(root)) {
+        account();
+    }
+
+    ~p() {
+        disboard::AllocationCounters::count(disboard::AllocationCounters::modelBytes, -accountedBytes);
+    }
 
 private:
     MoveListModel *q;
@@ -15,6 +21,14 @@ private:
     QUuid root;
 
     QVector<QUuid> mainlineNodes;
+    qint64 accountedBytes = 0;
+
+    // Keeps the process-wide model byte counter in step with mainlineNodes
+    void account() {
+        auto bytes = disboard::heapBytes(mainlineNodes);
+        disboard::AllocationCounters::count(disboard::AllocationCounters::modelBytes, bytes - accountedBytes);
+        accountedBytes = bytes;
+    }
 
     [[nodiscard]] disboard::Color rootTurn() const {
         return c->board().turn(root);
@@ -64,6 +78,7 @@ private:
                 q->beginInsertRows({}, 0, 0);
                 mainlineNodes.push_back(node);
                 q->endInsertRows();
+                account();
             }
             return;
         }
@@ -84,6 +99,7 @@ private:
                     auto topLeft = q->index(oldRow, 0);
                     auto bottomRight = q->index(newRow, 1);
                     mainlineNodes.push_back(node);
+                    account();
                     emit q->dataChanged(topLeft, bottomRight, {NodeRole, Qt::DisplayRole});
                     return;
                 }
@@ -92,6 +108,7 @@ private:
                 q->beginInsertRows({}, oldRow, oldRow);
                 mainlineNodes.push_back(node);
                 q->endInsertRows();
+                account();
 
                 return;
             }
@@ -104,6 +121,85 @@ private:
         auto qIdx = q->index(idxToRow(idx), idxToCol(idx));
         emit q->dataChanged(qIdx, qIdx, {VariationsRole});
     }
+
+    void addLine(const QVector<QUuid> &nodes) {
+        if (nodes.empty()) return;
+
+        // A line that continues the mainline goes in as one row insertion,
+        // anything else is handled node by node.
+        auto parent = c->board().prevNode(nodes.front());
+        auto end = mainlineNodes.empty() ? root : mainlineNodes.back();
+        if (!parent.has_value() || *parent != end) {
+            for (auto node: nodes) addNode(node);
+            return;
+        }
+
+        auto oldRows = q->rowCount({});
+        auto newRows = idxToRow(static_cast<int>(mainlineNodes.count() + nodes.count()) - 1) + 1;
+
+        if (newRows > oldRows) {
+            q->beginInsertRows({}, oldRows, newRows - 1);
+            mainlineNodes.append(nodes);
+            q->endInsertRows();
+        } else {
+            mainlineNodes.append(nodes);
+        }
+        account();
+
+        // The previously last row may have gained its second move
+        if (oldRows > 0) {
+            emit q->dataChanged(q->index(oldRows - 1, 0), q->index(oldRows - 1, 1),
+                                {NodeRole, Qt::DisplayRole});
+        }
+    }
+
+    // Brings the mainline after `parent` in step with the tree once it was
+    // edited there. Rows up to the first move that changed are left alone,
+    // the ones after are removed and the new line is inserted in their place.
+    void relink(QUuid parent) {
+        qsizetype start = 0;
+        if (parent != root) {
+            start = mainlineNodes.indexOf(parent);
+            if (start < 0) return; // not on this mainline, nothing shown changed
+            start += 1;
+        }
+
+        auto tail = c->board().mainlineNodes(parent);
+        auto oldCount = mainlineNodes.count();
+        qsizetype same = 0;
+        while (start + same < oldCount && same < tail.count() && mainlineNodes[start + same] == tail[same]) {
+            same += 1;
+        }
+        auto first = static_cast<int>(start + same);
+
+        // A row keeping its first move only changes its second one
+        bool partial = first > 0 && idxToCol(first) == 1;
+        auto firstRow = partial ? idxToRow(first) + 1 : idxToRow(first);
+        auto oldRows = q->rowCount({});
+
+        if (first < oldCount) {
+            if (firstRow < oldRows) q->beginRemoveRows({}, firstRow, oldRows - 1);
+            mainlineNodes.resize(first);
+            if (firstRow < oldRows) q->endRemoveRows();
+        }
+
+        if (same < tail.count()) {
+            auto newRows = idxToRow(static_cast<int>(start + tail.count()) - 1) + 1;
+            if (newRows > firstRow) q->beginInsertRows({}, firstRow, newRows - 1);
+            mainlineNodes.append(tail.mid(same));
+            if (newRows > firstRow) q->endInsertRows();
+        }
+        account();
+
+        if (partial && (first < oldCount || same < tail.count())) {
+            emit q->dataChanged(q->index(firstRow - 1, 0), q->index(firstRow - 1, 1));
+        }
+        // The move after `parent` lost or gained siblings, or they moved
+        if (start < first) {
+            auto qIdx = q->index(idxToRow(static_cast<int>(start)), idxToCol(static_cast<int>(start)));
+            emit q->dataChanged(qIdx, qIdx, {VariationsRole});
+        }
+    }
 };
 
 MoveListModel::MoveListModel(QObject *parent)
@@ -130,9 +226,9 @@ QVariant MoveListModel::data(const QModelIndex &idx, int role) const {
 
     if (role == NodeRole) return node;
     if (role == Qt::DisplayRole) {
-        auto move = p->c->board().lastMove(node);
-        if (!move.has_value()) return {};
-        return move->toString();
+        auto san = p->c->board().san(node);
+        if (san.isEmpty()) return {};
+        return san;
     }
     if (role == VariationsRole) {
         auto variations = p->c->board().siblings(node);
@@ -140,19 +236,21 @@ QVariant MoveListModel::data(const QModelIndex &idx, int role) const {
 
         QVector<VariationInfo> variationsRoleVec;
         for (auto variation: variations) {
-            VariationInfo map;
-
-            auto variationMove = p->c->board().lastMove(variation);
-            if (!variationMove.has_value()) continue; // impossible to reach anyway
+            auto variationSan = p->c->board().san(variation);
+            if (variationSan.isEmpty()) continue; // impossible to reach anyway
 
+            auto stats = p->c->nodeStats(variation);
             variationsRoleVec.emplace_back(
                     variation,
-                    variationMove->toString()
+                    variationSan,
+                    stats.isValid() ? stats.value<disboard::NodeStats>().games : 0
             );
         }
 
         return QVariant::fromValue(variationsRoleVec);
     }
+    if (role == StatsRole) return p->c->nodeStats(node);
+    if (role == StatusRole) return QVariant::fromValue(p->c->board().status(node));
 
     return {};
 }
@@ -162,6 +260,8 @@ QHash<int, QByteArray> MoveListModel::roleNames() const {
 
     roles[NodeRole] = "node";
     roles[VariationsRole] = "variations";
+    roles[StatsRole] = "stats";
+    roles[StatusRole] = "status";
 
     return roles;
 }
@@ -197,10 +297,26 @@ void MoveListModel::reset(Controller *newC, QUuid newR) {
         if (p) {
             disconnect(p->c, &Controller::nodePushed,
                        this, &MoveListModel::handleNodePushed);
+            disconnect(p->c, &Controller::nodesPushed,
+                       this, &MoveListModel::handleNodesPushed);
+            disconnect(p->c, &Controller::rootChanged,
+                       this, &MoveListModel::handleRootChanged);
+            disconnect(p->c, &Controller::nodesRemoved,
+                       this, &MoveListModel::handleNodesRemoved);
+            disconnect(p->c, &Controller::variationsReordered,
+                       this, &MoveListModel::handleVariationsReordered);
             p.reset();
         }
         connect(newC, &Controller::nodePushed,
                 this, &MoveListModel::handleNodePushed);
+        connect(newC, &Controller::nodesPushed,
+                this, &MoveListModel::handleNodesPushed);
+        connect(newC, &Controller::rootChanged,
+                this, &MoveListModel::handleRootChanged);
+        connect(newC, &Controller::nodesRemoved,
+                this, &MoveListModel::handleNodesRemoved);
+        connect(newC, &Controller::variationsReordered,
+                this, &MoveListModel::handleVariationsReordered);
         p = std::make_shared<class MoveListModel::p>(newC, newR, this);
     }
     endResetModel();
@@ -210,3 +326,31 @@ void MoveListModel::handleNodePushed(QUuid node) {
     if (!p) return; // how?
     p->addNode(node);
 }
+
+void MoveListModel::handleNodesPushed(const QVector<QUuid> &nodes) {
+    if (!p) return;
+    p->addLine(nodes);
+}
+
+void MoveListModel::handleRootChanged() {
+    if (!p) return;
+    // The old tree is gone, follow the controller into the new one
+    reset(p->c, p->c->root());
+    emit rootChanged();
+}
+
+void MoveListModel::handleNodesRemoved(QUuid parent, const QVector<QUuid> &nodes) {
+    if (!p) return;
+    if (nodes.contains(p->root)) {
+        // The line shown is gone, show the one it branched off
+        reset(p->c, parent);
+        emit rootChanged();
+        return;
+    }
+    p->relink(parent);
+}
+
+void MoveListModel::handleVariationsReordered(QUuid parent) {
+    if (!p) return;
+    p->relink(parent);
+}
@@ -12,15 +12,18 @@ class VariationInfo {
     QML_VALUE_TYPE(variationInfo)
     Q_PROPERTY(QUuid node MEMBER node CONSTANT)
     Q_PROPERTY(QString display MEMBER display CONSTANT)
+    // Games of the loaded repertoire reaching the variation, 0 without one
+    Q_PROPERTY(int games MEMBER games CONSTANT)
 
 public:
     VariationInfo() = default;
-    VariationInfo(QUuid node, QString display)
-        : node(node), display(std::move(display)) {}
+    VariationInfo(QUuid node, QString display, int games = 0)
+        : node(node), display(std::move(display)), games(games) {}
 
 private:
     QUuid node;
     QString display;
+    int games = 0;
 };
 
 class MoveListModel : public QAbstractTableModel {
@@ -35,6 +38,10 @@ public:
     enum ItemRoles {
         NodeRole = Qt::UserRole + 1,
         VariationsRole,
+        // Repertoire NodeStats of the move, null without a repertoire
+        StatsRole,
+        // GameStatus after the move
+        StatusRole,
     };
 
     explicit MoveListModel(QObject *parent = nullptr);
@@ -56,6 +63,10 @@ private:
 
     void reset(Controller* controller, QUuid root);
     void handleNodePushed(QUuid node);
+    void handleNodesPushed(const QVector<QUuid> &nodes);
+    void handleRootChanged();
+    void handleNodesRemoved(QUuid parent, const QVector<QUuid> &nodes);
+    void handleVariationsReordered(QUuid parent);
 
 signals:
     void controllerChanged();
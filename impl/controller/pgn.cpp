@@ -0,0 +1,410 @@
+#include "pgn.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace disboard;
+
+namespace {
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    bool isBlank(std::string_view line) {
+        return std::all_of(line.begin(), line.end(), isSpace);
+    }
+
+    bool isResult(std::string_view token) {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+
+    bool endsToken(char c) {
+        return isSpace(c) || c == '(' || c == ')' || c == '{' || c == '}' || c == ';' || c == '$';
+    }
+
+    std::string_view trimmed(std::string_view str) {
+        while (!str.empty() && isSpace(str.front())) str.remove_prefix(1);
+        while (!str.empty() && isSpace(str.back())) str.remove_suffix(1);
+        return str;
+    }
+
+    // Traditional move suffixes and their NAG
+    std::optional<uint8_t> suffixNag(std::string_view suffix) {
+        if (suffix == "!") return 1;
+        if (suffix == "?") return 2;
+        if (suffix == "!!") return 3;
+        if (suffix == "??") return 4;
+        if (suffix == "!?") return 5;
+        if (suffix == "?!") return 6;
+        return {};
+    }
+
+    void appendComment(std::string &comment, std::string_view text) {
+        text = trimmed(text);
+        if (text.empty()) return;
+        if (!comment.empty()) comment += ' ';
+        comment += text;
+    }
+
+    std::string escapeTag(std::string_view value) {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (auto c: value) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    QVector<QVector<int>> childrenOf(const QVector<PgnNode> &nodes) {
+        QVector<QVector<int>> children(nodes.count());
+        for (int idx = 1; idx < nodes.count(); idx += 1) {
+            children[nodes[idx].parent].push_back(idx);
+        }
+        return children;
+    }
+
+    class MovetextWriter {
+    public:
+        MovetextWriter(const PgnGame &game) : game(game), children(childrenOf(game.nodes)) {}
+
+        std::vector<std::string> tokens;
+
+        void variation(int node, Position position, bool forceNumber) {
+            while (!children[node].empty()) {
+                auto main = children[node].front();
+                move(position, main, forceNumber);
+                forceNumber = !game.nodes[main].comment.empty();
+
+                for (qsizetype idx = 1; idx < children[node].count(); idx += 1) {
+                    auto alt = children[node][idx];
+                    openParen = true;
+                    move(position, alt, true);
+                    auto altPosition = position;
+                    altPosition.play(game.nodes[alt].move);
+                    variation(alt, altPosition, false);
+                    tokens.back() += ')';
+                    forceNumber = true;
+                }
+
+                position.play(game.nodes[main].move);
+                node = main;
+            }
+        }
+
+        void comment(const std::string &text) {
+            if (!text.empty()) push("{" + text + "}");
+        }
+
+    private:
+        const PgnGame &game;
+        QVector<QVector<int>> children;
+        bool openParen = false;
+
+        void push(std::string token) {
+            if (std::exchange(openParen, false)) token.insert(token.begin(), '(');
+            tokens.push_back(std::move(token));
+        }
+
+        void move(const Position &position, int idx, bool forceNumber) {
+            const auto &node = game.nodes[idx];
+            auto number = std::to_string(position.fullmoves());
+            if (position.turn() == Color::White) {
+                push(number + ".");
+            } else if (forceNumber) {
+                push(number + "...");
+            }
+            push(position.san(node.move));
+            for (auto nag: node.nags) push("$" + std::to_string(nag));
+            comment(node.comment);
+        }
+    };
+}
+
+std::optional<PgnGame> PgnGame::parse(std::string_view text, QString *error) {
+    auto fail = [error](const QString &message) -> std::optional<PgnGame> {
+        if (error) *error = message;
+        return {};
+    };
+
+    PgnGame game;
+    size_t pos = 0;
+    auto skipLine = [&]() {
+        while (pos < text.size() && text[pos] != '\n') pos += 1;
+    };
+
+    // Tag pairs
+    for (;;) {
+        while (pos < text.size() && isSpace(text[pos])) pos += 1;
+        if (pos >= text.size() || text[pos] != '[') break;
+
+        auto close = text.find(']', pos);
+        auto quote = text.find('"', pos);
+        if (close == std::string_view::npos || quote == std::string_view::npos || quote > close) {
+            auto line = text.substr(pos, text.find('\n', pos) - pos);
+            return fail(QStringLiteral("malformed tag %1").arg(
+                    QString::fromUtf8(line.data(), static_cast<qsizetype>(line.size()))));
+        }
+
+        auto name = trimmed(text.substr(pos + 1, quote - pos - 1));
+        std::string value;
+        pos = quote + 1;
+        for (; pos < text.size() && text[pos] != '"'; pos += 1) {
+            if (text[pos] == '\\' && pos + 1 < text.size()) pos += 1;
+            value += text[pos];
+        }
+        close = text.find(']', pos);
+        if (close == std::string_view::npos) return fail(QStringLiteral("unterminated tag"));
+        pos = close + 1;
+
+        if (name == "FEN") {
+            auto start = Position::fromFen(value);
+            if (!start.has_value()) return fail(QStringLiteral("invalid FEN tag: %1").arg(QString::fromStdString(value)));
+            game.start = *start;
+        } else if (name == "Result") {
+            game.result = value;
+        }
+        game.tags.push_back({std::string(name), std::move(value)});
+    }
+
+    // Movetext
+    game.nodes.push_back({-1, Move(), {}, {}});
+    QVector<Position> positions{game.start};
+    QVector<int> stack;
+    int cur = 0;
+
+    while (pos < text.size()) {
+        auto c = text[pos];
+        if (isSpace(c)) {
+            pos += 1;
+        } else if (c == '{') {
+            auto close = text.find('}', pos);
+            if (close == std::string_view::npos) return fail(QStringLiteral("unterminated comment"));
+            appendComment(game.nodes[cur].comment, text.substr(pos + 1, close - pos - 1));
+            pos = close + 1;
+        } else if (c == '}') {
+            return fail(QStringLiteral("unbalanced '}'"));
+        } else if (c == ';') {
+            auto start = pos + 1;
+            skipLine();
+            appendComment(game.nodes[cur].comment, text.substr(start, pos - start));
+        } else if (c == '%' && (pos == 0 || text[pos - 1] == '\n')) {
+            skipLine();
+        } else if (c == '(') {
+            if (cur == 0) return fail(QStringLiteral("variation before the first move"));
+            stack.push_back(cur);
+            cur = game.nodes[cur].parent;
+            pos += 1;
+        } else if (c == ')') {
+            if (stack.empty()) return fail(QStringLiteral("unbalanced ')'"));
+            cur = stack.takeLast();
+            pos += 1;
+        } else if (c == '$') {
+            int nag = 0;
+            for (pos += 1; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; pos += 1) {
+                nag = std::min(nag * 10 + (text[pos] - '0'), 256);
+            }
+            if (cur != 0 && nag > 0 && nag < 256) game.nodes[cur].nags.push_back(static_cast<uint8_t>(nag));
+        } else if (c == '[') {
+            // The next game's tags, the splitter should have cut here
+            break;
+        } else {
+            auto start = pos;
+            while (pos < text.size() && !endsToken(text[pos])) pos += 1;
+            auto token = text.substr(start, pos - start);
+
+            if (isResult(token)) {
+                if (stack.empty()) game.result = token;
+                continue;
+            }
+
+            // Move numbers, possibly glued to the move as in "1.e4"
+            size_t digits = 0;
+            while (digits < token.size() && token[digits] >= '0' && token[digits] <= '9') digits += 1;
+            if (digits > 0 && digits < token.size() && token[digits] == '.') {
+                token.remove_prefix(digits);
+                while (!token.empty() && token.front() == '.') token.remove_prefix(1);
+            } else if (digits == token.size()) {
+                continue;
+            }
+            if (token.empty()) continue;
+
+            auto suffix = token.find_first_of("!?");
+            std::optional<uint8_t> nag;
+            if (suffix != std::string_view::npos) {
+                nag = suffixNag(token.substr(suffix));
+                token = token.substr(0, suffix);
+            }
+            if (token.empty()) {
+                // A suffix standing apart from its move
+                if (nag.has_value() && cur != 0) game.nodes[cur].nags.push_back(*nag);
+                continue;
+            }
+
+            auto m = positions[cur].parseSan(token);
+            if (!m.has_value()) {
+                auto ply = 0;
+                for (auto node = cur; node > 0; node = game.nodes[node].parent) ply += 1;
+                return fail(QStringLiteral("illegal move %1 at ply %2").arg(
+                        QString::fromUtf8(token.data(), static_cast<qsizetype>(token.size()))).arg(ply + 1));
+            }
+
+            auto position = positions[cur];
+            position.play(*m);
+            game.nodes.push_back({cur, *m, {}, {}});
+            if (nag.has_value()) game.nodes.back().nags.push_back(*nag);
+            positions.push_back(position);
+            cur = static_cast<int>(game.nodes.count() - 1);
+        }
+    }
+    if (!stack.empty()) return fail(QStringLiteral("unterminated variation"));
+
+    return game;
+}
+
+QVector<int> PgnGame::mainline() const {
+    // Children come after their parent, so the first one found is the main one
+    QVector<int> firstChild(nodes.count(), -1);
+    for (int idx = static_cast<int>(nodes.count()) - 1; idx > 0; idx -= 1) {
+        firstChild[nodes[idx].parent] = idx;
+    }
+
+    QVector<int> line;
+    for (auto node = nodes.empty() ? -1 : firstChild[0]; node >= 0; node = firstChild[node]) {
+        line.push_back(node);
+    }
+    return line;
+}
+
+QVector<Move> PgnGame::mainlineMoves() const {
+    QVector<Move> moves;
+    for (auto idx: mainline()) moves.push_back(nodes[idx].move);
+    return moves;
+}
+
+Position PgnGame::finalPosition() const {
+    auto position = start;
+    for (auto idx: mainline()) position.play(nodes[idx].move);
+    return position;
+}
+
+GameStates PgnGame::states() const {
+    GameStates states;
+    states.assign(start, nodes);
+    return states;
+}
+
+bool PgnGame::hasVariations() const {
+    return mainline().count() + 1 != nodes.count();
+}
+
+void PgnGame::stripVariations() {
+    QVector<PgnNode> line;
+    line.reserve(nodes.count());
+    if (!nodes.empty()) line.push_back(nodes.front());
+    for (auto idx: mainline()) {
+        auto node = nodes[idx];
+        node.parent = static_cast<int>(line.count() - 1);
+        line.push_back(std::move(node));
+    }
+    nodes = std::move(line);
+}
+
+uint64_t PgnGame::moveKey() const {
+    // FNV-1a over the start position's hash and the packed moves
+    uint64_t key = 0xcbf29ce484222325ull;
+    auto mix = [&key](uint64_t value, int bytes) {
+        for (int idx = 0; idx < bytes; idx += 1) {
+            key ^= (value >> (idx * 8)) & 0xff;
+            key *= 0x100000001b3ull;
+        }
+    };
+    mix(start.hash(), 8);
+    for (auto idx: mainline()) mix(nodes[idx].move.toBits(), 2);
+    return key;
+}
+
+std::string PgnGame::toPgn() const {
+    std::string out;
+    for (const auto &[name, value]: tags) {
+        out += '[';
+        out += name;
+        out += " \"";
+        out += escapeTag(value);
+        out += "\"]\n";
+    }
+    if (!tags.empty()) out += '\n';
+
+    MovetextWriter writer(*this);
+    if (!nodes.empty()) {
+        writer.comment(nodes.front().comment);
+        writer.variation(0, start, true);
+    }
+    writer.tokens.push_back(result);
+
+    size_t lineLength = 0;
+    for (const auto &token: writer.tokens) {
+        if (lineLength > 0 && lineLength + 1 + token.size() > 79) {
+            out += '\n';
+            lineLength = 0;
+        } else if (lineLength > 0) {
+            out += ' ';
+            lineLength += 1;
+        }
+        out += token;
+        lineLength += token.size();
+    }
+    out += "\n\n";
+    return out;
+}
+
+PgnSplitter::PgnSplitter(QIODevice *device) : device(device) {}
+
+std::optional<std::string> PgnSplitter::next() {
+    std::string game;
+    bool inMoves = false, inComment = false;
+    gameLine = 0;
+
+    for (;;) {
+        std::string line;
+        int number;
+        if (hasPending) {
+            line = std::move(pending);
+            number = pendingLine;
+            hasPending = false;
+        } else {
+            if (device->atEnd()) break;
+            line = device->readLine().toStdString();
+            lineNumber += 1;
+            number = lineNumber;
+        }
+
+        bool tag = !inComment && !line.empty() && line.front() == '[';
+        if (tag && inMoves) {
+            // Tags after movetext start the next game
+            pending = std::move(line);
+            pendingLine = number;
+            hasPending = true;
+            return game;
+        }
+        if (gameLine == 0 && !isBlank(line)) gameLine = number;
+
+        if (!tag && !isBlank(line) && (inComment || line.front() != '%')) {
+            inMoves = true;
+            for (auto c: line) {
+                if (inComment) {
+                    inComment = c != '}';
+                } else if (c == '{') {
+                    inComment = true;
+                } else if (c == ';') {
+                    break;
+                }
+            }
+        }
+        game += line;
+    }
+
+    if (gameLine == 0) return {};
+    return game;
+}
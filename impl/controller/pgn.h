@@ -0,0 +1,77 @@
+#ifndef DISBOARD_PGN_H
+#define DISBOARD_PGN_H
+
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "gamestate.h"
+#include "position.h"
+
+namespace disboard {
+    // A node of a parsed game. Nodes are flattened like NodeEntry, the root
+    // first with a parent of -1, and the first child of a node is its
+    // mainline continuation.
+    struct PgnNode {
+        int parent;
+        Move move;
+        // Comment after the move, or before the first move for the root
+        std::string comment;
+        QVector<uint8_t> nags;
+    };
+
+    // A game parsed natively, without a Rust tree behind it. This is what
+    // batch tools work on: replaying a game only needs Position.
+    struct PgnGame {
+        QVector<std::pair<std::string, std::string>> tags;
+        Position start;
+        QVector<PgnNode> nodes;
+        std::string result = "*";
+
+        [[nodiscard]] static std::optional<PgnGame> parse(std::string_view text, QString *error = nullptr);
+
+        // Node indices of the mainline, the root excluded
+        [[nodiscard]] QVector<int> mainline() const;
+        [[nodiscard]] Position finalPosition() const;
+        [[nodiscard]] QVector<Move> mainlineMoves() const;
+        [[nodiscard]] bool hasVariations() const;
+        // Draw state of every node, indexed like `nodes`, in one replay
+        [[nodiscard]] GameStates states() const;
+        void stripVariations();
+
+        // Hash of the start position and the mainline moves, for telling
+        // games with the same moves apart from transpositions
+        [[nodiscard]] uint64_t moveKey() const;
+
+        // Export format, movetext wrapped at 80 columns
+        [[nodiscard]] std::string toPgn() const;
+    };
+
+    // Splits a PGN stream into the text of single games without parsing
+    // them, so the expensive part can run elsewhere.
+    class PgnSplitter {
+    public:
+        explicit PgnSplitter(QIODevice *device);
+
+        // Nullopt at the end of the stream
+        [[nodiscard]] std::optional<std::string> next();
+        // Line the last returned game started on, counting from 1
+        [[nodiscard]] int line() const { return gameLine; }
+
+    private:
+        QIODevice *device;
+        std::string pending;
+        bool hasPending = false;
+        int lineNumber = 0;
+        int gameLine = 0;
+        int pendingLine = 0;
+    };
+}
+
+
+#endif //DISBOARD_PGN_H
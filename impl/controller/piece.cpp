@@ -2,18 +2,8 @@
 
 using namespace disboard;
 
-Piece::Piece(librustdisboard::Color color, librustdisboard::Role role)
-        : impl(librustdisboard::Piece{color, role}) {}
-
-Piece::Piece()
-        : impl(librustdisboard::piece_default()) {}
-
-Color Piece::color() const { return impl.color; }
-
-Role Piece::role() const { return impl.role; }
-
 QString Piece::roleStr() const {
-    switch (impl.role) {
+    switch (mRole) {
         case Role::Pawn:
             return "P";
         case Role::Knight:
@@ -31,7 +21,7 @@ QString Piece::roleStr() const {
 }
 
 QString Piece::pieceStr() const {
-    if (impl.color == Color::White) {
+    if (mColor == Color::White) {
         return "w" + roleStr();
     }
     return "b" + roleStr();
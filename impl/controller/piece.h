@@ -4,6 +4,8 @@
 #include <QObject>
 #include <QtQml/qqmlregistration.h>
 
+#include <type_traits>
+
 #include "librustdisboard/lib.h"
 
 namespace disboard {
@@ -17,26 +19,31 @@ namespace disboard {
         Q_PROPERTY(Role role READ role)
         Q_PROPERTY(QString roleStr READ roleStr)
         Q_PROPERTY(QString pieceStr READ pieceStr)
-        QML_UNCREATABLE("Piece can only be created on Rust side")
+        QML_UNCREATABLE("Piece can only be created on C++ side")
 
     public:
-        Piece(Color color, Role role);
-        Piece();
+        constexpr Piece(Color color, Role role)
+                : mColor(color), mRole(role) {}
+        constexpr Piece()
+                : Piece(Color::Black, Role::Knight) {}
 
-        [[nodiscard]] Color color() const;
-        [[nodiscard]] Role role() const;
+        [[nodiscard]] constexpr Color color() const { return mColor; }
+        [[nodiscard]] constexpr Role role() const { return mRole; }
 
         [[nodiscard]] QString roleStr() const;
         [[nodiscard]] QString pieceStr() const;
 
-        friend class Disboard;
+        constexpr bool operator==(Piece rhs) const {
+            return mColor == rhs.mColor && mRole == rhs.mRole;
+        }
+        constexpr bool operator!=(Piece rhs) const { return !(*this == rhs); }
 
     private:
-        explicit Piece(librustdisboard::Piece piece)
-            : impl(piece) {}
-
-        librustdisboard::Piece impl;
+        Color mColor;
+        Role mRole;
     };
+
+    static_assert(std::is_trivially_copyable_v<Piece>);
 }
 
 
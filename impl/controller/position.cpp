@@ -0,0 +1,757 @@
+#include "position.h"
+
+#include <algorithm>
+
+using namespace disboard;
+using namespace disboard::bitboard;
+
+namespace {
+    constexpr uint8_t NoSquare = 64;
+
+    constexpr uint8_t WhiteKingSide = 1;
+    constexpr uint8_t WhiteQueenSide = 2;
+    constexpr uint8_t BlackKingSide = 4;
+    constexpr uint8_t BlackQueenSide = 8;
+
+    constexpr uint8_t colorIdx(Color color) { return static_cast<uint8_t>(color); }
+    constexpr Color opposite(Color color) {
+        return color == Color::White ? Color::Black : Color::White;
+    }
+
+    constexpr uint8_t encodePiece(Piece piece) {
+        return static_cast<uint8_t>((colorIdx(piece.color()) << 3) | static_cast<uint8_t>(piece.role()));
+    }
+    constexpr Piece decodePiece(uint8_t code) {
+        return {static_cast<Color>(code >> 3), static_cast<Role>(code & 7)};
+    }
+
+    // Castling rights lost when a move leaves or lands on a square
+    constexpr uint8_t castlingMask(uint8_t square) {
+        switch (square) {
+            case 0:
+                return WhiteQueenSide;
+            case 4:
+                return WhiteKingSide | WhiteQueenSide;
+            case 7:
+                return WhiteKingSide;
+            case 56:
+                return BlackQueenSide;
+            case 60:
+                return BlackKingSide | BlackQueenSide;
+            case 63:
+                return BlackKingSide;
+            default:
+                return 0;
+        }
+    }
+
+    std::optional<Role> roleFromChar(char c) {
+        switch (c) {
+            case 'p':
+                return Role::Pawn;
+            case 'n':
+                return Role::Knight;
+            case 'b':
+                return Role::Bishop;
+            case 'r':
+                return Role::Rook;
+            case 'q':
+                return Role::Queen;
+            case 'k':
+                return Role::King;
+            default:
+                return {};
+        }
+    }
+
+    char roleChar(Role role) {
+        return " pnbrqk"[static_cast<uint8_t>(role)];
+    }
+
+    std::string_view nextField(std::string_view &str) {
+        auto start = str.find_first_not_of(' ');
+        if (start == std::string_view::npos) {
+            str = {};
+            return {};
+        }
+        str.remove_prefix(start);
+        auto end = std::min(str.find(' '), str.size());
+        auto field = str.substr(0, end);
+        str.remove_prefix(end);
+        return field;
+    }
+
+    std::optional<int> parseNumber(std::string_view str) {
+        if (str.empty() || str.size() > 5) return {};
+        int value = 0;
+        for (auto c: str) {
+            if (c < '0' || c > '9') return {};
+            value = value * 10 + (c - '0');
+        }
+        return value;
+    }
+
+    struct CastlingHome {
+        uint8_t right;
+        Color color;
+        uint8_t king;
+        uint8_t rook;
+    };
+
+    constexpr CastlingHome castlingHomes[4] = {
+            {WhiteKingSide, Color::White, 4, 7},
+            {WhiteQueenSide, Color::White, 4, 0},
+            {BlackKingSide, Color::Black, 60, 63},
+            {BlackQueenSide, Color::Black, 60, 56},
+    };
+
+    constexpr Role promotionRoles[4] = {Role::Queen, Role::Rook, Role::Bishop, Role::Knight};
+
+    struct ZobristKeys {
+        uint64_t pieces[16][64];
+        uint64_t castling[16];
+        uint64_t epFile[8];
+        uint64_t blackToMove;
+
+        ZobristKeys() {
+            // splitmix64 with a fixed seed, hashes are stable across runs
+            uint64_t state = 0x9e3779b97f4a7c15ULL;
+            auto next = [&state]() {
+                uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                return z ^ (z >> 31);
+            };
+
+            for (auto &squares: pieces) {
+                for (auto &key: squares) key = next();
+            }
+            for (auto &key: castling) key = next();
+            for (auto &key: epFile) key = next();
+            blackToMove = next();
+        }
+    };
+
+    const ZobristKeys &zobristKeys() {
+        static const ZobristKeys instance;
+        return instance;
+    }
+}
+
+Position::Position() {
+    static const Position start = *fromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    *this = start;
+}
+
+Position::Position(EmptyBoard) {
+    clear();
+}
+
+void Position::clear() {
+    std::fill(std::begin(byRole), std::end(byRole), 0);
+    std::fill(std::begin(byColor), std::end(byColor), 0);
+    std::fill(std::begin(board), std::end(board), 0);
+    sideToMove = Color::White;
+    castlingRights = 0;
+    epSquare = NoSquare;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    zobrist = 0;
+}
+
+void Position::put(Piece piece, Square square) {
+    auto bb = fromSquare(square);
+    byRole[static_cast<uint8_t>(piece.role())] |= bb;
+    byColor[colorIdx(piece.color())] |= bb;
+    board[square.index()] = encodePiece(piece);
+    zobrist ^= zobristKeys().pieces[board[square.index()]][square.index()];
+}
+
+void Position::remove(Square square) {
+    auto code = board[square.index()];
+    if (!code) return;
+    auto bb = fromSquare(square);
+    byRole[code & 7] &= ~bb;
+    byColor[code >> 3] &= ~bb;
+    board[square.index()] = 0;
+    zobrist ^= zobristKeys().pieces[code][square.index()];
+}
+
+std::optional<Position> Position::fromFen(std::string_view fen) {
+    Position pos{EmptyBoard{}};
+
+    auto placement = nextField(fen);
+    int file = 0, rank = 7;
+    for (auto c: placement) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) return {};
+            file = 0;
+            rank -= 1;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+            if (file > 8) return {};
+        } else {
+            auto color = (c >= 'A' && c <= 'Z') ? Color::White : Color::Black;
+            auto role = roleFromChar(static_cast<char>(color == Color::White ? c - 'A' + 'a' : c));
+            if (!role.has_value() || file > 7) return {};
+            pos.put({color, *role}, Square(file, rank));
+            file += 1;
+        }
+    }
+    if (file != 8 || rank != 0) return {};
+    if (pos.pieces(Role::Pawn) & (Rank1 | Rank8)) return {};
+
+    auto turn = nextField(fen);
+    if (turn == "w") {
+        pos.sideToMove = Color::White;
+    } else if (turn == "b") {
+        pos.sideToMove = Color::Black;
+    } else {
+        return {};
+    }
+
+    auto castling = nextField(fen);
+    if (castling != "-") {
+        for (auto c: castling) {
+            switch (c) {
+                case 'K':
+                    pos.castlingRights |= WhiteKingSide;
+                    break;
+                case 'Q':
+                    pos.castlingRights |= WhiteQueenSide;
+                    break;
+                case 'k':
+                    pos.castlingRights |= BlackKingSide;
+                    break;
+                case 'q':
+                    pos.castlingRights |= BlackQueenSide;
+                    break;
+                default:
+                    return {};
+            }
+        }
+    }
+    // Drop rights whose king or rook is not on its home square
+    for (auto home: castlingHomes) {
+        if (pos.board[home.king] != encodePiece({home.color, Role::King})
+            || pos.board[home.rook] != encodePiece({home.color, Role::Rook})) {
+            pos.castlingRights &= ~home.right;
+        }
+    }
+
+    auto ep = nextField(fen);
+    if (ep != "-") {
+        // Behind a pawn the side not to move has just pushed two squares
+        auto epRank = pos.sideToMove == Color::White ? '6' : '3';
+        if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != epRank) return {};
+        auto epSq = Square(ep[0] - 'a', ep[1] - '1');
+        auto pushed = Square(epSq.file(), pos.sideToMove == Color::White ? 4 : 3);
+        if (pos.board[pushed.index()] != encodePiece({opposite(pos.sideToMove), Role::Pawn})) return {};
+        // Only keep an en passant square that can actually be captured on
+        if (pawnAttacks(opposite(pos.sideToMove), epSq) & pos.pieces(pos.sideToMove, Role::Pawn)) {
+            pos.epSquare = epSq.index();
+        }
+    }
+
+    if (auto halfmoves = nextField(fen); !halfmoves.empty()) {
+        auto value = parseNumber(halfmoves);
+        if (!value.has_value()) return {};
+        pos.halfmoveClock = static_cast<uint16_t>(*value);
+    }
+    if (auto fullmoves = nextField(fen); !fullmoves.empty()) {
+        auto value = parseNumber(fullmoves);
+        if (!value.has_value() || *value == 0) return {};
+        pos.fullmoveNumber = static_cast<uint16_t>(*value);
+    }
+
+    // Exactly one king each, and the side not to move may not be in check
+    if (count(pos.pieces(Color::White, Role::King)) != 1
+        || count(pos.pieces(Color::Black, Role::King)) != 1) {
+        return {};
+    }
+    auto theirKing = lsb(pos.pieces(opposite(pos.sideToMove), Role::King));
+    if (pos.attackersTo(theirKing, pos.occupied()) & pos.pieces(pos.sideToMove)) return {};
+
+    const auto &keys = zobristKeys();
+    pos.zobrist ^= keys.castling[pos.castlingRights];
+    if (pos.epSquare != NoSquare) pos.zobrist ^= keys.epFile[pos.epSquare & 7];
+    if (pos.sideToMove == Color::Black) pos.zobrist ^= keys.blackToMove;
+
+    return pos;
+}
+
+std::string Position::fen() const {
+    std::string fen;
+    for (int rank = 7; rank >= 0; rank -= 1) {
+        int empty = 0;
+        for (int file = 0; file < 8; file += 1) {
+            auto code = board[Square(file, rank).index()];
+            if (!code) {
+                empty += 1;
+                continue;
+            }
+            if (empty) fen += static_cast<char>('0' + empty);
+            empty = 0;
+
+            auto piece = decodePiece(code);
+            auto c = roleChar(piece.role());
+            fen += piece.color() == Color::White ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+        if (empty) fen += static_cast<char>('0' + empty);
+        if (rank) fen += '/';
+    }
+
+    fen += sideToMove == Color::White ? " w " : " b ";
+
+    if (!castlingRights) fen += '-';
+    if (castlingRights & WhiteKingSide) fen += 'K';
+    if (castlingRights & WhiteQueenSide) fen += 'Q';
+    if (castlingRights & BlackKingSide) fen += 'k';
+    if (castlingRights & BlackQueenSide) fen += 'q';
+
+    if (epSquare != NoSquare) {
+        auto ep = Square::fromIndex(epSquare);
+        fen += ' ';
+        fen += static_cast<char>('a' + ep.file());
+        fen += static_cast<char>('1' + ep.rank());
+    } else {
+        fen += " -";
+    }
+
+    fen += ' ' + std::to_string(halfmoveClock) + ' ' + std::to_string(fullmoveNumber);
+    return fen;
+}
+
+std::optional<Piece> Position::pieceAt(Square square) const {
+    auto code = board[square.index()];
+    if (!code) return {};
+    return decodePiece(code);
+}
+
+uint64_t Position::materialKey() const {
+    uint64_t key = 0;
+    for (auto color: {Color::Black, Color::White}) {
+        for (uint8_t role = 1; role <= 6; role += 1) {
+            auto n = std::min(count(pieces(color, static_cast<Role>(role))), 15);
+            key |= uint64_t(n) << (4 * (colorIdx(color) * 6 + role - 1));
+        }
+    }
+    return key;
+}
+
+Bitboard Position::attackersTo(Square square, Bitboard occupied) const {
+    return (pawnAttacks(Color::White, square) & pieces(Color::Black, Role::Pawn))
+           | (pawnAttacks(Color::Black, square) & pieces(Color::White, Role::Pawn))
+           | (knightAttacks(square) & pieces(Role::Knight))
+           | (kingAttacks(square) & pieces(Role::King))
+           | (bishopAttacks(square, occupied) & (pieces(Role::Bishop) | pieces(Role::Queen)))
+           | (rookAttacks(square, occupied) & (pieces(Role::Rook) | pieces(Role::Queen)));
+}
+
+Bitboard Position::checkers() const {
+    auto king = lsb(pieces(sideToMove, Role::King));
+    return attackersTo(king, occupied()) & pieces(opposite(sideToMove));
+}
+
+Bitboard Position::pinned(Color color, Square king) const {
+    auto them = pieces(opposite(color));
+    Bitboard snipers = ((rookAttacks(king, 0) & (pieces(Role::Rook) | pieces(Role::Queen)))
+                        | (bishopAttacks(king, 0) & (pieces(Role::Bishop) | pieces(Role::Queen))))
+                       & them;
+
+    Bitboard result = 0;
+    while (snipers) {
+        auto sniper = popLsb(snipers);
+        auto blockers = between(king, sniper) & occupied();
+        if (blockers && !moreThanOne(blockers)) result |= blockers & pieces(color);
+    }
+    return result;
+}
+
+MoveList Position::legalMoves() const {
+    MoveList list;
+    generate(list, All);
+    return list;
+}
+
+MoveList Position::legalMoves(Square from) const {
+    MoveList list;
+    generate(list, fromSquare(from));
+    return list;
+}
+
+void Position::generate(MoveList &list, Bitboard fromMask) const {
+    auto us = sideToMove;
+    auto ours = pieces(us);
+    auto theirs = pieces(opposite(us));
+    auto king = lsb(pieces(us, Role::King));
+    auto checkers = attackersTo(king, occupied()) & theirs;
+
+    if (fromMask & fromSquare(king)) {
+        // The king may not hide behind itself from a slider
+        auto occupiedWithoutKing = occupied() ^ fromSquare(king);
+        auto targets = kingAttacks(king) & ~ours;
+        while (targets) {
+            auto to = popLsb(targets);
+            if (!(attackersTo(to, occupiedWithoutKing) & theirs)) list.push(Move(king, to));
+        }
+        if (!checkers) generateCastling(list, king);
+    }
+
+    if (moreThanOne(checkers)) return;
+
+    // Non-king moves have to capture the checker or block the check
+    auto target = checkers ? (between(king, lsb(checkers)) | checkers) : All;
+    auto pinnedPieces = pinned(us, king);
+
+    auto movers = ours & ~pieces(Role::King) & fromMask;
+    while (movers) {
+        auto from = popLsb(movers);
+        auto pinMask = contains(pinnedPieces, from) ? line(king, from) : All;
+        auto role = static_cast<Role>(board[from.index()] & 7);
+
+        if (role == Role::Pawn) {
+            generatePawnMoves(list, from, target & pinMask, king);
+            continue;
+        }
+
+        auto targets = attacks(role, us, from, occupied()) & ~ours & target & pinMask;
+        while (targets) list.push(Move(from, popLsb(targets)));
+    }
+}
+
+void Position::generatePawnMoves(MoveList &list, Square from, Bitboard target, Square king) const {
+    auto us = sideToMove;
+    int forward = us == Color::White ? 8 : -8;
+    uint8_t startRank = us == Color::White ? 1 : 6;
+    uint8_t lastRank = us == Color::White ? 7 : 0;
+
+    auto push = [&list, lastRank](Square from, Square to) {
+        if (to.rank() != lastRank) {
+            list.push(Move(from, to));
+            return;
+        }
+        for (auto role: promotionRoles) {
+            list.push(Move(from, to, Move::Kind::Promotion, role));
+        }
+    };
+
+    auto single = Square::fromIndex(static_cast<uint8_t>(from.index() + forward));
+    if (!board[single.index()]) {
+        if (contains(target, single)) push(from, single);
+
+        auto twice = Square::fromIndex(static_cast<uint8_t>(single.index() + forward));
+        if (from.rank() == startRank && !board[twice.index()] && contains(target, twice)) {
+            list.push(Move(from, twice));
+        }
+    }
+
+    auto captures = pawnAttacks(us, from) & pieces(opposite(us)) & target;
+    while (captures) push(from, popLsb(captures));
+
+    if (epSquare == NoSquare) return;
+
+    auto ep = Square::fromIndex(epSquare);
+    if (!contains(pawnAttacks(us, from), ep)) return;
+
+    // The captured pawn may itself be the checker, hence the wider target
+    auto captured = Square::fromIndex(static_cast<uint8_t>(epSquare - forward));
+    if (!contains(target, ep) && !contains(target, captured)) return;
+
+    // Removing two pawns from one rank can expose the king, check directly
+    auto occupiedAfter = (occupied() ^ fromSquare(from) ^ fromSquare(captured)) | fromSquare(ep);
+    auto them = pieces(opposite(us));
+    if (rookAttacks(king, occupiedAfter) & them & (pieces(Role::Rook) | pieces(Role::Queen))) return;
+    if (bishopAttacks(king, occupiedAfter) & them & (pieces(Role::Bishop) | pieces(Role::Queen))) return;
+
+    list.push(Move(from, ep, Move::Kind::EnPassant));
+}
+
+void Position::generateCastling(MoveList &list, Square king) const {
+    auto us = sideToMove;
+    auto them = pieces(opposite(us));
+    uint8_t rank = us == Color::White ? 0 : 7;
+    uint8_t kingSide = us == Color::White ? WhiteKingSide : BlackKingSide;
+    uint8_t queenSide = us == Color::White ? WhiteQueenSide : BlackQueenSide;
+
+    auto safe = [this, them](Square square) {
+        return !(attackersTo(square, occupied()) & them);
+    };
+
+    if (castlingRights & kingSide) {
+        auto f = Square(5, rank), g = Square(6, rank);
+        if (!board[f.index()] && !board[g.index()] && safe(f) && safe(g)) {
+            list.push(Move(king, g, Move::Kind::Castle));
+        }
+    }
+    if (castlingRights & queenSide) {
+        auto b = Square(1, rank), c = Square(2, rank), d = Square(3, rank);
+        if (!board[b.index()] && !board[c.index()] && !board[d.index()] && safe(c) && safe(d)) {
+            list.push(Move(king, c, Move::Kind::Castle));
+        }
+    }
+}
+
+std::optional<Move> Position::legalMove(Square from, Square to) const {
+    for (auto move: legalMoves(from)) {
+        if (move.to() == to) return move;
+        if (move.isCastle() && move.castleRookFrom() == to) return move;
+    }
+    return {};
+}
+
+bool Position::isLegal(Move move) const {
+    if (move.isNull()) return false;
+    for (auto legal: legalMoves(move.from())) {
+        if (legal == move) return true;
+    }
+    return false;
+}
+
+std::pair<Bitboard, Bitboard> Position::hints(Square from) const {
+    Bitboard quiet = 0, captures = 0;
+    for (auto move: legalMoves(from)) {
+        if (move.isCastle()) {
+            quiet |= fromSquare(move.to());
+            captures |= fromSquare(move.castleRookFrom());
+        } else if (isCapture(move)) {
+            captures |= fromSquare(move.to());
+        } else {
+            quiet |= fromSquare(move.to());
+        }
+    }
+    return {quiet, captures};
+}
+
+bool Position::isInsufficientMaterial() const {
+    if (pieces(Role::Pawn) | pieces(Role::Rook) | pieces(Role::Queen)) return false;
+    if (bitboard::count(pieces(Role::Knight) | pieces(Role::Bishop)) <= 1) return true;
+    if (pieces(Role::Knight)) return false;
+
+    auto bishops = pieces(Role::Bishop);
+    return (bishops & bitboard::DarkSquares) == 0 || (bishops & ~bitboard::DarkSquares) == 0;
+}
+
+bool Position::isCapture(Move move) const {
+    return move.isEnPassant() || (!move.isCastle() && board[move.to().index()]);
+}
+
+Bitboard Position::premoveTargets(Piece piece, Square from) {
+    auto color = piece.color();
+    switch (piece.role()) {
+        case Role::Pawn: {
+            auto targets = pawnAttacks(color, from);
+            int forward = color == Color::White ? 8 : -8;
+            int single = from.index() + forward;
+            if (single >= 0 && single < 64) {
+                targets |= fromSquare(Square::fromIndex(static_cast<uint8_t>(single)));
+                if (from.rank() == (color == Color::White ? 1 : 6)) {
+                    targets |= fromSquare(Square::fromIndex(static_cast<uint8_t>(single + forward)));
+                }
+            }
+            return targets;
+        }
+        case Role::King: {
+            auto targets = kingAttacks(from);
+            auto rank = color == Color::White ? 0 : 7;
+            if (from == Square(4, rank)) {
+                targets |= fromSquare(Square(0, rank)) | fromSquare(Square(2, rank))
+                           | fromSquare(Square(6, rank)) | fromSquare(Square(7, rank));
+            }
+            return targets;
+        }
+        default:
+            return attacks(piece.role(), color, from, Empty);
+    }
+}
+
+std::string Position::san(Move move) const {
+    std::string san;
+    if (move.isCastle()) {
+        san = move.to().file() > move.from().file() ? "O-O" : "O-O-O";
+    } else {
+        auto role = decodePiece(board[move.from().index()]).role();
+        auto capture = isCapture(move);
+
+        if (role == Role::Pawn) {
+            if (capture) san += static_cast<char>('a' + move.from().file());
+        } else {
+            san += static_cast<char>(roleChar(role) - 'a' + 'A');
+
+            // Disambiguate by file if that is enough, then by rank
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for (auto other: legalMoves()) {
+                if (other == move || other.isCastle() || other.to() != move.to()) continue;
+                if (decodePiece(board[other.from().index()]).role() != role) continue;
+                ambiguous = true;
+                sameFile |= other.from().file() == move.from().file();
+                sameRank |= other.from().rank() == move.from().rank();
+            }
+            if (ambiguous) {
+                if (!sameFile || sameRank) san += static_cast<char>('a' + move.from().file());
+                if (sameFile) san += static_cast<char>('1' + move.from().rank());
+            }
+        }
+
+        if (capture) san += 'x';
+        san += static_cast<char>('a' + move.to().file());
+        san += static_cast<char>('1' + move.to().rank());
+
+        if (move.isPromotion()) {
+            san += '=';
+            san += static_cast<char>(roleChar(move.promotion()) - 'a' + 'A');
+        }
+    }
+
+    auto child = *this;
+    child.play(move);
+    if (child.isCheck()) san += child.legalMoves().empty() ? '#' : '+';
+    return san;
+}
+
+std::optional<Move> Position::parseSan(std::string_view san) const {
+    while (!san.empty() && std::string_view("+#!?").find(san.back()) != std::string_view::npos) {
+        san.remove_suffix(1);
+    }
+    if (san.empty()) return {};
+
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        bool kingSide = san.size() == 3;
+        for (auto move: legalMoves()) {
+            if (move.isCastle() && (move.to().file() > move.from().file()) == kingSide) return move;
+        }
+        return {};
+    }
+
+    // Plain UCI, as found in some EPD files
+    if ((san.size() == 4 || san.size() == 5)
+        && san[0] >= 'a' && san[0] <= 'h' && san[1] >= '1' && san[1] <= '8'
+        && san[2] >= 'a' && san[2] <= 'h' && san[3] >= '1' && san[3] <= '8') {
+        auto from = Square(san[0] - 'a', san[1] - '1');
+        auto to = Square(san[2] - 'a', san[3] - '1');
+        if (auto move = legalMove(from, to)) {
+            if (san.size() == 5) {
+                auto promotion = roleFromChar(san[4]);
+                if (!move->isPromotion() || !promotion.has_value()) return {};
+                move->setPromotion(*promotion);
+                if (!isLegal(*move)) return {};
+            }
+            return move;
+        }
+    }
+
+    auto role = Role::Pawn;
+    if (std::string_view("NBRQK").find(san.front()) != std::string_view::npos) {
+        role = *roleFromChar(static_cast<char>(san.front() - 'A' + 'a'));
+        san.remove_prefix(1);
+    }
+
+    std::optional<Role> promotion;
+    if (!san.empty() && std::string_view("NBRQ").find(san.back()) != std::string_view::npos) {
+        promotion = roleFromChar(static_cast<char>(san.back() - 'A' + 'a'));
+        san.remove_suffix(1);
+        if (!san.empty() && san.back() == '=') san.remove_suffix(1);
+    }
+
+    if (san.size() < 2) return {};
+    auto toFile = san[san.size() - 2], toRank = san[san.size() - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return {};
+    auto to = Square(toFile - 'a', toRank - '1');
+    san.remove_suffix(2);
+
+    int fromFile = -1, fromRank = -1;
+    for (auto c: san) {
+        if (c >= 'a' && c <= 'h') {
+            fromFile = c - 'a';
+        } else if (c >= '1' && c <= '8') {
+            fromRank = c - '1';
+        } else if (c != 'x' && c != '-' && c != ':') {
+            return {};
+        }
+    }
+
+    std::optional<Move> found;
+    for (auto move: legalMoves()) {
+        if (move.isCastle() || move.to() != to) continue;
+        if (decodePiece(board[move.from().index()]).role() != role) continue;
+        if (fromFile >= 0 && move.from().file() != fromFile) continue;
+        if (fromRank >= 0 && move.from().rank() != fromRank) continue;
+        // A pawn without a source file is a push
+        if (role == Role::Pawn && fromFile < 0 && move.from().file() != to.file()) continue;
+        if (move.isPromotion() != promotion.has_value()) continue;
+        if (promotion.has_value() && move.promotion() != *promotion) continue;
+
+        if (found.has_value()) return {};
+        found = move;
+    }
+    return found;
+}
+
+void Position::play(Move move) {
+    auto us = sideToMove;
+    auto from = move.from(), to = move.to();
+    auto piece = decodePiece(board[from.index()]);
+    int forward = us == Color::White ? 8 : -8;
+
+    halfmoveClock += 1;
+    if (piece.role() == Role::Pawn || isCapture(move)) halfmoveClock = 0;
+
+    const auto &keys = zobristKeys();
+    zobrist ^= keys.castling[castlingRights];
+    if (epSquare != NoSquare) zobrist ^= keys.epFile[epSquare & 7];
+
+    castlingRights &= ~(castlingMask(from.index()) | castlingMask(to.index()));
+    epSquare = NoSquare;
+
+    switch (move.kind()) {
+        case Move::Kind::Castle:
+            remove(from);
+            remove(move.castleRookFrom());
+            put(piece, to);
+            put({us, Role::Rook}, move.castleRookTo());
+            break;
+        case Move::Kind::EnPassant:
+            remove(Square::fromIndex(static_cast<uint8_t>(to.index() - forward)));
+            remove(from);
+            put(piece, to);
+            break;
+        case Move::Kind::Promotion:
+            remove(from);
+            remove(to);
+            put({us, move.promotion()}, to);
+            break;
+        case Move::Kind::Normal:
+            remove(from);
+            remove(to);
+            put(piece, to);
+
+            if (piece.role() == Role::Pawn && (to.index() ^ from.index()) == 16) {
+                auto ep = Square::fromIndex(static_cast<uint8_t>(from.index() + forward));
+                if (pawnAttacks(us, ep) & pieces(opposite(us), Role::Pawn)) {
+                    epSquare = ep.index();
+                }
+            }
+            break;
+    }
+
+    zobrist ^= keys.castling[castlingRights] ^ keys.blackToMove;
+    if (epSquare != NoSquare) zobrist ^= keys.epFile[epSquare & 7];
+
+    if (us == Color::Black) fullmoveNumber += 1;
+    sideToMove = opposite(us);
+}
+
+uint64_t Position::perft(int depth) const {
+    if (depth <= 0) return 1;
+
+    auto moves = legalMoves();
+    if (depth == 1) return static_cast<uint64_t>(moves.size());
+
+    uint64_t nodes = 0;
+    for (auto move: moves) {
+        auto child = *this;
+        child.play(move);
+        nodes += child.perft(depth - 1);
+    }
+    return nodes;
+}
@@ -0,0 +1,138 @@
+#ifndef DISBOARD_POSITION_H
+#define DISBOARD_POSITION_H
+
+#include "bitboard.h"
+#include "move.h"
+#include "piece.h"
+#include "square.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace disboard {
+    class MoveList {
+    public:
+        MoveList() : count(0) {}
+
+        void push(Move move) { moves[count++] = move; }
+
+        [[nodiscard]] int size() const { return count; }
+        [[nodiscard]] bool empty() const { return count == 0; }
+        [[nodiscard]] Move operator[](int idx) const { return moves[idx]; }
+
+        [[nodiscard]] const Move *begin() const { return moves; }
+        [[nodiscard]] const Move *end() const { return moves + count; }
+
+    private:
+        // No legal chess position has more than 218 moves. The union keeps
+        // the buffer uninitialized, a list is built on every legality query.
+        union {
+            Move moves[256];
+        };
+        int count;
+    };
+
+    // A standard chess position with a native legal move generator. It
+    // mirrors the rules of the Rust game tree so that the interactive hot
+    // paths (piece lookup, legality, hints) never have to cross the FFI.
+    class Position {
+    public:
+        // The standard starting position
+        Position();
+
+        [[nodiscard]] static std::optional<Position> fromFen(std::string_view fen);
+        [[nodiscard]] std::string fen() const;
+
+        [[nodiscard]] Color turn() const { return sideToMove; }
+        [[nodiscard]] int halfmoves() const { return halfmoveClock; }
+        [[nodiscard]] int fullmoves() const { return fullmoveNumber; }
+
+        [[nodiscard]] Bitboard occupied() const { return byColor[0] | byColor[1]; }
+        [[nodiscard]] Bitboard pieces(Color color) const {
+            return byColor[static_cast<uint8_t>(color)];
+        }
+        [[nodiscard]] Bitboard pieces(Role role) const {
+            return byRole[static_cast<uint8_t>(role)];
+        }
+        [[nodiscard]] Bitboard pieces(Color color, Role role) const {
+            return pieces(color) & pieces(role);
+        }
+        [[nodiscard]] std::optional<Piece> pieceAt(Square square) const;
+
+        // Zobrist hash, maintained incrementally by play()
+        [[nodiscard]] uint64_t hash() const { return zobrist; }
+        // Piece counts per color and role, four bits each
+        [[nodiscard]] uint64_t materialKey() const;
+
+        [[nodiscard]] Bitboard checkers() const;
+        [[nodiscard]] bool isCheck() const { return checkers() != 0; }
+        // Neither side can ever mate: bare kings, a single minor piece, or
+        // bishops all on squares of one color
+        [[nodiscard]] bool isInsufficientMaterial() const;
+
+        [[nodiscard]] MoveList legalMoves() const;
+        [[nodiscard]] MoveList legalMoves(Square from) const;
+
+        // Resolves a move from its source and destination square the same
+        // way the Rust side does: castling may be given as the king's
+        // destination or as the rook's square, promotions come back with
+        // the first generated promotion role.
+        [[nodiscard]] std::optional<Move> legalMove(Square from, Square to) const;
+        [[nodiscard]] bool isLegal(Move move) const;
+
+        // Quiet destinations and capture destinations of the piece on
+        // `from`, castling reported both as the king's destination and as a
+        // capture of the rook.
+        [[nodiscard]] std::pair<Bitboard, Bitboard> hints(Square from) const;
+
+        [[nodiscard]] bool isCapture(Move move) const;
+
+        // Squares `piece` could move to on some future board: its attacks on
+        // an empty board, pawn pushes and the castling squares of a king on
+        // its home square. Used to accept premoves before it is our turn.
+        [[nodiscard]] static Bitboard premoveTargets(Piece piece, Square from);
+
+        // Standard algebraic notation of a legal move, with check suffix
+        [[nodiscard]] std::string san(Move move) const;
+        // Accepts SAN with or without check and annotation suffixes, castling
+        // written with letters or zeros, and plain UCI as a fallback.
+        // Ambiguous or illegal moves are rejected.
+        [[nodiscard]] std::optional<Move> parseSan(std::string_view san) const;
+
+        // Plays a move that must be legal in this position
+        void play(Move move);
+
+        [[nodiscard]] uint64_t perft(int depth) const;
+
+    private:
+        struct EmptyBoard {};
+        explicit Position(EmptyBoard);
+
+        Bitboard byRole[7];
+        Bitboard byColor[2];
+        uint8_t board[64];
+
+        Color sideToMove;
+        uint8_t castlingRights;
+        uint8_t epSquare;
+        uint16_t halfmoveClock;
+        uint16_t fullmoveNumber;
+        uint64_t zobrist;
+
+        void clear();
+        void put(Piece piece, Square square);
+        void remove(Square square);
+
+        [[nodiscard]] Bitboard attackersTo(Square square, Bitboard occupied) const;
+        [[nodiscard]] Bitboard pinned(Color color, Square king) const;
+
+        void generate(MoveList &list, Bitboard fromMask) const;
+        void generatePawnMoves(MoveList &list, Square from, Bitboard target, Square king) const;
+        void generateCastling(MoveList &list, Square king) const;
+    };
+}
+
+
+#endif //DISBOARD_POSITION_H
@@ -0,0 +1,198 @@
+#include "positionsearch.h"
+#include "scheduler.h"
+
+#include <algorithm>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+using namespace disboard;
+
+void PiecePattern::add(Piece piece, Square square) {
+    required[static_cast<uint8_t>(piece.color())][static_cast<uint8_t>(piece.role())]
+            |= bitboard::fromSquare(square);
+}
+
+bool PiecePattern::empty() const {
+    for (const auto &roles: required) {
+        for (auto bb: roles) {
+            if (bb) return false;
+        }
+    }
+    return true;
+}
+
+bool PiecePattern::matches(const Position &position) const {
+    for (auto color: {Color::Black, Color::White}) {
+        for (uint8_t role = 1; role <= 6; role += 1) {
+            auto bb = required[static_cast<uint8_t>(color)][role];
+            if ((position.pieces(color, static_cast<Role>(role)) & bb) != bb) return false;
+        }
+    }
+    return true;
+}
+
+SearchQuery SearchQuery::samePosition(const Position &position) {
+    SearchQuery query{Kind::SamePosition};
+    query.key = position.hash();
+    return query;
+}
+
+SearchQuery SearchQuery::sameMaterial(const Position &position) {
+    SearchQuery query{Kind::SameMaterial};
+    query.key = position.materialKey();
+    return query;
+}
+
+SearchQuery SearchQuery::piecePattern(const PiecePattern &pattern) {
+    SearchQuery query{Kind::Pattern};
+    query.pattern = pattern;
+    return query;
+}
+
+bool SearchQuery::matches(uint64_t hash, uint64_t material) const {
+    switch (mKind) {
+        case Kind::SamePosition:
+            return hash == key;
+        case Kind::SameMaterial:
+            return material == key;
+        case Kind::Pattern:
+            return false;
+    }
+    return false;
+}
+
+bool SearchQuery::matches(const Position &position) const {
+    switch (mKind) {
+        case Kind::SamePosition:
+            return position.hash() == key;
+        case Kind::SameMaterial:
+            return position.materialKey() == key;
+        case Kind::Pattern:
+            return pattern.matches(position);
+    }
+    return false;
+}
+
+struct PositionSearch::State {
+    static constexpr int chunkSize = 16;
+
+    QVector<std::shared_ptr<const IndexedGame>> games;
+    SearchQuery query;
+
+    // Cleared by detach(), the mutex is held while one is called
+    std::mutex mutex;
+    HitsCallback onHits;
+    FinishedCallback onFinished;
+
+    std::atomic<int> scanned{0};
+    std::atomic<int> pending{0};
+    std::atomic<bool> finished{false};
+    CancelToken token = CancelToken::make();
+
+    State(QVector<std::shared_ptr<const IndexedGame>> games, SearchQuery query)
+            : games(std::move(games)), query(std::move(query)) {}
+
+    void scan(int gameIdx, QVector<SearchHit> &hits) const {
+        const auto &index = games[gameIdx]->index();
+        auto count = index.nodes.count();
+
+        if (query.kind() != SearchQuery::Kind::Pattern) {
+            for (qsizetype idx = 0; idx < count; idx += 1) {
+                if (query.matches(index.hashes[idx], index.materials[idx])) {
+                    hits.push_back({gameIdx, index.nodes[idx].node, index.plies[idx]});
+                }
+            }
+            return;
+        }
+
+        std::vector<Position> positions;
+        positions.reserve(count);
+        for (qsizetype idx = 0; idx < count; idx += 1) {
+            const auto &entry = index.nodes[idx];
+            if (entry.parent < 0) {
+                positions.push_back(games[gameIdx]->game()->initialPosition());
+            } else {
+                auto position = positions[entry.parent];
+                position.play(entry.move);
+                positions.push_back(position);
+            }
+
+            if (query.matches(positions.back())) {
+                hits.push_back({gameIdx, entry.node, index.plies[idx]});
+            }
+        }
+    }
+
+    // One chunk per scheduler job, so interactive work can cut in between
+    // chunks however large the collection is
+    void scanChunk(int first) {
+        auto total = static_cast<int>(games.count());
+        if (first < total && !token.cancelled()) {
+            QVector<SearchHit> hits;
+            int last = std::min(first + chunkSize, total);
+            int done = 0;
+            for (int gameIdx = first; gameIdx < last; gameIdx += 1) {
+                if (token.cancelled()) break;
+                scan(gameIdx, hits);
+                done += 1;
+            }
+
+            auto scannedNow = scanned.fetch_add(done) + done;
+            std::lock_guard lock(mutex);
+            if (onHits) onHits(std::move(hits), scannedNow);
+        }
+
+        if (pending.fetch_sub(1) == 1) finish();
+    }
+
+    // Once, by the last chunk or by cancel(), whichever comes first.
+    // Chunks skipped after a cancel never count down.
+    void finish() {
+        if (finished.exchange(true)) return;
+        std::lock_guard lock(mutex);
+        if (onFinished) onFinished(token.cancelled());
+    }
+
+    // Waits only for a callback already being made
+    void detach() {
+        std::lock_guard lock(mutex);
+        onHits = {};
+        onFinished = {};
+    }
+};
+
+PositionSearch::PositionSearch(QVector<std::shared_ptr<const IndexedGame>> games, SearchQuery query)
+        : state(std::make_shared<State>(std::move(games), std::move(query))) {}
+
+PositionSearch::~PositionSearch() {
+    // No callback may outlive the search, the receiver goes away with it.
+    // Chunks still queued or running finish on their own and only touch
+    // the state they keep alive.
+    state->detach();
+    state->token.cancel();
+}
+
+void PositionSearch::start(HitsCallback onHits, FinishedCallback onFinished) {
+    state->onHits = std::move(onHits);
+    state->onFinished = std::move(onFinished);
+
+    auto &scheduler = Scheduler::instance();
+    int chunks = static_cast<int>((state->games.count() + State::chunkSize - 1) / State::chunkSize);
+    chunks = std::max(chunks, 1);
+
+    state->pending = chunks;
+    for (int chunk = 0; chunk < chunks; chunk += 1) {
+        // Every job keeps the state alive until it is done with it, chunks
+        // still queued when the search is cancelled are dropped unrun
+        scheduler.submit(Priority::Visible, [state = state, first = chunk * State::chunkSize]() {
+            state->scanChunk(first);
+        }, state->token);
+    }
+}
+
+void PositionSearch::cancel() {
+    state->token.cancel();
+    state->finish();
+}
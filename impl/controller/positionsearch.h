@@ -0,0 +1,84 @@
+#ifndef DISBOARD_POSITIONSEARCH_H
+#define DISBOARD_POSITIONSEARCH_H
+
+#include <QUuid>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+#include "gamecollection.h"
+#include "position.h"
+
+namespace disboard {
+    // Pieces that have to stand on given squares, other squares are free
+    class PiecePattern {
+    public:
+        void add(Piece piece, Square square);
+
+        [[nodiscard]] bool empty() const;
+        [[nodiscard]] bool matches(const Position &position) const;
+
+    private:
+        Bitboard required[2][7] = {};
+    };
+
+    class SearchQuery {
+    public:
+        enum class Kind {
+            SamePosition,
+            SameMaterial,
+            Pattern,
+        };
+
+        [[nodiscard]] static SearchQuery samePosition(const Position &position);
+        [[nodiscard]] static SearchQuery sameMaterial(const Position &position);
+        [[nodiscard]] static SearchQuery piecePattern(const PiecePattern &pattern);
+
+        [[nodiscard]] Kind kind() const { return mKind; }
+
+        // Position and material queries are answered from the per-node keys
+        // of the game index alone, patterns need the replayed positions.
+        [[nodiscard]] bool matches(uint64_t hash, uint64_t material) const;
+        [[nodiscard]] bool matches(const Position &position) const;
+
+    private:
+        explicit SearchQuery(Kind kind) : mKind(kind) {}
+
+        Kind mKind;
+        uint64_t key = 0;
+        PiecePattern pattern;
+    };
+
+    struct SearchHit {
+        int game;
+        QUuid node;
+        int ply;
+    };
+
+    // Scans a snapshot of a collection on the global thread pool. Workers
+    // claim small chunks of games, so hits arrive in batches while the scan
+    // is still running. The callbacks are invoked from worker threads.
+    // Destroying the search cancels it without waiting for the scan: no
+    // callback is made once the destructor returns.
+    class PositionSearch {
+    public:
+        using HitsCallback = std::function<void(QVector<SearchHit> hits, int scanned)>;
+        using FinishedCallback = std::function<void(bool cancelled)>;
+
+        PositionSearch(QVector<std::shared_ptr<const IndexedGame>> games, SearchQuery query);
+        ~PositionSearch();
+
+        void start(HitsCallback onHits, FinishedCallback onFinished);
+        // Stops every chunk at its next game boundary and reports the search
+        // finished right away
+        void cancel();
+
+    private:
+        struct State;
+        std::shared_ptr<State> state;
+    };
+}
+
+
+#endif //DISBOARD_POSITIONSEARCH_H
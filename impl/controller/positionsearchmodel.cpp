@@ -0,0 +1,179 @@
+#include "positionsearchmodel.h"
+#include "scheduler.h"
+
+#include <QPointer>
+
+#include <algorithm>
+
+class PositionSearchModel::p {
+    friend PositionSearchModel;
+
+private:
+    QPointer<GameCollection> collection;
+
+    std::unique_ptr<disboard::PositionSearch> search;
+    // Results of superseded searches may still be queued, they are told
+    // apart from the current one by generation.
+    quint64 generation = 0;
+    bool running = false;
+    int scanned = 0;
+
+    QVector<disboard::SearchHit> hits;
+};
+
+PositionSearchModel::PositionSearchModel(QObject *parent)
+        : QAbstractListModel(parent),
+          p(new class PositionSearchModel::p) {}
+
+PositionSearchModel::~PositionSearchModel() {
+    p->search.reset();
+}
+
+int PositionSearchModel::rowCount(const QModelIndex &parent) const {
+    if (parent.isValid()) return 0;
+    return static_cast<int>(p->hits.count());
+}
+
+QVariant PositionSearchModel::data(const QModelIndex &idx, int role) const {
+    if (!idx.isValid()) return {};
+    if (idx.row() < 0 || idx.row() >= p->hits.count()) return {};
+
+    const auto &hit = p->hits[idx.row()];
+    if (role == GameRole) return hit.game;
+    if (role == NodeRole) return hit.node;
+    if (role == PlyRole) return hit.ply;
+
+    return {};
+}
+
+QHash<int, QByteArray> PositionSearchModel::roleNames() const {
+    QHash<int, QByteArray> roles = QAbstractItemModel::roleNames();
+
+    roles[GameRole] = "game";
+    roles[NodeRole] = "node";
+    roles[PlyRole] = "ply";
+
+    return roles;
+}
+
+GameCollection *PositionSearchModel::collection() const {
+    return p->collection;
+}
+
+void PositionSearchModel::setCollection(GameCollection *newValue) {
+    if (p->collection == newValue) return;
+    cancel();
+    p->collection = newValue;
+    emit collectionChanged();
+}
+
+bool PositionSearchModel::running() const {
+    return p->running;
+}
+
+int PositionSearchModel::scanned() const {
+    return p->scanned;
+}
+
+int PositionSearchModel::count() const {
+    return static_cast<int>(p->hits.count());
+}
+
+void PositionSearchModel::searchPosition(Controller *controller) {
+    if (!controller) return;
+    start(disboard::SearchQuery::samePosition(
+            controller->board().position(controller->curNode())));
+}
+
+void PositionSearchModel::searchMaterial(Controller *controller) {
+    if (!controller) return;
+    start(disboard::SearchQuery::sameMaterial(
+            controller->board().position(controller->curNode())));
+}
+
+void PositionSearchModel::searchPattern(const QVector<disboard::Square> &squares,
+                                        const QVector<disboard::Piece> &pieces) {
+    disboard::PiecePattern pattern;
+    auto count = std::min(squares.count(), pieces.count());
+    for (qsizetype idx = 0; idx < count; idx += 1) {
+        pattern.add(pieces[idx], squares[idx]);
+    }
+    if (pattern.empty()) return;
+    start(disboard::SearchQuery::piecePattern(pattern));
+}
+
+void PositionSearchModel::cancel() {
+    if (!p->search) return;
+    p->search->cancel();
+    p->search.reset();
+    p->generation += 1;
+
+    if (p->running) {
+        p->running = false;
+        emit runningChanged();
+    }
+}
+
+void PositionSearchModel::start(disboard::SearchQuery query) {
+    cancel();
+    if (!p->collection) return;
+
+    beginResetModel();
+    p->hits.clear();
+    endResetModel();
+    emit countChanged();
+
+    p->scanned = 0;
+    emit scannedChanged();
+
+    p->running = true;
+    emit runningChanged();
+
+    auto generation = p->generation;
+    p->search = std::make_unique<disboard::PositionSearch>(
+            p->collection->snapshot(), std::move(query));
+
+    // The search is owned by this model and makes no callback once
+    // destroyed, so `this` outlives every callback. Deliveries still queued
+    // when the model goes away are dropped by the scheduler. A fast search
+    // produces hits quicker than rows can be inserted, the delivery budget
+    // spreads them over frames.
+    p->search->start(
+            [this, generation](QVector<disboard::SearchHit> hits, int scanned) {
+                disboard::Scheduler::instance().deliver(this, [this, generation, hits = std::move(hits), scanned]() {
+                    appendHits(generation, hits, scanned);
+                });
+            },
+            [this, generation](bool) {
+                disboard::Scheduler::instance().deliver(this, [this, generation]() {
+                    finish(generation);
+                });
+            });
+}
+
+void PositionSearchModel::appendHits(quint64 generation, const QVector<disboard::SearchHit> &hits, int scanned) {
+    if (generation != p->generation) return;
+
+    if (!hits.empty()) {
+        auto first = static_cast<int>(p->hits.count());
+        beginInsertRows({}, first, first + static_cast<int>(hits.count()) - 1);
+        p->hits.append(hits);
+        endInsertRows();
+        emit countChanged();
+    }
+
+    // Chunks complete out of order, keep the counter monotonic
+    if (scanned > p->scanned) {
+        p->scanned = scanned;
+        emit scannedChanged();
+    }
+}
+
+void PositionSearchModel::finish(quint64 generation) {
+    if (generation != p->generation) return;
+
+    p->search.reset();
+    p->generation += 1;
+    p->running = false;
+    emit runningChanged();
+}
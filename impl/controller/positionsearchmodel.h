@@ -0,0 +1,69 @@
+#ifndef DISBOARD_POSITIONSEARCHMODEL_H
+#define DISBOARD_POSITIONSEARCHMODEL_H
+
+#include <QAbstractListModel>
+#include <QObject>
+#include <QtQml/qqmlregistration.h>
+
+#include "controller.h"
+#include "gamecollection.h"
+#include "positionsearch.h"
+
+class PositionSearchModel : public QAbstractListModel {
+Q_OBJECT
+
+    QML_ELEMENT
+    Q_DISABLE_COPY(PositionSearchModel)
+
+    Q_PROPERTY(GameCollection *collection READ collection WRITE setCollection NOTIFY collectionChanged)
+    Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+    Q_PROPERTY(int scanned READ scanned NOTIFY scannedChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+public:
+    enum ItemRoles {
+        GameRole = Qt::UserRole + 1,
+        NodeRole,
+        PlyRole,
+    };
+
+    explicit PositionSearchModel(QObject *parent = nullptr);
+    ~PositionSearchModel() override;
+
+    [[nodiscard]] int rowCount(const QModelIndex &parent) const override;
+    [[nodiscard]] QVariant data(const QModelIndex &index, int role) const override;
+    [[nodiscard]] QHash<int, QByteArray> roleNames() const override;
+
+    [[nodiscard]] GameCollection *collection() const;
+    void setCollection(GameCollection *newValue);
+
+    [[nodiscard]] bool running() const;
+    [[nodiscard]] int scanned() const;
+    [[nodiscard]] int count() const;
+
+    // Exact position (pieces, side to move, castling, en passant) of the
+    // controller's current node
+    Q_INVOKABLE void searchPosition(Controller *controller);
+    // Same material balance as the controller's current node
+    Q_INVOKABLE void searchMaterial(Controller *controller);
+    // The given pieces on the given squares, the rest of the board is free
+    Q_INVOKABLE void searchPattern(const QVector<disboard::Square> &squares,
+                                   const QVector<disboard::Piece> &pieces);
+    Q_INVOKABLE void cancel();
+
+private:
+    class p;
+    std::shared_ptr<p> p;
+
+    void start(disboard::SearchQuery query);
+    void appendHits(quint64 generation, const QVector<disboard::SearchHit> &hits, int scanned);
+    void finish(quint64 generation);
+
+signals:
+    void collectionChanged();
+    void runningChanged();
+    void scannedChanged();
+    void countChanged();
+};
+
+
+#endif //DISBOARD_POSITIONSEARCHMODEL_H
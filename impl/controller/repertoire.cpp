@@ -0,0 +1,266 @@
+#include "repertoire.h"
+#include "scheduler.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+
+using namespace disboard;
+
+namespace {
+    enum class Outcome {
+        WhiteWin,
+        Draw,
+        BlackWin,
+        Unknown,
+    };
+
+    Outcome outcomeOf(const std::string &result) {
+        if (result == "1-0") return Outcome::WhiteWin;
+        if (result == "0-1") return Outcome::BlackWin;
+        if (result == "1/2-1/2") return Outcome::Draw;
+        return Outcome::Unknown;
+    }
+
+    // A move trie with counters. Children are kept as linked lists, most
+    // nodes have only a handful of them.
+    class Trie {
+    public:
+        struct Node {
+            int parent;
+            Move move;
+            int firstChild = -1;
+            int nextSibling = -1;
+            NodeStats stats;
+        };
+
+        QVector<Node> nodes{Node{-1, Move()}};
+
+        int child(int parent, Move move) {
+            for (auto idx = nodes[parent].firstChild; idx >= 0; idx = nodes[idx].nextSibling) {
+                if (nodes[idx].move == move) return idx;
+            }
+            auto idx = static_cast<int>(nodes.count());
+            nodes.push_back({parent, move, -1, nodes[parent].firstChild});
+            nodes[parent].firstChild = idx;
+            return idx;
+        }
+
+        void add(const RepertoireGame &game, int maxPlies) {
+            auto outcome = outcomeOf(game.result);
+            auto plies = maxPlies > 0 ? std::min<qsizetype>(game.moves.count(), maxPlies) : game.moves.count();
+
+            int node = 0;
+            count(node, outcome);
+            for (qsizetype ply = 0; ply < plies; ply += 1) {
+                node = child(node, game.moves[ply]);
+                count(node, outcome);
+            }
+        }
+
+        // Folds another trie in, nodes are visited parents first
+        void merge(const Trie &other) {
+            QVector<int> mapped(other.nodes.count());
+            mapped[0] = 0;
+            add(0, other.nodes[0].stats);
+            for (qsizetype idx = 1; idx < other.nodes.count(); idx += 1) {
+                const auto &node = other.nodes[idx];
+                mapped[idx] = child(mapped[node.parent], node.move);
+                add(mapped[idx], node.stats);
+            }
+        }
+
+        // Children by descending game count, earliest first on ties
+        [[nodiscard]] QVector<int> children(int parent) const {
+            QVector<int> list;
+            for (auto idx = nodes[parent].firstChild; idx >= 0; idx = nodes[idx].nextSibling) {
+                list.push_back(idx);
+            }
+            std::sort(list.begin(), list.end(), [this](int lhs, int rhs) {
+                if (nodes[lhs].stats.games != nodes[rhs].stats.games) {
+                    return nodes[lhs].stats.games > nodes[rhs].stats.games;
+                }
+                return lhs < rhs;
+            });
+            return list;
+        }
+
+    private:
+        void count(int idx, Outcome outcome) {
+            auto &stats = nodes[idx].stats;
+            stats.games += 1;
+            if (outcome == Outcome::WhiteWin) stats.whiteWins += 1;
+            if (outcome == Outcome::Draw) stats.draws += 1;
+            if (outcome == Outcome::BlackWin) stats.blackWins += 1;
+        }
+
+        void add(int idx, const NodeStats &other) {
+            auto &stats = nodes[idx].stats;
+            stats.games += other.games;
+            stats.whiteWins += other.whiteWins;
+            stats.draws += other.draws;
+            stats.blackWins += other.blackWins;
+        }
+    };
+
+    // Builds one trie per shard of `count` games as background jobs and
+    // merges them. `gameAt` is called from the shard jobs.
+    Trie buildTrie(int count, int threads, int maxPlies,
+                   const std::function<std::optional<RepertoireGame>(int)> &gameAt) {
+        // Small inputs are not worth a thread each
+        auto shards = std::clamp(count / 64, 1, threads);
+        QVector<Trie> tries(shards);
+
+        // Waiting runs shards too, so this is fine inside a scheduler job
+        TaskGroup group(Priority::Background);
+        for (int shard = 0; shard < shards; shard += 1) {
+            group.run([&, shard]() {
+                auto begin = static_cast<int>(static_cast<qint64>(count) * shard / shards);
+                auto end = static_cast<int>(static_cast<qint64>(count) * (shard + 1) / shards);
+                auto &trie = tries[shard];
+                for (auto idx = begin; idx < end; idx += 1) {
+                    if (auto game = gameAt(idx)) trie.add(*game, maxPlies);
+                }
+            });
+        }
+        group.wait();
+
+        auto trie = std::move(tries.front());
+        for (qsizetype shard = 1; shard < tries.count(); shard += 1) {
+            trie.merge(tries[shard]);
+        }
+        return trie;
+    }
+
+    std::optional<Repertoire> graft(const Trie &trie, const Position &start, bool linkTranspositions) {
+        auto tree = start.hash() == Position().hash() ?
+                    std::optional<Disboard>(Disboard()) :
+                    Disboard::fromFen(start.fen());
+        if (!tree.has_value()) return {};
+
+        // Parents first, with the most played child leading every node so
+        // that it becomes the mainline
+        QVector<int> order;
+        QVector<int> parents;
+        QVector<Move> moves;
+        QVector<int> listIdx(trie.nodes.count(), -1);
+        QVector<uint64_t> hashes(trie.nodes.count());
+        QVector<int> plies(trie.nodes.count());
+        order.reserve(trie.nodes.count() - 1);
+        parents.reserve(trie.nodes.count() - 1);
+        moves.reserve(trie.nodes.count() - 1);
+
+        std::vector<std::pair<int, Position>> stack{{0, start}};
+        hashes[0] = start.hash();
+        while (!stack.empty()) {
+            auto [idx, position] = std::move(stack.back());
+            stack.pop_back();
+
+            auto children = trie.children(idx);
+            // Pushed in reverse, so the main child is grafted first
+            for (auto it = children.crbegin(); it != children.crend(); ++it) {
+                auto child = *it;
+                auto childPosition = position;
+                childPosition.play(trie.nodes[child].move);
+                hashes[child] = childPosition.hash();
+                plies[child] = plies[idx] + 1;
+                stack.emplace_back(child, childPosition);
+            }
+
+            if (idx == 0) continue;
+            listIdx[idx] = static_cast<int>(order.count());
+            order.push_back(idx);
+            parents.push_back(listIdx[trie.nodes[idx].parent]);
+            moves.push_back(trie.nodes[idx].move);
+        }
+
+        auto root = tree->root();
+        auto newNodes = tree->addTree(root, parents, moves);
+
+        Repertoire repertoire{std::move(*tree), {}};
+        auto &stats = repertoire.stats;
+        stats.reserve(newNodes.count() + 1);
+        stats.insert(root, trie.nodes[0].stats);
+        for (qsizetype idx = 0; idx < newNodes.count(); idx += 1) {
+            stats.insert(newNodes[idx], trie.nodes[order[idx]].stats);
+        }
+        if (!linkTranspositions) return repertoire;
+
+        // The node reaching a position in the fewest plies stands for it
+        QHash<uint64_t, int> canonical;
+        canonical.insert(hashes[0], 0);
+        for (qsizetype idx = 0; idx < newNodes.count(); idx += 1) {
+            auto trieIdx = order[idx];
+            auto it = canonical.find(hashes[trieIdx]);
+            if (it == canonical.end()) {
+                canonical.insert(hashes[trieIdx], trieIdx);
+            } else if (plies[trieIdx] < plies[*it]) {
+                *it = trieIdx;
+            }
+        }
+
+        auto nodeOf = [&](int trieIdx) {
+            return trieIdx == 0 ? root : newNodes[listIdx[trieIdx]];
+        };
+        for (qsizetype idx = 0; idx < newNodes.count(); idx += 1) {
+            auto trieIdx = order[idx];
+            auto canonicalIdx = canonical.value(hashes[trieIdx]);
+            if (canonicalIdx == trieIdx) continue;
+            if (canonicalIdx != 0 && listIdx[canonicalIdx] >= newNodes.count()) continue;
+            stats[newNodes[idx]].transposition = nodeOf(canonicalIdx);
+        }
+        return repertoire;
+    }
+}
+
+qreal NodeStats::whiteScore() const {
+    auto decided = whiteWins + draws + blackWins;
+    if (decided == 0) return 0;
+    return (whiteWins + draws * 0.5) / decided;
+}
+
+RepertoireGame RepertoireGame::fromPgn(const PgnGame &game) {
+    return {game.mainlineMoves(), game.result};
+}
+
+RepertoireBuilder::RepertoireBuilder(RepertoireOptions options) : options(options) {}
+
+std::optional<Repertoire> RepertoireBuilder::build(const Position &start, const QVector<RepertoireGame> &games) const {
+    auto threads = options.threads > 0 ? options.threads : Scheduler::instance().threadCount();
+    auto trie = buildTrie(static_cast<int>(games.count()), threads, options.maxPlies, [&games](int idx) {
+        return std::optional<RepertoireGame>(games[idx]);
+    });
+    return graft(trie, start, options.linkTranspositions);
+}
+
+std::optional<Repertoire> RepertoireBuilder::load(const QString &path) const {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+
+    // Splitting is sequential, parsing happens in the shards
+    QVector<std::string> texts;
+    PgnSplitter splitter(&file);
+    while (auto text = splitter.next()) texts.push_back(std::move(*text));
+
+    std::optional<Position> start;
+    for (const auto &text: texts) {
+        if (auto game = PgnGame::parse(text)) {
+            start = game->start;
+            break;
+        }
+    }
+    if (!start.has_value()) return {};
+
+    auto startHash = start->hash();
+    auto threads = options.threads > 0 ? options.threads : Scheduler::instance().threadCount();
+    auto trie = buildTrie(static_cast<int>(texts.count()), threads, options.maxPlies,
+                          [&texts, startHash](int idx) -> std::optional<RepertoireGame> {
+                              auto game = PgnGame::parse(texts[idx]);
+                              if (!game.has_value() || game->start.hash() != startHash) return {};
+                              return RepertoireGame::fromPgn(*game);
+                          });
+    return graft(trie, *start, options.linkTranspositions);
+}
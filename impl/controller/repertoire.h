@@ -0,0 +1,82 @@
+#ifndef DISBOARD_REPERTOIRE_H
+#define DISBOARD_REPERTOIRE_H
+
+#include <QHash>
+#include <QObject>
+#include <QUuid>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+#include <optional>
+
+#include "disboard.h"
+#include "pgn.h"
+
+namespace disboard {
+    // How often a node was reached by the games folded into a repertoire,
+    // and how those games ended
+    class NodeStats {
+        Q_GADGET
+        QML_VALUE_TYPE(nodeStats)
+        Q_PROPERTY(int games MEMBER games CONSTANT)
+        Q_PROPERTY(int whiteWins MEMBER whiteWins CONSTANT)
+        Q_PROPERTY(int draws MEMBER draws CONSTANT)
+        Q_PROPERTY(int blackWins MEMBER blackWins CONSTANT)
+        Q_PROPERTY(qreal whiteScore READ whiteScore CONSTANT)
+        // Node of the same position reached in fewer plies, null if none
+        Q_PROPERTY(QUuid transposition MEMBER transposition CONSTANT)
+        QML_UNCREATABLE("NodeStats can only be created on C++ side")
+
+    public:
+        int games = 0;
+        int whiteWins = 0;
+        int draws = 0;
+        int blackWins = 0;
+        QUuid transposition;
+
+        // Points per game for white, draws counting half
+        [[nodiscard]] qreal whiteScore() const;
+    };
+
+    struct Repertoire {
+        Disboard tree;
+        QHash<QUuid, NodeStats> stats;
+    };
+
+    struct RepertoireGame {
+        QVector<Move> moves;
+        // As in PGN: "1-0", "0-1", "1/2-1/2" or "*"
+        std::string result;
+
+        // The mainline of a parsed game
+        [[nodiscard]] static RepertoireGame fromPgn(const PgnGame &game);
+    };
+
+    struct RepertoireOptions {
+        // 0 uses one shard per scheduler thread
+        int threads = 0;
+        // Moves past this ply are not folded in, 0 keeps whole games
+        int maxPlies = 0;
+        bool linkTranspositions = true;
+    };
+
+    // Folds many games from one start position into a single tree. Each
+    // shard builds a move trie from its share of the games, the tries are
+    // merged, and the result is grafted onto a fresh Disboard in one call
+    // with the most played move of every node as its mainline.
+    class RepertoireBuilder {
+    public:
+        explicit RepertoireBuilder(RepertoireOptions options);
+
+        // Empty when the start position cannot back a tree
+        [[nodiscard]] std::optional<Repertoire> build(const Position &start, const QVector<RepertoireGame> &games) const;
+        // Games of the file that start from the position of the first one
+        [[nodiscard]] std::optional<Repertoire> load(const QString &path) const;
+
+    private:
+        RepertoireOptions options;
+    };
+}
+
+
+#endif //DISBOARD_REPERTOIRE_H
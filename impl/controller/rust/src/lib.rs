@@ -23,13 +23,11 @@ mod ffi {
         King = 6,
     }
 
-    pub struct Piece {
-        pub color: Color,
-        pub role: Role,
-    }
-
-    extern "Rust" {
-        fn piece_default() -> Piece;
+    // One node of a tree flattened in preorder, mainline children first
+    pub struct TreeEntry {
+        pub node: Uuid,
+        pub parent: u32,
+        pub m: u16,
     }
 
     #[derive(PartialEq)]
@@ -37,65 +35,79 @@ mod ffi {
         pub index: u8,
     }
 
-    extern "Rust" {
-        fn square_default() -> Square;
-        fn square_from_coords(file: u8, rank: u8) -> Square;
-        fn file(self: &Square) -> u8;
-        fn rank(self: &Square) -> u8;
+    // Estimated heap held by a tree. sac keeps its nodes private, so the
+    // bytes are worked out from the node count and the layout of a node.
+    pub struct TreeMemory {
+        pub nodes: usize,
+        pub bytes: usize,
     }
 
-    extern "Rust" {
-        type Move;
-        fn clone(&self) -> Box<Move>;
-        fn from(&self) -> Square;
-        fn to(&self) -> Square;
-        fn is_promotion(&self) -> bool;
-        fn set_promotion(&mut self, role: Role);
-        fn is_en_passant(&self) -> bool;
-        fn is_castle(&self) -> bool;
-        fn castle_rook_from(&self) -> Square;
-        fn castle_rook_to(&self) -> Square;
-        fn to_string(&self) -> String;
+    // Tablebase result of one legal move, from the mover's point of view.
+    // `promotion` is a Role or 0, castling goes to the rook's square.
+    pub struct TablebaseMove {
+        pub from: u8,
+        pub to: u8,
+        pub promotion: u8,
+        pub wdl: i8,
+        pub dtz: i32,
+        pub has_dtz: bool,
     }
 
-    extern "Rust" {
-        type CurPosition;
-        fn turn(&self) -> Color;
+    // WDL is -2 (loss) to 2 (win), with -1 and 1 for results spoiled by
+    // the 50-move rule. DTZ may be missing when only WDL tables exist.
+    pub struct TablebaseProbe {
+        pub wdl: i8,
+        pub dtz: i32,
+        pub has_dtz: bool,
+        pub moves: Vec<TablebaseMove>,
+    }
 
-        fn squares(&self) -> Vec<Square>;
-        fn pieces(&self) -> Vec<Piece>;
+    extern "Rust" {
+        type Tablebase;
+        fn tablebase_new() -> Box<Tablebase>;
 
-        fn has_piece_at(&self, square: Square) -> bool;
-        fn piece_at(&self, square: Square) -> Piece;
-        fn has_legal_move(&self, src: Square, dest: Square) -> bool;
-        fn legal_move(&self, src: Square, dest: Square) -> Box<Move>;
+        fn add_tablebase_directory(&mut self, path: &str) -> Result<usize>;
+        fn tablebase_max_pieces(&self) -> usize;
+        fn probe_tablebase(&self, fen: &str) -> Result<TablebaseProbe>;
+    }
 
-        fn hints(&self, src: Square) -> Vec<Square>;
-        fn captures(&self, src: Square) -> Vec<Square>;
+    extern "Rust" {
+        type CurPosition;
+        fn perft(&self, depth: u32) -> u64;
     }
 
     extern "Rust" {
         type GameTree;
         fn game_default() -> Box<GameTree>;
+        fn game_from_fen(fen: &str) -> Result<Box<GameTree>>;
 
         fn root(&self) -> Uuid;
         fn position(&self, node: Uuid) -> Box<CurPosition>;
 
-        fn has_prev_move(&self, node: Uuid) -> bool;
-        fn prev_move(&self, node: Uuid) -> Box<Move>;
+        fn prev_move(&self, node: Uuid) -> u16;
+        fn line_moves(&self, node: Uuid) -> Vec<u16>;
+        fn san(&self, node: Uuid) -> String;
 
         fn has_prev_node(&self, node: Uuid) -> bool;
         fn prev_node(&self, node: Uuid) -> Uuid;
         fn has_next_mainline_node(&self, node: Uuid) -> bool;
         fn next_mainline_node(&self, node: Uuid) -> Uuid;
 
+        fn ply(&self, node: Uuid) -> u32;
+        fn ancestor(&self, node: Uuid, plies: u32) -> Uuid;
+        fn mainline_descendant(&self, node: Uuid, plies: u32) -> Uuid;
+
         fn variations(&self, node: Uuid) -> Vec<Uuid>;
         fn siblings(&self, node: Uuid) -> Vec<Uuid>;
         fn mainline_nodes(&self, node: Uuid) -> Vec<Uuid>;
+        fn entries(&self) -> Vec<TreeEntry>;
 
-        fn add_node(&mut self, node: Uuid, m: Box<Move>) -> Uuid;
+        fn add_node(&mut self, node: Uuid, m: u16) -> Uuid;
+        fn add_moves(&mut self, node: Uuid, moves: &[u16]) -> Vec<Uuid>;
+        fn add_tree(&mut self, node: Uuid, parents: &[i32], moves: &[u16]) -> Vec<Uuid>;
 
         fn pgn(&self) -> String;
+        fn memory(&self) -> TreeMemory;
     }
 }
 
@@ -153,22 +165,6 @@ convert_enum!(
     King,
 );
 
-impl From<sac::Piece> for ffi::Piece {
-    fn from(value: sac::Piece) -> ffi::Piece {
-        ffi::Piece {
-            color: value.color.into(),
-            role: value.role.into(),
-        }
-    }
-}
-
-fn piece_default() -> ffi::Piece {
-    ffi::Piece {
-        color: ffi::Color::Black,
-        role: ffi::Role::Knight,
-    }
-}
-
 impl From<sac::Square> for ffi::Square {
     fn from(value: sac::Square) -> ffi::Square {
         ffi::Square {
@@ -183,253 +179,117 @@ impl From<ffi::Square> for sac::Square {
     }
 }
 
-fn square_default() -> ffi::Square {
-    ffi::Square { index: 0 }
-}
+const MOVE_KIND_NORMAL: u16 = 0;
+const MOVE_KIND_PROMOTION: u16 = 1;
+const MOVE_KIND_EN_PASSANT: u16 = 2;
+const MOVE_KIND_CASTLE: u16 = 3;
 
-fn square_from_coords(file: u8, rank: u8) -> ffi::Square {
-    let sq = sac::Square::from_coords(sac::File::new(file as u32), sac::Rank::new(rank as u32));
-    ffi::Square {
-        index: u8::from(sq),
-    }
-}
+fn castle_king_to(m: &sac::Move) -> sac::Square {
+    let castling_side = m.castling_side().unwrap();
 
-impl ffi::Square {
-    fn file(&self) -> u8 {
-        self.index & 7
-    }
-    fn rank(&self) -> u8 {
-        self.index >> 3
-    }
-}
+    let to_rank = m.from().unwrap().rank();
+    let to_file = castling_side.king_to_file();
 
-struct Move {
-    inner: sac::Move,
-    san: sac::SanPlus,
+    sac::Square::from_coords(to_file, to_rank)
 }
 
-impl Move {
-    fn clone(&self) -> Box<Move> {
-        Box::new(Move {
-            inner: self.inner.clone(),
-            san: self.san.clone(),
-        })
-    }
-
-    fn from(&self) -> ffi::Square {
-        self.inner
-            .from()
-            .expect("a chess move always comes from somewhere")
-            .into()
-    }
-
-    fn to(&self) -> ffi::Square {
-        if let sac::Move::Castle { king: _, rook: _ } = self.inner {
-            // Treat castling as special case
-            let castling_side = self.inner.castling_side().unwrap();
-
-            let to_rank = self.inner.from().unwrap().rank();
-            let to_file = castling_side.king_to_file();
-
-            let dest_sq = sac::Square::from_coords(to_file, to_rank);
-            return dest_sq.into();
-        }
-
-        self.inner.to().into()
-    }
-
-    fn is_promotion(&self) -> bool {
-        self.inner.is_promotion()
-    }
+fn encode_move(m: &sac::Move) -> u16 {
+    let from = u8::from(m.from().expect("a chess move always comes from somewhere")) as u16;
+    let (to, kind) = match m {
+        // Castling moves are encoded with the king's destination
+        sac::Move::Castle { .. } => (castle_king_to(m), MOVE_KIND_CASTLE),
+        sac::Move::EnPassant { .. } => (m.to(), MOVE_KIND_EN_PASSANT),
+        _ if m.is_promotion() => (m.to(), MOVE_KIND_PROMOTION),
+        _ => (m.to(), MOVE_KIND_NORMAL),
+    };
+    let promotion = m
+        .promotion()
+        .map(|role| (ffi::Role::from(role).repr - ffi::Role::Knight.repr) as u16)
+        .unwrap_or(0);
+
+    from | ((u8::from(to) as u16) << 6) | (promotion << 12) | (kind << 14)
+}
 
-    fn set_promotion(&mut self, role: ffi::Role) {
-        if let sac::Move::Normal {
-            ref mut promotion, ..
-        } = self.inner
-        {
+fn decode_move(pos: &sac::Chess, bits: u16) -> Option<sac::Move> {
+    let src = ffi::Square {
+        index: (bits & 0x3f) as u8,
+    };
+    let dest = ffi::Square {
+        index: ((bits >> 6) & 0x3f) as u8,
+    };
+    let mut m = find_legal_move(pos, src, dest)?;
+
+    if let sac::Move::Normal {
+        ref mut promotion, ..
+    } = m
+    {
+        if promotion.is_some() {
+            let role = ffi::Role {
+                repr: ((bits >> 12) & 3) as u8 + ffi::Role::Knight.repr,
+            };
             *promotion = Some(role.into());
         }
     }
 
-    fn is_en_passant(&self) -> bool {
-        self.inner.is_en_passant()
-    }
-
-    fn is_castle(&self) -> bool {
-        self.inner.is_castle()
-    }
-
-    fn castle_rook_from(&self) -> ffi::Square {
-        if let sac::Move::Castle { king: _, rook } = self.inner {
-            return rook.into();
-        }
+    Some(m)
+}
 
-        ffi::Square { index: 0 }
-    }
+fn find_legal_move(pos: &sac::Chess, src_sq: ffi::Square, dest_sq: ffi::Square) -> Option<sac::Move> {
+    let src_sq: sac::Square = src_sq.into();
+    let dest_sq: sac::Square = dest_sq.into();
 
-    fn castle_rook_to(&self) -> ffi::Square {
-        if self.inner.is_castle() {
-            let castling_side = self.inner.castling_side().unwrap();
-            let from_rank = self.inner.from().unwrap().rank();
-            let to_file = castling_side.rook_to_file();
+    let move_vec: Vec<sac::Move> = pos
+        .legal_moves()
+        .into_iter()
+        .filter(|v| v.from().unwrap() == src_sq)
+        .collect::<Vec<sac::Move>>();
 
-            return sac::Square::from_coords(to_file, from_rank).into();
+    for m in move_vec {
+        if let sac::Move::Castle { king: _, rook } = m {
+            if castle_king_to(&m) == dest_sq {
+                return Some(m);
+            }
+            if rook == dest_sq {
+                return Some(m);
+            }
+            continue;
         }
 
-        ffi::Square { index: 0 }
+        if m.to() == dest_sq {
+            // A legal move!
+            return Some(m);
+        }
     }
 
-    fn to_string(&self) -> String {
-        format!("{}", self.san)
-    }
+    None
 }
 
 struct CurPosition(sac::Chess);
 
 impl CurPosition {
-    fn turn(&self) -> ffi::Color {
-        self.0.turn().into()
-    }
-
-    fn squares(&self) -> Vec<ffi::Square> {
-        let board = self.0.board().clone();
-
-        board
-            .into_iter()
-            .map(|(sq, _)| sq.into())
-            .collect::<Vec<ffi::Square>>()
-    }
-
-    fn pieces(&self) -> Vec<ffi::Piece> {
-        let board = self.0.board().clone();
-
-        board
-            .into_iter()
-            .map(|(_, p)| p.into())
-            .collect::<Vec<ffi::Piece>>()
+    fn perft(&self, depth: u32) -> u64 {
+        perft(&self.0, depth)
     }
+}
 
-    fn has_piece_at(&self, square: ffi::Square) -> bool {
-        let square: sac::Square = square.into();
-        self.0.board().piece_at(square).is_some()
+fn perft(pos: &sac::Chess, depth: u32) -> u64 {
+    if depth == 0 {
+        return 1;
     }
 
-    fn piece_at(&self, square: ffi::Square) -> ffi::Piece {
-        let square: sac::Square = square.into();
-        self.0
-            .board()
-            .piece_at(square)
-            .map(|val| val.into())
-            .unwrap_or(piece_default())
+    let moves = pos.legal_moves();
+    if depth == 1 {
+        return moves.len() as u64;
     }
 
-    fn has_legal_move(&self, src: ffi::Square, dest: ffi::Square) -> bool {
-        self._legal_move(src, dest).is_some()
-    }
-
-    fn legal_move(&self, src: ffi::Square, dest: ffi::Square) -> Box<Move> {
-        let legal_move = self._legal_move(src, dest).unwrap_or(sac::Move::Put {
-            role: sac::Role::Pawn,
-            to: sac::Square::A1,
-        });
-        let san = sac::SanPlus::from_move(self.0.clone(), &legal_move);
-        Box::new(Move {
-            inner: legal_move,
-            san,
+    moves
+        .iter()
+        .map(|m| {
+            let mut child = pos.clone();
+            child.play_unchecked(m);
+            perft(&child, depth - 1)
         })
-    }
-
-    fn hints(&self, src: ffi::Square) -> Vec<ffi::Square> {
-        let (hint_vec, _) = self._legal_moves(src);
-        hint_vec
-    }
-
-    fn captures(&self, src: ffi::Square) -> Vec<ffi::Square> {
-        let (_, captures_vec) = self._legal_moves(src);
-        captures_vec
-    }
-}
-
-impl CurPosition {
-    fn _legal_move(&self, src_sq: ffi::Square, dest_sq: ffi::Square) -> Option<sac::Move> {
-        let src_sq: sac::Square = src_sq.into();
-        let dest_sq: sac::Square = dest_sq.into();
-
-        let move_vec: Vec<sac::Move> = self
-            .0
-            .legal_moves()
-            .into_iter()
-            .filter(|v| v.from().unwrap() == src_sq)
-            .collect::<Vec<sac::Move>>();
-
-        for m in move_vec {
-            if let sac::Move::Castle { king, rook } = m {
-                let castling_side = m.castling_side().unwrap();
-                let to_file = castling_side.king_to_file();
-                let to_king_sq = sac::Square::from_coords(to_file, king.rank());
-                if to_king_sq == dest_sq {
-                    return Some(m);
-                }
-                if rook == dest_sq {
-                    return Some(m);
-                }
-                continue;
-            }
-
-            if m.to() == dest_sq {
-                // A legal move!
-                return Some(m);
-            }
-        }
-
-        None
-    }
-
-    fn _legal_moves(&self, sq: ffi::Square) -> (Vec<ffi::Square>, Vec<ffi::Square>) {
-        let sq: sac::Square = sq.into();
-        let mut move_vec = self
-            .0
-            .legal_moves()
-            .into_iter()
-            .filter(|v| v.from().unwrap() == sq)
-            .collect::<Vec<sac::Move>>();
-        move_vec.dedup_by(|l, r| {
-            if !l.is_promotion() || !r.is_promotion() {
-                return false;
-            }
-
-            l.to() == r.to()
-        });
-
-        let (castling_move_vec, move_vec): (Vec<sac::Move>, Vec<sac::Move>) =
-            move_vec.into_iter().partition(|m| m.is_castle());
-
-        let (capture_vec, move_vec): (Vec<sac::Move>, Vec<sac::Move>) =
-            move_vec.into_iter().partition(|m| m.capture().is_some());
-        let mut move_vec = move_vec
-            .into_iter()
-            .map(|m| m.to().into())
-            .collect::<Vec<ffi::Square>>();
-        let mut capture_vec = capture_vec
-            .into_iter()
-            .map(|m| m.to().into())
-            .collect::<Vec<ffi::Square>>();
-
-        for castling_move in castling_move_vec {
-            if let sac::Move::Castle { king: _, rook } = castling_move {
-                let castling_side = castling_move.castling_side().unwrap();
-
-                let to_rank = castling_move.from().unwrap().rank();
-                let to_file = castling_side.king_to_file();
-
-                move_vec.push(sac::Square::from_coords(to_file, to_rank).into());
-
-                capture_vec.push(rook.into());
-            }
-        }
-
-        (move_vec, capture_vec)
-    }
+        .sum()
 }
 
 struct GameTree {
@@ -442,6 +302,21 @@ fn game_default() -> Box<GameTree> {
     })
 }
 
+// The tree can only start from a setup through its PGN reader, so the
+// position is handed over as the FEN header of an otherwise empty game.
+// The FEN itself has already been validated by the native position.
+fn game_from_fen(fen: &str) -> Result<Box<GameTree>, String> {
+    let fen = fen.trim();
+    if fen.is_empty() || fen.contains(|c| c == '"' || c == ']' || c == '\n') {
+        return Err(format!("invalid fen: {}", fen));
+    }
+
+    let pgn = format!("[SetUp \"1\"]\n[FEN \"{}\"]\n\n*\n", fen);
+    Ok(Box::new(GameTree {
+        inner: sac::read_pgn(&pgn),
+    }))
+}
+
 impl GameTree {
     fn root(&self) -> ffi::Uuid {
         self.inner.root().into()
@@ -453,20 +328,34 @@ impl GameTree {
         ))
     }
 
-    fn has_prev_move(&self, node: ffi::Uuid) -> bool {
-        self.inner.prev_move(node.into()).is_some()
+    fn prev_move(&self, node: ffi::Uuid) -> u16 {
+        self.inner
+            .prev_move(node.into())
+            .map(|m| encode_move(&m))
+            .unwrap_or(0)
+    }
+
+    fn line_moves(&self, node: ffi::Uuid) -> Vec<u16> {
+        let mut cur_node: uuid::Uuid = node.into();
+        let mut move_vec: Vec<u16> = Vec::new();
+        while let Some(m) = self.inner.prev_move(cur_node) {
+            move_vec.push(encode_move(&m));
+            cur_node = self.inner.parent(cur_node).expect("a move always has a parent node");
+        }
+
+        move_vec.reverse();
+        move_vec
     }
 
-    fn prev_move(&self, node: ffi::Uuid) -> Box<Move> {
+    fn san(&self, node: ffi::Uuid) -> String {
         let node = node.into();
-        let m = self.inner.prev_move(node).unwrap_or(sac::Move::Put {
-            role: sac::Role::Pawn,
-            to: sac::Square::A1,
-        });
+        let m = match self.inner.prev_move(node) {
+            Some(m) => m,
+            None => return String::new(),
+        };
         let pos = self.inner.board_before(node).expect("invalid node");
-        let san = sac::SanPlus::from_move(pos, &m);
 
-        Box::new(Move { inner: m, san })
+        format!("{}", sac::SanPlus::from_move(pos, &m))
     }
 
     fn has_prev_node(&self, node: ffi::Uuid) -> bool {
@@ -482,6 +371,38 @@ impl GameTree {
         self.inner.mainline(node.into()).unwrap_or_default().into()
     }
 
+    fn ply(&self, node: ffi::Uuid) -> u32 {
+        let mut cur_node: uuid::Uuid = node.into();
+        let mut ply = 0;
+        while let Some(node) = self.inner.parent(cur_node) {
+            ply += 1;
+            cur_node = node;
+        }
+        ply
+    }
+
+    fn ancestor(&self, node: ffi::Uuid, plies: u32) -> ffi::Uuid {
+        let mut cur_node: uuid::Uuid = node.into();
+        for _ in 0..plies {
+            match self.inner.parent(cur_node) {
+                Some(node) => cur_node = node,
+                None => break,
+            }
+        }
+        cur_node.into()
+    }
+
+    fn mainline_descendant(&self, node: ffi::Uuid, plies: u32) -> ffi::Uuid {
+        let mut cur_node: uuid::Uuid = node.into();
+        for _ in 0..plies {
+            match self.inner.mainline(cur_node) {
+                Some(node) => cur_node = node,
+                None => break,
+            }
+        }
+        cur_node.into()
+    }
+
     fn variations(&self, node: ffi::Uuid) -> Vec<ffi::Uuid> {
         let node: uuid::Uuid = node.into();
         let variation_vec = self.inner.other_variations(node);
@@ -517,14 +438,228 @@ impl GameTree {
             .collect::<Vec<ffi::Uuid>>()
     }
 
-    fn add_node(&mut self, node: ffi::Uuid, m: Box<Move>) -> ffi::Uuid {
+    fn entries(&self) -> Vec<ffi::TreeEntry> {
+        let mut entry_vec: Vec<ffi::TreeEntry> = Vec::new();
+        let mut stack: Vec<(uuid::Uuid, u32)> = vec![(self.inner.root(), u32::MAX)];
+
+        while let Some((node, parent)) = stack.pop() {
+            let idx = entry_vec.len() as u32;
+            entry_vec.push(ffi::TreeEntry {
+                node: node.into(),
+                parent,
+                m: self.inner.prev_move(node).map(|m| encode_move(&m)).unwrap_or(0),
+            });
+
+            // Pushed in reverse so that the mainline child is visited first
+            for child in self.children(node).into_iter().rev() {
+                stack.push((child, idx));
+            }
+        }
+
+        entry_vec
+    }
+
+    fn memory(&self) -> ffi::TreeMemory {
+        let mut nodes = 0;
+        let mut stack = vec![self.inner.root()];
+        while let Some(node) = stack.pop() {
+            nodes += 1;
+            stack.extend(self.children(node));
+        }
+
+        // Map key and value (parent, move, child list) plus the control
+        // byte of the hash table, and the entry in the parent's child list
+        let node_bytes = std::mem::size_of::<uuid::Uuid>()
+            + std::mem::size_of::<Option<uuid::Uuid>>()
+            + std::mem::size_of::<Option<sac::Move>>()
+            + std::mem::size_of::<Vec<uuid::Uuid>>()
+            + 1;
+        let child_bytes = std::mem::size_of::<uuid::Uuid>();
+
+        ffi::TreeMemory {
+            nodes,
+            bytes: std::mem::size_of::<GameTree>()
+                + std::mem::size_of::<sac::Chess>()
+                + nodes * node_bytes
+                + (nodes - 1) * child_bytes,
+        }
+    }
+
+    fn add_node(&mut self, node: ffi::Uuid, m: u16) -> ffi::Uuid {
+        let node: uuid::Uuid = node.into();
+        let pos = self.inner.board_at(node).expect("invalid node in add_node");
+        let m = decode_move(&pos, m).expect("illegal move in add_node");
+
         self.inner
-            .add_node(node.into(), m.inner)
+            .add_node(node, m)
             .expect("invalid node in add_node")
             .into()
     }
 
+    // Appends a line of moves, each one after the node added before it.
+    // Stops at the first move that is not legal and returns the new nodes.
+    fn add_moves(&mut self, node: ffi::Uuid, moves: &[u16]) -> Vec<ffi::Uuid> {
+        let mut node: uuid::Uuid = node.into();
+        let mut pos = self.inner.board_at(node).expect("invalid node in add_moves");
+
+        let mut node_vec = Vec::with_capacity(moves.len());
+        for &bits in moves {
+            let m = match decode_move(&pos, bits) {
+                Some(m) => m,
+                None => break,
+            };
+            node = self
+                .inner
+                .add_node(node, m.clone())
+                .expect("invalid node in add_moves");
+            pos.play_unchecked(&m);
+            node_vec.push(node.into());
+        }
+
+        node_vec
+    }
+
+    // Grafts a subtree below `node`. Parents index into the same slices,
+    // -1 meaning `node`, and always come before their children. Positions
+    // are kept per new node, so nothing is replayed from the root. Stops
+    // at the first move that is not legal.
+    fn add_tree(&mut self, node: ffi::Uuid, parents: &[i32], moves: &[u16]) -> Vec<ffi::Uuid> {
+        let node: uuid::Uuid = node.into();
+        let root_pos = self.inner.board_at(node).expect("invalid node in add_tree");
+
+        let mut node_vec: Vec<uuid::Uuid> = Vec::with_capacity(moves.len());
+        let mut positions: Vec<sac::Chess> = Vec::with_capacity(moves.len());
+        for (&parent, &bits) in parents.iter().zip(moves) {
+            let (parent_node, parent_pos) = match usize::try_from(parent) {
+                Ok(idx) if idx < node_vec.len() => (node_vec[idx], &positions[idx]),
+                Ok(_) => break,
+                Err(_) => (node, &root_pos),
+            };
+            let m = match decode_move(parent_pos, bits) {
+                Some(m) => m,
+                None => break,
+            };
+            let mut pos = parent_pos.clone();
+            pos.play_unchecked(&m);
+
+            let new_node = self
+                .inner
+                .add_node(parent_node, m)
+                .expect("invalid node in add_tree");
+            node_vec.push(new_node);
+            positions.push(pos);
+        }
+
+        node_vec.into_iter().map(Into::into).collect()
+    }
+
     fn pgn(&self) -> String {
         format!("{}", self.inner)
     }
 }
+
+impl GameTree {
+    fn children(&self, node: uuid::Uuid) -> Vec<uuid::Uuid> {
+        match self.inner.mainline(node) {
+            Some(mainline) => {
+                let mut child_vec = vec![mainline];
+                child_vec.extend(
+                    self.inner
+                        .siblings(mainline)
+                        .into_iter()
+                        .filter(|val| *val != mainline),
+                );
+                child_vec
+            }
+            None => Vec::new(),
+        }
+    }
+}
+
+// Positions cross over as FEN, which keeps the tablebase crate free to use
+// another shakmaty release than the game tree.
+struct Tablebase(shakmaty_syzygy::Tablebase<shakmaty::Chess>);
+
+fn tablebase_new() -> Box<Tablebase> {
+    // Tables are mapped on first access, so a full 6-man set costs address
+    // space rather than memory. Safe as long as nobody truncates the files
+    // while they are mapped.
+    let tables = unsafe { shakmaty_syzygy::Tablebase::with_mmap_filesystem() };
+    Box::new(Tablebase(tables))
+}
+
+impl Tablebase {
+    fn add_tablebase_directory(&mut self, path: &str) -> Result<usize, String> {
+        self.0.add_directory(path).map_err(|e| e.to_string())
+    }
+
+    fn tablebase_max_pieces(&self) -> usize {
+        self.0.max_pieces()
+    }
+
+    fn probe_tablebase(&self, fen: &str) -> Result<ffi::TablebaseProbe, String> {
+        use shakmaty::Position;
+
+        let setup: shakmaty::fen::Fen = fen.parse().map_err(|e: shakmaty::fen::ParseFenError| e.to_string())?;
+        let pos: shakmaty::Chess = setup
+            .into_position(shakmaty::CastlingMode::Standard)
+            .map_err(|e| e.to_string())?;
+
+        let wdl = self.wdl(&pos)?;
+        let dtz = self.dtz(&pos);
+
+        let mut move_vec = Vec::new();
+        for m in pos.legal_moves() {
+            let mut child = pos.clone();
+            child.play_unchecked(&m);
+
+            let child_wdl = match self.wdl(&child) {
+                Ok(child_wdl) => child_wdl,
+                Err(_) => continue,
+            };
+            // One more ply to the next zeroing move, unless this move is it
+            let dtz = if m.is_zeroing() {
+                Some((-child_wdl).signum() as i32)
+            } else {
+                self.dtz(&child).map(|child_dtz| -child_dtz - child_dtz.signum())
+            };
+
+            move_vec.push(ffi::TablebaseMove {
+                from: m.from().map(u8::from).unwrap_or(0),
+                to: u8::from(m.to()),
+                promotion: m.promotion().map(|role| role as u8).unwrap_or(0),
+                wdl: -child_wdl,
+                dtz: dtz.unwrap_or(0),
+                has_dtz: dtz.is_some(),
+            });
+        }
+
+        Ok(ffi::TablebaseProbe {
+            wdl,
+            dtz: dtz.unwrap_or(0),
+            has_dtz: dtz.is_some(),
+            moves: move_vec,
+        })
+    }
+}
+
+impl Tablebase {
+    fn wdl(&self, pos: &shakmaty::Chess) -> Result<i8, String> {
+        use shakmaty_syzygy::AmbiguousWdl;
+
+        Ok(match self.0.probe_wdl(pos).map_err(|e| e.to_string())? {
+            AmbiguousWdl::Loss | AmbiguousWdl::MaybeLoss => -2,
+            AmbiguousWdl::BlessedLoss => -1,
+            AmbiguousWdl::Draw => 0,
+            AmbiguousWdl::CursedWin => 1,
+            AmbiguousWdl::Win | AmbiguousWdl::MaybeWin => 2,
+        })
+    }
+
+    fn dtz(&self, pos: &shakmaty::Chess) -> Option<i32> {
+        self.0
+            .probe_dtz(pos)
+            .ok()
+            .map(|dtz| i32::from(dtz.ignore_rounding()))
+    }
+}
@@ -0,0 +1,347 @@
+#include "scheduler.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QThread>
+
+#include <algorithm>
+#include <exception>
+
+using namespace disboard;
+
+namespace {
+    // Set on the scheduler's own workers, so their submissions stay local
+    thread_local const Scheduler *currentScheduler = nullptr;
+    thread_local int currentIndex = -1;
+
+    qint64 microseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    }
+
+    const char *priorityName(int priority) {
+        static const char *names[] = {"interactive", "visible", "background"};
+        return names[priority];
+    }
+}
+
+CancelToken CancelToken::make() {
+    CancelToken token;
+    token.flag = std::make_shared<std::atomic<bool>>(false);
+    return token;
+}
+
+void Scheduler::Samples::add(qint64 us) {
+    std::lock_guard lock(mutex);
+    if (values.size() < capacity) {
+        values.push_back(us);
+    } else {
+        values[next] = us;
+    }
+    next = (next + 1) % capacity;
+}
+
+std::array<double, 3> Scheduler::Samples::percentiles() const {
+    std::vector<qint64> sorted;
+    {
+        std::lock_guard lock(mutex);
+        sorted = values;
+    }
+    if (sorted.empty()) return {};
+    std::sort(sorted.begin(), sorted.end());
+
+    auto at = [&](double fraction) {
+        auto idx = std::min(sorted.size() - 1, static_cast<size_t>(fraction * static_cast<double>(sorted.size())));
+        return static_cast<double>(sorted[idx]) / 1000.0;
+    };
+    return {at(0.5), at(0.95), at(0.99)};
+}
+
+QString SchedulerStats::toString() const {
+    QString text = QStringLiteral("%1 threads").arg(threads);
+    for (int priority = 0; priority < priorityCount; priority += 1) {
+        const auto &c = classes[priority];
+        text += QStringLiteral(" | %1: %2 queued, %3 running, %4 done, %5 cancelled, "
+                               "wait %6/%7/%8 ms, run %9/%10/%11 ms")
+                .arg(QLatin1String(priorityName(priority)))
+                .arg(c.queued).arg(c.running).arg(c.completed).arg(c.cancelled)
+                .arg(c.waitP50, 0, 'f', 2).arg(c.waitP95, 0, 'f', 2).arg(c.waitP99, 0, 'f', 2)
+                .arg(c.runP50, 0, 'f', 2).arg(c.runP95, 0, 'f', 2).arg(c.runP99, 0, 'f', 2);
+    }
+    text += QStringLiteral(" | delivery: %1 pending, %2/%3/%4 ms")
+            .arg(pendingDeliveries)
+            .arg(deliveryP50, 0, 'f', 2).arg(deliveryP95, 0, 'f', 2).arg(deliveryP99, 0, 'f', 2);
+    return text;
+}
+
+Scheduler::Scheduler(int threads) {
+    auto count = threads > 0 ? threads : std::max(2, QThread::idealThreadCount());
+    // One worker is always left to the interactive and visible classes
+    backgroundLimit = std::max(1, count - 1);
+
+    for (int idx = 0; idx < count; idx += 1) local.push_back(std::make_unique<Queues>());
+    workers.reserve(count);
+    for (int idx = 0; idx < count; idx += 1) {
+        workers.emplace_back([this, idx]() { work(idx); });
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    // Jobs still queued are dropped, running ones finish first
+    for (auto &worker: workers) worker.join();
+}
+
+Scheduler &Scheduler::instance() {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+void Scheduler::submit(Priority priority, Job job, CancelToken token) {
+    auto &state = classes[static_cast<int>(priority)];
+    state.submitted.fetch_add(1, std::memory_order_relaxed);
+    state.queued.fetch_add(1);
+
+    Task task{std::move(job), std::move(token), priority, Clock::now()};
+    auto &queues = currentScheduler == this ? *local[currentIndex] : shared;
+    {
+        std::lock_guard lock(queues.mutex);
+        queues.tasks[static_cast<int>(priority)].push_back(std::move(task));
+    }
+
+    // Taking the lock orders this against a worker about to sleep
+    { std::lock_guard lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool Scheduler::help() {
+    return runOne(currentScheduler == this ? currentIndex : -1, true);
+}
+
+void Scheduler::work(int index) {
+    currentScheduler = this;
+    currentIndex = index;
+
+    for (;;) {
+        if (runOne(index, false)) continue;
+
+        std::unique_lock lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || runnable(); });
+        if (stopping) return;
+    }
+}
+
+bool Scheduler::runnable() const {
+    const auto &background = classes[static_cast<int>(Priority::Background)];
+    return classes[static_cast<int>(Priority::Interactive)].queued.load() > 0 ||
+           classes[static_cast<int>(Priority::Visible)].queued.load() > 0 ||
+           (background.queued.load() > 0 && background.running.load() < backgroundLimit);
+}
+
+bool Scheduler::runOne(int index, bool helping) {
+    for (int priority = 0; priority < priorityCount; priority += 1) {
+        auto &state = classes[priority];
+        if (state.queued.load(std::memory_order_relaxed) == 0) continue;
+
+        // The slot is claimed before looking for a task, so two workers
+        // cannot both squeeze past the background limit
+        auto limited = priority == static_cast<int>(Priority::Background) && !helping;
+        auto running = state.running.load();
+        bool claimed = false;
+        while (!limited || running < backgroundLimit) {
+            if (state.running.compare_exchange_weak(running, running + 1)) {
+                claimed = true;
+                break;
+            }
+        }
+        if (!claimed) continue;
+
+        auto task = take(index, static_cast<Priority>(priority));
+        if (!task.has_value()) {
+            state.running.fetch_sub(1);
+            continue;
+        }
+        execute(*task);
+        return true;
+    }
+    return false;
+}
+
+std::optional<Scheduler::Task> Scheduler::take(int index, Priority priority) {
+    auto idx = static_cast<int>(priority);
+    auto pop = [&](Queues &queues, bool newest) -> std::optional<Task> {
+        std::lock_guard lock(queues.mutex);
+        auto &tasks = queues.tasks[idx];
+        if (tasks.empty()) return {};
+        std::optional<Task> task;
+        if (newest) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        classes[idx].queued.fetch_sub(1);
+        return task;
+    };
+
+    if (index >= 0) {
+        if (auto task = pop(*local[index], true)) return task;
+    }
+    if (auto task = pop(shared, false)) return task;
+
+    auto count = static_cast<int>(local.size());
+    for (int offset = 1; offset <= count; offset += 1) {
+        auto victim = (std::max(index, 0) + offset) % count;
+        if (victim == index) continue;
+        if (auto task = pop(*local[victim], false)) return task;
+    }
+    return {};
+}
+
+void Scheduler::execute(Task &task) {
+    auto &state = classes[static_cast<int>(task.priority)];
+    auto start = Clock::now();
+    state.wait.add(microseconds(start - task.queued));
+
+    if (task.token.cancelled()) {
+        state.cancelled.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        try {
+            task.job();
+        } catch (const std::exception &e) {
+            qWarning() << "Scheduler job failed:" << e.what();
+        }
+        state.run.add(microseconds(Clock::now() - start));
+        state.completed.fetch_add(1, std::memory_order_relaxed);
+    }
+    state.running.fetch_sub(1);
+
+    // A background slot came free, a sleeping worker may want it
+    if (task.priority == Priority::Background) {
+        { std::lock_guard lock(sleepMutex); }
+        wake.notify_one();
+    }
+}
+
+void Scheduler::deliver(QObject *context, Job callback, CancelToken token) {
+    deliver(context, context != nullptr, std::move(callback), std::move(token));
+}
+
+void Scheduler::deliver(QPointer<QObject> context, bool hasContext, Job callback, CancelToken token) {
+    {
+        std::lock_guard lock(deliveryMutex);
+        deliveries.push_back({std::move(context), hasContext, std::move(callback), std::move(token), Clock::now()});
+        if (drainPosted) return;
+        drainPosted = true;
+    }
+    postDrain();
+}
+
+void Scheduler::setDeliveryBudget(std::chrono::microseconds budget) {
+    deliveryBudgetUs = budget.count();
+}
+
+void Scheduler::postDrain() {
+    auto app = QCoreApplication::instance();
+    if (!app) {
+        std::lock_guard lock(deliveryMutex);
+        deliveries.clear();
+        drainPosted = false;
+        return;
+    }
+    // Queued behind whatever input and paint events are already waiting
+    QMetaObject::invokeMethod(app, [this]() { drain(); }, Qt::QueuedConnection);
+}
+
+void Scheduler::drain() {
+    auto start = Clock::now();
+    for (;;) {
+        Delivery delivery;
+        {
+            std::lock_guard lock(deliveryMutex);
+            if (deliveries.empty()) {
+                drainPosted = false;
+                return;
+            }
+            if (microseconds(Clock::now() - start) >= deliveryBudgetUs.load()) break;
+            delivery = std::move(deliveries.front());
+            deliveries.pop_front();
+        }
+
+        deliveryLatency.add(microseconds(Clock::now() - delivery.queued));
+        if (delivery.token.cancelled() || (delivery.hasContext && !delivery.context)) continue;
+        delivery.callback();
+    }
+    // Over budget, the rest waits for the next pass of the event loop
+    postDrain();
+}
+
+SchedulerStats Scheduler::stats() const {
+    SchedulerStats stats;
+    stats.threads = threadCount();
+    for (int priority = 0; priority < priorityCount; priority += 1) {
+        const auto &state = classes[priority];
+        auto &out = stats.classes[priority];
+        out.queued = state.queued.load();
+        out.running = state.running.load();
+        out.submitted = state.submitted.load();
+        out.completed = state.completed.load();
+        out.cancelled = state.cancelled.load();
+        auto wait = state.wait.percentiles();
+        out.waitP50 = wait[0], out.waitP95 = wait[1], out.waitP99 = wait[2];
+        auto run = state.run.percentiles();
+        out.runP50 = run[0], out.runP95 = run[1], out.runP99 = run[2];
+    }
+    {
+        std::lock_guard lock(deliveryMutex);
+        stats.pendingDeliveries = static_cast<int>(deliveries.size());
+    }
+    auto delivery = deliveryLatency.percentiles();
+    stats.deliveryP50 = delivery[0], stats.deliveryP95 = delivery[1], stats.deliveryP99 = delivery[2];
+    return stats;
+}
+
+TaskGroup::TaskGroup(Priority priority, CancelToken token, Scheduler &scheduler)
+        : scheduler(scheduler), priority(priority), cancelToken(std::move(token)),
+          state(std::make_shared<State>()) {}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(Scheduler::Job job) {
+    {
+        std::lock_guard lock(state->mutex);
+        state->pending += 1;
+    }
+    // Not passed as the job's token: a skipped job must still count down
+    scheduler.submit(priority, [state = state, token = cancelToken, job = std::move(job)]() {
+        struct CountDown {
+            State &state;
+
+            ~CountDown() {
+                std::lock_guard lock(state.mutex);
+                if (--state.pending == 0) state.done.notify_all();
+            }
+        } countDown{*state};
+        if (!token.cancelled()) job();
+    });
+}
+
+void TaskGroup::wait() {
+    for (;;) {
+        {
+            std::lock_guard lock(state->mutex);
+            if (state->pending == 0) return;
+        }
+        if (scheduler.help()) continue;
+
+        // Nothing left to help with, the rest is running elsewhere
+        std::unique_lock lock(state->mutex);
+        state->done.wait_for(lock, std::chrono::milliseconds(1), [this]() { return state->pending == 0; });
+    }
+}
@@ -0,0 +1,229 @@
+#ifndef DISBOARD_SCHEDULER_H
+#define DISBOARD_SCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace disboard {
+    enum class Priority {
+        // Answers the user is waiting on right now: probes, hints
+        Interactive,
+        // Fills something on screen: searches, thumbnails
+        Visible,
+        // Nobody is looking: imports, indexing, autosave
+        Background,
+    };
+
+    constexpr int priorityCount = 3;
+
+    // Shared cancellation flag. Jobs check it between steps, the scheduler
+    // checks it before starting a job and before delivering its result. A
+    // default constructed token is never cancelled.
+    class CancelToken {
+    public:
+        CancelToken() = default;
+
+        [[nodiscard]] static CancelToken make();
+
+        [[nodiscard]] bool cancelled() const {
+            return flag && flag->load(std::memory_order_relaxed);
+        }
+        void cancel() const {
+            if (flag) flag->store(true, std::memory_order_relaxed);
+        }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
+    };
+
+    struct SchedulerClassStats {
+        int queued = 0;
+        int running = 0;
+        qint64 submitted = 0;
+        qint64 completed = 0;
+        qint64 cancelled = 0;
+        // Milliseconds from submission to start, and of running, over the
+        // last samples of the class
+        double waitP50 = 0, waitP95 = 0, waitP99 = 0;
+        double runP50 = 0, runP95 = 0, runP99 = 0;
+    };
+
+    struct SchedulerStats {
+        int threads = 0;
+        std::array<SchedulerClassStats, priorityCount> classes;
+        int pendingDeliveries = 0;
+        // Milliseconds from deliver() to the callback on the GUI thread
+        double deliveryP50 = 0, deliveryP95 = 0, deliveryP99 = 0;
+
+        [[nodiscard]] QString toString() const;
+    };
+
+    // One pool of workers for all background work of the library. Every
+    // worker has a deque per priority: jobs submitted from a worker go to
+    // its own deque and are taken newest first, idle workers steal the
+    // oldest ones from the others, and jobs from other threads go through a
+    // shared queue. Higher classes are always looked at first, and
+    // background jobs never hold the last worker, so interactive work finds
+    // a free thread however much background work is queued.
+    class Scheduler {
+    public:
+        using Job = std::function<void()>;
+
+        // 0 uses one thread per core, at least two
+        explicit Scheduler(int threads = 0);
+        ~Scheduler();
+        Scheduler(const Scheduler &) = delete;
+        Scheduler &operator=(const Scheduler &) = delete;
+
+        [[nodiscard]] static Scheduler &instance();
+
+        [[nodiscard]] int threadCount() const { return static_cast<int>(workers.size()); }
+
+        // Skipped without running when `token` is cancelled before it starts
+        void submit(Priority priority, Job job, CancelToken token = {});
+
+        // Queues `callback` for the GUI thread. Callbacks run in order,
+        // as many per event loop pass as fit the delivery budget; the rest
+        // wait for the next pass. Dropped when `context` is gone or `token`
+        // cancelled by then.
+        void deliver(QObject *context, Job callback, CancelToken token = {});
+
+        // `work` on a worker, then `done(result)` on the GUI thread
+        template<typename Work, typename Done>
+        void run(Priority priority, QObject *context, Work work, Done done, CancelToken token = {}) {
+            // Whether there was a context is settled here: by the time the
+            // work is done the pointer may have gone null already
+            submit(priority, [this, context = QPointer<QObject>(context), hasContext = context != nullptr,
+                              work, done, token]() {
+                auto result = std::make_shared<decltype(work())>(work());
+                deliver(context, hasContext, [done, result]() { done(std::move(*result)); }, token);
+            }, token);
+        }
+
+        void setDeliveryBudget(std::chrono::microseconds budget);
+
+        // Runs one queued job on the calling thread if there is one. For
+        // threads waiting on other jobs, which would otherwise deadlock a
+        // full pool; they may take background jobs beyond the limit since
+        // their own slot is taken already.
+        bool help();
+
+        [[nodiscard]] SchedulerStats stats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Task {
+            Job job;
+            CancelToken token;
+            Priority priority;
+            Clock::time_point queued;
+        };
+
+        struct Queues {
+            std::mutex mutex;
+            std::array<std::deque<Task>, priorityCount> tasks;
+        };
+
+        // Last samples of one latency, in microseconds
+        class Samples {
+        public:
+            void add(qint64 us);
+            [[nodiscard]] std::array<double, 3> percentiles() const;
+
+        private:
+            static constexpr size_t capacity = 1024;
+            mutable std::mutex mutex;
+            std::vector<qint64> values;
+            size_t next = 0;
+        };
+
+        struct ClassState {
+            std::atomic<int> queued{0};
+            std::atomic<int> running{0};
+            std::atomic<qint64> submitted{0};
+            std::atomic<qint64> completed{0};
+            std::atomic<qint64> cancelled{0};
+            Samples wait;
+            Samples run;
+        };
+
+        struct Delivery {
+            QPointer<QObject> context;
+            bool hasContext;
+            Job callback;
+            CancelToken token;
+            Clock::time_point queued;
+        };
+
+        std::vector<std::unique_ptr<Queues>> local;
+        Queues shared;
+        std::array<ClassState, priorityCount> classes;
+        int backgroundLimit;
+
+        std::vector<std::thread> workers;
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        mutable std::mutex deliveryMutex;
+        std::deque<Delivery> deliveries;
+        bool drainPosted = false;
+        std::atomic<qint64> deliveryBudgetUs{4000};
+        Samples deliveryLatency;
+
+        void work(int index);
+        [[nodiscard]] bool runnable() const;
+        bool runOne(int index, bool helping);
+        std::optional<Task> take(int index, Priority priority);
+        void execute(Task &task);
+        void deliver(QPointer<QObject> context, bool hasContext, Job callback, CancelToken token);
+        void postDrain();
+        void drain();
+    };
+
+    // Jobs that are waited for together, e.g. the shards of one build. The
+    // waiting thread runs queued jobs meanwhile, so groups nest inside
+    // scheduler jobs without tying up the pool.
+    class TaskGroup {
+    public:
+        explicit TaskGroup(Priority priority, CancelToken token = {},
+                           Scheduler &scheduler = Scheduler::instance());
+        ~TaskGroup();
+        TaskGroup(const TaskGroup &) = delete;
+        TaskGroup &operator=(const TaskGroup &) = delete;
+
+        void run(Scheduler::Job job);
+        void wait();
+
+        [[nodiscard]] const CancelToken &token() const { return cancelToken; }
+
+    private:
+        struct State {
+            std::mutex mutex;
+            std::condition_variable done;
+            int pending = 0;
+        };
+
+        Scheduler &scheduler;
+        Priority priority;
+        CancelToken cancelToken;
+        std::shared_ptr<State> state;
+    };
+}
+
+
+#endif //DISBOARD_SCHEDULER_H
@@ -0,0 +1,262 @@
+#include "selfplay.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+
+using namespace disboard;
+
+namespace {
+    constexpr int mateScore = 1000000;
+    constexpr int pieceValues[] = {0, 100, 320, 330, 500, 900, 0};
+
+    int material(const Position &position, Color color) {
+        int total = 0;
+        for (uint8_t role = 1; role <= 5; role += 1) {
+            total += pieceValues[role] * bitboard::count(position.pieces(color, static_cast<Role>(role)));
+        }
+        return total;
+    }
+
+    Color opponent(Color color) {
+        return color == Color::White ? Color::Black : Color::White;
+    }
+
+    // Material balance for the side to move
+    int evaluate(const Position &position) {
+        return material(position, position.turn()) - material(position, opponent(position.turn()));
+    }
+
+    // Captures first, they settle most cutoffs
+    MoveList ordered(const Position &position) {
+        auto moves = position.legalMoves();
+        MoveList list;
+        for (auto m: moves) {
+            if (position.isCapture(m) || m.isPromotion()) list.push(m);
+        }
+        for (auto m: moves) {
+            if (!position.isCapture(m) && !m.isPromotion()) list.push(m);
+        }
+        return list;
+    }
+
+    int search(const Position &position, int depth, int alpha, int beta, int ply) {
+        auto moves = ordered(position);
+        if (moves.empty()) return position.isCheck() ? -mateScore + ply : 0;
+        if (depth == 0) return evaluate(position);
+
+        for (auto m: moves) {
+            auto child = position;
+            child.play(m);
+            auto score = -search(child, depth - 1, -beta, -alpha, ply + 1);
+            if (score >= beta) return score;
+            alpha = std::max(alpha, score);
+        }
+        return alpha;
+    }
+
+    void putVarint(QByteArray &out, uint32_t value) {
+        while (value >= 0x80) {
+            out.append(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.append(static_cast<char>(value));
+    }
+}
+
+PgnGame SelfPlayGame::toPgnGame(const SelfPlayOptions &options) const {
+    PgnGame game;
+    game.start = tree.initialPosition();
+    game.result = result.toStdString();
+
+    auto policy = SelfPlay::policyName(options.policy).toStdString();
+    game.tags = {
+            {"Event", "Self-play"},
+            {"Site", "?"},
+            {"Date", "????.??.??"},
+            {"Round", std::to_string(index + 1)},
+            {"White", policy},
+            {"Black", policy},
+            {"Result", game.result},
+            {"Termination", termination.toStdString()},
+    };
+
+    // Read back from the tree rather than from `moves`, which is what
+    // makes the export cover the tree too
+    for (const auto &entry: tree.nodes()) {
+        game.nodes.push_back({entry.parent, entry.move, {}, {}});
+    }
+    return game;
+}
+
+QByteArray SelfPlayGame::toBinary() const {
+    QByteArray bytes;
+    bytes.reserve(4 + moves.count() * 2);
+    putVarint(bytes, static_cast<uint32_t>(moves.count()));
+
+    char code = 0;
+    if (result == QStringLiteral("1-0")) code = 1;
+    else if (result == QStringLiteral("0-1")) code = 2;
+    else if (result == QStringLiteral("1/2-1/2")) code = 3;
+    bytes.append(code);
+
+    for (auto m: moves) {
+        bytes.append(static_cast<char>(m.toBits() & 0xff));
+        bytes.append(static_cast<char>(m.toBits() >> 8));
+    }
+    return bytes;
+}
+
+double SelfPlayReport::gamesPerSecond() const {
+    return elapsedNs > 0 ? static_cast<double>(games) * 1e9 / static_cast<double>(elapsedNs) : 0;
+}
+
+double SelfPlayReport::movesPerSecond() const {
+    return elapsedNs > 0 ? static_cast<double>(moves) * 1e9 / static_cast<double>(elapsedNs) : 0;
+}
+
+SelfPlay::SelfPlay(SelfPlayOptions options) : options(std::move(options)) {}
+
+SelfPlayReport SelfPlay::run(const std::function<void(SelfPlayGame &&)> &onFinished) const {
+    QElapsedTimer timer;
+    timer.start();
+
+    SelfPlayReport report;
+    report.threads = options.threads > 0 ? options.threads : std::max(1, QThread::idealThreadCount());
+
+    std::atomic<int> next{0};
+    std::atomic<qint64> moves{0};
+    std::mutex finishedMutex;
+    auto work = [&]() {
+        for (auto idx = next.fetch_add(1); idx < options.games; idx = next.fetch_add(1)) {
+            auto game = play(idx);
+            moves += game.moves.count();
+
+            std::lock_guard lock(finishedMutex);
+            report.games += 1;
+            onFinished(std::move(game));
+        }
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(report.threads);
+    for (int idx = 0; idx < report.threads; idx += 1) {
+        pool.start(work);
+    }
+    pool.waitForDone();
+
+    report.moves = moves;
+    report.elapsedNs = timer.nsecsElapsed();
+    return report;
+}
+
+SelfPlayGame SelfPlay::play(int index) const {
+    std::mt19937_64 rng(options.seed * 0x9e3779b97f4a7c15ull + static_cast<uint64_t>(index));
+
+    SelfPlayGame game{index, Disboard(), {}, QStringLiteral("*"), {}};
+    auto node = game.tree.root();
+    auto position = game.tree.initialPosition();
+    QHash<uint64_t, int> seen;
+    seen[position.hash()] += 1;
+
+    auto advance = [&](Move m) {
+        node = game.tree.addNode(node, m);
+        position.play(m);
+        game.moves.push_back(m);
+        seen[position.hash()] += 1;
+    };
+
+    if (!options.openings.empty() && options.openingPlies > 0) {
+        const auto &opening = options.openings[static_cast<qsizetype>(rng() % options.openings.count())];
+        for (qsizetype ply = 0; ply < std::min<qsizetype>(opening.count(), options.openingPlies); ply += 1) {
+            if (!position.isLegal(opening[ply])) break;
+            advance(opening[ply]);
+        }
+    }
+
+    for (;;) {
+        if (position.legalMoves().empty()) {
+            if (position.isCheck()) {
+                game.result = position.turn() == Color::White ? QStringLiteral("0-1") : QStringLiteral("1-0");
+                game.termination = QStringLiteral("checkmate");
+            } else {
+                game.result = QStringLiteral("1/2-1/2");
+                game.termination = QStringLiteral("stalemate");
+            }
+            break;
+        }
+        if (position.halfmoves() >= 100) {
+            game.result = QStringLiteral("1/2-1/2");
+            game.termination = QStringLiteral("fifty-move rule");
+            break;
+        }
+        if (seen.value(position.hash()) >= 3) {
+            game.result = QStringLiteral("1/2-1/2");
+            game.termination = QStringLiteral("threefold repetition");
+            break;
+        }
+        if (position.isInsufficientMaterial()) {
+            game.result = QStringLiteral("1/2-1/2");
+            game.termination = QStringLiteral("insufficient material");
+            break;
+        }
+        if (game.moves.count() >= options.maxPlies) {
+            game.termination = QStringLiteral("ply limit");
+            break;
+        }
+
+        advance(*choose(position, rng));
+    }
+    return game;
+}
+
+std::optional<Move> SelfPlay::choose(const Position &position, std::mt19937_64 &rng) const {
+    auto moves = ordered(position);
+    if (moves.empty()) return {};
+
+    // Every policy scores the moves and picks among the best at random
+    QVector<Move> best;
+    auto bestScore = std::numeric_limits<int>::min();
+    for (auto m: moves) {
+        int score = 0;
+        if (options.policy != SelfPlayOptions::Policy::Random) {
+            auto child = position;
+            child.play(m);
+            if (options.policy == SelfPlayOptions::Policy::Greedy) {
+                score = -evaluate(child);
+            } else {
+                // Scores below the best so far only need to be bounded
+                auto alpha = bestScore == std::numeric_limits<int>::min() ? -mateScore - 1 : bestScore - 1;
+                score = -search(child, std::max(options.searchDepth - 1, 0), -mateScore - 1, -alpha, 1);
+            }
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            best.clear();
+        }
+        if (score == bestScore) best.push_back(m);
+    }
+    return best[static_cast<qsizetype>(rng() % best.count())];
+}
+
+QByteArray SelfPlay::binaryHeader() {
+    return QByteArrayLiteral("DSBG\x01");
+}
+
+QString SelfPlay::policyName(SelfPlayOptions::Policy policy) {
+    switch (policy) {
+        case SelfPlayOptions::Policy::Random:
+            return QStringLiteral("random");
+        case SelfPlayOptions::Policy::Greedy:
+            return QStringLiteral("greedy");
+        case SelfPlayOptions::Policy::Search:
+            return QStringLiteral("search");
+    }
+    return {};
+}
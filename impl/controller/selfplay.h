@@ -0,0 +1,96 @@
+#ifndef DISBOARD_SELFPLAY_H
+#define DISBOARD_SELFPLAY_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <optional>
+#include <random>
+
+#include "disboard.h"
+#include "pgn.h"
+
+namespace disboard {
+    struct SelfPlayOptions {
+        enum class Policy {
+            Random,
+            // Takes the most material right away, ties broken at random
+            Greedy,
+            // Material alpha-beta to `searchDepth` plies
+            Search,
+        };
+
+        Policy policy = Policy::Random;
+        int searchDepth = 2;
+
+        int games = 100;
+        // 0 uses one thread per core
+        int threads = 0;
+        // Games still going after this many plies end unfinished
+        int maxPlies = 400;
+        // Each game plays from its own generator seeded with seed + index,
+        // so a run is reproducible regardless of the thread count
+        uint64_t seed = 0;
+
+        // Mainlines of the seed collection. Each game starts with the first
+        // `openingPlies` moves of a random one, when there are any.
+        QVector<QVector<Move>> openings;
+        int openingPlies = 8;
+    };
+
+    struct SelfPlayGame {
+        int index;
+        Disboard tree;
+        QVector<Move> moves;
+        // PGN result token
+        QString result;
+        QString termination;
+
+        // The tree as a parsed game, tagged for export
+        [[nodiscard]] PgnGame toPgnGame(const SelfPlayOptions &options) const;
+        // Ply count, result code (0 unfinished, 1 white, 2 black, 3 draw)
+        // and the packed moves, see SelfPlay::binaryHeader()
+        [[nodiscard]] QByteArray toBinary() const;
+    };
+
+    struct SelfPlayReport {
+        int games = 0;
+        qint64 moves = 0;
+        int threads = 0;
+        qint64 elapsedNs = 0;
+
+        [[nodiscard]] double gamesPerSecond() const;
+        [[nodiscard]] double movesPerSecond() const;
+    };
+
+    // Plays games on a private thread pool, one game per thread at a time.
+    // Moves go through the Rust tree one node at a time, so a run doubles
+    // as a stress test of the tree and the native move generator.
+    class SelfPlay {
+    public:
+        explicit SelfPlay(SelfPlayOptions options);
+
+        // Called for every finished game, from the worker that played it
+        // but never concurrently. Blocks until all games are played.
+        SelfPlayReport run(const std::function<void(SelfPlayGame &&)> &onFinished) const;
+
+        [[nodiscard]] SelfPlayGame play(int index) const;
+
+        // Starts a binary stream: magic and version, then one record per
+        // game as a varint ply count, a result byte and 16-bit moves from
+        // the standard position, all little endian
+        [[nodiscard]] static QByteArray binaryHeader();
+
+        [[nodiscard]] static QString policyName(SelfPlayOptions::Policy policy);
+
+    private:
+        SelfPlayOptions options;
+
+        [[nodiscard]] std::optional<Move> choose(const Position &position, std::mt19937_64 &rng) const;
+    };
+}
+
+
+#endif //DISBOARD_SELFPLAY_H
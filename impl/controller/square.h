@@ -1,11 +1,12 @@
 #ifndef DISBOARD_SQUARE_H
 #define DISBOARD_SQUARE_H
 
-#include "librustdisboard/lib.h"
-
 #include <QObject>
 #include <QtQml/qqmlregistration.h>
 
+#include <cstdint>
+#include <type_traits>
+
 namespace disboard {
     class Square {
     Q_GADGET
@@ -14,24 +15,28 @@ namespace disboard {
         Q_PROPERTY(uint8_t file READ file)
         Q_PROPERTY(uint8_t rank READ rank)
     public:
-        Square();
-        Square(uint8_t file, uint8_t rank);
+        constexpr Square() : mIndex(0) {}
+        constexpr Square(uint8_t file, uint8_t rank)
+                : mIndex(static_cast<uint8_t>((rank << 3) | file)) {}
 
-        [[nodiscard]] uint8_t index() const;
-        [[nodiscard]] uint8_t file() const;
-        [[nodiscard]] uint8_t rank() const;
+        [[nodiscard]] static constexpr Square fromIndex(uint8_t index) {
+            Square square;
+            square.mIndex = index;
+            return square;
+        }
 
-        bool operator==(Square &rhs);
+        [[nodiscard]] constexpr uint8_t index() const { return mIndex; }
+        [[nodiscard]] constexpr uint8_t file() const { return mIndex & 7; }
+        [[nodiscard]] constexpr uint8_t rank() const { return mIndex >> 3; }
 
-        friend class Disboard;
-        friend class Move;
+        constexpr bool operator==(Square rhs) const { return mIndex == rhs.mIndex; }
+        constexpr bool operator!=(Square rhs) const { return mIndex != rhs.mIndex; }
 
     private:
-        explicit Square(librustdisboard::Square square)
-                : impl(square) {}
-
-        librustdisboard::Square impl;
+        uint8_t mIndex;
     };
+
+    static_assert(std::is_trivially_copyable_v<Square>);
 }
 
 
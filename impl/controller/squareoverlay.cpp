@@ -0,0 +1,160 @@
+#include "squareoverlay.h"
+
+#include <QPainter>
+
+using disboard::SquareSet;
+
+SquareOverlay::SquareOverlay(QQuickItem *parent)
+        : QQuickPaintedItem(parent) {
+    setAntialiasing(true);
+}
+
+void SquareOverlay::paint(QPainter *painter) {
+    if (mSquares.empty() || mPieceSize <= 0) return;
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    auto size = static_cast<qreal>(mPieceSize);
+    auto bb = mSquares.bits();
+    while (bb) {
+        auto square = disboard::bitboard::popLsb(bb);
+        QRectF rect(square.file() * size, (7 - square.rank()) * size, size, size);
+        auto color = colorAt(square);
+
+        switch (mShape) {
+            case Shape::Fill:
+                painter->fillRect(rect, color);
+                break;
+            case Shape::Dot:
+                painter->setPen(Qt::NoPen);
+                painter->setBrush(color);
+                painter->drawEllipse(rect.center(), size / 6, size / 6);
+                break;
+            case Shape::Ring: {
+                // Stroked inside the square, like a Rectangle border
+                auto width = size / 8;
+                painter->setPen(QPen(color, width));
+                painter->setBrush(Qt::NoBrush);
+                painter->drawEllipse(rect.adjusted(width / 2, width / 2, -width / 2, -width / 2));
+                break;
+            }
+        }
+    }
+}
+
+QColor SquareOverlay::colorAt(disboard::Square square) const {
+    if (mWins.contains(square)) return mWinColor;
+    if (mLosses.contains(square)) return mLossColor;
+    if (mDraws.contains(square)) return mDrawColor;
+    return mColor;
+}
+
+SquareSet SquareOverlay::squares() const {
+    return mSquares;
+}
+
+void SquareOverlay::setSquares(SquareSet newValue) {
+    if (mSquares == newValue) return;
+    mSquares = newValue;
+    update();
+    emit squaresChanged();
+}
+
+int SquareOverlay::pieceSize() const {
+    return mPieceSize;
+}
+
+void SquareOverlay::setPieceSize(int newValue) {
+    if (mPieceSize == newValue) return;
+    mPieceSize = newValue;
+    setImplicitSize(newValue * 8, newValue * 8);
+    update();
+    emit pieceSizeChanged();
+}
+
+SquareOverlay::Shape SquareOverlay::shape() const {
+    return mShape;
+}
+
+void SquareOverlay::setShape(Shape newValue) {
+    if (mShape == newValue) return;
+    mShape = newValue;
+    update();
+    emit shapeChanged();
+}
+
+QColor SquareOverlay::color() const {
+    return mColor;
+}
+
+void SquareOverlay::setColor(const QColor &newValue) {
+    if (mColor == newValue) return;
+    mColor = newValue;
+    update();
+    emit colorChanged();
+}
+
+SquareSet SquareOverlay::wins() const {
+    return mWins;
+}
+
+void SquareOverlay::setWins(SquareSet newValue) {
+    if (mWins == newValue) return;
+    mWins = newValue;
+    update();
+    emit outcomesChanged();
+}
+
+SquareSet SquareOverlay::draws() const {
+    return mDraws;
+}
+
+void SquareOverlay::setDraws(SquareSet newValue) {
+    if (mDraws == newValue) return;
+    mDraws = newValue;
+    update();
+    emit outcomesChanged();
+}
+
+SquareSet SquareOverlay::losses() const {
+    return mLosses;
+}
+
+void SquareOverlay::setLosses(SquareSet newValue) {
+    if (mLosses == newValue) return;
+    mLosses = newValue;
+    update();
+    emit outcomesChanged();
+}
+
+QColor SquareOverlay::winColor() const {
+    return mWinColor;
+}
+
+void SquareOverlay::setWinColor(const QColor &newValue) {
+    if (mWinColor == newValue) return;
+    mWinColor = newValue;
+    update();
+    emit outcomesChanged();
+}
+
+QColor SquareOverlay::drawColor() const {
+    return mDrawColor;
+}
+
+void SquareOverlay::setDrawColor(const QColor &newValue) {
+    if (mDrawColor == newValue) return;
+    mDrawColor = newValue;
+    update();
+    emit outcomesChanged();
+}
+
+QColor SquareOverlay::lossColor() const {
+    return mLossColor;
+}
+
+void SquareOverlay::setLossColor(const QColor &newValue) {
+    if (mLossColor == newValue) return;
+    mLossColor = newValue;
+    update();
+    emit outcomesChanged();
+}
@@ -0,0 +1,93 @@
+#ifndef DISBOARD_SQUAREOVERLAY_H
+#define DISBOARD_SQUAREOVERLAY_H
+
+#include <QColor>
+#include <QQuickPaintedItem>
+#include <QtQml/qqmlregistration.h>
+
+#include "squareset.h"
+
+// Paints one shape on every square of a SquareSet, in place of a Repeater
+// of per-square delegates. A changed set costs a repaint of this item and
+// nothing else, whatever the number of squares.
+class SquareOverlay : public QQuickPaintedItem {
+Q_OBJECT
+
+    QML_ELEMENT
+    Q_DISABLE_COPY(SquareOverlay)
+
+    Q_PROPERTY(disboard::SquareSet squares READ squares WRITE setSquares NOTIFY squaresChanged)
+    Q_PROPERTY(int pieceSize READ pieceSize WRITE setPieceSize NOTIFY pieceSizeChanged)
+    Q_PROPERTY(Shape shape READ shape WRITE setShape NOTIFY shapeChanged)
+    Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
+
+    // Squares drawn in winColor, drawColor or lossColor instead of color,
+    // for tablebase results
+    Q_PROPERTY(disboard::SquareSet wins READ wins WRITE setWins NOTIFY outcomesChanged)
+    Q_PROPERTY(disboard::SquareSet draws READ draws WRITE setDraws NOTIFY outcomesChanged)
+    Q_PROPERTY(disboard::SquareSet losses READ losses WRITE setLosses NOTIFY outcomesChanged)
+    Q_PROPERTY(QColor winColor READ winColor WRITE setWinColor NOTIFY outcomesChanged)
+    Q_PROPERTY(QColor drawColor READ drawColor WRITE setDrawColor NOTIFY outcomesChanged)
+    Q_PROPERTY(QColor lossColor READ lossColor WRITE setLossColor NOTIFY outcomesChanged)
+
+public:
+    enum class Shape {
+        Fill,
+        // Dot in the middle, a third of the square
+        Dot,
+        // Ring along the edge, for captures
+        Ring,
+    };
+    Q_ENUM(Shape)
+
+    explicit SquareOverlay(QQuickItem *parent = nullptr);
+
+    void paint(QPainter *painter) override;
+
+    [[nodiscard]] disboard::SquareSet squares() const;
+    void setSquares(disboard::SquareSet newValue);
+    [[nodiscard]] int pieceSize() const;
+    void setPieceSize(int newValue);
+    [[nodiscard]] Shape shape() const;
+    void setShape(Shape newValue);
+    [[nodiscard]] QColor color() const;
+    void setColor(const QColor &newValue);
+
+    [[nodiscard]] disboard::SquareSet wins() const;
+    void setWins(disboard::SquareSet newValue);
+    [[nodiscard]] disboard::SquareSet draws() const;
+    void setDraws(disboard::SquareSet newValue);
+    [[nodiscard]] disboard::SquareSet losses() const;
+    void setLosses(disboard::SquareSet newValue);
+    [[nodiscard]] QColor winColor() const;
+    void setWinColor(const QColor &newValue);
+    [[nodiscard]] QColor drawColor() const;
+    void setDrawColor(const QColor &newValue);
+    [[nodiscard]] QColor lossColor() const;
+    void setLossColor(const QColor &newValue);
+
+signals:
+    void squaresChanged();
+    void pieceSizeChanged();
+    void shapeChanged();
+    void colorChanged();
+    void outcomesChanged();
+
+private:
+    disboard::SquareSet mSquares;
+    int mPieceSize = 0;
+    Shape mShape = Shape::Fill;
+    QColor mColor{Qt::black};
+
+    disboard::SquareSet mWins;
+    disboard::SquareSet mDraws;
+    disboard::SquareSet mLosses;
+    QColor mWinColor{0x15, 0x78, 0x1b};
+    QColor mDrawColor{0x5a, 0x5a, 0x5a};
+    QColor mLossColor{0xb2, 0x22, 0x22};
+
+    [[nodiscard]] QColor colorAt(disboard::Square square) const;
+};
+
+
+#endif //DISBOARD_SQUAREOVERLAY_H
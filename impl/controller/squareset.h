@@ -0,0 +1,51 @@
+#ifndef DISBOARD_SQUARESET_H
+#define DISBOARD_SQUARESET_H
+
+#include <QObject>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+#include <type_traits>
+
+#include "bitboard.h"
+
+namespace disboard {
+    // A set of squares as one 64-bit mask. QML gets it as a value type
+    // instead of a list, so passing it around allocates nothing and it
+    // keeps all 64 bits, which a JS number would not.
+    class SquareSet {
+    Q_GADGET
+        QML_VALUE_TYPE(squareSet)
+        Q_PROPERTY(int count READ count)
+        Q_PROPERTY(bool empty READ empty)
+    public:
+        constexpr SquareSet() : mask(bitboard::Empty) {}
+        constexpr explicit SquareSet(Bitboard mask) : mask(mask) {}
+
+        [[nodiscard]] constexpr Bitboard bits() const { return mask; }
+        [[nodiscard]] int count() const { return bitboard::count(mask); }
+        [[nodiscard]] constexpr bool empty() const { return mask == bitboard::Empty; }
+
+        [[nodiscard]] Q_INVOKABLE bool contains(Square square) const {
+            return bitboard::contains(mask, square);
+        }
+        [[nodiscard]] Q_INVOKABLE QVector<Square> squares() const {
+            QVector<Square> squares;
+            squares.reserve(count());
+            auto bb = mask;
+            while (bb) squares.push_back(bitboard::popLsb(bb));
+            return squares;
+        }
+
+        constexpr bool operator==(SquareSet rhs) const { return mask == rhs.mask; }
+        constexpr bool operator!=(SquareSet rhs) const { return mask != rhs.mask; }
+
+    private:
+        Bitboard mask;
+    };
+
+    static_assert(std::is_trivially_copyable_v<SquareSet>);
+}
+
+
+#endif //DISBOARD_SQUARESET_H
@@ -0,0 +1,167 @@
+#include "tablebase.h"
+
+#include "librustdisboard/lib.h"
+
+#include <QCache>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+using namespace disboard;
+
+namespace {
+    std::optional<int> dtzOf(bool hasDtz, int32_t dtz) {
+        if (!hasDtz) return {};
+        return dtz;
+    }
+
+    TablebaseProbe convert(const Position &position, const librustdisboard::TablebaseProbe &raw) {
+        TablebaseProbe probe;
+        probe.wdl = raw.wdl;
+        probe.dtz = dtzOf(raw.has_dtz, raw.dtz);
+        probe.moves.reserve(static_cast<qsizetype>(raw.moves.size()));
+
+        for (const auto &rawMove: raw.moves) {
+            auto m = position.legalMove(Square::fromIndex(rawMove.from), Square::fromIndex(rawMove.to));
+            if (!m.has_value()) continue;
+            if (rawMove.promotion) m->setPromotion(static_cast<Role>(rawMove.promotion));
+            probe.moves.push_back({*m, rawMove.wdl, dtzOf(rawMove.has_dtz, rawMove.dtz)});
+        }
+        return probe;
+    }
+}
+
+QVector<Move> TablebaseProbe::bestMoves() const {
+    if (moves.empty()) return {};
+
+    auto best = std::max_element(moves.cbegin(), moves.cend(), [](const auto &lhs, const auto &rhs) {
+        return lhs.wdl < rhs.wdl;
+    })->wdl;
+
+    // Winning sides hurry to the next zeroing move, losing sides delay it
+    std::optional<int> bestDtz;
+    if (best != 0) {
+        for (const auto &m: moves) {
+            if (m.wdl != best || !m.dtz.has_value()) continue;
+            if (!bestDtz.has_value() || *m.dtz < *bestDtz) bestDtz = m.dtz;
+        }
+    }
+
+    QVector<Move> result;
+    for (const auto &m: moves) {
+        if (m.wdl != best) continue;
+        if (bestDtz.has_value() && m.dtz != bestDtz) continue;
+        result.push_back(m.move);
+    }
+    return result;
+}
+
+std::optional<int> TablebaseProbe::wdlAfter(Square from, Square to) const {
+    std::optional<int> result;
+    for (const auto &m: moves) {
+        if (m.move.from() != from) continue;
+        if (m.move.to() != to && !(m.move.isCastle() && m.move.castleRookFrom() == to)) continue;
+        // Promotions to different pieces share their squares
+        if (!result.has_value() || m.wdl > *result) result = m.wdl;
+    }
+    return result;
+}
+
+struct Tablebase::State {
+    // Probes share the tables, adding a directory needs them exclusively
+    std::shared_mutex tablesMutex;
+    rust::Box<librustdisboard::Tablebase> tables = librustdisboard::tablebase_new();
+    std::atomic<int> maxPieces = 0;
+
+    std::mutex cacheMutex;
+    QCache<quint64, TablebaseProbe> cache{4096};
+
+    std::optional<TablebaseProbe> cached(uint64_t hash) {
+        std::lock_guard lock(cacheMutex);
+        if (auto probe = cache.object(hash)) return *probe;
+        return {};
+    }
+
+    std::optional<TablebaseProbe> probe(const Position &position) {
+        if (auto probe = cached(position.hash())) return probe;
+
+        std::optional<TablebaseProbe> result;
+        try {
+            std::shared_lock lock(tablesMutex);
+            auto fen = position.fen();
+            result = convert(position, tables->probe_tablebase(rust::Str(fen.data(), fen.size())));
+        } catch (const rust::Error &) {
+            // Missing table, castling rights or an unreadable file
+            return {};
+        }
+
+        std::lock_guard lock(cacheMutex);
+        cache.insert(position.hash(), new TablebaseProbe(*result));
+        return result;
+    }
+};
+
+Tablebase::Tablebase(QObject *context)
+        : state(std::make_shared<State>()), context(context) {}
+
+Tablebase::~Tablebase() = default;
+
+int Tablebase::addDirectory(const QString &path) {
+    auto utf8 = path.toStdString();
+    int found;
+    try {
+        std::unique_lock lock(state->tablesMutex);
+        found = static_cast<int>(state->tables->add_tablebase_directory(rust::Str(utf8.data(), utf8.size())));
+        state->maxPieces = static_cast<int>(state->tables->tablebase_max_pieces());
+    } catch (const rust::Error &) {
+        return -1;
+    }
+
+    std::lock_guard lock(state->cacheMutex);
+    state->cache.clear();
+    return found;
+}
+
+int Tablebase::maxPieces() const {
+    return state->maxPieces;
+}
+
+bool Tablebase::covers(const Position &position) const {
+    return bitboard::count(position.occupied()) <= state->maxPieces;
+}
+
+std::optional<TablebaseProbe> Tablebase::cached(const Position &position) const {
+    return state->cached(position.hash());
+}
+
+std::optional<TablebaseProbe> Tablebase::probe(const Position &position) const {
+    if (!covers(position)) return {};
+    return state->probe(position);
+}
+
+void Tablebase::probeAsync(const Position &position, Probed onProbed, CancelToken token) {
+    auto hash = position.hash();
+    if (!covers(position)) {
+        onProbed(hash, {});
+        return;
+    }
+    if (auto probe = state->cached(hash)) {
+        onProbed(hash, probe);
+        return;
+    }
+
+    // Jobs only hold the shared state, so the tables may go while a probe
+    // is still running
+    Scheduler::instance().run(Priority::Interactive, context, [state = state, position]() {
+        return state->probe(position);
+    }, [onProbed = std::move(onProbed), hash](std::optional<TablebaseProbe> probe) {
+        onProbed(hash, std::move(probe));
+    }, token);
+}
+
+void Tablebase::setCacheLimit(int limit) {
+    std::lock_guard lock(state->cacheMutex);
+    state->cache.setMaxCost(limit);
+}
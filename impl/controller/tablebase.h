@@ -0,0 +1,77 @@
+#ifndef DISBOARD_TABLEBASE_H
+#define DISBOARD_TABLEBASE_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "position.h"
+#include "scheduler.h"
+
+namespace disboard {
+    // WDL runs from -2 (loss) to 2 (win) for the side to move, -1 and 1
+    // being results the 50-move rule turns into a draw.
+    struct TablebaseMove {
+        Move move;
+        int wdl;
+        std::optional<int> dtz;
+    };
+
+    struct TablebaseProbe {
+        int wdl = 0;
+        // Plies to the next capture or pawn move, signed like the WDL.
+        // Missing when the directory only holds WDL tables.
+        std::optional<int> dtz;
+        QVector<TablebaseMove> moves;
+
+        // Moves keeping the best result: the quickest win, the longest
+        // resistance when losing, every move holding a draw
+        [[nodiscard]] QVector<Move> bestMoves() const;
+        // Result for the side to move after the move from `from` to `to`
+        [[nodiscard]] std::optional<int> wdlAfter(Square from, Square to) const;
+    };
+
+    // Syzygy tables in local directories. Files are memory mapped on first
+    // access, so even a full 6-man set only costs address space. Results are
+    // kept in an LRU cache keyed by position hash.
+    class Tablebase {
+    public:
+        // Called on the thread of `context`, nullopt when the position is
+        // not covered or the files are unreadable
+        using Probed = std::function<void(uint64_t hash, std::optional<TablebaseProbe> probe)>;
+
+        explicit Tablebase(QObject *context);
+        ~Tablebase();
+
+        Tablebase(const Tablebase &) = delete;
+        Tablebase &operator=(const Tablebase &) = delete;
+
+        // Returns the number of tables found, -1 if the directory is not
+        // readable. Clears the cache since covered positions may change.
+        int addDirectory(const QString &path);
+        [[nodiscard]] int maxPieces() const;
+        [[nodiscard]] bool covers(const Position &position) const;
+
+        [[nodiscard]] std::optional<TablebaseProbe> cached(const Position &position) const;
+        // Blocks on file I/O, prefer probeAsync() on the GUI thread
+        [[nodiscard]] std::optional<TablebaseProbe> probe(const Position &position) const;
+        // Answers from the cache right away, otherwise probes on a worker
+        // as interactive work. Never answers once `token` is cancelled.
+        void probeAsync(const Position &position, Probed onProbed, CancelToken token = {});
+
+        void setCacheLimit(int limit);
+
+    private:
+        struct State;
+        std::shared_ptr<State> state;
+
+        QObject *context;
+    };
+}
+
+
+#endif //DISBOARD_TABLEBASE_H
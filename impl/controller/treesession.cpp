@@ -0,0 +1,173 @@
+#include "treesession.h"
+
+#include "controller.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QUuid>
+
+#include <algorithm>
+#include <utility>
+
+TreeSession::TreeSession(QObject *parent)
+        : QObject(parent),
+          mDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/trees")) {
+    connect(&checkTimer, &QTimer::timeout, this, &TreeSession::evict);
+    updateCheckInterval();
+}
+
+TreeSession::~TreeSession() {
+    auto left = std::exchange(entries, {});
+    for (const auto &entry: left) {
+        if (entry.controller) {
+            disconnect(entry.controller, nullptr, this, nullptr);
+            entry.controller->setSession(nullptr);
+            // A tree that cannot be read back keeps its file
+            if (!entry.controller->board().restore()) continue;
+        }
+        QFile::remove(entry.file);
+    }
+}
+
+QString TreeSession::directory() const {
+    return mDirectory;
+}
+
+void TreeSession::setDirectory(const QString &newValue) {
+    if (mDirectory == newValue) return;
+    mDirectory = newValue;
+    emit directoryChanged();
+}
+
+int TreeSession::idleTimeout() const {
+    return mIdleTimeout;
+}
+
+void TreeSession::setIdleTimeout(int newValue) {
+    newValue = std::max(newValue, 0);
+    if (mIdleTimeout == newValue) return;
+    mIdleTimeout = newValue;
+    updateCheckInterval();
+    emit idleTimeoutChanged();
+}
+
+int TreeSession::maxResident() const {
+    return mMaxResident;
+}
+
+void TreeSession::setMaxResident(int newValue) {
+    newValue = std::max(newValue, 0);
+    if (mMaxResident == newValue) return;
+    mMaxResident = newValue;
+    emit maxResidentChanged();
+    evict();
+}
+
+int TreeSession::resident() const {
+    return static_cast<int>(std::count_if(entries.cbegin(), entries.cend(), [](const Entry &entry) {
+        return entry.controller && entry.controller->board().resident();
+    }));
+}
+
+int TreeSession::spilled() const {
+    return static_cast<int>(entries.count()) - resident();
+}
+
+qint64 TreeSession::spilledBytes() const {
+    qint64 bytes = 0;
+    for (const auto &entry: entries) {
+        if (entry.controller) bytes += entry.controller->board().spilledBytes();
+    }
+    return bytes;
+}
+
+void TreeSession::add(Controller *controller) {
+    if (!controller) return;
+    for (const auto &entry: entries) {
+        if (entry.controller == controller) return;
+    }
+    entries.push_back({controller, QDateTime::currentMSecsSinceEpoch(), {}});
+
+    // Navigation and edits count as use, and fault the tree back in anyway
+    auto used = [this, controller]() { touch(controller); };
+    connect(controller, &Controller::curNodeChanged, this, used);
+    connect(controller, &Controller::treeChanged, this, used);
+    connect(controller, &Controller::rootChanged, this, used);
+    connect(controller, &QObject::destroyed, this, [this, controller]() { remove(controller); });
+    emit countersChanged();
+}
+
+void TreeSession::remove(Controller *controller) {
+    disconnect(controller, nullptr, this, nullptr);
+    auto it = std::stable_partition(entries.begin(), entries.end(), [controller](const Entry &entry) {
+        return !entry.controller.isNull() && entry.controller != controller;
+    });
+    if (it == entries.end()) return;
+
+    QStringList lost;
+    for (auto left = it; left != entries.end(); ++left) {
+        // Nothing reads a spilled tree back in once it has left
+        if (left->controller && !left->controller->board().restore()) {
+            lost.push_back(left->file);
+            continue;
+        }
+        QFile::remove(left->file);
+    }
+    entries.erase(it, entries.end());
+    emit countersChanged();
+    for (const auto &file: lost) emit treeLost(file);
+}
+
+void TreeSession::evict() {
+    auto now = QDateTime::currentMSecsSinceEpoch();
+    bool changed = false;
+
+    // Most recently used first, anything past the limit goes
+    std::sort(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs) {
+        return lhs.lastUsed > rhs.lastUsed;
+    });
+    int kept = 0;
+    for (auto &entry: entries) {
+        if (!entry.controller || !entry.controller->board().resident()) continue;
+        bool idle = mIdleTimeout > 0 && now - entry.lastUsed >= mIdleTimeout;
+        bool over = mMaxResident > 0 && kept >= mMaxResident;
+        if ((idle || over) && spill(entry)) {
+            changed = true;
+        } else {
+            kept += 1;
+        }
+    }
+
+    if (changed) emit countersChanged();
+}
+
+void TreeSession::touch(Controller *controller) {
+    auto now = QDateTime::currentMSecsSinceEpoch();
+    for (auto &entry: entries) {
+        if (entry.controller != controller) continue;
+        entry.lastUsed = now;
+    }
+    emit countersChanged();
+    if (mMaxResident > 0 && resident() > mMaxResident) evict();
+}
+
+bool TreeSession::spill(Entry &entry) {
+    if (!QDir().mkpath(mDirectory)) return false;
+
+    auto path = QDir(mDirectory).filePath(QUuid::createUuid().toString(QUuid::WithoutBraces) + QStringLiteral(".tree"));
+    if (!entry.controller->spillTree(path)) return false;
+    entry.file = path;
+    return true;
+}
+
+void TreeSession::updateCheckInterval() {
+    // A tree may stay resident up to a quarter timeout past its limit
+    if (mIdleTimeout > 0) {
+        checkTimer.start(std::max(mIdleTimeout / 4, 1000));
+    } else {
+        checkTimer.stop();
+    }
+}
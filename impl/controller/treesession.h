@@ -0,0 +1,84 @@
+#ifndef DISBOARD_TREESESSION_H
+#define DISBOARD_TREESESSION_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+#include <QtQml/qqmlregistration.h>
+
+class Controller;
+
+// Spills the trees of idle controllers to disk. A tree that has not been
+// navigated or edited for idleTimeout, or that falls out of the
+// maxResident most recently used ones, is written to `directory` and
+// freed. Touching it again reads it back in, see Disboard::spill().
+class TreeSession : public QObject {
+Q_OBJECT
+
+    QML_ELEMENT
+    Q_DISABLE_COPY(TreeSession)
+
+    // Defaults to a "trees" folder in the cache location
+    Q_PROPERTY(QString directory READ directory WRITE setDirectory NOTIFY directoryChanged)
+    // Milliseconds, 0 never spills for idleness alone
+    Q_PROPERTY(int idleTimeout READ idleTimeout WRITE setIdleTimeout NOTIFY idleTimeoutChanged)
+    // 0 keeps any number of trees resident
+    Q_PROPERTY(int maxResident READ maxResident WRITE setMaxResident NOTIFY maxResidentChanged)
+
+    Q_PROPERTY(int resident READ resident NOTIFY countersChanged)
+    Q_PROPERTY(int spilled READ spilled NOTIFY countersChanged)
+    Q_PROPERTY(qint64 spilledBytes READ spilledBytes NOTIFY countersChanged)
+public:
+    explicit TreeSession(QObject *parent = nullptr);
+    ~TreeSession() override;
+
+    [[nodiscard]] QString directory() const;
+    void setDirectory(const QString &newValue);
+    [[nodiscard]] int idleTimeout() const;
+    void setIdleTimeout(int newValue);
+    [[nodiscard]] int maxResident() const;
+    void setMaxResident(int newValue);
+
+    [[nodiscard]] int resident() const;
+    [[nodiscard]] int spilled() const;
+    [[nodiscard]] qint64 spilledBytes() const;
+
+    // Controllers join through Controller::session. A tree leaving the
+    // session spilled is read back in first, one that cannot be is
+    // reported through treeLost() and its file kept.
+    void add(Controller *controller);
+    void remove(Controller *controller);
+
+    // Applies the limits right away instead of on the next check
+    Q_INVOKABLE void evict();
+
+private:
+    struct Entry {
+        QPointer<Controller> controller;
+        qint64 lastUsed;
+        // Last spill file, gone once the tree is read back in
+        QString file;
+    };
+
+    QString mDirectory;
+    int mIdleTimeout = 10 * 60 * 1000;
+    int mMaxResident = 0;
+    QVector<Entry> entries;
+    QTimer checkTimer;
+
+    void touch(Controller *controller);
+    bool spill(Entry &entry);
+    void updateCheckInterval();
+
+signals:
+    void directoryChanged();
+    void idleTimeoutChanged();
+    void maxResidentChanged();
+    void countersChanged();
+    // A spilled tree could not be read back in, `file` is left in place
+    void treeLost(const QString &file);
+};
+
+
+#endif //DISBOARD_TREESESSION_H
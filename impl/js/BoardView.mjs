@@ -2,6 +2,9 @@ export class Piece {
     constructor(componentConstructor) {
         this.componentConstructor = componentConstructor;
         this.pieceVec = Array(64).fill(null);
+        // Piece delegates created, destroyed and animated, and full resets.
+        // Read by the frame-time benchmark, see bench/
+        this.stats = {created: 0, destroyed: 0, moved: 0, resets: 0};
     }
 
     connect(boardCon) {
@@ -27,6 +30,7 @@ export class Piece {
         if (piece == null) return;
         this.pieceVec[square.index] = null;
         piece.destroy();
+        this.stats.destroyed += 1;
     }
 
     place(piece, square) {
@@ -34,6 +38,7 @@ export class Piece {
 
         const new_piece = this.componentConstructor(piece, square);
         this.pieceVec[square.index] = new_piece;
+        this.stats.created += 1;
     }
 
     move(src, dest) {
@@ -45,12 +50,15 @@ export class Piece {
         srcPiece.animationEnabled = true;
         srcPiece.square = dest;
         srcPiece.animationEnabled = false;
+        this.stats.moved += 1;
 
         this.pieceVec[src.index] = null;
         this.pieceVec[dest.index] = srcPiece;
     }
 
     reset(squares, pieces) {
+        this.stats.resets += 1;
+
         var initial = [];
         var i = 0;
         while (i < squares.length) {
@@ -78,11 +86,13 @@ export class Piece {
 
             const new_piece = this.componentConstructor(piece, square);
             this.pieceVec[idx] = new_piece;
+            this.stats.created += 1;
         }
 
         for (const piece of prevPieceVec) {
             if (piece != null) {
                 piece.destroy();
+                this.stats.destroyed += 1;
             }
         }
     }
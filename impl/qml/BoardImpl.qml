@@ -9,9 +9,33 @@ Item {
 
     property alias pgn: boardCon.pgn
     readonly property alias controller: boardCon
+    // Counters of the piece view, updated in place
+    readonly property var viewStats: pieceView.inner.stats
 
     id: board
 
+    focus: true
+
+    Keys.onPressed: function (event) {
+        switch (event.key) {
+        case Qt.Key_Left:
+            boardCon.seek(-1);
+            break;
+        case Qt.Key_Right:
+            boardCon.seek(1);
+            break;
+        case Qt.Key_Home:
+            boardCon.seekToPly(0);
+            break;
+        case Qt.Key_End:
+            boardCon.seek(0x7fffffff);
+            break;
+        default:
+            return;
+        }
+        event.accepted = true;
+    }
+
     QtObject {
         readonly property var component: Qt.createComponent("Piece.qml")
 
@@ -85,6 +109,7 @@ Item {
 
         pieceSize: board.pieceSize
         dragPos: dragArea.dragPos
+        window: board.Window.window
     }
 
     DragArea {
@@ -92,6 +117,7 @@ Item {
         anchors.fill: parent
 
         onClicked: function (x, y) {
+            board.forceActiveFocus();
             boardCon.coordClicked(x, y);
         }
         onDragEnded: function (srcX, srcY, destX, destY) {
@@ -101,11 +127,7 @@ Item {
             boardCon.coordDragStarted(srcX, srcY, destX, destY);
         }
         onScrolled: function (delta) {
-            if (delta > 0) {
-                boardCon.nextMove();
-            } else {
-                boardCon.prevMove();
-            }
+            boardCon.seek(delta > 0 ? 1 : -1);
         }
     }
 
@@ -114,43 +136,62 @@ Item {
 
         id: hintCanvas
 
-        Repeater {
-            model: boardCon.hintSq
-
-            HintRect {
-                required property var modelData
-
-                square: modelData
-                size: board.pieceSize
-            }
-        }
-
-        Repeater {
-            model: boardCon.captureSq
-
-            CaptureHintRect {
-                required property var modelData
-
-                square: modelData
-                size: board.pieceSize
-            }
+        // Dots for quiet targets and rings for captures, tinted by tablebase
+        // result, one item per kind however many targets the selected piece has
+        SquareOverlay {
+            anchors.fill: parent
+
+            squares: boardCon.hintMask
+            wins: boardCon.winMask
+            draws: boardCon.drawMask
+            losses: boardCon.lossMask
+            pieceSize: board.pieceSize
+            shape: SquareOverlay.Dot
+            color: "#000000"
+            opacity: 0.2
+        }
+
+        SquareOverlay {
+            anchors.fill: parent
+
+            squares: boardCon.captureMask
+            wins: boardCon.winMask
+            draws: boardCon.drawMask
+            losses: boardCon.lossMask
+            pieceSize: board.pieceSize
+            shape: SquareOverlay.Ring
+            color: "#000000"
+            opacity: 0.2
         }
     }
 
     Item {
         anchors.fill: parent
 
-        HighlightRect {
-            square: boardCon.highlightedSq
-            size: board.pieceSize
+        SquareOverlay {
+            anchors.fill: parent
+
+            squares: boardCon.highlightMask
+            pieceSize: board.pieceSize
+            color: "#00A5FF"
+            opacity: 0.5
         }
-        HighlightRect {
-            square: boardCon.lastSrcSq
-            size: board.pieceSize
+        SquareOverlay {
+            anchors.fill: parent
+
+            squares: boardCon.lastMoveMask
+            pieceSize: board.pieceSize
+            color: "#00A5FF"
+            opacity: 0.5
         }
-        HighlightRect {
-            square: boardCon.lastDestSq
-            size: board.pieceSize
+
+        SquareOverlay {
+            anchors.fill: parent
+
+            squares: boardCon.premoveMask
+            pieceSize: board.pieceSize
+            color: "#FF5A36"
+            opacity: 0.4
         }
     }
 
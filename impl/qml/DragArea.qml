@@ -72,8 +72,8 @@ Item {
         function update_cur_pos(event) {
             const rect_x = Math.max(Math.min(event.x, dragArea.x + dragArea.width - 1), dragArea.x);
             const rect_y = Math.max(Math.min(event.y, dragArea.y + dragArea.height - 1), dragArea.y);
-            curPos.x = rect_x;
-            curPos.y = rect_y;
+            // One write, so the controller sees a single position change
+            curPos = Qt.point(rect_x, rect_y);
         }
 
         onDragEnded: function (srcX, srcY, destX, destY) {
@@ -1,10 +0,0 @@
-import QtQuick
-
-Square {
-    Rectangle {
-        anchors.fill: parent
-
-        color: "#00A5FF"
-        opacity: 0.5
-    }
-}
@@ -0,0 +1,16 @@
+#ifndef DISBOARD_TESTUTIL_H
+#define DISBOARD_TESTUTIL_H
+
+#include <QStringList>
+#include <QUuid>
+#include <QVector>
+
+#include "disboard.h"
+
+// Plays `sans` one after another from `node`, returning the nodes reached
+inline QVector<QUuid> play(disboard::Disboard &board, QUuid node, const QStringList &sans) {
+    return board.addNodes(node, board.parseMoves(node, sans));
+}
+
+
+#endif //DISBOARD_TESTUTIL_H
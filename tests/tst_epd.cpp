@@ -0,0 +1,193 @@
+#include <QtTest>
+
+#include "epd.h"
+#include "epdrunner.h"
+#include "position.h"
+
+using namespace disboard;
+
+namespace {
+    const QString start = QStringLiteral("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -");
+    const QString kiwipete = QStringLiteral("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+
+    EpdRecord record(const QString &line) {
+        QString error;
+        auto parsed = EpdRecord::parse(line.toStdString(), &error);
+        if (!parsed.has_value()) qWarning() << "unexpected error:" << error;
+        return parsed.value_or(EpdRecord());
+    }
+}
+
+// EPD records as read from a suite, and the jobs run on them
+class TestEpd : public QObject {
+Q_OBJECT
+
+private slots:
+    void sixFieldFen();
+    void moveCounters();
+    void quotedId();
+    void bestMoves();
+    void solver();
+    void malformedPerft_data();
+    void malformedPerft();
+    void suiteErrors();
+    void runner();
+};
+
+void TestEpd::sixFieldFen() {
+    auto parsed = record(QStringLiteral("%1 3 17 ;D1 48 ;D2 2039 ;D3 97862").arg(kiwipete));
+    QCOMPARE(QString::fromStdString(parsed.position.fen()), QStringLiteral("%1 3 17").arg(kiwipete));
+    QCOMPARE(parsed.perft.count(), 3);
+    QCOMPARE(parsed.perft[0].depth, 1);
+    QCOMPARE(parsed.perft[0].nodes, quint64(48));
+    QCOMPARE(parsed.perft[2].depth, 3);
+    QCOMPARE(parsed.perft[2].nodes, quint64(97862));
+}
+
+void TestEpd::moveCounters() {
+    auto parsed = record(QStringLiteral("%1 hmvc 12; fmvn 40;").arg(start));
+    QCOMPARE(QString::fromStdString(parsed.position.fen()), QStringLiteral("%1 12 40").arg(start));
+
+    // Without either, the position starts the game
+    parsed = record(start);
+    QCOMPARE(QString::fromStdString(parsed.position.fen()), QStringLiteral("%1 0 1").arg(start));
+    QVERIFY(parsed.perft.empty());
+}
+
+void TestEpd::quotedId() {
+    auto parsed = record(QStringLiteral("%1 bm e4; id \"Opening 1 (king's pawn)\"; c0 \"ignored\";").arg(start));
+    QCOMPARE(parsed.id, QStringLiteral("Opening 1 (king's pawn)"));
+    QCOMPARE(parsed.bestMoves, QStringList{QStringLiteral("e4")});
+
+    parsed = record(QStringLiteral("%1 id bare words;").arg(start));
+    QCOMPARE(parsed.id, QStringLiteral("bare words"));
+}
+
+void TestEpd::bestMoves() {
+    auto parsed = record(QStringLiteral("%1 bm Nf3 e2e4 d4; am g1h3 f3;").arg(start));
+    QCOMPARE(parsed.bestMoves, (QStringList{"Nf3", "e2e4", "d4"}));
+    QCOMPARE(parsed.avoidMoves, (QStringList{"g1h3", "f3"}));
+
+    // SAN and UCI alike resolve, without a solver that is all there is to it
+    EpdRunner runner({});
+    auto result = runner.runOne(parsed);
+    QCOMPARE(result.legalMoves, 20);
+    QVERIFY(result.unresolved.empty());
+    QVERIFY(!result.solved.has_value());
+    QVERIFY(result.passed());
+
+    // Moves that are not legal in the position are kept as written
+    parsed = record(QStringLiteral("%1 bm Nf6 e2e5; am Ke2;").arg(start));
+    result = runner.runOne(parsed);
+    QCOMPARE(result.unresolved, (QStringList{"Nf6", "e2e5", "Ke2"}));
+    QVERIFY(!result.passed());
+}
+
+void TestEpd::solver() {
+    auto parsed = record(QStringLiteral("%1 bm Nf3 e2e4; am g1h3;").arg(start));
+    auto solving = [](const char *san) {
+        EpdOptions options;
+        options.solver = [san](const Position &position) { return position.parseSan(san); };
+        return EpdRunner(options);
+    };
+
+    auto result = solving("e4").runOne(parsed);
+    QCOMPARE(result.solved, std::optional<bool>(true));
+    QCOMPARE(result.solverMove, QStringLiteral("e4"));
+    QVERIFY(result.passed());
+
+    result = solving("Nh3").runOne(parsed);
+    QCOMPARE(result.solved, std::optional<bool>(false));
+    QCOMPARE(result.solverMove, QStringLiteral("Nh3"));
+    QVERIFY(!result.passed());
+
+    // Only avoid moves: anything else does
+    parsed = record(QStringLiteral("%1 am g1h3;").arg(start));
+    result = solving("d4").runOne(parsed);
+    QCOMPARE(result.solved, std::optional<bool>(true));
+}
+
+void TestEpd::malformedPerft_data() {
+    QTest::addColumn<QString>("operations");
+
+    QTest::newRow("depth zero") << "D0 1;";
+    QTest::newRow("depth not a number") << "Dx 20;";
+    QTest::newRow("negative depth") << "D-1 20;";
+    QTest::newRow("no count") << "D1;";
+    QTest::newRow("count not a number") << "D1 twenty;";
+}
+
+void TestEpd::malformedPerft() {
+    QFETCH(QString, operations);
+
+    QString error;
+    auto line = QStringLiteral("%1 0 1 ;D2 400 ;%2").arg(start, operations);
+    QVERIFY(!EpdRecord::parse(line.toStdString(), &error).has_value());
+    QVERIFY2(error.startsWith(QStringLiteral("malformed perft operation")), qPrintable(error));
+}
+
+void TestEpd::suiteErrors() {
+    auto data = QStringLiteral(
+            "# perft suite\n"
+            "\n"
+            "%1 ;D1 20\n"
+            "%1 ;D1\n"
+            "8/8/8/8/8/8/8/8 w - - ;D1 0\n"
+            "%1\n"
+            "  %2 bm Bxa6; id \"kiwipete\";\n"
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq\n").arg(start, kiwipete).toUtf8();
+    auto suite = EpdSuite::parse(data);
+
+    QCOMPARE(suite.records.count(), 3);
+    QCOMPARE(suite.records[0].line, 3);
+    QCOMPARE(suite.records[1].line, 6);
+    QCOMPARE(suite.records[2].line, 7);
+    QCOMPARE(suite.records[2].id, QStringLiteral("kiwipete"));
+
+    // Every bad line is reported with its number, the rest still loads
+    QCOMPARE(suite.errors.count(), 3);
+    QCOMPARE(suite.errors[0].line, 4);
+    QVERIFY(suite.errors[0].message.startsWith(QStringLiteral("malformed perft operation")));
+    QCOMPARE(suite.errors[1].line, 5);
+    QVERIFY(suite.errors[1].message.startsWith(QStringLiteral("illegal position")));
+    QCOMPARE(suite.errors[2].line, 8);
+    QCOMPARE(suite.errors[2].message, QStringLiteral("expected four position fields"));
+}
+
+void TestEpd::runner() {
+    auto suite = EpdSuite::parse(QStringLiteral(
+            "%1 ;D1 20 ;D2 400 ;D3 8902\n"
+            "%2 bm Bxa6 ;D1 48 ;D2 2039\n"
+            "%1 ;D1 20 ;D2 401\n").arg(start, kiwipete).toUtf8());
+    QVERIFY(suite.errors.empty());
+
+    EpdOptions options;
+    options.maxPerftDepth = 2;
+    options.threads = 2;
+    auto report = EpdRunner(options).run(suite.records);
+
+    // In the order of the records, perft only as deep as allowed
+    QCOMPARE(report.threads, 2);
+    QCOMPARE(report.results.count(), 3);
+    for (int idx = 0; idx < 3; idx += 1) QCOMPARE(report.results[idx].line, idx + 1);
+    QCOMPARE(report.results[0].perft.count(), 2);
+    QCOMPARE(report.results[0].perft[1].nodes, quint64(400));
+    QCOMPARE(report.results[1].legalMoves, 48);
+    QVERIFY(report.results[0].passed());
+    QVERIFY(report.results[1].passed());
+    QVERIFY(!report.results[2].passed());
+    QCOMPARE(report.failures(), 1);
+
+    auto json = report.toJson();
+    auto summary = json[QStringLiteral("summary")].toObject();
+    QCOMPARE(summary[QStringLiteral("positions")].toInt(), 3);
+    QCOMPARE(summary[QStringLiteral("failures")].toInt(), 1);
+    QCOMPARE(summary[QStringLiteral("perftNodes")].toString(), QStringLiteral("2927"));
+    auto results = json[QStringLiteral("results")].toArray();
+    QCOMPARE(results.count(), 3);
+    QCOMPARE(results[2].toObject()[QStringLiteral("passed")].toBool(), false);
+}
+
+QTEST_GUILESS_MAIN(TestEpd)
+
+#include "tst_epd.moc"
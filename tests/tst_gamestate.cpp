@@ -0,0 +1,209 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <numeric>
+
+#include "disboard.h"
+#include "gamestate.h"
+#include "position.h"
+#include "testutil.h"
+
+using namespace disboard;
+
+namespace {
+    const QStringList shuffle = {"Nf3", "Nf6", "Ng1", "Ng8"};
+
+    void compare(const GameStatus &actual, const GameStatus &expected) {
+        QCOMPARE(actual.halfmoves, expected.halfmoves);
+        QCOMPARE(actual.repetitions, expected.repetitions);
+        QCOMPARE(actual.insufficientMaterial, expected.insufficientMaterial);
+    }
+}
+
+// Draw rules per node, kept up to date as the tree grows
+class TestGameState : public QObject {
+Q_OBJECT
+
+private slots:
+    void repetitionsThroughVariations();
+    void resetsOnIrreversibleMoves();
+    void moveRules();
+    void assignInAnyOrder();
+    void insufficientMaterial_data();
+    void insufficientMaterial();
+};
+
+void TestGameState::repetitionsThroughVariations() {
+    Disboard board;
+    auto root = board.root();
+    // Queried first, so every node after is tracked as it is added
+    QCOMPARE(board.status(root).repetitions, 1);
+
+    auto first = play(board, root, shuffle);
+    QCOMPARE(board.status(first[3]).repetitions, 2);
+    QCOMPARE(board.status(first[3]).reason(), QString());
+
+    // The same moves again are the nodes already there
+    QCOMPARE(play(board, root, shuffle), first);
+    QCOMPARE(board.status(first[3]).repetitions, 2);
+
+    // A sideline only counts its own path, not the line next to it
+    auto side = play(board, root, {"Nc3", "Nc6", "Nb1", "Nb8"});
+    QCOMPARE(board.status(side[3]).repetitions, 2);
+
+    // One below a repetition counts everything before it
+    auto branch = play(board, first[3], {"Nc3", "Nc6", "Nb1", "Nb8"});
+    auto status = board.status(branch[3]);
+    QCOMPARE(status.repetitions, 3);
+    QVERIFY(status.threefold());
+    QVERIFY(status.claimable());
+    QVERIFY(!status.drawn());
+    QCOMPARE(status.reason(), QStringLiteral("threefold repetition"));
+
+    auto second = play(board, first[3], shuffle);
+    auto third = play(board, second[3], shuffle);
+    auto fourth = play(board, third[3], shuffle);
+    QCOMPARE(board.status(second[3]).repetitions, 3);
+    QCOMPARE(board.status(third[3]).repetitions, 4);
+    QCOMPARE(board.status(fourth[0]).repetitions, 4);
+    status = board.status(fourth[3]);
+    QCOMPARE(status.repetitions, 5);
+    QVERIFY(status.drawn());
+    QCOMPARE(status.reason(), QStringLiteral("fivefold repetition"));
+
+    // The sideline is still where it was
+    QCOMPARE(board.status(side[3]).repetitions, 2);
+}
+
+void TestGameState::resetsOnIrreversibleMoves() {
+    Disboard board;
+    auto root = board.root();
+    (void) board.status(root);
+
+    auto line = play(board, root, {"Nf3", "Nf6", "e4", "Nc6", "Nc3", "Nxe4", "Nxe4", "d5"});
+    QVector<int> halfmoves;
+    for (auto node: line) halfmoves.push_back(board.status(node).halfmoves);
+    QCOMPARE(halfmoves, (QVector<int>{1, 2, 0, 1, 2, 0, 0, 0}));
+
+    // Repetitions count from the last capture or pawn move on
+    auto after = play(board, line.back(), {"Nc3", "Nb8", "Ne4", "Nc6"});
+    QCOMPARE(board.status(after[3]).repetitions, 2);
+    QCOMPARE(board.status(after[3]).halfmoves, 4);
+    auto pushed = play(board, after[3], {"d3", "Nb8", "Nc3", "Nc6", "Ne4"});
+    QCOMPARE(board.status(pushed[0]).halfmoves, 0);
+    QCOMPARE(board.status(pushed[0]).repetitions, 1);
+    QCOMPARE(board.status(pushed[4]).repetitions, 2);
+
+    // Both agree with the states worked out from scratch
+    auto fresh = *Disboard::fromFen(Position().fen());
+    auto again = play(fresh, fresh.root(), {"Nf3", "Nf6", "e4", "Nc6", "Nc3", "Nxe4", "Nxe4", "d5",
+                                            "Nc3", "Nb8", "Ne4", "Nc6", "d3", "Nb8", "Nc3", "Nc6", "Ne4"});
+    auto expected = line + after + pushed;
+    QCOMPARE(again.count(), expected.count());
+    for (int idx = 0; idx < again.count(); idx += 1) {
+        compare(fresh.status(again[idx]), board.status(expected[idx]));
+    }
+}
+
+void TestGameState::moveRules() {
+    auto board = *Disboard::fromFen("4k3/r7/8/8/8/8/R7/4K3 w - - 98 80");
+    (void) board.status(board.root());
+
+    auto line = play(board, board.root(), {"Rb2", "Rb7"});
+    auto status = board.status(line[1]);
+    QCOMPARE(status.halfmoves, 100);
+    QVERIFY(status.fiftyMoves());
+    QVERIFY(status.claimable());
+    QVERIFY(!status.drawn());
+    QCOMPARE(status.reason(), QStringLiteral("fifty-move rule"));
+
+    auto capture = play(board, line[1], {"Rxb7"});
+    QCOMPARE(board.status(capture[0]).halfmoves, 0);
+    QVERIFY(!board.status(capture[0]).claimable());
+
+    board = *Disboard::fromFen("4k3/r7/8/8/8/8/R7/4K3 w - - 148 80");
+    line = play(board, board.root(), {"Rb2", "Rb7"});
+    status = board.status(line[1]);
+    QCOMPARE(status.halfmoves, 150);
+    QVERIFY(status.drawn());
+    QCOMPARE(status.reason(), QStringLiteral("seventy-five-move rule"));
+}
+
+void TestGameState::assignInAnyOrder() {
+    Disboard board;
+    auto root = board.root();
+    (void) board.status(root);
+    auto first = play(board, root, shuffle);
+    play(board, root, {"Nc3", "Nc6", "Nb1", "Nb8"});
+    auto second = play(board, first[3], shuffle);
+    play(board, first[3], {"e4", "e5", "Nf3", "Nf6", "Ng1", "Ng8"});
+    play(board, second[3], {"Nc3", "Nc6", "Nb1", "Nb8"});
+    play(board, second[1], {"Nc3", "Nc6", "Nb1", "Nb8", "Ng1", "Ng8"});
+
+    QCOMPARE(board.status(second[3]).repetitions, 3);
+
+    // Against the states tracked while the tree grew
+    auto entries = board.nodes();
+    QVector<GameStatus> expected;
+    for (const auto &entry: entries) expected.push_back(board.status(entry.node));
+
+    // In preorder, as the tree hands them out
+    GameStates states;
+    states.assign(board.initialPosition(), entries);
+    QCOMPARE(states.count(), static_cast<int>(entries.count()));
+    for (int idx = 0; idx < entries.count(); idx += 1) compare(states.status(idx), expected[idx]);
+
+    // Level by level, every parent still before its children
+    QVector<int> depth(entries.count(), 0);
+    for (int idx = 1; idx < entries.count(); idx += 1) depth[idx] = depth[entries[idx].parent] + 1;
+    QVector<int> order(entries.count());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&depth](int lhs, int rhs) { return depth[lhs] < depth[rhs]; });
+    QVector<int> position(entries.count());
+    for (int idx = 0; idx < order.count(); idx += 1) position[order[idx]] = idx;
+
+    QVector<NodeEntry> shuffled;
+    for (auto idx: order) {
+        auto entry = entries[idx];
+        if (entry.parent >= 0) entry.parent = position[entry.parent];
+        shuffled.push_back(entry);
+    }
+    QVERIFY(!std::is_sorted(order.begin(), order.end()));
+    states.assign(board.initialPosition(), shuffled);
+    QCOMPARE(states.count(), static_cast<int>(entries.count()));
+    for (int idx = 0; idx < order.count(); idx += 1) compare(states.status(idx), expected[order[idx]]);
+}
+
+void TestGameState::insufficientMaterial_data() {
+    QTest::addColumn<QString>("fen");
+    QTest::addColumn<bool>("insufficient");
+
+    QTest::newRow("kings only") << "8/8/4k3/8/8/3K4/8/8 w - - 0 1" << true;
+    QTest::newRow("bishop") << "8/8/4k3/8/8/3K4/8/5B2 w - - 0 1" << true;
+    QTest::newRow("knight") << "8/8/4k3/8/8/3K4/8/5N2 w - - 0 1" << true;
+    QTest::newRow("bishops on one colour") << "8/8/2b1k3/8/8/3K4/8/5B2 w - - 0 1" << true;
+    QTest::newRow("three bishops on one colour") << "8/8/2b1k3/8/8/3K4/8/3B1B2 w - - 0 1" << true;
+    QTest::newRow("bishops on both colours") << "8/8/3bk3/8/8/3K4/8/5B2 w - - 0 1" << false;
+    QTest::newRow("knight and bishop") << "8/8/2b1k3/8/8/3K4/8/5N2 w - - 0 1" << false;
+    QTest::newRow("two knights") << "8/8/4k3/8/8/3K4/8/4NN2 w - - 0 1" << false;
+    QTest::newRow("pawn") << "8/8/4k3/8/8/3K4/5P2/8 w - - 0 1" << false;
+    QTest::newRow("rook") << "8/8/4k3/8/8/3K4/8/5R2 w - - 0 1" << false;
+}
+
+void TestGameState::insufficientMaterial() {
+    QFETCH(QString, fen);
+    QFETCH(bool, insufficient);
+
+    auto position = Position::fromFen(fen.toStdString());
+    QVERIFY(position.has_value());
+    QCOMPARE(position->isInsufficientMaterial(), insufficient);
+
+    GameStates states;
+    auto status = states.status(states.add(-1, *position));
+    QCOMPARE(status.insufficientMaterial, insufficient);
+    QCOMPARE(status.drawn(), insufficient);
+}
+
+QTEST_GUILESS_MAIN(TestGameState)
+
+#include "tst_gamestate.moc"
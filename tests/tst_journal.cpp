@@ -0,0 +1,188 @@
+#include <QtTest>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "disboard.h"
+#include "journal.h"
+
+using namespace disboard;
+
+namespace {
+    // SAN of the moves leading to `node`
+    QStringList line(const Disboard &board, QUuid node) {
+        QStringList sans;
+        for (auto prev = std::optional<QUuid>(node); prev.has_value(); prev = board.prevNode(*prev)) {
+            if (*prev != board.root()) sans.push_front(board.san(*prev));
+        }
+        return sans;
+    }
+
+    // Plays `sans` after `node` and tells the journal
+    QVector<QUuid> play(Disboard &board, Journal &journal, QUuid node, const QStringList &sans) {
+        auto moves = board.parseMoves(node, sans);
+        auto nodes = board.addNodes(node, moves);
+        journal.added(board, node, nodes, moves);
+        return nodes;
+    }
+}
+
+class TestJournal : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void replaysTree();
+    void replaysEdits();
+    void stopsAtTornTail();
+    void stopsAtBadChecksum();
+    void compacts();
+
+private:
+    std::unique_ptr<QTemporaryDir> dir;
+    QString path;
+};
+
+void TestJournal::init() {
+    dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(dir->isValid());
+    path = dir->filePath(QStringLiteral("tree.journal"));
+}
+
+void TestJournal::replaysTree() {
+    auto board = *Disboard::fromFen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    QUuid shown;
+    {
+        Journal journal(path, board, board.root());
+        auto mainline = play(board, journal, board.root(), {"Bb5", "a6", "Ba4", "Nf6"});
+        play(board, journal, mainline[1], {"Bc4", "Bc5"});
+        // The same move again is the same node, not a new one
+        play(board, journal, board.root(), {"Bb5", "Nf6"});
+        shown = mainline[2];
+        journal.selected(shown);
+        journal.sync();
+        QVERIFY(!journal.failed());
+    }
+
+    auto replay = Journal::replay(path);
+    QVERIFY(replay.has_value());
+    QCOMPARE(replay->board.pgn(), board.pgn());
+    QCOMPARE(replay->board.nodes().count(), board.nodes().count());
+    QCOMPARE(line(replay->board, replay->curNode), line(board, shown));
+}
+
+void TestJournal::replaysEdits() {
+    Disboard board;
+    QUuid shown;
+    {
+        Journal journal(path, board, board.root());
+        auto e4 = play(board, journal, board.root(), {"e4", "e5", "Nf3", "Nc6"});
+        auto d4 = play(board, journal, board.root(), {"d4", "d5"});
+        auto c4 = play(board, journal, board.root(), {"c4"});
+        auto sicilian = play(board, journal, e4[0], {"c5", "Nf3"});
+        play(board, journal, e4[1], {"Bc4"});
+
+        auto removed = board.removeNode(d4[0]);
+        QCOMPARE(removed.count(), 2);
+        journal.removed(board, d4[0], removed);
+
+        QVERIFY(board.moveVariation(c4[0], 0));
+        journal.movedVariation(board, c4[0], 0);
+
+        QVERIFY(!board.promoteVariation(sicilian[1]).empty());
+        journal.promotedVariation(board, sicilian[1]);
+
+        removed = board.truncate(e4[1]);
+        QCOMPARE(removed.count(), 3);
+        journal.truncated(board, e4[1], removed);
+
+        // Ids handed out after an edit keep following the tree
+        play(board, journal, e4[1], {"Nc3"});
+        shown = sicilian[1];
+        journal.selected(shown);
+        journal.sync();
+    }
+
+    auto replay = Journal::replay(path);
+    QVERIFY(replay.has_value());
+    QCOMPARE(replay->board.pgn(), board.pgn());
+    QCOMPARE(line(replay->board, replay->curNode), line(board, shown));
+}
+
+void TestJournal::stopsAtTornTail() {
+    Disboard board;
+    QString before;
+    {
+        Journal journal(path, board, board.root());
+        auto nodes = play(board, journal, board.root(), {"e4", "e5"});
+        journal.sync();
+        before = board.pgn();
+        play(board, journal, nodes.back(), {"Nf3", "Nc6", "Bb5"});
+        journal.sync();
+    }
+
+    // A crash in the middle of the last write
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 3));
+    file.close();
+
+    auto replay = Journal::replay(path);
+    QVERIFY(replay.has_value());
+    QCOMPARE(replay->board.pgn(), before);
+}
+
+void TestJournal::stopsAtBadChecksum() {
+    Disboard board;
+    QString before;
+    {
+        Journal journal(path, board, board.root());
+        auto nodes = play(board, journal, board.root(), {"d4", "Nf6"});
+        journal.sync();
+        before = board.pgn();
+        play(board, journal, nodes.back(), {"c4"});
+        journal.sync();
+    }
+
+    // One bit flipped in the last record's move
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    auto bytes = file.readAll();
+    bytes[bytes.size() - 6] = static_cast<char>(bytes[bytes.size() - 6] ^ 0x01);
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(bytes), bytes.size());
+    file.close();
+
+    auto replay = Journal::replay(path);
+    QVERIFY(replay.has_value());
+    QCOMPARE(replay->board.pgn(), before);
+}
+
+void TestJournal::compacts() {
+    Disboard board;
+    qint64 journaled = 0;
+    {
+        Journal journal(path, board, board.root());
+        // The same move over and over, one record each
+        auto node = board.root();
+        for (int idx = 0; idx < Journal::compactAfter - 1; idx += 1) {
+            node = play(board, journal, board.root(), {"Nf3"}).back();
+        }
+        journal.sync();
+        journaled = QFileInfo(path).size();
+
+        play(board, journal, node, {"Nf6"});
+        journal.sync();
+        QVERIFY(!journal.failed());
+    }
+
+    // The records repeating the same move are gone after the snapshot
+    QVERIFY(QFileInfo(path).size() < journaled / 100);
+    auto replay = Journal::replay(path);
+    QVERIFY(replay.has_value());
+    QCOMPARE(replay->board.pgn(), board.pgn());
+}
+
+QTEST_GUILESS_MAIN(TestJournal)
+
+#include "tst_journal.moc"
@@ -0,0 +1,181 @@
+#include <QtTest>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+
+#include "controller.h"
+#include "livefeed.h"
+
+using namespace disboard;
+
+namespace {
+    // Stand-in for the broadcast relay: one client at a time, lines written
+    // as given and commands from the client collected
+    class StandInRelay : public QObject {
+    public:
+        StandInRelay() {
+            static int serial = 0;
+            name = QStringLiteral("disboard-tst-livefeed-%1-%2")
+                    .arg(QCoreApplication::applicationPid()).arg(serial++);
+            QLocalServer::removeServer(name);
+            server.listen(name);
+
+            connect(&server, &QLocalServer::newConnection, this, [this]() {
+                while (auto socket = server.nextPendingConnection()) {
+                    client = socket;
+                    connections += 1;
+                    connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+                        while (socket->canReadLine()) {
+                            received.push_back(QString::fromUtf8(socket->readLine()).trimmed());
+                        }
+                    });
+                }
+            });
+        }
+
+        // Everything in one write, so the client reads it as one batch
+        void send(const QStringList &lines) {
+            QVERIFY(client);
+            client->write((lines.join(QLatin1Char('\n')) + QLatin1Char('\n')).toUtf8());
+            client->flush();
+        }
+
+        void drop() {
+            if (client) client->abort();
+        }
+
+        QString name;
+        QLocalServer server;
+        QPointer<QLocalSocket> client;
+        int connections = 0;
+        QStringList received;
+    };
+
+    QStringList mainline(const Controller &controller) {
+        const auto &board = controller.board();
+        QStringList sans;
+        for (auto node: board.mainlineNodes(board.root())) sans.push_back(board.san(node));
+        return sans;
+    }
+}
+
+class TestLiveFeed : public QObject {
+Q_OBJECT
+
+private slots:
+    void batchesMoves();
+    void reconnects();
+    void resyncsFromMoveList();
+    void replacesDivergedGame();
+};
+
+void TestLiveFeed::batchesMoves() {
+    StandInRelay relay;
+    Controller controller;
+    LiveFeed feed;
+    feed.attach(QStringLiteral("g1"), &controller);
+    feed.setServer(relay.name);
+
+    QTRY_VERIFY(feed.connected());
+    QTRY_COMPARE(relay.received, QStringList{QStringLiteral("sync g1")});
+
+    QSignalSpy trees(&controller, &Controller::treeChanged);
+    QSignalSpy batches(&feed, &LiveFeed::latencyMeasured);
+    relay.send({
+            QStringLiteral("g1 moves"),
+            QStringLiteral("g1 move e4"),
+            QStringLiteral("@1 g1 move e5 Nf3"),
+            QStringLiteral("other move d4"),
+            QStringLiteral("g1 move Nc6"),
+    });
+
+    // Four moves of three lines end up as one tree update
+    QTRY_COMPARE(mainline(controller), (QStringList{"e4", "e5", "Nf3", "Nc6"}));
+    QCOMPARE(trees.count(), 1);
+    QCOMPARE(batches.count(), 1);
+}
+
+void TestLiveFeed::reconnects() {
+    StandInRelay relay;
+    Controller controller;
+    LiveFeed feed;
+    feed.attach(QStringLiteral("g1"), &controller);
+    feed.setServer(relay.name);
+
+    QTRY_COMPARE(relay.received.count(), 1);
+    relay.send({QStringLiteral("g1 moves e4 e5")});
+    QTRY_COMPARE(mainline(controller), (QStringList{"e4", "e5"}));
+
+    relay.drop();
+    QTRY_VERIFY(!feed.connected());
+
+    // The client comes back on its own and asks for the list again
+    QTRY_VERIFY_WITH_TIMEOUT(feed.connected(), 5000);
+    QTRY_COMPARE(relay.received.count(), 2);
+    QCOMPARE(relay.connections, 2);
+    QCOMPARE(relay.received.back(), QStringLiteral("sync g1"));
+
+    // Moves made while the connection was down come with the full list
+    relay.send({QStringLiteral("g1 moves e4 e5 Nf3 Nc6 Bb5")});
+    QTRY_COMPARE(mainline(controller), (QStringList{"e4", "e5", "Nf3", "Nc6", "Bb5"}));
+}
+
+void TestLiveFeed::resyncsFromMoveList() {
+    // The game so far with a viewer's variation on the side
+    Disboard board;
+    auto node = board.root();
+    for (auto san: {"e4", "e5"}) node = board.addNode(node, *board.position(node).parseSan(san));
+    board.addNode(board.root(), *board.position(board.root()).parseSan("d4"));
+
+    StandInRelay relay;
+    Controller controller;
+    controller.setBoard(std::move(board));
+    auto root = controller.board().root();
+    LiveFeed feed;
+    QSignalSpy errors(&feed, &LiveFeed::protocolError);
+    feed.attach(QStringLiteral("g1"), &controller);
+    feed.setServer(relay.name);
+
+    QTRY_COMPARE(relay.received.count(), 1);
+
+    // A move that does not fit means a missed line, the client asks for
+    // the list again and the list only extends the game
+    relay.send({QStringLiteral("g1 move Nf6")});
+    QTRY_COMPARE(relay.received.count(), 2);
+    QCOMPARE(relay.received.back(), QStringLiteral("sync g1"));
+    QCOMPARE(errors.count(), 1);
+    QCOMPARE(mainline(controller), (QStringList{"e4", "e5"}));
+
+    relay.send({QStringLiteral("g1 moves e4 e5 Nf3")});
+    QTRY_COMPARE(mainline(controller), (QStringList{"e4", "e5", "Nf3"}));
+    QCOMPARE(controller.board().root(), root);
+    QCOMPARE(controller.board().nodes().count(), 5);
+}
+
+void TestLiveFeed::replacesDivergedGame() {
+    StandInRelay relay;
+    Controller controller;
+    LiveFeed feed;
+    feed.attach(QStringLiteral("g1"), &controller);
+    feed.setServer(relay.name);
+
+    QTRY_COMPARE(relay.received.count(), 1);
+    relay.send({QStringLiteral("g1 moves e4 e5 Nf3")});
+    QTRY_COMPARE(mainline(controller), (QStringList{"e4", "e5", "Nf3"}));
+
+    // A corrected list takes over the whole tree, the board on its last move
+    QSignalSpy rootChanged(&controller, &Controller::rootChanged);
+    relay.send({QStringLiteral("g1 moves d4 d5")});
+    QTRY_COMPARE(mainline(controller), (QStringList{"d4", "d5"}));
+    QCOMPARE(rootChanged.count(), 1);
+    QCOMPARE(controller.board().san(controller.curNode()), QStringLiteral("d5"));
+
+    // So does a new game from a position
+    relay.send({QStringLiteral("g1 start 4k3/8/8/8/8/8/4P3/4K3 w - - 0 1"), QStringLiteral("g1 move e4")});
+    QTRY_COMPARE(mainline(controller), QStringList{"e4"});
+    QCOMPARE(controller.board().initialPosition().fen(), std::string("4k3/8/8/8/8/8/4P3/4K3 w - - 0 1"));
+}
+
+QTEST_MAIN(TestLiveFeed)
+
+#include "tst_livefeed.moc"
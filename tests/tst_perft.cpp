@@ -0,0 +1,160 @@
+#include <QtTest>
+
+#include "disboard.h"
+#include "position.h"
+
+using namespace disboard;
+
+// Node counts of the native move generator, against published figures and
+// against the Rust generator the tree is built on
+class TestPerft : public QObject {
+Q_OBJECT
+
+private slots:
+    void native_data();
+    void native();
+    void reference_data();
+    void reference();
+    void sanRoundTrip_data();
+    void sanRoundTrip();
+    void rejectsFen_data();
+    void rejectsFen();
+
+private:
+    static void addPositions(int maxNodes);
+};
+
+namespace {
+    struct Case {
+        const char *name;
+        const char *fen;
+        int depth;
+        quint64 nodes;
+    };
+
+    // The usual suites: start position, kiwipete and the CPW positions,
+    // then positions for one rule each
+    constexpr Case cases[] = {
+            {"start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+            {"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+            {"cpw3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+            {"cpw4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3, 9467},
+            {"cpw4 mirrored", "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 3, 9467},
+            {"cpw5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+            {"cpw6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 3, 89890},
+
+            {"promotion captures", "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1", 3, 9483},
+            {"promotion out of check", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},
+            {"promotion into check", "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},
+            {"underpromotion", "8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},
+            {"promotion stalemate", "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217},
+            {"promotion race", "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},
+
+            {"en passant pinned", "8/8/8/8/k2Pp2Q/8/8/3K4 b - d3 0 1", 1, 6},
+            {"en passant discovered check", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},
+            {"en passant out of check", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},
+            {"double push", "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+
+            {"castling both sides", "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", 3, 13744},
+            {"castling both sides black", "r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1", 3, 13744},
+            {"short castling", "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},
+            {"long castling", "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+            {"castling rights lost", "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},
+            {"castling through check", "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},
+
+            {"self stalemate", "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658},
+            {"discovered checks", "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527},
+    };
+}
+
+void TestPerft::addPositions(int maxNodes) {
+    QTest::addColumn<QString>("fen");
+    QTest::addColumn<int>("depth");
+    QTest::addColumn<quint64>("nodes");
+
+    for (const auto &test: cases) {
+        if (maxNodes > 0 && test.nodes > static_cast<quint64>(maxNodes)) continue;
+        QTest::newRow(test.name) << QString::fromLatin1(test.fen) << test.depth << test.nodes;
+    }
+}
+
+void TestPerft::native_data() {
+    addPositions(0);
+}
+
+void TestPerft::native() {
+    QFETCH(QString, fen);
+    QFETCH(int, depth);
+    QFETCH(quint64, nodes);
+
+    auto position = Position::fromFen(fen.toStdString());
+    QVERIFY(position.has_value());
+    QCOMPARE(position->perft(depth), nodes);
+}
+
+void TestPerft::reference_data() {
+    // The Rust side counts through the FFI, keep to the smaller trees
+    addPositions(250000);
+}
+
+void TestPerft::reference() {
+    QFETCH(QString, fen);
+    QFETCH(int, depth);
+
+    auto board = Disboard::fromFen(fen.toStdString());
+    QVERIFY(board.has_value());
+    auto root = board->root();
+
+    // Per move first, so a mismatch names the move that differs
+    for (auto move: board->position(root).legalMoves()) {
+        auto child = board->addNode(root, move);
+        QVERIFY2(board->perft(child, depth - 1) == board->referencePerft(child, depth - 1),
+                 qPrintable(move.toString()));
+    }
+    QCOMPARE(board->perft(root, depth), board->referencePerft(root, depth));
+}
+
+void TestPerft::sanRoundTrip_data() {
+    addPositions(0);
+}
+
+void TestPerft::sanRoundTrip() {
+    QFETCH(QString, fen);
+
+    auto position = Position::fromFen(fen.toStdString());
+    QVERIFY(position.has_value());
+
+    // Every legal move two plies deep reads back as itself
+    for (auto move: position->legalMoves()) {
+        auto san = position->san(move);
+        QCOMPARE(position->parseSan(san), std::optional<Move>(move));
+
+        auto after = *position;
+        after.play(move);
+        for (auto reply: after.legalMoves()) {
+            QCOMPARE(after.parseSan(after.san(reply)), std::optional<Move>(reply));
+        }
+    }
+}
+
+void TestPerft::rejectsFen_data() {
+    QTest::addColumn<QString>("fen");
+
+    QTest::newRow("white pawn on rank 1") << "4k3/8/8/8/8/8/8/P3K3 w - - 0 1";
+    QTest::newRow("black pawn on rank 8") << "p3k3/8/8/8/8/8/8/4K3 w - - 0 1";
+    QTest::newRow("white pawn on rank 8") << "P3k3/8/8/8/8/8/8/4K3 b - - 0 1";
+    QTest::newRow("en passant of the side to move") << "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR w KQkq d3 0 3";
+    QTest::newRow("en passant without the pushed pawn") << "rnbqkbnr/ppp1pppp/8/4P3/8/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 3";
+    QTest::newRow("en passant behind a piece") << "rnbqkbnr/ppp1pppp/8/3nP3/8/8/PPPP1PPP/RNBQKB1R w KQkq d6 0 3";
+    QTest::newRow("en passant of black to move") << "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e6 0 1";
+}
+
+void TestPerft::rejectsFen() {
+    QFETCH(QString, fen);
+
+    QVERIFY(!Position::fromFen(fen.toStdString()).has_value());
+}
+
+QTEST_GUILESS_MAIN(TestPerft)
+
+#include "tst_perft.moc"
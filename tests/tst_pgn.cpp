@@ -0,0 +1,148 @@
+#include <QtTest>
+
+#include "annotations.h"
+#include "disboard.h"
+#include "pgn.h"
+
+using namespace disboard;
+
+// Annotations read from PGN comments and NAGs, and written back unchanged
+class TestPgn : public QObject {
+Q_OBJECT
+
+private slots:
+    void clock_data();
+    void clock();
+    void nags();
+    void gameRoundTrip();
+    void gameExport();
+};
+
+void TestPgn::clock_data() {
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("ms");
+    QTest::addColumn<QString>("written");
+
+    QTest::newRow("whole seconds") << "1:30:00" << 5400000 << "1:30:00";
+    QTest::newRow("minutes only") << "3:07" << 187000 << "0:03:07";
+    QTest::newRow("tenths") << "0:00:09.5" << 9500 << "0:00:09.5";
+    QTest::newRow("hundredths") << "0:00:01.25" << 1250 << "0:00:01.250";
+    QTest::newRow("milliseconds") << "0:00:01.234" << 1234 << "0:00:01.234";
+    QTest::newRow("below a tenth") << "0:00:00.007" << 7 << "0:00:00.007";
+    QTest::newRow("past milliseconds") << "0:00:02.0009" << 2000 << "0:00:02";
+}
+
+void TestPgn::clock() {
+    QFETCH(QString, text);
+    QFETCH(int, ms);
+    QFETCH(QString, written);
+
+    Annotations notes;
+    auto node = QUuid::createUuid();
+    notes.setPgnComment(node, "[%clk " + text.toStdString() + "]");
+    QCOMPARE(notes.clock(node), ms);
+    QCOMPARE(QString::fromStdString(notes.pgnComment(node)), "[%clk " + written + "]");
+
+    // What is written reads back as the same clock
+    Annotations again;
+    again.setPgnComment(node, notes.pgnComment(node));
+    QCOMPARE(again.clock(node), ms);
+}
+
+void TestPgn::nags() {
+    auto game = PgnGame::parse("1. e4! e5?! 2. Nf3 $14 $32 Nc6!! $18 *");
+    QVERIFY(game.has_value());
+
+    auto mainline = game->mainline();
+    QCOMPARE(mainline.count(), 4);
+    QCOMPARE(game->nodes[mainline[0]].nags, QVector<uint8_t>{1});
+    QCOMPARE(game->nodes[mainline[1]].nags, QVector<uint8_t>{6});
+    QCOMPARE(game->nodes[mainline[2]].nags, (QVector<uint8_t>{14, 32}));
+    QCOMPARE(game->nodes[mainline[3]].nags, (QVector<uint8_t>{3, 18}));
+
+    // Suffixes are written as numbers and read back the same
+    auto again = PgnGame::parse(game->toPgn());
+    QVERIFY(again.has_value());
+    QCOMPARE(again->toPgn(), game->toPgn());
+    for (int idx = 0; idx < mainline.count(); idx += 1) {
+        QCOMPARE(again->nodes[again->mainline()[idx]].nags, game->nodes[mainline[idx]].nags);
+    }
+}
+
+void TestPgn::gameRoundTrip() {
+    const char *text =
+            "[Event \"Round trip\"]\n"
+            "\n"
+            "1. e4 $1 {Best by test [%clk 0:05:00]} 1... c5 {[%clk 0:04:59.5] [%eval 0.31]}\n"
+            "2. Nf3 {[%clk 0:04:58.123]} (2. c3 $5 {Alapin [%clk 0:04:57]}) 2... d6 $2\n"
+            "{[%clk 0:04:51.004] [%cal Gd6d5,Rc5c4]} *\n";
+
+    auto parsed = PgnGame::parse(text);
+    QVERIFY(parsed.has_value());
+    auto board = Disboard::fromPgn(*parsed);
+    QVERIFY(board.has_value());
+
+    const auto &notes = board->annotations();
+    auto mainline = board->mainlineNodes(board->root());
+    QCOMPARE(mainline.count(), 4);
+    QCOMPARE(notes.clocks(mainline), (QVector<int32_t>{300000, 299500, 298123, 291004}));
+    QCOMPARE(notes.nags(mainline[0]), QVector<uint8_t>{1});
+    QCOMPARE(notes.nags(mainline[3]), QVector<uint8_t>{2});
+    QCOMPARE(notes.comment(mainline[0]), QStringLiteral("Best by test"));
+    QCOMPARE(notes.eval(mainline[1]), 31);
+    QCOMPARE(notes.arrows(mainline[3]).count(), 2);
+
+    // Written out and read again, nothing is lost or rounded
+    auto written = board->pgn();
+    QVERIFY(written.contains(QStringLiteral("[%clk 0:04:58.123]")));
+    QVERIFY(written.contains(QStringLiteral("[%clk 0:04:51.004]")));
+    QVERIFY(written.contains(QStringLiteral("$5")));
+
+    auto reparsed = PgnGame::parse(written.toStdString());
+    QVERIFY(reparsed.has_value());
+    auto again = Disboard::fromPgn(*reparsed);
+    QVERIFY(again.has_value());
+    QCOMPARE(again->pgn(), written);
+    auto line = again->mainlineNodes(again->root());
+    QCOMPARE(again->annotations().clocks(line), notes.clocks(mainline));
+}
+
+void TestPgn::gameExport() {
+    // Commands in any order and spelling, as other tools write them
+    const char *text =
+            "1. e4 {Best by test [%clk 0:05:00] [%eval 0.31,18]} c5 {[%eval -0.15] [%clk 0:04:59.5]}\n"
+            "2. Nf3 {[%cal Gd2d4,Rc2c3] [%clk 0:04:58.123]} (2. c3 $5 {Alapin [%clk 0:04:57] [%eval #12]})\n"
+            "d6 $2 {[%clk 0:04:51.004] [%cal Gd6d5] [%eval #-3]} 3. d4 {[%clk 1:00:00] [%eval +12.4]} *\n";
+    // Written back as clock, eval and arrows, at the precision they came in
+    const char *expected =
+            "1. e4 {Best by test [%clk 0:05:00] [%eval 0.31]} 1... c5\n"
+            "{[%clk 0:04:59.5] [%eval -0.15]} 2. Nf3 {[%clk 0:04:58.123] [%cal Gd2d4,Rc2c3]}\n"
+            "(2. c3 $5 {Alapin [%clk 0:04:57] [%eval #12]}) 2... d6 $2\n"
+            "{[%clk 0:04:51.004] [%eval #-3] [%cal Gd6d5]} 3. d4\n"
+            "{[%clk 1:00:00] [%eval 12.40]} *\n"
+            "\n";
+
+    auto parsed = PgnGame::parse(text);
+    QVERIFY(parsed.has_value());
+    auto board = Disboard::fromPgn(*parsed);
+    QVERIFY(board.has_value());
+
+    const auto &notes = board->annotations();
+    auto mainline = board->mainlineNodes(board->root());
+    QCOMPARE(mainline.count(), 5);
+    QCOMPARE(notes.clocks(mainline), (QVector<int32_t>{300000, 299500, 298123, 291004, 3600000}));
+    QCOMPARE(notes.evals(mainline)[4], 1240);
+    QCOMPARE(Annotations::mateIn(notes.eval(mainline[3])), -3);
+    QCOMPARE(board->pgn(), QString::fromLatin1(expected));
+
+    // The export is a fixed point
+    auto reparsed = PgnGame::parse(expected);
+    QVERIFY(reparsed.has_value());
+    auto again = Disboard::fromPgn(*reparsed);
+    QVERIFY(again.has_value());
+    QCOMPARE(again->pgn(), QString::fromLatin1(expected));
+}
+
+QTEST_GUILESS_MAIN(TestPgn)
+
+#include "tst_pgn.moc"
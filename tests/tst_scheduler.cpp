@@ -0,0 +1,192 @@
+#include <QtTest>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "disboard.h"
+#include "gamecollection.h"
+#include "positionsearch.h"
+#include "scheduler.h"
+
+using namespace disboard;
+
+namespace {
+    QVector<std::shared_ptr<const IndexedGame>> games(int count) {
+        QVector<std::shared_ptr<const IndexedGame>> list;
+        for (int idx = 0; idx < count; idx += 1) {
+            auto board = std::make_shared<Disboard>();
+            auto moves = board->parseMoves(board->root(), {"e4", idx % 2 ? "e5" : "c5", "Nf3"});
+            board->addNodes(board->root(), moves);
+            list.push_back(std::make_shared<IndexedGame>(board));
+        }
+        return list;
+    }
+}
+
+class TestScheduler : public QObject {
+Q_OBJECT
+
+private slots:
+    void skipsCancelledJobs();
+    void groupsWait();
+    void nestedGroupsHelp();
+    void dropsDeliveriesWithoutContext();
+    void dropsResultsWithoutContext();
+    void searchFinishesOnce();
+    void searchCancelsWithoutWaiting();
+};
+
+void TestScheduler::skipsCancelledJobs() {
+    Scheduler scheduler(2);
+    std::atomic<int> ran{0};
+
+    auto token = CancelToken::make();
+    token.cancel();
+    scheduler.submit(Priority::Visible, [&ran]() { ran += 1; }, token);
+    scheduler.submit(Priority::Visible, [&ran]() { ran += 10; });
+
+    QTRY_COMPARE(scheduler.stats().classes[static_cast<int>(Priority::Visible)].completed
+                 + scheduler.stats().classes[static_cast<int>(Priority::Visible)].cancelled, qint64(2));
+    QCOMPARE(ran.load(), 10);
+    QCOMPARE(scheduler.stats().classes[static_cast<int>(Priority::Visible)].cancelled, qint64(1));
+}
+
+void TestScheduler::groupsWait() {
+    Scheduler scheduler(2);
+    std::atomic<int> ran{0};
+
+    TaskGroup group(Priority::Background, {}, scheduler);
+    for (int idx = 0; idx < 1000; idx += 1) group.run([&ran]() { ran += 1; });
+    group.wait();
+    QCOMPARE(ran.load(), 1000);
+}
+
+void TestScheduler::nestedGroupsHelp() {
+    // More waiting jobs than workers, each waiting on jobs of its own: the
+    // waiters run the queued jobs themselves instead of deadlocking
+    Scheduler scheduler(2);
+    std::atomic<int> ran{0};
+
+    TaskGroup outer(Priority::Visible, {}, scheduler);
+    for (int idx = 0; idx < 8; idx += 1) {
+        outer.run([&scheduler, &ran]() {
+            TaskGroup inner(Priority::Visible, {}, scheduler);
+            for (int job = 0; job < 8; job += 1) inner.run([&ran]() { ran += 1; });
+            inner.wait();
+        });
+    }
+    outer.wait();
+    QCOMPARE(ran.load(), 64);
+}
+
+void TestScheduler::dropsDeliveriesWithoutContext() {
+    Scheduler scheduler(2);
+    int delivered = 0;
+
+    auto gone = new QObject;
+    QObject kept;
+    scheduler.deliver(gone, [&delivered]() { delivered += 1; });
+    scheduler.deliver(&kept, [&delivered]() { delivered += 10; });
+    auto token = CancelToken::make();
+    scheduler.deliver(&kept, [&delivered]() { delivered += 100; }, token);
+    delete gone;
+    token.cancel();
+
+    QTRY_COMPARE(scheduler.stats().pendingDeliveries, 0);
+    QCOMPARE(delivered, 10);
+}
+
+void TestScheduler::dropsResultsWithoutContext() {
+    Scheduler scheduler(2);
+    std::atomic<bool> release{false};
+    std::atomic<int> worked{0};
+    int done = 0;
+
+    // The context goes away while the work is still running
+    auto gone = new QObject;
+    QObject kept;
+    auto work = [&release, &worked]() {
+        while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return worked += 1;
+    };
+    scheduler.run(Priority::Visible, gone, work, [&done](int) { done += 1; });
+    scheduler.run(Priority::Visible, &kept, work, [&done](int) { done += 10; });
+    scheduler.run(Priority::Visible, nullptr, work, [&done](int) { done += 100; });
+    delete gone;
+    release = true;
+
+    QTRY_COMPARE(worked.load(), 3);
+    QTRY_COMPARE(scheduler.stats().pendingDeliveries, 0);
+    QTRY_COMPARE(done, 110);
+    QTest::qWait(10);
+    QCOMPARE(done, 110);
+}
+
+void TestScheduler::searchFinishesOnce() {
+    auto list = games(100);
+    std::atomic<int> hits{0}, scanned{0}, finished{0};
+    std::atomic<bool> cancelled{true};
+
+    PositionSearch search(list, SearchQuery::samePosition(*Position::fromFen(
+            "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2")));
+    search.start([&](QVector<SearchHit> batch, int total) {
+        hits += static_cast<int>(batch.count());
+        int seen = scanned.load();
+        while (total > seen && !scanned.compare_exchange_weak(seen, total)) {}
+    }, [&](bool wasCancelled) {
+        cancelled = wasCancelled;
+        finished += 1;
+    });
+
+    QTRY_COMPARE(finished.load(), 1);
+    QVERIFY(!cancelled);
+    QCOMPARE(scanned.load(), 100);
+    QCOMPARE(hits.load(), 50);
+}
+
+void TestScheduler::searchCancelsWithoutWaiting() {
+    auto list = games(200);
+    auto calls = std::make_shared<std::atomic<int>>(0);
+    std::atomic<int> finished{0};
+    std::atomic<bool> cancelled{false};
+
+    // Every worker busy, so no chunk starts before the search is cancelled
+    auto &scheduler = Scheduler::instance();
+    auto release = std::make_shared<std::atomic<bool>>(false);
+    auto busy = std::make_shared<std::atomic<int>>(0);
+    for (int idx = 0; idx < scheduler.threadCount(); idx += 1) {
+        scheduler.submit(Priority::Interactive, [release, busy]() {
+            *busy += 1;
+            while (!*release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    }
+    QTRY_COMPARE(busy->load(), scheduler.threadCount());
+
+    auto search = std::make_unique<PositionSearch>(list, SearchQuery::sameMaterial(Position()));
+    search->start([calls](QVector<SearchHit>, int) { *calls += 1; }, [&](bool wasCancelled) {
+        cancelled = wasCancelled;
+        finished += 1;
+    });
+
+    // Finished is reported by cancel() itself, not by the last chunk, and
+    // the destructor returns with every chunk still queued
+    search->cancel();
+    QCOMPARE(finished.load(), 1);
+    QVERIFY(cancelled);
+    search.reset();
+
+    // The queued chunks are dropped without calling back
+    auto visible = [&scheduler]() {
+        return scheduler.stats().classes[static_cast<int>(Priority::Visible)];
+    };
+    auto before = visible().cancelled;
+    *release = true;
+    QTRY_COMPARE(visible().cancelled - before, qint64((200 + 15) / 16));
+    QCOMPARE(calls->load(), 0);
+    QCOMPARE(finished.load(), 1);
+}
+
+QTEST_GUILESS_MAIN(TestScheduler)
+
+#include "tst_scheduler.moc"
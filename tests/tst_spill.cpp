@@ -0,0 +1,183 @@
+#include <QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "disboard.h"
+#include "testutil.h"
+
+using namespace disboard;
+
+namespace {
+    // Everything a handle answers, to compare before and after a round trip
+    struct Snapshot {
+        QVector<QUuid> nodes;
+        QVector<int> parents;
+        QVector<Move> moves;
+        QVector<std::optional<QUuid>> prev;
+        QVector<QVector<QUuid>> siblings;
+        QStringList sans;
+        QString pgn;
+    };
+
+    Snapshot snapshot(const Disboard &board) {
+        Snapshot shot;
+        for (const auto &entry: board.nodes()) {
+            shot.nodes.push_back(entry.node);
+            shot.parents.push_back(entry.parent);
+            shot.moves.push_back(entry.move);
+            shot.prev.push_back(board.prevNode(entry.node));
+            shot.siblings.push_back(board.siblings(entry.node));
+            shot.sans.push_back(board.san(entry.node));
+        }
+        shot.pgn = board.pgn();
+        return shot;
+    }
+
+    void compare(const Snapshot &actual, const Snapshot &expected) {
+        QCOMPARE(actual.nodes, expected.nodes);
+        QCOMPARE(actual.parents, expected.parents);
+        QCOMPARE(actual.moves, expected.moves);
+        QCOMPARE(actual.prev, expected.prev);
+        QCOMPARE(actual.siblings, expected.siblings);
+        QCOMPARE(actual.sans, expected.sans);
+        QCOMPARE(actual.pgn, expected.pgn);
+    }
+}
+
+// Node handles across spill() and the fault-in that reads the tree back
+// with new ids on the Rust side
+class TestSpill : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void keepsHandles();
+    void growsAfterFaultIn();
+    void editsAfterFaultIn();
+    void spillsTwice();
+    void keepsDamagedFile();
+
+private:
+    std::unique_ptr<QTemporaryDir> dir;
+    QString path;
+
+    static Disboard sample();
+};
+
+void TestSpill::init() {
+    dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(dir->isValid());
+    path = dir->filePath(QStringLiteral("tree.spill"));
+}
+
+Disboard TestSpill::sample() {
+    auto board = *Disboard::fromFen("rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 1 2");
+    auto mainline = play(board, board.root(), {"c4", "e6", "Nc3", "Bb4"});
+    play(board, board.root(), {"Nf3", "d5", "g3"});
+    play(board, mainline[1], {"Nf3", "b6"});
+    play(board, mainline[0], {"g6", "Nc3", "d5"});
+    board.annotations().setPgnComment(mainline[3], "Nimzo [%clk 0:09:58.250]");
+    return board;
+}
+
+void TestSpill::keepsHandles() {
+    auto board = sample();
+    auto before = snapshot(board);
+
+    QVERIFY(board.spill(path));
+    QVERIFY(!board.resident());
+    QVERIFY(QFile::exists(path));
+    QVERIFY(board.spilledBytes() > 0);
+
+    // The first query reads it back in, under the handles given out before
+    compare(snapshot(board), before);
+    QVERIFY(board.resident());
+    QVERIFY(!QFile::exists(path));
+    QCOMPARE(board.annotations().clock(before.nodes[4]), 598250);
+}
+
+void TestSpill::growsAfterFaultIn() {
+    auto board = sample();
+    auto mainline = board.mainlineFrom(board.root());
+    QVERIFY(board.spill(path));
+
+    // A move added to an old handle gets a handle of its own that resolves
+    // like any other
+    auto added = play(board, mainline.back(), {"e3"});
+    QCOMPARE(added.count(), 1);
+    QCOMPARE(board.prevNode(added[0]), std::optional<QUuid>(mainline.back()));
+    QCOMPARE(board.nextMainlineNode(mainline.back()), std::optional<QUuid>(added[0]));
+    QCOMPARE(board.san(added[0]), QStringLiteral("e3"));
+    QCOMPARE(board.mainlineNodes(board.root()), mainline.mid(1) + added);
+
+    // The same move again is the node already there
+    QCOMPARE(board.addNode(mainline.back(), board.parseMoves(mainline.back(), {"e3"}).front()), added[0]);
+}
+
+void TestSpill::editsAfterFaultIn() {
+    auto board = sample();
+    auto mainline = board.mainlineFrom(board.root());
+    auto sideline = board.siblings(mainline[1]);
+    QCOMPARE(sideline.count(), 2);
+    QVERIFY(board.spill(path));
+
+    // Edits rebuild the tree again, old and new ids alike keep working
+    auto promoted = board.promoteVariation(sideline[1]);
+    QVERIFY(!promoted.empty());
+    QCOMPARE(board.siblings(mainline[1]), (QVector<QUuid>{sideline[1], mainline[1]}));
+    auto removed = board.removeNode(mainline[1]);
+    QCOMPARE(removed.front(), mainline[1]);
+    QCOMPARE(board.siblings(sideline[1]), QVector<QUuid>{sideline[1]});
+    QCOMPARE(board.prevNode(sideline[1]), std::optional<QUuid>(board.root()));
+
+    auto before = snapshot(board);
+    QVERIFY(board.spill(path));
+    compare(snapshot(board), before);
+}
+
+void TestSpill::spillsTwice() {
+    auto board = sample();
+    auto before = snapshot(board);
+
+    // Handles that are already aliases go out and come back as themselves
+    for (int round = 0; round < 3; round += 1) {
+        QVERIFY(board.spill(path));
+        compare(snapshot(board), before);
+    }
+}
+
+void TestSpill::keepsDamagedFile() {
+    auto board = sample();
+    auto before = snapshot(board);
+    QVERIFY(board.spill(path));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    auto bytes = file.readAll();
+    QVERIFY(file.resize(bytes.size() / 2));
+    file.close();
+
+    // A truncated file is reported and left alone, the tree stays spilled
+    QTest::ignoreMessage(QtCriticalMsg, QRegularExpression(QStringLiteral("could not read spilled tree")));
+    QVERIFY(!board.restore());
+    QVERIFY(!board.resident());
+    QVERIFY(QFile::exists(path));
+
+    // So is one that is gone entirely
+    QVERIFY(QFile::remove(path));
+    QTest::ignoreMessage(QtCriticalMsg, QRegularExpression(QStringLiteral("could not read spilled tree")));
+    QVERIFY(!board.restore());
+    QVERIFY(!board.resident());
+
+    // Put back whole, it reads in as if nothing happened
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(bytes), bytes.size());
+    file.close();
+    QVERIFY(board.restore());
+    QVERIFY(!QFile::exists(path));
+    compare(snapshot(board), before);
+}
+
+QTEST_GUILESS_MAIN(TestSpill)
+
+#include "tst_spill.moc"
@@ -0,0 +1,90 @@
+#include <QtTest>
+
+#include "disboard.h"
+#include "testutil.h"
+
+using namespace disboard;
+
+// What the tree keeps next to the Rust nodes across removals
+class TestTreeEdits : public QObject {
+Q_OBJECT
+
+private slots:
+    void dropsAnnotationsOfRemoved();
+    void packsAnnotations();
+    void keepsDrawStates();
+};
+
+void TestTreeEdits::dropsAnnotationsOfRemoved() {
+    Disboard board;
+    auto e4 = play(board, board.root(), {"e4", "e5"});
+    auto d4 = play(board, board.root(), {"d4", "d5"});
+    auto &notes = board.annotations();
+    notes.setPgnComment(e4[0], "Best by test [%clk 0:05:00]");
+    notes.setPgnComment(d4[0], "Solid [%eval 0.20]");
+    notes.setPgnComment(d4[1], "[%cal Gd5d4]");
+
+    auto removed = board.removeNode(d4[0]);
+    QCOMPARE(removed, d4);
+    QVERIFY(!notes.contains(d4[0]));
+    QVERIFY(!notes.contains(d4[1]));
+    QCOMPARE(notes.comment(e4[0]), QStringLiteral("Best by test"));
+    QCOMPARE(notes.clock(e4[0]), 300000);
+    QVERIFY(!board.pgn().contains(QStringLiteral("Solid")));
+
+    board.truncate(board.root());
+    QVERIFY(notes.empty());
+}
+
+void TestTreeEdits::packsAnnotations() {
+    Disboard board;
+    auto mainline = play(board, board.root(), {"e4", "e5", "Nf3", "Nc6"});
+    auto &notes = board.annotations();
+    for (int idx = 0; idx < mainline.count(); idx += 1) {
+        notes.setPgnComment(mainline[idx], "Main " + std::to_string(idx) + " [%clk 0:01:00] [%cal Ge2e4]");
+    }
+
+    // Sidelines annotated and cut again, more than half of all slots
+    QVector<QUuid> sidelines;
+    for (const auto &san: {"a3", "a4", "b3", "b4", "c3", "c4", "d3", "d4", "f3", "f4", "g3", "g4", "h3", "h4"}) {
+        auto node = play(board, board.root(), {san}).front();
+        notes.setPgnComment(node, std::string("Side ") + san + " [%eval -0.50] [%cal Rd7d5,Ya2a3]");
+        sidelines.push_back(node);
+    }
+    auto memory = notes.memoryBytes();
+    for (auto node: sidelines) QCOMPARE(board.removeNode(node).count(), 1);
+
+    QVERIFY(notes.memoryBytes() < memory);
+    for (int idx = 0; idx < mainline.count(); idx += 1) {
+        QCOMPARE(notes.comment(mainline[idx]), QStringLiteral("Main %1").arg(idx));
+        QCOMPARE(notes.clock(mainline[idx]), 60000);
+        QCOMPARE(notes.arrows(mainline[idx]).count(), 1);
+    }
+    QCOMPARE(notes.clocks(mainline), QVector<int32_t>(mainline.count(), 60000));
+
+    // Slots handed out after the packing do not collide with the old ones
+    auto node = play(board, mainline.back(), {"Bb5"}).front();
+    notes.setComment(node, "Ruy Lopez");
+    QCOMPARE(notes.comment(node), QStringLiteral("Ruy Lopez"));
+    QCOMPARE(notes.comment(mainline.back()), QStringLiteral("Main 3"));
+}
+
+void TestTreeEdits::keepsDrawStates() {
+    Disboard board;
+    auto shuffle = play(board, board.root(), {"Nf3", "Nf6", "Ng1", "Ng8", "Nf3", "Nf6", "Ng1", "Ng8"});
+    QCOMPARE(board.status(shuffle.back()).repetitions, 3);
+
+    auto side = play(board, shuffle[3], {"e4", "e5"});
+    QCOMPARE(board.status(side.back()).halfmoves, 0);
+    board.removeNode(side.front());
+
+    // Replayed after the removal, and nodes added later are tracked again
+    QCOMPARE(board.status(shuffle.back()).repetitions, 3);
+    auto more = play(board, shuffle.back(), {"Nf3"});
+    QCOMPARE(board.status(more.front()).repetitions, 3);
+    QCOMPARE(board.status(more.front()).halfmoves, 9);
+}
+
+QTEST_GUILESS_MAIN(TestTreeEdits)
+
+#include "tst_treeedits.moc"